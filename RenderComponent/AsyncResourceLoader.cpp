@@ -0,0 +1,162 @@
+#include <OpenGLFramework\Components\RenderComponent\AsyncResourceLoader.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\OBJMeshCache.h>
+#include <chrono>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+namespace {
+	double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+};
+
+AsyncResourceLoader::AsyncResourceLoader() : stopping(false), numThreads(0) {
+	memset(&stats, 0, sizeof(stats));
+	//The caches used by loadResourcesToMainMemory are created before us, so they are destroyed after us (and after our workers)
+	GPUAssetCache::instance();
+	OBJMeshCache::instance();
+}
+
+AsyncResourceLoader::~AsyncResourceLoader() {
+	shutdown();
+}
+
+AsyncResourceLoader& AsyncResourceLoader::instance() {
+	static AsyncResourceLoader _instance;
+	return _instance;
+}
+
+void AsyncResourceLoader::startWorkers() {
+	unsigned int threads = numThreads;
+	if (threads == 0) {
+		unsigned int cores = std::thread::hardware_concurrency();
+		threads = (cores > 1) ? cores - 1 : 1;		//Leave one core for the thread that renders
+	}
+	for (unsigned int i = 0; i < threads; i++)
+		workers.push_back(std::thread(&AsyncResourceLoader::workerLoop, this));
+}
+
+void AsyncResourceLoader::load(OpenGL_Renderable* renderable, CompletionCallback onComplete) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping) {
+			renderable->setResourceState(OpenGL_Renderable::FAILED);
+			return;
+		}
+		renderable->setResourceState(OpenGL_Renderable::LOADING);
+		if (workers.empty())
+			startWorkers();
+		Job job = { renderable, onComplete, false };
+		pendingLoads.push_back(job);
+		stats.requested++;
+	}
+	workAvailable.notify_one();
+}
+
+void AsyncResourceLoader::workerLoop() {
+	OPENGLFRAMEWORK_PROFILE_THREAD_NAME("Resource loader");
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping && pendingLoads.empty())
+				workAvailable.wait(lock);
+			if (stopping)
+				return;
+			job = pendingLoads.front();
+			pendingLoads.pop_front();
+		}
+		//Phase 1, in parallel with other workers (CPU only, no OpenGL)
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		job.loaded = job.renderable->loadResourcesToMainMemory();		//Profiled by the renderable itself, as when it is loaded by hand
+		job.renderable->setResourceState(job.loaded ? OpenGL_Renderable::LOADED : OpenGL_Renderable::FAILED);
+		double seconds = secondsSince(start);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.loadSeconds += seconds;
+			if (job.loaded) stats.loaded++;
+			pendingUploads.push_back(job);		//Failed jobs also go here, so the callbacks are called from the OpenGL thread
+		}
+		uploadAvailable.notify_all();
+	}
+}
+
+unsigned int AsyncResourceLoader::processUploads(double budgetSeconds) {
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	unsigned int processed = 0;
+	do {
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (pendingUploads.empty())
+				break;
+			job = pendingUploads.front();
+			pendingUploads.pop_front();
+		}
+		//Phase 2, in this (OpenGL) thread
+		bool success = job.loaded;
+		double uploadSeconds = 0;
+		if (success) {
+			std::chrono::high_resolution_clock::time_point uploadStart = std::chrono::high_resolution_clock::now();
+			success = job.renderable->allocateOpenGLResources();
+			uploadSeconds = secondsSince(uploadStart);
+		}
+		job.renderable->setResourceState(success ? OpenGL_Renderable::READY : OpenGL_Renderable::FAILED);
+		unsigned int finished, requested;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.uploadSeconds += uploadSeconds;	//getStatistics may be reading it from another thread
+			if (success) stats.ready++;
+			else stats.failed++;
+			finished = stats.ready + stats.failed;
+			requested = stats.requested;
+		}
+		processed++;
+		if (job.onComplete) job.onComplete(job.renderable, success);
+		if (onProgress) onProgress(finished, requested);
+	} while (secondsSince(start) < budgetSeconds);
+	//Uploads change OpenGL state behind RenderState's back (textures, buffers, VAOs)
+	if (processed > 0)
+		RenderState::instance().invalidate();
+	return processed;
+}
+
+void AsyncResourceLoader::shutdown() {
+	std::vector<std::thread> stopped;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		stopped.swap(workers);
+		//Renderables not started yet are dropped (they stay LOADING, and are never rendered)
+		stats.requested -= (unsigned int)pendingLoads.size();
+		pendingLoads.clear();
+	}
+	workAvailable.notify_all();
+	for (size_t i = 0; i < stopped.size(); i++)
+		stopped[i].join();		//Lets the renderables being loaded finish
+}
+
+void AsyncResourceLoader::finishAll() {
+	while (true) {
+		processUploads(1.0);
+		std::unique_lock<std::mutex> lock(mutex);
+		if (stats.ready + stats.failed == stats.requested)
+			return;
+		if (pendingUploads.empty())
+			uploadAvailable.wait(lock);		//Workers are still busy
+	}
+}
+
+bool AsyncResourceLoader::isIdle() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats.ready + stats.failed == stats.requested;
+}
+
+AsyncResourceLoader::Statistics AsyncResourceLoader::getStatistics() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
@@ -0,0 +1,103 @@
+/**********************************************************************
+NAME: AsyncResourceLoader
+DESCRIPTION: Loads renderables in the background, so the application can start rendering before everything is loaded.
+	OpenGL_Renderable splits its initialization in two phases, and we run each one where it belongs:
+		1. loadResourcesToMainMemory() only uses the CPU (reading files, parsing, welding...). A pool of worker threads 
+		runs it for many renderables at once.
+		2. allocateOpenGLResources() needs OpenGL, which can only be used from the thread that owns the context. 
+		Renderables that finished phase 1 wait in a queue, and the application calls processUploads() once per frame 
+		(in its OpenGL thread) to run phase 2 for as many of them as fit in a time budget (e.g. 2 ms).
+	Renderables being loaded are not rendered (see OpenGL_Renderable::isReadyToRender); they simply pop into the scene 
+	when they are ready. Callbacks (always called from processUploads, i.e., from the OpenGL thread) report each 
+	renderable finished and the overall progress (e.g. to show a loading bar).
+	Usage: 
+		AsyncResourceLoader::instance().load(renderable);			//Instead of loadResources... + allocateOpenGL...
+		...
+		AsyncResourceLoader::instance().processUploads(0.002);		//Every frame, before rendering
+		...
+		AsyncResourceLoader::instance().shutdown();					//Before main returns
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_ASYNCRESOURCELOADER
+#define _OPENGLFRAMEWORK_ASYNCRESOURCELOADER
+#include "OpenGLFRameworkPrerequisites.h"
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace OpenGLFramework {
+	class OpenGL_Renderable;		//Forward declaration
+
+	class AsyncResourceLoader {
+	public:
+		//Called when a renderable is ready to render (success = true) or failed to load
+		typedef std::function<void(OpenGL_Renderable* renderable, bool success)> CompletionCallback;
+		//Called after each renderable finishes: how many have finished, out of how many requested so far
+		typedef std::function<void(unsigned int finished, unsigned int requested)> ProgressCallback;
+		struct Statistics {
+			unsigned int requested;			//Renderables passed to load()
+			unsigned int loaded;			//Finished phase 1 (main memory)
+			unsigned int ready;				//Finished phase 2 (ready to render)
+			unsigned int failed;
+			double loadSeconds;				//Time spent in phase 1, added up over all the threads
+			double uploadSeconds;			//Time spent in phase 2
+		};
+	private:
+		struct Job {
+			OpenGL_Renderable* renderable;
+			CompletionCallback onComplete;
+			bool loaded;					//Result of phase 1
+		};
+		std::vector<std::thread> workers;
+		std::deque<Job> pendingLoads;		//Waiting for phase 1
+		std::deque<Job> pendingUploads;		//Waiting for phase 2
+		std::mutex mutex;
+		std::condition_variable workAvailable, uploadAvailable;
+		bool stopping;
+		unsigned int numThreads;
+		ProgressCallback onProgress;
+		Statistics stats;
+		AsyncResourceLoader();
+		~AsyncResourceLoader();
+		void startWorkers();
+		void workerLoop();
+	public:
+		static AsyncResourceLoader& instance();
+		/**
+			Number of worker threads (0 = one per core, minus the one rendering). Only has effect before the first load().
+		*/
+		inline void setNumThreads(unsigned int threads) { numThreads = threads; }
+		inline void setProgressCallback(ProgressCallback callback) { onProgress = callback; }
+		/**
+			Queues a renderable to be loaded. It will not be rendered until it is ready.
+		*/
+		void load(OpenGL_Renderable* renderable, CompletionCallback onComplete = CompletionCallback());
+		/**
+			Runs phase 2 (allocateOpenGLResources) for the renderables waiting for it, until the time budget runs out
+			(at least one renderable is processed per call, if any is waiting). Call it from the OpenGL thread, once per frame.
+			Returns the number of renderables processed.
+		*/
+		unsigned int processUploads(double budgetSeconds);
+		/**
+			Blocks until everything requested so far is ready (e.g. for a loading screen, or before taking a screenshot).
+			Call it from the OpenGL thread.
+		*/
+		void finishAll();
+		/**
+			True if nothing is waiting to be loaded or uploaded.
+		*/
+		bool isIdle();
+		Statistics getStatistics();
+		/**
+			Stops the workers, waiting for the renderables they are loading (the ones not started yet are dropped, and 
+			further calls to load() fail). Call it before main returns, while the renderables and the other singletons 
+			(GPUAssetCache, OBJMeshCache...) still exist: the destructor does it too, but during static destruction, when 
+			those may already be gone.
+		*/
+		void shutdown();
+	};
+};
+#endif
@@ -0,0 +1,55 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+namespace {
+	unsigned int numFailures = 0;
+
+	bool byName(const Benchmark* a, const Benchmark* b) {
+		return strcmp(a->getName(), b->getName()) < 0;
+	}
+};
+
+std::vector<Benchmark*>& Benchmark::registered() {
+	static std::vector<Benchmark*> cases;	//Created on first use: cases register themselves during static initialisation
+	return cases;
+}
+
+Benchmark::Benchmark(const char* name, const char* description, Function function) : name(name), description(description), function(function) {
+	registered().push_back(this);
+}
+
+std::vector<const Benchmark*> Benchmark::getAll() {
+	std::vector<const Benchmark*> all(registered().begin(), registered().end());
+	std::sort(all.begin(), all.end(), byName);
+	return all;
+}
+
+void Benchmark::report(const char* what, const char* format, ...) {
+	printf("  %s: ", what);
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+	fflush(stdout);
+}
+
+void Benchmark::fail(const char* format, ...) {
+	printf("  MISMATCH: ");
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+	fflush(stdout);
+	numFailures++;
+}
+
+unsigned int Benchmark::getNumFailures() {
+	return numFailures;
+}
@@ -0,0 +1,90 @@
+/**********************************************************************
+NAME: Benchmark
+DESCRIPTION: Measurements of the render components, run by RenderBenchmark (a small executable that needs no window,
+	no OpenGL context and no scene files: see RenderBenchmark.cpp). Each feature that is there to make something faster
+	has a case here, which builds its own synthetic data, times the old way and the new way (or the new way at several
+	sizes), checks they give the same results, and prints what it measured. A case is a function registered with the
+	macro below, in its own .cpp file in this folder:
+		OPENGLFRAMEWORK_BENCHMARK(MeshPicker, "Ray/triangle picking, BVH vs brute force") {
+			size_t triangles = settings.scaled(100000);
+			...
+			Benchmark::report("pick", "%.0f rays/s", rays / seconds);
+		}
+	Sizes go through settings.scaled(), so "--scale 0.1" gives a quick run and "--scale 10" a long one. Timed loops
+	use Benchmark::best, which takes the fastest of settings.repeats runs (the least disturbed by the rest of the machine).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_BENCHMARK
+#define _OPENGLFRAMEWORK_BENCHMARK
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+#include <string>
+#include <chrono>
+
+namespace OpenGLFramework {
+	class Benchmark {
+	public:
+		struct Settings {
+			double scale;					//Multiplies the sizes of all the cases (1 by default)
+			unsigned int repeats;			//Runs of each timed loop (the best one is reported)
+			unsigned int maxThreads;		//For cases that use threads (0: one per core)
+			inline size_t scaled(size_t size) const { size_t s = (size_t)(size * scale); return s > 0 ? s : 1; }
+		};
+		typedef void (*Function)(const Settings& settings);
+		class Timer {
+			std::chrono::high_resolution_clock::time_point start;
+		public:
+			inline Timer() : start(std::chrono::high_resolution_clock::now()) { ; }
+			inline void restart() { start = std::chrono::high_resolution_clock::now(); }
+			inline double seconds() const { return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count(); }
+		};
+	private:
+		const char* name;
+		const char* description;
+		Function function;
+		static std::vector<Benchmark*>& registered();
+	public:
+		/**
+			Registers a case (use OPENGLFRAMEWORK_BENCHMARK, which creates one of these as a static object).
+		*/
+		Benchmark(const char* name, const char* description, Function function);
+		inline const char* getName() const { return name; }
+		inline const char* getDescription() const { return description; }
+		inline void run(const Settings& settings) const { function(settings); }
+		/**
+			All the cases linked into the executable, sorted by name.
+		*/
+		static std::vector<const Benchmark*> getAll();
+		/**
+			Runs code settings.repeats times, and returns the seconds taken by the fastest run.
+		*/
+		template <class Code> static double best(const Settings& settings, Code code) {
+			double bestSeconds = 0;
+			for (unsigned int i = 0; i < settings.repeats || i == 0; i++) {
+				Timer timer;
+				code();
+				double seconds = timer.seconds();
+				if (i == 0 || seconds < bestSeconds)
+					bestSeconds = seconds;
+			}
+			return bestSeconds;
+		}
+		/**
+			Prints one measurement of the case being run, as "  <what>: <value>" (value formatted as in printf).
+		*/
+		static void report(const char* what, const char* format, ...);
+		/**
+			Prints a mismatch between the fast path and the reference one, and remembers it: RenderBenchmark fails
+			(returns 1) if any case found one.
+		*/
+		static void fail(const char* format, ...);
+		static unsigned int getNumFailures();
+	};
+};
+
+#define OPENGLFRAMEWORK_BENCHMARK(caseName, caseDescription) \
+	static void benchmark_##caseName(const OpenGLFramework::Benchmark::Settings& settings); \
+	static OpenGLFramework::Benchmark benchmarkRegistration_##caseName(#caseName, caseDescription, benchmark_##caseName); \
+	static void benchmark_##caseName(const OpenGLFramework::Benchmark::Settings& settings)
+
+#endif
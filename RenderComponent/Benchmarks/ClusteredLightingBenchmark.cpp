@@ -0,0 +1,144 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\ClusteredLighting.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cfloat>
+#include <cstdio>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Fixed sequence of random numbers in [0, 1), the same in every run
+	struct Random {
+		unsigned int seed;
+		Random(unsigned int seed) : seed(seed) { ; }
+		inline float next() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; }
+	};
+
+	struct Box { glm::vec3 minimum, maximum; };
+
+	//View space box around each cluster of a perspective projection, as ClusteredLighting builds them
+	std::vector<Box> getClusterBoxes(const glm::mat4& P, const glm::vec4& depthParameters) {
+		const unsigned int X = ClusteredLighting::CLUSTERS_X, Y = ClusteredLighting::CLUSTERS_Y, Z = ClusteredLighting::CLUSTERS_Z;
+		float nearPlane = depthParameters.x, farPlane = depthParameters.y;
+		std::vector<Box> boxes(ClusteredLighting::NUM_CLUSTERS);
+		for (unsigned int z = 0; z < Z; z++) {
+			float depth[2];
+			for (unsigned int s = 0; s < 2; s++)
+				depth[s] = nearPlane * std::pow(farPlane / nearPlane, (float)(z + s) / Z);
+			for (unsigned int y = 0; y < Y; y++)
+				for (unsigned int x = 0; x < X; x++) {
+					Box& box = boxes[x + X * (y + Y * z)];
+					box.minimum = glm::vec3(FLT_MAX, FLT_MAX, -depth[1]);
+					box.maximum = glm::vec3(-FLT_MAX, -FLT_MAX, -depth[0]);
+					for (unsigned int corner = 0; corner < 8; corner++) {
+						float nx = -1 + 2.0f * (x + (corner & 1)) / X, ny = -1 + 2.0f * (y + ((corner >> 1) & 1)) / Y;
+						float d = depth[corner >> 2];
+						glm::vec2 p((nx + P[2][0]) * d / P[0][0], (ny + P[2][1]) * d / P[1][1]);
+						box.minimum = glm::vec3(std::min(box.minimum.x, p.x), std::min(box.minimum.y, p.y), box.minimum.z);
+						box.maximum = glm::vec3(std::max(box.maximum.x, p.x), std::max(box.maximum.y, p.y), box.maximum.z);
+					}
+				}
+		}
+		return boxes;
+	}
+
+	//Is the light (view space) out of the tile of the screen, i.e. beyond one of the 4 planes through the camera around it?
+	bool outsideTile(const glm::mat4& P, const glm::vec3& position, float radius, unsigned int x, unsigned int y) {
+		const unsigned int cells[2] = { ClusteredLighting::CLUSTERS_X, ClusteredLighting::CLUSTERS_Y };
+		const unsigned int tile[2] = { x, y };
+		for (int c = 0; c < 2; c++) {
+			for (unsigned int side = 0; side < 2; side++) {
+				//Points of the plane at ndc = n satisfy P[c][c] * p[c] + (n + P[2][c]) * p.z = 0 (positive towards larger ndc)
+				float n = -1 + 2.0f * (tile[c] + side) / cells[c];
+				float distance = (P[c][c] * position[c] + (n + P[2][c]) * position.z) / sqrtf(P[c][c] * P[c][c] + (n + P[2][c]) * (n + P[2][c]));
+				if ((side == 0 && distance < -radius) || (side == 1 && distance > radius))
+					return true;
+			}
+		}
+		return false;
+	}
+};
+
+//Assigning 100, 1000 and 5000 point lights (scattered in front of the camera, 2 to 5 units of radius) to the clusters
+//of the view frustum, as the RenderableVisitor does every frame: ClusteredLighting::update on one thread and on all
+//of them, vs testing every light against every cluster. Also how many lights each fragment loops over, instead of all.
+OPENGLFRAMEWORK_BENCHMARK(ClusteredLighting, "Light assignment per frame for 100/1000/5000 lights: clustered vs every light against every cluster") {
+	const size_t sizes[3] = { settings.scaled(100), settings.scaled(1000), settings.scaled(5000) };
+	float top = 0.1f * tanf(0.5236f), right = top * 16 / 9;
+	glm::mat4 P = glm::frustum(-right, right, -top, top, 0.1f, 1000.0f);
+	glm::mat4 V = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+	ClusteredLighting& lighting = ClusteredLighting::instance();
+	std::vector<ClusteredLighting::PointLight> previousLights = lighting.getLights();
+	lighting.acquire();
+	for (int s = 0; s < 3; s++) {
+		size_t numLights = sizes[s];
+		Random random((unsigned int)numLights);
+		std::vector<ClusteredLighting::PointLight>& lights = lighting.getLights();
+		lights.clear();
+		for (size_t i = 0; i < numLights; i++) {
+			float x = random.next(), y = random.next(), z = random.next();
+			glm::vec3 colour(random.next(), random.next(), random.next());
+			lights.push_back(ClusteredLighting::createLight(glm::vec3(120 * x - 60, 60 * y - 30, -150 * z), colour, 0.016f + 0.08f * random.next()));
+		}
+		//1. Clustered assignment (and upload), on one thread and on all of them
+		double seconds[2];
+		ClusteredLighting::Statistics stats[2];
+		for (int way = 0; way < 2; way++) {
+			lighting.setMaxThreads(way == 0 ? 1 : settings.maxThreads);
+			seconds[way] = Benchmark::best(settings, [&]() { lighting.update(P, V); stats[way] = lighting.getStatistics(); });
+		}
+		lighting.setMaxThreads(0);
+		//2. Every light against every cluster
+		std::vector<Box> boxes = getClusterBoxes(P, lighting.getDepthParameters());
+		std::vector<std::vector<unsigned int> > bruteForce(ClusteredLighting::NUM_CLUSTERS);
+		double bruteSeconds = Benchmark::best(settings, [&]() {
+			std::vector<glm::vec3> viewPositions(lights.size());
+			for (size_t l = 0; l < lights.size(); l++)
+				viewPositions[l] = glm::vec3(V * glm::vec4(lights[l].position, 1));
+			for (unsigned int c = 0; c < ClusteredLighting::NUM_CLUSTERS; c++) {
+				bruteForce[c].clear();
+				for (unsigned int l = 0; l < lights.size(); l++) {
+					glm::vec3 d = glm::clamp(viewPositions[l], boxes[c].minimum, boxes[c].maximum) - viewPositions[l];
+					if (glm::dot(d, d) <= lights[l].radius * lights[l].radius)
+						bruteForce[c].push_back(l);
+				}
+			}
+		});
+		//3. The clustered lists may only leave out lights whose box test was a false positive: the box around a cluster
+		//is bigger than the cluster, and the light is out of its tile on screen
+		unsigned int wrongPairs = 0, falsePositives = 0;
+		for (unsigned int z = 0; z < ClusteredLighting::CLUSTERS_Z; z++)
+			for (unsigned int y = 0; y < ClusteredLighting::CLUSTERS_Y; y++)
+				for (unsigned int x = 0; x < ClusteredLighting::CLUSTERS_X; x++) {
+					std::vector<unsigned int> clustered = lighting.getClusterLights(x, y, z);
+					const std::vector<unsigned int>& all = bruteForce[x + ClusteredLighting::CLUSTERS_X * (y + ClusteredLighting::CLUSTERS_Y * z)];
+					std::sort(clustered.begin(), clustered.end());
+					for (size_t i = 0; i < clustered.size(); i++)
+						if (!std::binary_search(all.begin(), all.end(), clustered[i]))
+							wrongPairs++;		//Its sphere does not even touch the box
+					for (size_t i = 0; i < all.size(); i++)
+						if (!std::binary_search(clustered.begin(), clustered.end(), all[i])) {
+							if (outsideTile(P, glm::vec3(V * glm::vec4(lights[all[i]].position, 1)), lights[all[i]].radius, x, y))
+								falsePositives++;
+							else wrongPairs++;		//It reaches the cluster, but the cluster does not list it
+						}
+				}
+		if (wrongPairs)
+			Benchmark::fail("%u light-cluster pairs differ from testing every light against every cluster", wrongPairs);
+		char what[64];
+		sprintf(what, "%u lights", (unsigned int)numLights);
+		Benchmark::report(what, "%u in the frustum, %u light-cluster pairs, %.1f lights per lit cluster (at most %u) instead of %u", stats[1].lightsInFrustum
+			, stats[1].lightClusterPairs, stats[1].clustersLit ? (double)stats[1].lightClusterPairs / stats[1].clustersLit : 0.0, stats[1].maxLightsPerCluster
+			, (unsigned int)numLights);
+		sprintf(what, "%u lights, update", (unsigned int)numLights);
+		Benchmark::report(what, "%.3f ms on 1 thread, %.3f ms on all (assignment %.3f ms, upload %.3f ms, %u KB)", 1000 * seconds[0], 1000 * seconds[1]
+			, 1000 * stats[1].assignSeconds, 1000 * stats[1].uploadSeconds, (unsigned int)(stats[1].bytesUploaded / 1024));
+		sprintf(what, "%u lights, every light", (unsigned int)numLights);
+		Benchmark::report(what, "%.3f ms (%.0fx slower than 1 thread), %u more pairs (lights out of the tile, but touching the box around the cluster)"
+			, 1000 * bruteSeconds, bruteSeconds / seconds[0], falsePositives);
+	}
+	lighting.getLights() = previousLights;
+	lighting.release();
+}
@@ -0,0 +1,140 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\DynamicAABBTree.h>
+#include <cmath>
+#include <cstdio>
+#include <cfloat>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Fixed sequence of random numbers in [0, 1), the same in every run
+	struct Random {
+		unsigned int seed;
+		Random(unsigned int seed) : seed(seed) { ; }
+		inline float next() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; }
+		inline glm::vec3 point(float size) { float x = next(), y = next(); return glm::vec3(x, y, next()) * size; }
+	};
+
+	const unsigned int NUM_QUERIES = 200;
+	const unsigned int NUM_FRAMES = 10;
+};
+
+//Spatial queries over N objects (unit boxes scattered in a volume that grows with N, so the density is the same at
+//every size), with the DynamicAABBTree and with a linear scan of all the boxes (what picking object by object did):
+//closest box along a ray, boxes overlapping a box, and nearest box to a point. Also the cost of moving 10% of the
+//objects each frame (the linear scan has nothing to update).
+OPENGLFRAMEWORK_BENCHMARK(DynamicAABBTree, "Ray, box and nearest queries over 1k/10k/100k objects: BVH vs linear scan") {
+	const size_t sizes[3] = { settings.scaled(1000), settings.scaled(10000), settings.scaled(100000) };
+	for (int s = 0; s < 3; s++) {
+		size_t numObjects = sizes[s];
+		float side = 4.0f * powf((float)numObjects, 1.0f / 3);
+		Random random(numObjects);
+		std::vector<AABB> boxes(numObjects);
+		for (size_t i = 0; i < numObjects; i++) {
+			glm::vec3 corner = random.point(side);
+			boxes[i] = AABB(corner, corner + glm::vec3(1));
+		}
+		//1. Building the tree, and moving some objects each frame
+		DynamicAABBTree tree;
+		std::vector<int> proxies(numObjects);
+		double buildSeconds = Benchmark::best(settings, [&]() {
+			tree.clear();
+			for (size_t i = 0; i < numObjects; i++)
+				proxies[i] = tree.createProxy(boxes[i], (void*)i);
+		});
+		unsigned int reinserted = 0;
+		Benchmark::Timer timer;
+		for (unsigned int frame = 0; frame < NUM_FRAMES; frame++)
+			for (size_t i = frame % 10; i < numObjects; i += 10) {
+				glm::vec3 offset = random.point(0.1f) - glm::vec3(0.05f);	//Small steps, as objects move from one frame to the next
+				boxes[i] = AABB(boxes[i].min + offset, boxes[i].max + offset);
+				if (tree.moveProxy(proxies[i], boxes[i]))
+					reinserted++;
+			}
+		double updateSeconds = timer.seconds() / NUM_FRAMES;
+		//2. The queries
+		std::vector<glm::vec3> origins(NUM_QUERIES), directions(NUM_QUERIES), points(NUM_QUERIES);
+		std::vector<AABB> queryBoxes(NUM_QUERIES);
+		for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+			origins[q] = random.point(side);
+			directions[q] = glm::normalize(random.point(2) - glm::vec3(1));
+			points[q] = random.point(side);
+			glm::vec3 corner = random.point(side);
+			queryBoxes[q] = AABB(corner, corner + glm::vec3(5));
+		}
+		std::vector<float> treeHit(NUM_QUERIES), scanHit(NUM_QUERIES), treeNearest(NUM_QUERIES), scanNearest(NUM_QUERIES);
+		std::vector<unsigned int> treeOverlaps(NUM_QUERIES), scanOverlaps(NUM_QUERIES);
+		double treeSeconds[3], scanSeconds[3];
+		treeSeconds[0] = Benchmark::best(settings, [&]() {
+			for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+				glm::vec3 invDir(1.0f / directions[q].x, 1.0f / directions[q].y, 1.0f / directions[q].z);
+				float closest = FLT_MAX;
+				tree.rayCast(origins[q], directions[q], FLT_MAX, [&](int proxy, float maxT) -> float {
+					float t = boxes[(size_t)tree.getUserData(proxy)].intersectRay(origins[q], invDir, maxT);
+					if (t >= 0 && t < closest) closest = t;
+					return closest < maxT ? closest : maxT;
+				});
+				treeHit[q] = closest;
+			}
+		});
+		scanSeconds[0] = Benchmark::best(settings, [&]() {
+			for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+				glm::vec3 invDir(1.0f / directions[q].x, 1.0f / directions[q].y, 1.0f / directions[q].z);
+				float closest = FLT_MAX;
+				for (size_t i = 0; i < numObjects; i++) {
+					float t = boxes[i].intersectRay(origins[q], invDir, closest);
+					if (t >= 0 && t < closest) closest = t;
+				}
+				scanHit[q] = closest;
+			}
+		});
+		treeSeconds[1] = Benchmark::best(settings, [&]() {
+			for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+				unsigned int count = 0;
+				tree.queryBox(queryBoxes[q], [&](int proxy) -> bool {
+					if (boxes[(size_t)tree.getUserData(proxy)].overlaps(queryBoxes[q])) count++;
+					return true;
+				});
+				treeOverlaps[q] = count;
+			}
+		});
+		scanSeconds[1] = Benchmark::best(settings, [&]() {
+			for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+				unsigned int count = 0;
+				for (size_t i = 0; i < numObjects; i++)
+					if (boxes[i].overlaps(queryBoxes[q])) count++;
+				scanOverlaps[q] = count;
+			}
+		});
+		treeSeconds[2] = Benchmark::best(settings, [&]() {
+			for (unsigned int q = 0; q < NUM_QUERIES; q++)
+				tree.nearest(points[q], [&](int proxy) -> float { return boxes[(size_t)tree.getUserData(proxy)].distanceSquared(points[q]); }, &treeNearest[q]);
+		});
+		scanSeconds[2] = Benchmark::best(settings, [&]() {
+			for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+				float closest = FLT_MAX;
+				for (size_t i = 0; i < numObjects; i++)
+					closest = std::min(closest, boxes[i].distanceSquared(points[q]));
+				scanNearest[q] = closest;
+			}
+		});
+		//3. Both must find the same (distances compared, as several boxes can be at the same distance)
+		unsigned int mismatches = 0;
+		for (unsigned int q = 0; q < NUM_QUERIES; q++)
+			if (treeHit[q] != scanHit[q] || treeOverlaps[q] != scanOverlaps[q] || treeNearest[q] != scanNearest[q])
+				mismatches++;
+		if (mismatches)
+			Benchmark::fail("%u of %u queries over %u objects gave different results with the tree and the linear scan", mismatches, NUM_QUERIES, (unsigned int)numObjects);
+		const char* names[3] = { "ray", "box", "nearest" };
+		char what[64];
+		sprintf(what, "%u objects", (unsigned int)numObjects);
+		Benchmark::report(what, "build %.2f ms, tree height %d, moving 10%% of them %.3f ms per frame (%.1f%% reinserted)", 1000 * buildSeconds, tree.getHeight()
+			, 1000 * updateSeconds, 100.0 * reinserted / (NUM_FRAMES * (numObjects / 10.0)));
+		for (int k = 0; k < 3; k++) {
+			sprintf(what, "%u objects, %s", (unsigned int)numObjects, names[k]);
+			Benchmark::report(what, "%.2f us per query (linear scan %.2f us, %.0fx)", 1e6 * treeSeconds[k] / NUM_QUERIES, 1e6 * scanSeconds[k] / NUM_QUERIES
+				, scanSeconds[k] / treeSeconds[k]);
+		}
+	}
+}
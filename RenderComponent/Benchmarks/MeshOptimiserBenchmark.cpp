@@ -0,0 +1,84 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshOptimiser.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshWelder.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <array>
+
+using namespace OpenGLFramework;
+
+namespace {
+	typedef std::array<float, 9> TriangleCorners;
+
+	//The triangles of a mesh, as the positions of their corners (sorted, so it does not depend on the order optimise chooses)
+	std::vector<TriangleCorners> getTriangles(const MeshData& mesh) {
+		std::vector<TriangleCorners> triangles(mesh.indices.size() / 3);
+		for (size_t t = 0; t < triangles.size(); t++) {
+			glm::vec3 corners[3] = { mesh.vertices[mesh.indices[3 * t]], mesh.vertices[mesh.indices[3 * t + 1]], mesh.vertices[mesh.indices[3 * t + 2]] };
+			//Starting at the smallest corner keeps the winding (a triangle turned around would not match)
+			int first = 0;
+			for (int c = 1; c < 3; c++)
+				if (std::make_pair(corners[c].x, std::make_pair(corners[c].y, corners[c].z)) < std::make_pair(corners[first].x, std::make_pair(corners[first].y, corners[first].z)))
+					first = c;
+			for (int c = 0; c < 3; c++) {
+				const glm::vec3& p = corners[(first + c) % 3];
+				triangles[t][3 * c] = p.x; triangles[t][3 * c + 1] = p.y; triangles[t][3 * c + 2] = p.z;
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+};
+
+//Vertex cache and fetch order of a welded mesh (a sphere), before and after MeshOptimiser::optimise: the triangles in
+//the order the welder leaves them (ring after ring, as a modelling tool would write them) and shuffled (the worst case).
+//The optimised mesh must have the same triangles, and optimising it again must give exactly the same result.
+OPENGLFRAMEWORK_BENCHMARK(MeshOptimiser, "ACMR/ATVR before and after MeshOptimiser, and its cost") {
+	unsigned int rings = (unsigned int)(200 * sqrt(settings.scale)) + 2;
+	MeshData welded;
+	SyntheticMeshes::makeSphere(rings, 2 * rings, welded.vertices, welded.uvs, welded.normals);
+	if (!MeshWelder::weld(welded.vertices, welded.uvs, welded.normals, welded.indices)) {
+		Benchmark::fail("could not weld the sphere");
+		return;
+	}
+	welded.bb = MeshStatistics::computeBoundingBox(welded.vertices);
+	MeshData shuffled = welded;
+	unsigned int seed = 777;
+	for (size_t t = shuffled.indices.size() / 3 - 1; t > 0; t--) {		//Fisher-Yates, on whole triangles
+		seed = seed * 1664525u + 1013904223u;
+		size_t other = (seed >> 8) % (t + 1);
+		for (int c = 0; c < 3; c++)
+			std::swap(shuffled.indices[3 * t + c], shuffled.indices[3 * other + c]);
+	}
+	Benchmark::report("mesh", "%u triangles, %u vertices (cache of %u vertices)", (unsigned int)welded.indices.size() / 3, (unsigned int)welded.vertices.size()
+		, MeshOptimiser::CACHE_SIZE);
+	const char* names[2] = { "welded order", "shuffled" };
+	const MeshData* inputs[2] = { &welded, &shuffled };
+	for (int k = 0; k < 2; k++) {
+		//Each run optimises a new copy of the mesh (copying it is not timed)
+		MeshData optimised, again;
+		MeshOptimiser::Report report;
+		double seconds = 0;
+		for (unsigned int i = 0; i < settings.repeats || i == 0; i++) {
+			optimised = *inputs[k];
+			Benchmark::Timer timer;
+			report = MeshOptimiser::optimise(optimised);
+			double s = timer.seconds();
+			if (i == 0 || s < seconds) seconds = s;
+		}
+		again = *inputs[k];
+		MeshOptimiser::optimise(again);
+		MeshOptimiser::Metrics check = MeshOptimiser::analyse(optimised.indices, optimised.vertices.size());
+		if (optimised.indices != again.indices || optimised.vertices != again.vertices)
+			Benchmark::fail("%s: optimising the same mesh twice gave different results", names[k]);
+		if (check.acmr != report.after.acmr || check.atvr != report.after.atvr)
+			Benchmark::fail("%s: optimise reports ACMR %.3f, the optimised mesh has %.3f", names[k], report.after.acmr, check.acmr);
+		if (getTriangles(optimised) != getTriangles(*inputs[k]))
+			Benchmark::fail("%s: the optimised mesh does not have the same triangles", names[k]);
+		Benchmark::report(names[k], "ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, optimised in %.1f ms (%.1f Mtriangles/s)", report.before.acmr, report.after.acmr
+			, report.before.atvr, report.after.atvr, 1000 * seconds, optimised.indices.size() / 3 / seconds / 1e6);
+	}
+}
@@ -0,0 +1,105 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\MeshPicker.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Fixed sequence of random numbers in [0, 1), the same in every run
+	struct Random {
+		unsigned int seed;
+		Random(unsigned int seed) : seed(seed) { ; }
+		inline float next() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; }
+		inline glm::vec3 point(float size) { float x = next(), y = next(); return glm::vec3(x, y, next()) * size; }
+	};
+
+	const unsigned int NUM_PICKS = 1000;
+	const unsigned int NUM_BRUTE_FORCE_PICKS = 20;		//Each one tests every triangle: a few ms with 1M triangles
+
+	//Closest triangle along the ray, testing all of them (Moller-Trumbore), as picking did before the TriangleBVH
+	bool pickBruteForce(const MeshData& mesh, const glm::vec3& origin, const glm::vec3& dir, float& closest, unsigned int& triangle) {
+		closest = FLT_MAX;
+		for (size_t t = 0; t < mesh.indices.size() / 3; t++) {
+			const glm::vec3& v0 = mesh.vertices[mesh.indices[3 * t]];
+			glm::vec3 e1 = mesh.vertices[mesh.indices[3 * t + 1]] - v0, e2 = mesh.vertices[mesh.indices[3 * t + 2]] - v0;
+			glm::vec3 p = glm::cross(dir, e2);
+			float det = glm::dot(e1, p);
+			if (fabsf(det) < 1e-12f)
+				continue;
+			float invDet = 1.0f / det;
+			glm::vec3 s = origin - v0;
+			float u = glm::dot(s, p) * invDet;
+			if (u < 0 || u > 1)
+				continue;
+			glm::vec3 q = glm::cross(s, e1);
+			float v = glm::dot(dir, q) * invDet;
+			if (v < 0 || u + v > 1)
+				continue;
+			float distance = glm::dot(e2, q) * invDet;
+			if (distance > 0 && distance < closest) {
+				closest = distance;
+				triangle = (unsigned int)t;
+			}
+		}
+		return closest < FLT_MAX;
+	}
+};
+
+//Picking the triangle under a ray on a mesh of 1M triangles (a sphere): the MeshPicker (TriangleBVH, built on the
+//first pick) vs testing every triangle. Rays come from around the sphere, aimed at points near it (most of them hit).
+OPENGLFRAMEWORK_BENCHMARK(MeshPicker, "Picking a triangle of a 1M triangle mesh: TriangleBVH vs brute force") {
+	unsigned int rings = (unsigned int)(500 * sqrt(settings.scale)) + 2;
+	std::shared_ptr<MeshData> mesh(new MeshData());
+	SyntheticMeshes::makeSphere(rings, 2 * rings, mesh->vertices, mesh->uvs, mesh->normals);
+	mesh->indices.resize(mesh->vertices.size());
+	for (size_t i = 0; i < mesh->indices.size(); i++)
+		mesh->indices[i] = (unsigned int)i;
+	mesh->bb = MeshStatistics::computeBoundingBox(mesh->vertices);
+	std::shared_ptr<const MeshData> constMesh = mesh;
+	Random random(2024);
+	std::vector<glm::vec3> origins(NUM_PICKS), directions(NUM_PICKS);
+	for (unsigned int q = 0; q < NUM_PICKS; q++) {
+		origins[q] = glm::normalize(random.point(2) - glm::vec3(1)) * 3.0f;
+		directions[q] = glm::normalize(random.point(2.4f) - glm::vec3(1.2f) - origins[q]);
+	}
+	//1. Building the BVH (what the first pick of a mesh does, or prepare)
+	MeshPicker& picker = MeshPicker::instance();
+	double buildSeconds = Benchmark::best(settings, [&]() {
+		picker.clear();
+		picker.getBVH(constMesh);
+	});
+	MeshPicker::Statistics stats = picker.getStatistics();
+	//2. Picking with it, and testing every triangle (fewer rays: it takes much longer)
+	std::vector<MeshPicker::Hit> hits(NUM_PICKS);
+	std::vector<bool> found(NUM_PICKS);
+	double pickSeconds = Benchmark::best(settings, [&]() {
+		for (unsigned int q = 0; q < NUM_PICKS; q++)
+			found[q] = picker.pickLocal(constMesh, origins[q], directions[q], hits[q]);
+	});
+	std::vector<float> bruteDistances(NUM_BRUTE_FORCE_PICKS);
+	std::vector<unsigned int> bruteTriangles(NUM_BRUTE_FORCE_PICKS);
+	std::vector<bool> bruteFound(NUM_BRUTE_FORCE_PICKS);
+	double bruteSeconds = Benchmark::best(settings, [&]() {
+		for (unsigned int q = 0; q < NUM_BRUTE_FORCE_PICKS; q++)
+			bruteFound[q] = pickBruteForce(*mesh, origins[q], directions[q], bruteDistances[q], bruteTriangles[q]);
+	});
+	picker.clear();
+	//3. Both must find the same hits (a ray through an edge can hit either triangle: the distances are compared)
+	unsigned int mismatches = 0, numHits = 0;
+	for (unsigned int q = 0; q < NUM_PICKS; q++)
+		if (found[q]) numHits++;
+	for (unsigned int q = 0; q < NUM_BRUTE_FORCE_PICKS; q++)
+		if (found[q] != bruteFound[q] || (found[q] && hits[q].triangle != bruteTriangles[q] && fabsf(hits[q].distance - bruteDistances[q]) > 1e-5f))
+			mismatches++;
+	if (mismatches)
+		Benchmark::fail("%u of %u picks did not hit the same triangle with the BVH and testing every triangle", mismatches, NUM_BRUTE_FORCE_PICKS);
+	Benchmark::report("mesh", "%u triangles, BVH built in %.1f ms (%.1f MB, %s triangle tests)", (unsigned int)mesh->indices.size() / 3
+		, 1000 * buildSeconds, stats.bytes / (1024.0 * 1024.0), TriangleBVH::getInstructionSet());
+	Benchmark::report("BVH", "%.2f us per pick (%u of %u rays hit)", 1e6 * pickSeconds / NUM_PICKS, numHits, NUM_PICKS);
+	Benchmark::report("brute force", "%.2f ms per pick (%.0fx slower)", 1000 * bruteSeconds / NUM_BRUTE_FORCE_PICKS
+		, (bruteSeconds / NUM_BRUTE_FORCE_PICKS) / (pickSeconds / NUM_PICKS));
+}
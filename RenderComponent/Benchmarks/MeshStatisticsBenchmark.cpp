@@ -0,0 +1,61 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	bool sameBox(const BoundingBox& a, const BoundingBox& b) {
+		return a.xmin == b.xmin && a.xmax == b.xmax && a.ymin == b.ymin && a.ymax == b.ymax && a.zmin == b.zmin && a.zmax == b.zmax;
+	}
+
+	bool close(float a, float b, float tolerance) {
+		return fabsf(a - b) <= tolerance * std::max(1.0f, std::max(fabsf(a), fabsf(b)));
+	}
+
+	//Results must match exactly, but for the sums (the centroid), which SIMD adds in a different order
+	bool sameResult(const MeshStatistics::Result& a, const MeshStatistics::Result& b) {
+		return sameBox(a.bb, b.bb) && a.sphereCentre == b.sphereCentre && close(a.sphereRadius, b.sphereRadius, 1e-6f)
+			&& close(a.centroid.x, b.centroid.x, 1e-5f) && close(a.centroid.y, b.centroid.y, 1e-5f) && close(a.centroid.z, b.centroid.z, 1e-5f)
+			&& a.invalidVertices == b.invalidVertices && a.degenerateTriangles == b.degenerateTriangles;
+	}
+};
+
+//Bounding box alone, and all the statistics (box, centroid, sphere, invalid vertices and degenerate triangles), of a
+//big vertex array: the scalar kernels on one thread, the SIMD kernels on one thread, and the SIMD kernels on all of them.
+OPENGLFRAMEWORK_BENCHMARK(MeshStatistics, "Bounding volumes of big vertex arrays: scalar vs SIMD kernels") {
+	size_t numVertices = 3 * settings.scaled(1000000);
+	//1. Random vertices in a box (a fixed sequence, the same in every run), with a few NaNs and infinities
+	std::vector<GLfloat> vertices(3 * numVertices);
+	unsigned int seed = 12345;
+	for (size_t i = 0; i < vertices.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		vertices[i] = (seed >> 8) / 16777216.0f * 200.0f - 100.0f;
+	}
+	for (size_t i = 0; i < numVertices; i += 100003)
+		vertices[3 * i + i % 3] = (i % 2) ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+	//2. The same work, three ways
+	const char* names[3] = { "scalar, 1 thread", "SIMD, 1 thread", "SIMD, all threads" };
+	MeshStatistics::Result results[3];
+	BoundingBox boxes[3];
+	double boxSeconds[3], allSeconds[3];
+	for (int way = 0; way < 3; way++) {
+		MeshStatistics::setUseSIMD(way > 0);
+		MeshStatistics::setMaxThreads(way < 2 ? 1 : settings.maxThreads);
+		boxSeconds[way] = Benchmark::best(settings, [&]() { boxes[way] = MeshStatistics::computeBoundingBox(numVertices, &vertices[0]); });
+		allSeconds[way] = Benchmark::best(settings, [&]() { results[way] = MeshStatistics::compute(numVertices, &vertices[0]); });
+	}
+	MeshStatistics::setUseSIMD(true);
+	MeshStatistics::setMaxThreads(0);
+	Benchmark::report("vertices", "%u (%s kernels)", (unsigned int)numVertices, MeshStatistics::getInstructionSet());
+	for (int way = 0; way < 3; way++) {
+		Benchmark::report(names[way], "box %.2f ms (%.0f Mvertices/s, %.1fx), all statistics %.2f ms (%.1fx)", 1000 * boxSeconds[way]
+			, numVertices / boxSeconds[way] / 1e6, boxSeconds[0] / boxSeconds[way], 1000 * allSeconds[way], allSeconds[0] / allSeconds[way]);
+		if (way > 0 && (!sameBox(boxes[way], boxes[0]) || !sameResult(results[way], results[0])))
+			Benchmark::fail("%s does not give the same results as the scalar kernels", names[way]);
+	}
+	Benchmark::report("results", "box (%g %g %g)-(%g %g %g), radius %g, %u invalid vertices, %u degenerate triangles", boxes[0].xmin, boxes[0].ymin, boxes[0].zmin
+		, boxes[0].xmax, boxes[0].ymax, boxes[0].zmax, results[0].sphereRadius, (unsigned int)results[0].invalidVertices, (unsigned int)results[0].degenerateTriangles);
+}
@@ -0,0 +1,64 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\OBJMeshCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\ParallelOBJLoader.h>
+#include <cstdio>
+#include <cmath>
+
+using namespace OpenGLFramework;
+
+namespace {
+	bool sameMesh(const MeshData& a, const MeshData& b) {
+		return a.vertices == b.vertices && a.uvs == b.uvs && a.normals == b.normals && a.indices == b.indices && a.lodIndices == b.lodIndices
+			&& a.bb.xmin == b.bb.xmin && a.bb.xmax == b.bb.xmax && a.bb.ymin == b.bb.ymin && a.bb.ymax == b.bb.ymax && a.bb.zmin == b.bb.zmin && a.bb.zmax == b.bb.zmax;
+	}
+};
+
+//Loading a model: parsing the OBJ file (and welding, simplifying and optimising it, as OBJMeshCache does on a miss)
+//vs reading the binary cache written the first time. The model is a sphere written as an OBJ file in the current
+//folder (deleted afterwards, with its cache).
+OPENGLFRAMEWORK_BENCHMARK(OBJMeshCache, "Loading a model: parsing the OBJ file vs the binary mesh cache") {
+	unsigned int rings = (unsigned int)(200 * sqrt(settings.scale)) + 2;
+	std::vector<glm::vec3> vertices, normals;
+	std::vector<glm::vec2> uvs;
+	SyntheticMeshes::makeSphere(rings, 2 * rings, vertices, uvs, normals);
+	std::string objFile = "RenderBenchmark_sphere.obj";
+	if (!SyntheticMeshes::writeOBJ(objFile, vertices, uvs, normals)) {
+		Benchmark::fail("could not write %s", objFile.c_str());
+		return;
+	}
+	OBJMeshCache& cache = OBJMeshCache::instance();
+	bool wasEnabled = cache.isEnabled();
+	//1. Parsing only (what loadOBJ did every time a renderable was loaded)
+	std::vector<glm::vec3> parsedVertices, parsedNormals;
+	std::vector<glm::vec2> parsedUVs;
+	double parseSeconds = Benchmark::best(settings, [&]() { loadOBJParallel(objFile.c_str(), parsedVertices, parsedUVs, parsedNormals); });
+	//2. Everything a miss does (the cache disabled, so it is not written)
+	MeshData fromOBJ, fromCache;
+	cache.setEnabled(false);
+	double objSeconds = Benchmark::best(settings, [&]() { cache.load(objFile, fromOBJ); });
+	//3. The first load with the cache writes it; the rest read it
+	cache.setEnabled(true);
+	std::remove(OBJMeshCache::getCacheFileName(objFile).c_str());
+	Benchmark::Timer timer;
+	cache.load(objFile, fromCache);
+	double firstSeconds = timer.seconds();
+	cache.resetStatistics();
+	double cachedSeconds = Benchmark::best(settings, [&]() { cache.load(objFile, fromCache); });
+	OBJMeshCache::Statistics stats = cache.getStatistics();
+	cache.setEnabled(wasEnabled);
+	if (parsedVertices.size() != vertices.size())
+		Benchmark::fail("the OBJ file has %u corners, %u were parsed", (unsigned int)vertices.size(), (unsigned int)parsedVertices.size());
+	if (stats.misses > 0)
+		Benchmark::fail("%u loads did not use the cache", stats.misses);
+	if (!sameMesh(fromOBJ, fromCache))
+		Benchmark::fail("the mesh read from the cache is not the one built from the OBJ file");
+	Benchmark::report("model", "%u triangles, %u vertices after welding", (unsigned int)fromOBJ.indices.size() / 3, (unsigned int)fromOBJ.vertices.size());
+	Benchmark::report("parse OBJ", "%.1f ms", 1000 * parseSeconds);
+	Benchmark::report("parse + weld + simplify + optimise", "%.1f ms", 1000 * objSeconds);
+	Benchmark::report("first load (also writes the cache)", "%.1f ms", 1000 * firstSeconds);
+	Benchmark::report("cached load", "%.2f ms (%.0fx faster than parsing, %.2f MB mapped)", 1000 * cachedSeconds, objSeconds / cachedSeconds
+		, stats.hits ? stats.bytesMapped / (1024.0 * 1024.0) / stats.hits : 0.0);
+	std::remove(OBJMeshCache::getCacheFileName(objFile).c_str());
+	std::remove(objFile.c_str());
+}
@@ -0,0 +1,95 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\RenderableVisitor.h>
+#include <OpenGLFramework\Components\RenderComponent\PerVertexColourMesh_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\TexturedManualMesh_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\PhongShadingOBJMesh_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+using namespace OpenGLFramework;
+
+namespace {
+	const unsigned int NUM_FRAMES = 10;
+};
+
+//Cost of the profiler: the scene of SceneSubmission rendered with its scopes on and off. Scopes are only compiled in
+//with OPENGLFRAMEWORK_PROFILING: a build without it reports the frame time alone, to compare it with a build with it.
+//The difference is measured and also estimated (scopes per frame times the cost of one), as it is close to the noise.
+OPENGLFRAMEWORK_BENCHMARK(ProfilerOverhead, "Frame time of the same scene with profiling on and off (target: <1% overhead)") {
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+	size_t numObjects = settings.scaled(10000);
+	std::vector<GLfloat> vertices, uvs, normals;
+	SyntheticMeshes::makeSphere(8, 16, vertices, uvs, normals);
+	int numVertex = (int)vertices.size() / 3;
+	std::vector<GLfloat> colours(vertices.size(), 0.5f);
+	//1. The scene: a grid of spheres, 2 units apart (as SceneSubmission)
+	std::vector<OpenGL_Renderable*> renderables;
+	std::vector<glm::mat4> modelMatrices;
+	size_t side = (size_t)ceil(sqrt((double)numObjects));
+	for (size_t i = 0; i < numObjects; i++) {
+		OpenGL_Renderable* r;
+		if (i % 3 == 0)
+			r = new PerVertexColourMesh_Renderable(numVertex, &vertices[0], &colours[0]);
+		else if (i % 3 == 1)
+			r = new TexturedManualMesh_Renderable(numVertex, &vertices[0], &uvs[0], (GLuint)1);
+		else
+			r = new PhongShadingOBJMesh_Renderable(numVertex, &vertices[0], &uvs[0], &normals[0], "benchmark.bmp");
+		r->loadResourcesToMainMemory();
+		r->allocateOpenGLResources();
+		renderables.push_back(r);
+		modelMatrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * (i % side) - side, 2.0f * (i / side) - side, -10.0f)));
+	}
+	float top = 0.1f * tanf(0.5236f), right = top * 16 / 9;
+	glm::mat4 P = glm::frustum(-right, right, -top, top, 0.1f, 1000.0f);
+	glm::mat4 V = glm::lookAt(glm::vec3(0, 0, 0.5f * side), glm::vec3(0, 0, -10), glm::vec3(0, 1, 0));
+	auto renderFrames = [&]() {
+		for (unsigned int frame = 0; frame < NUM_FRAMES; frame++) {
+			RenderableVisitor visitor(P, V);
+			visitor.renderRenderables(&renderables[0], &modelMatrices[0], renderables.size());
+		}
+	};
+#ifdef OPENGLFRAMEWORK_PROFILING
+	//2. Frames with the scopes off and on (alternating, so both see the same state of the machine)
+	Profiler& profiler = Profiler::instance();
+	bool wasEnabled = Profiler::isEnabled();
+	double seconds[2] = { 0, 0 };
+	for (unsigned int i = 0; i < settings.repeats || i == 0; i++) {
+		for (int on = 0; on < 2; on++) {
+			Profiler::setEnabled(on == 1);
+			Benchmark::Timer timer;
+			renderFrames();
+			double s = timer.seconds() / NUM_FRAMES;
+			if (i == 0 || s < seconds[on]) seconds[on] = s;
+		}
+	}
+	//3. How many scopes a frame runs, from the frame summaries of the last frames (all with the scopes on)
+	profiler.clear();
+	Profiler::setEnabled(true);
+	renderFrames();
+	double scopesPerFrame = 0;
+	std::vector<Profiler::Summary> summaries = profiler.getFrameSummaries();
+	for (size_t s = 0; s < summaries.size(); s++)
+		if (summaries[s].name != "Frame")
+			scopesPerFrame += summaries[s].callsPerFrame * summaries[s].frames / NUM_FRAMES;
+	Profiler::setEnabled(wasEnabled);
+	double scopeNanoseconds = profiler.getScopeCostNanoseconds();
+	double estimated = 100 * scopesPerFrame * scopeNanoseconds * 1e-9 / seconds[0];
+	Benchmark::report("objects", "%u, %u frames per run", (unsigned int)numObjects, NUM_FRAMES);
+	Benchmark::report("profiling off", "%.3f ms per frame", 1000 * seconds[0]);
+	Benchmark::report("profiling on", "%.3f ms per frame (%+.2f%% measured)", 1000 * seconds[1], 100 * (seconds[1] - seconds[0]) / seconds[0]);
+	Benchmark::report("scopes", "%.1f per frame, %.1f ns each: %.3f%% of the frame estimated", scopesPerFrame, scopeNanoseconds, estimated);
+	if (estimated > 1)
+		Benchmark::fail("the scopes take %.2f%% of the frame (more than 1%%)", estimated);
+#else
+	double seconds = Benchmark::best(settings, renderFrames) / NUM_FRAMES;
+	Benchmark::report("objects", "%u, %u frames per run", (unsigned int)numObjects, NUM_FRAMES);
+	Benchmark::report("profiling not compiled in", "%.3f ms per frame (build with OPENGLFRAMEWORK_PROFILING to compare)", 1000 * seconds);
+#endif
+	for (size_t i = 0; i < renderables.size(); i++) {
+		renderables[i]->unallocateAllResources();
+		delete renderables[i];
+	}
+#endif
+}
@@ -0,0 +1,60 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\RayTracer.h>
+#include <OpenGLFramework\Components\RenderComponent\PhongShadingOBJMesh_Renderable.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+
+using namespace OpenGLFramework;
+
+//Ray tracing a grid of spheres (with shadow rays towards their light) on 1, 2, 4... threads, up to one per core (or
+//--threads): rays per second and speed-up over one thread. Every thread count must give the same image.
+OPENGLFRAMEWORK_BENCHMARK(RayTracer, "CPU ray tracing: rays/s and scaling from 1 to N threads") {
+	std::vector<GLfloat> vertices, uvs, normals;
+	SyntheticMeshes::makeSphere(32, 64, vertices, uvs, normals);
+	PhongShadingOBJMesh_Renderable sphere((int)vertices.size() / 3, &vertices[0], &uvs[0], &normals[0], "", glm::vec3(0, 20, 0), 400.0f);
+	if (!sphere.loadResourcesToMainMemory()) {
+		Benchmark::fail("could not load the sphere");
+		return;
+	}
+	//1. The scene: the same sphere (so a single BVH) at each point of a 10x10 grid, 3 units apart
+	RayTracer rayTracer;
+	for (int i = 0; i < 100; i++)
+		rayTracer.addRenderable(&sphere, glm::translate(glm::mat4(1.0f), glm::vec3(3.0f * (i % 10) - 13.5f, 0, -3.0f * (i / 10) - 5)));
+	unsigned int width = (unsigned int)(640 * sqrt(settings.scale)), height = width * 9 / 16;
+	if (height == 0) width = 16, height = 9;
+	float top = 0.1f * tanf(0.5236f), right = top * 16 / 9;
+	glm::mat4 P = glm::frustum(-right, right, -top, top, 0.1f, 1000.0f);
+	glm::mat4 V = glm::lookAt(glm::vec3(0, 8, 5), glm::vec3(0, 0, -15), glm::vec3(0, 1, 0));
+	//2. The same frame on more and more threads (the first render also builds the BVH, so it is not timed)
+	unsigned int maxThreads = settings.maxThreads ? settings.maxThreads : std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+	std::vector<unsigned char> reference, image;
+	rayTracer.setNumThreads(1);
+	rayTracer.render(P, V, width, height, reference);
+	const RayTracer::Statistics& scene = rayTracer.getStatistics();
+	Benchmark::report("scene", "%ux%u pixels, %u spheres (%u BVH of %u triangles, built in %.1f ms)", width, height, scene.instances
+		, scene.meshes, (unsigned int)scene.triangles, 1000 * scene.prepareSeconds);
+	double oneThreadSeconds = 0;
+	for (unsigned int threads = 1; ; threads = (2 * threads < maxThreads) ? 2 * threads : maxThreads) {
+		rayTracer.setNumThreads(threads);
+		RayTracer::Statistics stats;
+		double seconds = Benchmark::best(settings, [&]() {
+			rayTracer.render(P, V, width, height, image);
+			stats = rayTracer.getStatistics();
+		});
+		if (threads == 1) oneThreadSeconds = seconds;
+		if (image != reference)
+			Benchmark::fail("the image rendered on %u threads is not the one rendered on 1", threads);
+		char what[64];
+		sprintf(what, "%u threads", threads);
+		Benchmark::report(what, "%.1f ms, %.2f Mrays/s (%.0f%% shadow rays), %.2fx speed-up (%.0f%% efficiency), %u of %u tiles stolen", 1000 * seconds
+			, (stats.primaryRays + stats.shadowRays) / seconds / 1e6, 100 * stats.shadowRays / (stats.primaryRays + stats.shadowRays)
+			, oneThreadSeconds / seconds, 100 * oneThreadSeconds / seconds / threads, stats.tilesStolen, stats.tiles);
+		if (threads >= maxThreads)
+			break;
+	}
+	sphere.unallocateAllResources();
+}
@@ -0,0 +1,74 @@
+/**********************************************************************
+NAME: RenderBenchmark
+DESCRIPTION: Executable that runs the benchmarks of the render components (see Benchmark.h), without a window:
+	RecordingGL is put in HEADLESS mode, so the renderables go through all their OpenGL calls (which are counted) but
+	nothing reaches a GPU. Build it with OPENGLFRAMEWORK_RECORDING_GL defined, from this file, the .cpp files in this
+	folder (one per case) and the rest of the framework (as the application is built, without the application's main).
+	CMakeLists.txt in this folder does that, and adds a quick run of all the cases as a test (see the variables it needs).
+	Run it from the folder the application runs from: renderables read their shaders from OpenGLFramework/..., relative
+	to it. Usage:
+		RenderBenchmark [--list] [--scale <factor>] [--repeats <runs>] [--threads <threads>] [case ...]
+	With no cases, all of them run (in alphabetical order). It returns 1 if a case found results that do not match.
+***********************************************************************/
+
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+int main(int argc, char** argv) {
+#ifndef OPENGLFRAMEWORK_RECORDING_GL
+	printf("RenderBenchmark needs OPENGLFRAMEWORK_RECORDING_GL to be defined (it renders without an OpenGL context)\n");
+	return 1;
+#else
+	Benchmark::Settings settings = { 1.0, 5, 0 };
+	std::vector<std::string> selected;
+	std::vector<const Benchmark*> all = Benchmark::getAll();
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--list")) {
+			for (size_t c = 0; c < all.size(); c++)
+				printf("%-24s %s\n", all[c]->getName(), all[c]->getDescription());
+			return 0;
+		}
+		else if (!strcmp(argv[i], "--scale") && i + 1 < argc)
+			settings.scale = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--repeats") && i + 1 < argc)
+			settings.repeats = (unsigned int)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			settings.maxThreads = (unsigned int)atoi(argv[++i]);
+		else if (argv[i][0] == '-') {
+			printf("Usage: %s [--list] [--scale <factor>] [--repeats <runs>] [--threads <threads>] [case ...]\n", argv[0]);
+			return 1;
+		}
+		else
+			selected.push_back(argv[i]);
+	}
+	if (settings.scale <= 0 || settings.repeats == 0) {
+		printf("--scale and --repeats must be positive\n");
+		return 1;
+	}
+	RecordingGL::instance().setMode(RecordingGL::HEADLESS);
+	unsigned int run = 0;
+	for (size_t c = 0; c < all.size(); c++) {
+		bool wanted = selected.empty();
+		for (size_t s = 0; s < selected.size(); s++)
+			wanted = wanted || selected[s] == all[c]->getName();
+		if (!wanted)
+			continue;
+		printf("%s (%s)\n", all[c]->getName(), all[c]->getDescription());
+		fflush(stdout);
+		all[c]->run(settings);
+		run++;
+	}
+	if (run < selected.size())
+		printf("Some of the cases requested do not exist (see --list)\n");
+	if (Benchmark::getNumFailures() > 0) {
+		printf("%u mismatches\n", Benchmark::getNumFailures());
+		return 1;
+	}
+	return (run < selected.size()) ? 1 : 0;
+#endif
+}
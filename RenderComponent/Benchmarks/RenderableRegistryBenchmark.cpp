@@ -0,0 +1,77 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableRegistry.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\IComponent.h>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Renderable that does nothing: we only measure finding them
+	class EmptyRenderable : public OpenGL_Renderable {
+	public:
+		virtual bool loadResourcesToMainMemory() { return true; }
+		virtual bool allocateOpenGLResources() { return true; }
+		virtual bool unallocateAllResources() { return true; }
+	};
+
+	//Any other component an object may have
+	class OtherComponent : public IComponent {
+	public:
+		virtual std::string getComponentType() const { return "Behaviour"; }
+	};
+
+	//What IVirtualObject::getAllComponentsOfType does: compare the type of each component as a string, and return a new list
+	std::list<IComponent*> getAllComponentsOfType(const std::vector<IComponent*>& components, std::string type) {
+		std::list<IComponent*> result;
+		for (size_t i = 0; i < components.size(); i++)
+			if (components[i]->getComponentType() == type)
+				result.push_back(components[i]);
+		return result;
+	}
+};
+
+//Finding the renderables of every object, once per frame: asking each object for its components (the list built,
+//string comparisons and dynamic_casts of RenderableVisitor::visitVirtualObject without a registry), or reading them
+//from the RenderableRegistry. Objects have a renderable and another component each.
+OPENGLFRAMEWORK_BENCHMARK(RenderableRegistry, "Finding the renderables of each object: asking the object vs the registry") {
+	size_t numObjects = settings.scaled(100000);
+	std::vector<EmptyRenderable> renderables(numObjects);
+	std::vector<OtherComponent> others(numObjects);
+	std::vector<std::vector<IComponent*> > objects(numObjects);
+	std::vector<int> owners(numObjects);		//Stand-ins for the objects: the registry only uses their address
+	RenderableRegistry registry;
+	for (size_t i = 0; i < numObjects; i++) {
+		objects[i].push_back(&others[i]);
+		objects[i].push_back(&renderables[i]);
+		registry.add((const IVirtualObject*)&owners[i], &renderables[i]);
+	}
+	//1. Asking each object
+	size_t foundByObjects = 0, foundByRegistry = 0;
+	double objectSeconds = Benchmark::best(settings, [&]() {
+		foundByObjects = 0;
+		for (size_t i = 0; i < numObjects; i++) {
+			std::list<IComponent*> l = getAllComponentsOfType(objects[i], "Renderable");
+			for (std::list<IComponent*>::iterator it = l.begin(); it != l.end(); it++)
+				if (dynamic_cast<OpenGL_Renderable*>(*it))
+					foundByObjects++;
+		}
+	});
+	//2. The registry
+	double registrySeconds = Benchmark::best(settings, [&]() {
+		foundByRegistry = 0;
+		for (size_t i = 0; i < numObjects; i++) {
+			size_t count = 0;
+			OpenGL_Renderable* const* renderables = registry.getRenderables((const IVirtualObject*)&owners[i], count);
+			for (size_t r = 0; r < count; r++)
+				if (renderables[r]->isEnabled())
+					foundByRegistry++;
+		}
+	});
+	if (foundByObjects != numObjects || foundByRegistry != numObjects)
+		Benchmark::fail("found %u renderables asking the objects and %u in the registry, for %u objects", (unsigned int)foundByObjects
+			, (unsigned int)foundByRegistry, (unsigned int)numObjects);
+	Benchmark::report("objects", "%u", (unsigned int)numObjects);
+	Benchmark::report("asking the objects", "%.3f ms per frame (%.1f ns per object)", 1000 * objectSeconds, 1e9 * objectSeconds / numObjects);
+	Benchmark::report("registry", "%.3f ms per frame (%.1f ns per object)", 1000 * registrySeconds, 1e9 * registrySeconds / numObjects);
+	Benchmark::report("speed-up", "%.1fx", objectSeconds / registrySeconds);
+}
@@ -0,0 +1,69 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\RenderableVisitor.h>
+#include <OpenGLFramework\Components\RenderComponent\PerVertexColourMesh_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\TexturedManualMesh_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\PhongShadingOBJMesh_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <map>
+#include <cmath>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+//Frame submission: N objects of three types of renderable, on a grid in front of the camera (some of them out of
+//its frustum), rendered by the RenderableVisitor (culling, sorting, instancing) with the recorded OpenGL calls.
+OPENGLFRAMEWORK_BENCHMARK(SceneSubmission, "Frame submission time and OpenGL calls per renderable type") {
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+	size_t numObjects = settings.scaled(10000);
+	std::vector<GLfloat> vertices, uvs, normals;
+	SyntheticMeshes::makeSphere(8, 16, vertices, uvs, normals);
+	int numVertex = (int)vertices.size() / 3;
+	std::vector<GLfloat> colours(vertices.size(), 0.5f);
+	//1. The scene: a grid of spheres, 2 units apart
+	std::vector<OpenGL_Renderable*> renderables;
+	std::vector<glm::mat4> modelMatrices;
+	size_t side = (size_t)ceil(sqrt((double)numObjects));
+	for (size_t i = 0; i < numObjects; i++) {
+		OpenGL_Renderable* r;
+		if (i % 3 == 0)
+			r = new PerVertexColourMesh_Renderable(numVertex, &vertices[0], &colours[0]);
+		else if (i % 3 == 1)
+			r = new TexturedManualMesh_Renderable(numVertex, &vertices[0], &uvs[0], (GLuint)1);
+		else
+			r = new PhongShadingOBJMesh_Renderable(numVertex, &vertices[0], &uvs[0], &normals[0], "benchmark.bmp");
+		r->loadResourcesToMainMemory();
+		r->allocateOpenGLResources();
+		renderables.push_back(r);
+		modelMatrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * (i % side) - side, 2.0f * (i / side) - side, -10.0f)));
+	}
+	float top = 0.1f * tanf(0.5236f), right = top * 16 / 9;	//60 degrees vertical field of view, 16:9 (glm::frustum does not depend on glm's angle units)
+	glm::mat4 P = glm::frustum(-right, right, -top, top, 0.1f, 1000.0f);
+	glm::mat4 V = glm::lookAt(glm::vec3(0, 0, 0.5f * side), glm::vec3(0, 0, -10), glm::vec3(0, 1, 0));
+	//2. Frames, each with a new visitor (as the application does). We keep the statistics of the fastest one
+	RenderableVisitor::FrameStatistics frame;
+	memset(&frame, 0, sizeof(frame));
+	Benchmark::best(settings, [&]() {
+		RenderableVisitor visitor(P, V);
+		visitor.renderRenderables(&renderables[0], &modelMatrices[0], renderables.size());
+		if (frame.submitSeconds == 0 || visitor.getFrameStatistics().submitSeconds < frame.submitSeconds)
+			frame = visitor.getFrameStatistics();
+	});
+	const RecordingGL::FrameStatistics& recorded = RecordingGL::instance().getLastFrame();
+	Benchmark::report("objects", "%u (%u visible, %u culled)", (unsigned int)numObjects, frame.renderablesVisible, frame.renderablesCulled);
+	Benchmark::report("submitSeconds", "%.6f (traversal %.6f)", frame.submitSeconds, frame.traversalSeconds);
+	Benchmark::report("draws", "%u (%u renderables instanced)", frame.drawsSubmitted, frame.renderablesInstanced);
+	std::map<std::string, RecordingGL::Counters>::const_iterator it = recorded.byRenderableType.begin();
+	for (; it != recorded.byRenderableType.end(); it++) {
+		const RecordingGL::Counters& c = it->second;
+		Benchmark::report(it->first.c_str(), "%u draws (%u instanced), %u binds (%u redundant), %u other state changes, %u uniforms, %llu bytes uploaded"
+			, c.drawCalls, c.instancedDrawCalls, c.programBinds + c.vertexArrayBinds + c.bufferBinds + c.textureBinds, c.redundantBinds
+			, c.otherStateChanges, c.uniformUpdates, c.bytesUploaded);
+	}
+	for (size_t i = 0; i < renderables.size(); i++) {
+		renderables[i]->unallocateAllResources();
+		delete renderables[i];
+	}
+#endif
+}
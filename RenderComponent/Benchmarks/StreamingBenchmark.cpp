@@ -0,0 +1,103 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\RenderableVisitor.h>
+#include <OpenGLFramework\Components\RenderComponent\PerVertexColourMesh_Renderable.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	const unsigned int NUM_FRAMES = 10;
+
+	//A point cloud as a depth camera gives it: a grid of points over a wavy surface, different in every frame.
+	//Returns its bounding box (what the producer knows anyway, and endUpdate needs for the culling).
+	BoundingBox fillCloud(size_t numPoints, unsigned int frame, GLfloat* vertices, GLfloat* colours) {
+		size_t side = (size_t)sqrt((double)numPoints) + 1;
+		float phase = 0.1f * frame, zmin = 0, zmax = 0;
+		for (size_t i = 0; i < numPoints; i++) {
+			float x = (float)(i % side) / side - 0.5f, y = (float)(i / side) / side - 0.5f;
+			float z = -2.0f + 0.1f * sinf(10 * x + phase) * cosf(10 * y);
+			vertices[3 * i] = x; vertices[3 * i + 1] = y; vertices[3 * i + 2] = z;
+			colours[3 * i] = x + 0.5f; colours[3 * i + 1] = y + 0.5f; colours[3 * i + 2] = 0.5f;
+			zmin = i ? std::min(zmin, z) : z; zmax = i ? std::max(zmax, z) : z;
+		}
+		BoundingBox bounds;
+		bounds.xmin = -0.5f; bounds.xmax = 0.5f; bounds.ymin = -0.5f; bounds.ymax = 0.5f; bounds.zmin = zmin; bounds.zmax = zmax;
+		return bounds;
+	}
+};
+
+//A new point cloud every frame (e.g. a Kinect depth stream), at 300k, 1M and 2M points: produced in our own arrays and
+//handed to setVertices/setColours (a copy, and glBufferData reallocating the buffers), vs written straight into the
+//memory mapped from the StreamingRingBuffer (beginUpdate/endUpdate). Each frame is then rendered by the RenderableVisitor.
+OPENGLFRAMEWORK_BENCHMARK(Streaming, "Point cloud updates per frame: setVertices/glBufferData vs the streaming ring buffer") {
+	const size_t sizes[3] = { settings.scaled(300000), settings.scaled(1000000), settings.scaled(2000000) };
+	float top = 0.1f * tanf(0.5236f), right = top * 16 / 9;
+	glm::mat4 P = glm::frustum(-right, right, -top, top, 0.1f, 100.0f);
+	glm::mat4 V = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+	glm::mat4 M(1.0f);
+	for (int s = 0; s < 3; s++) {
+		int numPoints = (int)sizes[s];
+		std::vector<GLfloat> vertices(3 * numPoints), colours(3 * numPoints);
+		fillCloud(numPoints, 0, &vertices[0], &colours[0]);
+		//1. Without streaming: the producer fills our arrays, setVertices/setColours copy and upload them
+		PerVertexColourMesh_Renderable copied(numPoints, &vertices[0], &colours[0]);
+		copied.loadResourcesToMainMemory();
+		copied.allocateOpenGLResources();
+		unsigned int copiedDraws = 0;
+		double copiedSeconds = Benchmark::best(settings, [&]() {
+			for (unsigned int frame = 0; frame < NUM_FRAMES; frame++) {
+				fillCloud(numPoints, frame, &vertices[0], &colours[0]);
+				copied.setVertices(numPoints, &vertices[0]);
+				copied.setColours(numPoints, &colours[0]);
+				RenderableVisitor visitor(P, V);
+				OpenGL_Renderable* r = &copied;
+				visitor.renderRenderables(&r, &M, 1);
+				copiedDraws += visitor.getFrameStatistics().drawsSubmitted;
+			}
+		}) / NUM_FRAMES;
+		copied.unallocateAllResources();
+		//2. Streaming: the producer writes straight into the mapped segment
+		PerVertexColourMesh_Renderable streamed(numPoints, &vertices[0], &colours[0]);
+		streamed.enableStreaming(numPoints);
+		streamed.loadResourcesToMainMemory();
+		if (!streamed.allocateOpenGLResources()) {
+			Benchmark::fail("could not allocate a streaming renderable of %d points", numPoints);
+			return;
+		}
+		unsigned int streamedDraws = 0, failedUpdates = 0;
+		double streamedSeconds = Benchmark::best(settings, [&]() {
+			for (unsigned int frame = 0; frame < NUM_FRAMES; frame++) {
+				GLfloat *mappedVertices, *mappedColours;
+				if (!streamed.beginUpdate(mappedVertices, mappedColours)) {
+					failedUpdates++;
+					continue;
+				}
+				BoundingBox bounds = fillCloud(numPoints, frame, mappedVertices, mappedColours);
+				streamed.endUpdate(numPoints, &bounds);
+				RenderableVisitor visitor(P, V);
+				OpenGL_Renderable* r = &streamed;
+				visitor.renderRenderables(&r, &M, 1);
+				streamedDraws += visitor.getFrameStatistics().drawsSubmitted;
+			}
+		}) / NUM_FRAMES;
+		StreamingRingBuffer::Statistics ringStats = streamed.getStreamingStatistics();
+		streamed.unallocateAllResources();
+		//3. Same frames drawn both ways
+		if (failedUpdates)
+			Benchmark::fail("%u streaming updates could not map a segment", failedUpdates);
+		unsigned int numFrames = NUM_FRAMES * std::max(settings.repeats, 1u);
+		if (copiedDraws != numFrames || streamedDraws != numFrames)
+			Benchmark::fail("%u frames drawn with setVertices and %u streaming, %u expected", copiedDraws, streamedDraws, numFrames);
+		double megabytes = 6.0 * sizeof(GLfloat) * numPoints / (1024.0 * 1024.0);
+		char what[64];
+		sprintf(what, "%d points, setVertices", numPoints);
+		Benchmark::report(what, "%.2f ms per frame (%.1f Mpoints/s, %.0f MB/s)", 1000 * copiedSeconds, numPoints / copiedSeconds / 1e6, megabytes / copiedSeconds);
+		sprintf(what, "%d points, streaming", numPoints);
+		Benchmark::report(what, "%.2f ms per frame (%.1f Mpoints/s, %.0f MB/s, %.1fx), %u segments written, %u stalls (%.3f ms waiting)", 1000 * streamedSeconds
+			, numPoints / streamedSeconds / 1e6, megabytes / streamedSeconds, copiedSeconds / streamedSeconds, ringStats.segmentsWritten, ringStats.stalls
+			, 1000 * ringStats.stallSeconds);
+	}
+}
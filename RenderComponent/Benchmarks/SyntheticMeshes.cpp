@@ -0,0 +1,60 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\SyntheticMeshes.h>
+#include <cmath>
+#include <cstdio>
+
+using namespace OpenGLFramework;
+
+namespace {
+	const float PI = 3.14159265358979f;
+
+	//Point of the sphere at ring r (0 = north pole) and segment s
+	inline glm::vec3 spherePoint(unsigned int r, unsigned int s, unsigned int rings, unsigned int segments) {
+		float theta = PI * r / rings, phi = 2 * PI * (s % segments) / segments;
+		return glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+	}
+};
+
+void SyntheticMeshes::makeSphere(unsigned int rings, unsigned int segments, std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals) {
+	vertices.clear(); uvs.clear(); normals.clear();
+	vertices.reserve(6 * rings * segments); uvs.reserve(6 * rings * segments); normals.reserve(6 * rings * segments);
+	for (unsigned int r = 0; r < rings; r++)
+		for (unsigned int s = 0; s < segments; s++) {
+			//Corners of the quad, counter clockwise seen from outside
+			const unsigned int corners[6][2] = { { r, s }, { r + 1, s + 1 }, { r + 1, s }, { r, s }, { r, s + 1 }, { r + 1, s + 1 } };
+			for (int c = 0; c < 6; c++) {
+				glm::vec3 p = spherePoint(corners[c][0], corners[c][1], rings, segments);
+				vertices.push_back(p);
+				normals.push_back(p);
+				uvs.push_back(glm::vec2((float)corners[c][1] / segments, 1.0f - (float)corners[c][0] / rings));
+			}
+		}
+}
+
+void SyntheticMeshes::makeSphere(unsigned int rings, unsigned int segments, std::vector<GLfloat>& vertices, std::vector<GLfloat>& uvs, std::vector<GLfloat>& normals) {
+	std::vector<glm::vec3> v, n;
+	std::vector<glm::vec2> t;
+	makeSphere(rings, segments, v, t, n);
+	vertices.resize(3 * v.size()); uvs.resize(2 * t.size()); normals.resize(3 * n.size());
+	for (size_t i = 0; i < v.size(); i++) {
+		vertices[3 * i] = v[i].x; vertices[3 * i + 1] = v[i].y; vertices[3 * i + 2] = v[i].z;
+		normals[3 * i] = n[i].x; normals[3 * i + 1] = n[i].y; normals[3 * i + 2] = n[i].z;
+		uvs[2 * i] = t[i].x; uvs[2 * i + 1] = t[i].y;
+	}
+}
+
+bool SyntheticMeshes::writeOBJ(const std::string& file, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals) {
+	FILE* f = fopen(file.c_str(), "w");
+	if (!f)
+		return false;
+	fprintf(f, "# Synthetic mesh (RenderBenchmark)\no mesh\n");
+	for (size_t i = 0; i < vertices.size(); i++)
+		fprintf(f, "v %f %f %f\n", vertices[i].x, vertices[i].y, vertices[i].z);
+	for (size_t i = 0; i < uvs.size(); i++)
+		fprintf(f, "vt %f %f\n", uvs[i].x, 1.0f - uvs[i].y);	//The loaders flip V
+	for (size_t i = 0; i < normals.size(); i++)
+		fprintf(f, "vn %f %f %f\n", normals[i].x, normals[i].y, normals[i].z);
+	for (size_t i = 0; i + 2 < vertices.size(); i += 3)
+		fprintf(f, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", (unsigned int)i + 1, (unsigned int)i + 1, (unsigned int)i + 1
+			, (unsigned int)i + 2, (unsigned int)i + 2, (unsigned int)i + 2, (unsigned int)i + 3, (unsigned int)i + 3, (unsigned int)i + 3);
+	return fclose(f) == 0;
+}
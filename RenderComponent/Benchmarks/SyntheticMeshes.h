@@ -0,0 +1,34 @@
+/**********************************************************************
+NAME: SyntheticMeshes
+DESCRIPTION: Geometry generated by the benchmarks (see Benchmark.h), so they do not depend on asset files: any size
+	can be asked for, and every run (and every machine) measures exactly the same data.
+	Meshes come de-indexed, one position, UV and normal per triangle corner, as loadOBJ returns them (MeshWelder turns
+	them into an indexed mesh).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_SYNTHETICMESHES
+#define _OPENGLFRAMEWORK_SYNTHETICMESHES
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+#include <string>
+
+namespace OpenGLFramework {
+	class SyntheticMeshes {
+	public:
+		/**
+			Unit sphere (radius 1, centred at the origin) with rings x segments quads, split in two triangles each
+			(2 * rings * segments triangles).
+		*/
+		static void makeSphere(unsigned int rings, unsigned int segments, std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals);
+		/**
+			Same sphere, as flat arrays of floats (3 per position and normal, 2 per UV), for the renderables built from them.
+		*/
+		static void makeSphere(unsigned int rings, unsigned int segments, std::vector<GLfloat>& vertices, std::vector<GLfloat>& uvs, std::vector<GLfloat>& normals);
+		/**
+			Writes a de-indexed mesh as an OBJ file that loadOBJ (and loadOBJParallel) can read: every corner gets its own
+			v, vt and vn records, and each triangle an "f v/vt/vn v/vt/vn v/vt/vn" line. Returns false if it cannot be written.
+		*/
+		static bool writeOBJ(const std::string& file, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals);
+	};
+};
+#endif
@@ -0,0 +1,133 @@
+#include <OpenGLFramework\Components\RenderComponent\Benchmarks\Benchmark.h>
+#include <OpenGLFramework\Components\RenderComponent\WorldTransformCache.h>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Fixed sequence of random numbers in [0, 1), the same in every run
+	struct Random {
+		unsigned int seed;
+		Random(unsigned int seed) : seed(seed) { ; }
+		inline float next() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; }
+	};
+
+	const unsigned int NUM_FRAMES = 10;
+	const unsigned int NUM_ROOTS = 16;
+
+	//Rotation around Y and a translation, as the local matrix of an object placed in its parent
+	glm::mat4 makeLocal(Random& random) {
+		float angle = 6.2831853f * random.next(), c = cosf(angle), s = sinf(angle);
+		glm::mat4 M(1.0f);
+		M[0][0] = c; M[0][2] = -s; M[2][0] = s; M[2][2] = c;
+		M[3] = glm::vec4(4 * random.next() - 2, 4 * random.next() - 2, 4 * random.next() - 2, 1);
+		return M;
+	}
+
+	//World matrix of a node multiplying the local matrices from its root down (what asking each object for it does)
+	glm::mat4 walkParentChain(const WorldTransformCache& cache, unsigned int node, std::vector<unsigned int>& chain) {
+		chain.clear();
+		for (unsigned int n = node; n != WorldTransformCache::INVALID_NODE; n = cache.getParent(n))
+			chain.push_back(n);
+		glm::mat4 M = cache.getLocalTransform(chain.back());
+		for (size_t i = chain.size() - 1; i-- > 0;)
+			M = M * cache.getLocalTransform(chain[i]);
+		return M;
+	}
+
+	bool close(const glm::mat4& a, const glm::mat4& b) {
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				if (fabsf(a[c][r] - b[c][r]) > 1e-4f * std::max(1.0f, std::max(fabsf(a[c][r]), fabsf(b[c][r]))))
+					return false;
+		return true;
+	}
+
+	//Walking the parent chains vs the cache (on one thread and on all of them), in one hierarchy
+	void measure(const Benchmark::Settings& settings, const char* hierarchy, WorldTransformCache& cache, const std::vector<unsigned int>& nodes) {
+		size_t numNodes = nodes.size();
+		cache.update();
+		//1. Walking the parent chains (nothing is kept between frames, so it costs the same whatever moved)
+		std::vector<glm::mat4> walked(numNodes);
+		std::vector<unsigned int> chain;
+		double walkSeconds = Benchmark::best(settings, [&]() {
+			for (size_t i = 0; i < numNodes; i++)
+				walked[i] = walkParentChain(cache, nodes[i], chain);
+		});
+		size_t chainLength = 0;
+		for (size_t i = 0; i < numNodes; i++) {
+			for (unsigned int n = nodes[i]; n != WorldTransformCache::INVALID_NODE; n = cache.getParent(n))
+				chainLength++;
+		}
+		//2. The cache, on one thread and on all of them
+		const char* names[3] = { "roots move", "1% move", "nothing moves" };
+		double seconds[3][2];
+		unsigned int updated[3], threads[3];
+		std::vector<unsigned int> moving;
+		for (size_t i = 0; i < numNodes; i += 100)
+			moving.push_back(nodes[(i * 7919) % numNodes]);
+		for (int way = 0; way < 2; way++) {
+			cache.setMaxThreads(way == 0 ? 1 : settings.maxThreads);
+			for (int k = 0; k < 3; k++) {
+				seconds[k][way] = Benchmark::best(settings, [&]() {
+					for (unsigned int frame = 0; frame < NUM_FRAMES; frame++) {
+						if (k == 0)
+							for (unsigned int r = 0; r < NUM_ROOTS; r++) cache.setLocalTransform(nodes[r], cache.getLocalTransform(nodes[r]));
+						else if (k == 1)
+							for (size_t m = 0; m < moving.size(); m++) cache.setLocalTransform(moving[m], cache.getLocalTransform(moving[m]));
+						cache.update();
+						updated[k] = cache.getStatistics().nodesUpdated;
+						threads[k] = cache.getStatistics().threads;
+					}
+				}) / NUM_FRAMES;
+			}
+		}
+		cache.setMaxThreads(0);
+		//3. Both must give the same matrices (up to rounding: the cache multiplies with SSE)
+		unsigned int mismatches = 0;
+		for (size_t i = 0; i < numNodes; i++)
+			if (!close(cache.getWorldTransform(nodes[i]), walked[i]))
+				mismatches++;
+		if (mismatches)
+			Benchmark::fail("%s: %u of %u world matrices differ from walking the parent chain", hierarchy, mismatches, (unsigned int)numNodes);
+		if (updated[0] != numNodes || updated[2] != 0)
+			Benchmark::fail("%s: %u nodes updated when the roots moved (%u expected), %u when nothing did", hierarchy, updated[0], (unsigned int)numNodes, updated[2]);
+		char what[64];
+		sprintf(what, "%s: hierarchy", hierarchy);
+		Benchmark::report(what, "%u nodes, %u levels, %.1f nodes per parent chain", (unsigned int)numNodes, cache.getStatistics().levels
+			, (double)chainLength / numNodes);
+		sprintf(what, "%s: walking parent chains", hierarchy);
+		Benchmark::report(what, "%.3f ms per frame", 1000 * walkSeconds);
+		for (int k = 0; k < 3; k++) {
+			sprintf(what, "%s: %s", hierarchy, names[k]);
+			Benchmark::report(what, "%.3f ms per frame on 1 thread (%.0fx faster), %.3f ms on all (%u threads), %u nodes updated", 1000 * seconds[k][0]
+				, walkSeconds / seconds[k][0], 1000 * seconds[k][1], threads[k], updated[k]);
+		}
+	}
+};
+
+//World matrices of 50k nodes, every frame: walking the parent chain of each node vs WorldTransformCache::update, when
+//the roots move (every node changes), when 1% of the nodes move (and their subtrees), and when nothing moves. Two
+//hierarchies: one almost 40 levels deep (each node hangs from a random node in the second half of those created before
+//it), and a wide one of 3 levels (16 roots, 10% of the nodes under them, the rest under those), whose levels are big
+//enough to be split between threads.
+OPENGLFRAMEWORK_BENCHMARK(WorldTransformCache, "World matrices of 50k nodes: cached per frame vs walking parent chains") {
+	size_t numNodes = std::max<size_t>(settings.scaled(50000), NUM_ROOTS + 1);
+	for (int wide = 0; wide < 2; wide++) {
+		Random random(31337);
+		WorldTransformCache cache;
+		std::vector<unsigned int> nodes(numNodes);
+		size_t middle = std::max<size_t>(numNodes / 10, NUM_ROOTS + 1);		//First node of the last level (wide)
+		for (size_t i = 0; i < numNodes; i++) {
+			unsigned int parent = WorldTransformCache::INVALID_NODE;
+			if (i >= NUM_ROOTS && !wide)
+				parent = nodes[i / 2 + (size_t)(random.next() * (i - i / 2))];
+			else if (i >= NUM_ROOTS)
+				parent = (i < middle) ? nodes[(size_t)(random.next() * NUM_ROOTS)] : nodes[NUM_ROOTS + (size_t)(random.next() * (middle - NUM_ROOTS))];
+			nodes[i] = cache.createNode(parent, makeLocal(random));
+		}
+		measure(settings, wide ? "wide" : "deep", cache, nodes);
+	}
+}
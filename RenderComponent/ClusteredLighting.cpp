@@ -0,0 +1,309 @@
+#include <OpenGLFramework\Components\RenderComponent\ClusteredLighting.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderState.h>
+#include <OpenGLFramework\Components\RenderComponent\ProgramCache.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+const float ClusteredLighting::LIGHT_CUTOFF = 1.0f / 256;	//Less than one step of an 8 bit colour
+
+namespace {
+	const unsigned int TILES = ClusteredLighting::CLUSTERS_X * ClusteredLighting::CLUSTERS_Y;
+	const unsigned int SLICES = ClusteredLighting::CLUSTERS_Z;
+	const unsigned int MIN_LIGHTS_PER_THREAD = 32;
+	const float MAX_DEPTH_RATIO = 100000;		//Projections with an infinite far plane: how far we slice the depth
+	const GLenum FORMATS[3] = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+
+	inline unsigned int clampCell(float value, unsigned int cells) {
+		if (!(value > 0)) return 0;
+		return value >= cells - 1 ? cells - 1 : (unsigned int)value;
+	}
+
+	//Does the sphere touch the box?
+	inline bool intersects(const glm::vec3& centre, float radius, const glm::vec3& minimum, const glm::vec3& maximum) {
+		glm::vec3 closest = glm::clamp(centre, minimum, maximum);
+		glm::vec3 d = closest - centre;
+		return glm::dot(d, d) <= radius * radius;
+	}
+}
+
+ClusteredLighting::ClusteredLighting()
+	: users(0), maxThreads(0), P(0.0f), nearPlane(0), farPlane(0), sliceScale(0), logarithmicSlices(false), slices(CLUSTERS_Z)
+{
+	for (int i = 0; i < 3; i++)
+		buffers[i] = textures[i] = 0;
+	stats = Statistics();
+}
+
+ClusteredLighting& ClusteredLighting::instance() {
+	static ClusteredLighting _instance;
+	return _instance;
+}
+
+float ClusteredLighting::computeRadius(const glm::vec3& colour, float power) {
+	float brightest = std::max(colour.x, std::max(colour.y, colour.z));
+	return std::sqrt(std::max(brightest * power, 0.0f) / LIGHT_CUTOFF);
+}
+
+ClusteredLighting::PointLight ClusteredLighting::createLight(const glm::vec3& position, const glm::vec3& colour, float power) {
+	PointLight light;
+	light.position = position;
+	light.colour = colour;
+	light.power = power;
+	light.radius = computeRadius(colour, power);
+	return light;
+}
+
+void ClusteredLighting::acquire() {
+	users++;
+}
+
+void ClusteredLighting::release() {
+	if (users == 0 || --users > 0)
+		return;
+	if (textures[0]) {
+		glDeleteTextures(3, textures);
+		glDeleteBuffers(3, buffers);
+		RenderState::instance().invalidate();	//It might remember our textures as bound
+	}
+	for (int i = 0; i < 3; i++)
+		buffers[i] = textures[i] = 0;
+}
+
+void ClusteredLighting::setupGrid(const glm::mat4& projection) {
+	P = projection;
+	bool perspective = (P[2][3] != 0);
+	//1. Near and far planes, from the projection (glm::perspective/glm::frustum, or glm::ortho)
+	if (perspective) {
+		nearPlane = P[3][2] / (P[2][2] - 1);
+		farPlane = P[3][2] / (P[2][2] + 1);
+		if (!(farPlane > nearPlane) || !std::isfinite(farPlane))
+			farPlane = nearPlane * MAX_DEPTH_RATIO;
+	}
+	else {
+		nearPlane = (P[3][2] + 1) / P[2][2];
+		farPlane = (P[3][2] - 1) / P[2][2];
+	}
+	logarithmicSlices = perspective && nearPlane > 0;
+	sliceScale = logarithmicSlices ? CLUSTERS_Z / std::log(farPlane / nearPlane) : CLUSTERS_Z / (farPlane - nearPlane);
+	//2. The box around each cluster: its tile on screen, between the depths of its slice
+	boxes.resize(NUM_CLUSTERS);
+	for (unsigned int z = 0; z < CLUSTERS_Z; z++) {
+		float depth[2];
+		for (unsigned int s = 0; s < 2; s++)
+			depth[s] = logarithmicSlices ? nearPlane * std::pow(farPlane / nearPlane, (float)(z + s) / CLUSTERS_Z)
+				: nearPlane + (z + s) * (farPlane - nearPlane) / CLUSTERS_Z;
+		for (unsigned int y = 0; y < CLUSTERS_Y; y++)
+			for (unsigned int x = 0; x < CLUSTERS_X; x++) {
+				ClusterBox& box = boxes[x + CLUSTERS_X * (y + CLUSTERS_Y * z)];
+				box.minimum = glm::vec3(FLT_MAX, FLT_MAX, -depth[1]);
+				box.maximum = glm::vec3(-FLT_MAX, -FLT_MAX, -depth[0]);
+				for (unsigned int corner = 0; corner < 8; corner++) {
+					float nx = -1 + 2.0f * (x + (corner & 1)) / CLUSTERS_X;		//Normalised device coordinates
+					float ny = -1 + 2.0f * (y + ((corner >> 1) & 1)) / CLUSTERS_Y;
+					float d = depth[corner >> 2];
+					glm::vec2 p = perspective ? glm::vec2((nx + P[2][0]) * d / P[0][0], (ny + P[2][1]) * d / P[1][1])
+						: glm::vec2((nx - P[3][0]) / P[0][0], (ny - P[3][1]) / P[1][1]);
+					box.minimum = glm::vec3(std::min(box.minimum.x, p.x), std::min(box.minimum.y, p.y), box.minimum.z);
+					box.maximum = glm::vec3(std::max(box.maximum.x, p.x), std::max(box.maximum.y, p.y), box.maximum.z);
+				}
+			}
+	}
+}
+
+void ClusteredLighting::assignSlices(unsigned int begin, unsigned int end) {
+	for (unsigned int z = begin; z < end; z++) {
+		Slice& slice = slices[z];
+		slice.tiles.clear();
+		slice.lights.clear();
+		//1. Test each light against the clusters of this slice it could touch...
+		for (unsigned int l = 0; l < visible.size(); l++) {
+			const ViewLight& light = visible[l];
+			if (z < light.minSlice || z > light.maxSlice)
+				continue;
+			for (unsigned int y = light.minTile[1]; y <= light.maxTile[1]; y++)
+				for (unsigned int x = light.minTile[0]; x <= light.maxTile[0]; x++) {
+					unsigned int tile = x + CLUSTERS_X * y;
+					const ClusterBox& box = boxes[tile + TILES * z];
+					if (intersects(light.position, light.radius, box.minimum, box.maximum)) {
+						slice.tiles.push_back(tile);
+						slice.lights.push_back(l);
+					}
+				}
+		}
+		//2. ... and group them by tile (counting sort: the lights of each tile stay in the order of the list)
+		slice.count.assign(TILES, 0);
+		slice.first.resize(TILES);
+		for (size_t i = 0; i < slice.tiles.size(); i++)
+			slice.count[slice.tiles[i]]++;
+		unsigned int offset = 0;
+		for (unsigned int t = 0; t < TILES; t++) {
+			slice.first[t] = offset;
+			offset += slice.count[t];
+		}
+		slice.sorted.resize(slice.tiles.size());
+		std::vector<unsigned int> next(slice.first);
+		for (size_t i = 0; i < slice.tiles.size(); i++)
+			slice.sorted[next[slice.tiles[i]]++] = slice.lights[i];
+	}
+}
+
+void ClusteredLighting::update(const glm::mat4& projection, const glm::mat4& V) {
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	{
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Light assignment");
+		if (projection != P || boxes.empty())
+			setupGrid(projection);
+		bool perspective = (P[2][3] != 0);
+		//1. Lights in view space, and the range of clusters each one could touch (its bounding box, projected)
+		visible.clear();
+		for (unsigned int i = 0; i < lights.size(); i++) {
+			ViewLight light;
+			light.index = i;
+			light.position = glm::vec3(V * glm::vec4(lights[i].position, 1));
+			light.radius = lights[i].radius;
+			float depth = -light.position.z, r = light.radius;
+			if (!(r > 0) || depth + r < nearPlane || depth - r > farPlane)
+				continue;
+			float ndc[2][2];	//Minimum and maximum x and y, in normalised device coordinates
+			for (int c = 0; c < 2; c++) {
+				float scale = P[c][c], lowest = light.position[c] - r, highest = light.position[c] + r;
+				float a, b;
+				if (!perspective) {
+					a = scale * lowest + P[3][c];
+					b = scale * highest + P[3][c];
+				}
+				else if (depth - r > nearPlane * 0.5f) {	//The sphere is in front of the camera: x/depth is largest at one of the corners
+					float nearest = depth - r, farthest = depth + r;
+					a = scale * std::min(lowest / nearest, lowest / farthest) - P[2][c];
+					b = scale * std::max(highest / nearest, highest / farthest) - P[2][c];
+				}
+				else {												//Around the camera: it could be anywhere on screen
+					a = -1;
+					b = 1;
+				}
+				ndc[c][0] = std::min(a, b);
+				ndc[c][1] = std::max(a, b);
+			}
+			if (ndc[0][0] > 1 || ndc[0][1] < -1 || ndc[1][0] > 1 || ndc[1][1] < -1)
+				continue;
+			const unsigned int cells[2] = { CLUSTERS_X, CLUSTERS_Y };
+			for (int c = 0; c < 2; c++) {
+				light.minTile[c] = clampCell((ndc[c][0] * 0.5f + 0.5f) * cells[c], cells[c]);
+				light.maxTile[c] = clampCell((ndc[c][1] * 0.5f + 0.5f) * cells[c], cells[c]);
+			}
+			float range[2] = { std::max(depth - r, nearPlane), std::min(depth + r, farPlane) };	//Depths, then slices
+			for (int s = 0; s < 2; s++)
+				range[s] = logarithmicSlices ? std::log(range[s] / nearPlane) * sliceScale : (range[s] - nearPlane) * sliceScale;
+			light.minSlice = clampCell(range[0], CLUSTERS_Z);
+			light.maxSlice = clampCell(range[1], CLUSTERS_Z);
+			visible.push_back(light);
+		}
+		//2. Lights of each cluster. The slices are split between several threads
+		unsigned int threads = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+		threads = std::max(1u, std::min(threads, std::min(SLICES, 1 + (unsigned int)visible.size() / MIN_LIGHTS_PER_THREAD)));
+		unsigned int chunk = (SLICES + threads - 1) / threads;
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threads; t++)
+			workers.push_back(std::thread(&ClusteredLighting::assignSlices, this, std::min(SLICES, t * chunk), std::min(SLICES, (t + 1) * chunk)));
+		assignSlices(0, std::min(SLICES, chunk));	//This thread does its share too
+		for (size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+		//3. All the slices, one after the other
+		stats = Statistics();
+		clusterLights.resize(2 * NUM_CLUSTERS);
+		lightIndices.clear();
+		for (unsigned int z = 0; z < CLUSTERS_Z; z++) {
+			const Slice& slice = slices[z];
+			unsigned int offset = (unsigned int)lightIndices.size();
+			for (unsigned int t = 0; t < TILES; t++) {
+				unsigned int cluster = t + TILES * z;
+				clusterLights[2 * cluster] = offset + slice.first[t];
+				clusterLights[2 * cluster + 1] = slice.count[t];
+				stats.maxLightsPerCluster = std::max(stats.maxLightsPerCluster, slice.count[t]);
+				stats.clustersLit += (slice.count[t] > 0);
+			}
+			lightIndices.insert(lightIndices.end(), slice.sorted.begin(), slice.sorted.end());
+		}
+		lightData.resize(2 * visible.size());
+		for (size_t l = 0; l < visible.size(); l++) {
+			const PointLight& light = lights[visible[l].index];
+			lightData[2 * l] = glm::vec4(visible[l].position, light.radius);
+			lightData[2 * l + 1] = glm::vec4(light.colour * light.power, 0);
+		}
+		stats.lights = (unsigned int)lights.size();
+		stats.lightsInFrustum = (unsigned int)visible.size();
+		stats.lightClusterPairs = (unsigned int)lightIndices.size();
+	}
+	std::chrono::high_resolution_clock::time_point assigned = std::chrono::high_resolution_clock::now();
+	stats.assignSeconds = std::chrono::duration<double>(assigned - start).count();
+	{
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Upload light clusters");
+		upload();
+	}
+	stats.uploadSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - assigned).count();
+}
+
+std::vector<unsigned int> ClusteredLighting::getClusterLights(unsigned int x, unsigned int y, unsigned int z) const {
+	std::vector<unsigned int> result;
+	unsigned int cluster = x + CLUSTERS_X * (y + CLUSTERS_Y * z);
+	if (x >= CLUSTERS_X || y >= CLUSTERS_Y || z >= CLUSTERS_Z || clusterLights.empty())
+		return result;
+	for (unsigned int i = 0; i < clusterLights[2 * cluster + 1]; i++)
+		result.push_back(visible[lightIndices[clusterLights[2 * cluster] + i]].index);
+	return result;
+}
+
+void ClusteredLighting::allocateOpenGLResources() {
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+	const unsigned int empty[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(empty), empty, GL_STREAM_DRAW);	//Nothing is lit until the first update
+		RenderState::instance().bindTexture(GL_TEXTURE_BUFFER, TEXTURE_UNIT + i, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, FORMATS[i], buffers[i]);
+	}
+}
+
+void ClusteredLighting::upload() {
+	if (!textures[0])
+		allocateOpenGLResources();
+	//Empty buffers cannot back a texture: the lists always have at least one element
+	if (lightIndices.empty())
+		lightIndices.push_back(0);
+	if (lightData.empty())
+		lightData.resize(2, glm::vec4(0));
+	const void* data[3] = { &clusterLights[0], &lightIndices[0], &lightData[0] };
+	GLsizeiptr bytes[3] = { (GLsizeiptr)(clusterLights.size() * sizeof(unsigned int)), (GLsizeiptr)(lightIndices.size() * sizeof(unsigned int)),
+		(GLsizeiptr)(lightData.size() * sizeof(glm::vec4)) };
+	stats.bytesUploaded = 0;
+	for (int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, bytes[i], data[i], GL_STREAM_DRAW);	//New storage: the GPU might still read last frame's lists
+		stats.bytesUploaded += bytes[i];
+	}
+}
+
+ClusteredLighting::ProgramUniforms ClusteredLighting::getUniformLocations(GLuint program) {
+	ProgramUniforms uniforms;
+	uniforms.clusterLights = ProgramCache::instance().getUniformLocation(program, "ClusterLights");
+	uniforms.lightIndices = ProgramCache::instance().getUniformLocation(program, "LightIndices");
+	uniforms.lightData = ProgramCache::instance().getUniformLocation(program, "LightData");
+	return uniforms;
+}
+
+void ClusteredLighting::bind(const ProgramUniforms& uniforms) {
+	if (!textures[0])
+		allocateOpenGLResources();
+	for (int i = 0; i < 3; i++)
+		RenderState::instance().bindTexture(GL_TEXTURE_BUFFER, TEXTURE_UNIT + i, textures[i]);
+	glUniform1i(uniforms.clusterLights, TEXTURE_UNIT);
+	glUniform1i(uniforms.lightIndices, TEXTURE_UNIT + 1);
+	glUniform1i(uniforms.lightData, TEXTURE_UNIT + 2);
+}
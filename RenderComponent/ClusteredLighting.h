@@ -0,0 +1,139 @@
+/**********************************************************************
+NAME: ClusteredLighting
+DESCRIPTION: Scene-wide list of point lights, for renderables that want to be lit by many lights at once (see
+	PhongShadingOBJMesh_Renderable::setClusteredLighting). Looping over hundreds of lights for every pixel would be far
+	too slow, but each light only reaches a small part of the scene (its radius, see computeRadius). So, every frame:
+		- The view frustum is split into a grid of clusters (CLUSTERS_X x CLUSTERS_Y tiles on screen, and CLUSTERS_Z
+		slices in depth). Slices get exponentially deeper with the distance (as perspective makes far clusters look
+		smaller), or all the same depth with orthographic projections.
+		- On the CPU, we find the lights touching each cluster (the light's sphere against the box around the cluster,
+		in view space). The slices are split between several threads.
+		- The lists are uploaded in three buffer textures (GLSL 3.30 has no storage buffers): the first light and number
+		of lights of each cluster, the light indices of all the clusters one after the other, and the lights themselves
+		(view space position, radius, colour times power).
+		- The fragment shader (shaders/ClusteredPointLightShading.fragmentshader) finds its own cluster and only loops
+		over the lights in it.
+	The RenderableVisitor calls update() once per frame, before rendering, while any renderable uses the lights
+	(acquire/release). Renderables call bind() with their program, to read the lists in texture units TEXTURE_UNIT to
+	TEXTURE_UNIT+2. The grid itself (projection and depth slices) reaches the shaders in the FrameConstants uniform block
+	(see UniformBlocks). getStatistics() tells how many lights reached how many clusters, and how long it took.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_CLUSTEREDLIGHTING
+#define _OPENGLFRAMEWORK_CLUSTEREDLIGHTING
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>	//Replaces the OpenGL calls, if OPENGLFRAMEWORK_RECORDING_GL is defined
+#include <vector>
+
+namespace OpenGLFramework {
+	class ClusteredLighting {
+	public:
+		static const unsigned int CLUSTERS_X = 16, CLUSTERS_Y = 9, CLUSTERS_Z = 24;
+		static const unsigned int NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+		static const unsigned int TEXTURE_UNIT = 1;		//First of the 3 texture units we use (renderables use unit 0 for their texture)
+		static const float LIGHT_CUTOFF;				//Light (power / distance^2) too weak to be seen, used by computeRadius
+		struct PointLight {
+			glm::vec3 position;			//World space
+			glm::vec3 colour;
+			float power;				//As in PhongShadingOBJMesh_Renderable: the light fades with power / distance^2...
+			float radius;				//... and reaches 0 at this distance
+		};
+		struct Statistics {
+			unsigned int lights;				//Lights in the list
+			unsigned int lightsInFrustum;		//Lights whose sphere touches the view frustum
+			unsigned int lightClusterPairs;		//Light indices uploaded (each light, once per cluster it touches)
+			unsigned int maxLightsPerCluster;
+			unsigned int clustersLit;			//Clusters touched by at least one light
+			double assignSeconds;				//CPU time finding the lights of each cluster
+			double uploadSeconds;				//CPU time uploading the lists
+			size_t bytesUploaded;
+		};
+		/**
+			Locations of the uniforms bind() sets, in one program (see getUniformLocations).
+		*/
+		struct ProgramUniforms {
+			GLint clusterLights, lightIndices, lightData;
+		};
+	private:
+		struct ClusterBox {
+			glm::vec3 minimum, maximum;		//View space
+		};
+		struct Slice {						//Work of one depth slice (reused every frame)
+			std::vector<unsigned int> tiles, lights;	//(tile, light) pairs found
+			std::vector<unsigned int> first, count;		//Per tile, in sorted
+			std::vector<unsigned int> sorted;			//Lights of each tile, one tile after the other
+		};
+		struct ViewLight {					//Light in view space, and the clusters it could touch
+			unsigned int index;				//In lights
+			glm::vec3 position;
+			float radius;
+			unsigned int minTile[2], maxTile[2], minSlice, maxSlice;
+		};
+		std::vector<PointLight> lights;
+		unsigned int users;
+		unsigned int maxThreads;
+		//Grid, computed again only when the projection changes
+		glm::mat4 P;
+		float nearPlane, farPlane, sliceScale;
+		bool logarithmicSlices;
+		std::vector<ClusterBox> boxes;
+		//Lists of this frame
+		std::vector<ViewLight> visible;
+		std::vector<Slice> slices;
+		std::vector<unsigned int> clusterLights;	//first, count per cluster
+		std::vector<unsigned int> lightIndices;
+		std::vector<glm::vec4> lightData;			//2 per visible light
+		//OpenGL objects: cluster lights, light indices and light data
+		GLuint buffers[3], textures[3];
+		Statistics stats;
+		ClusteredLighting();
+		void setupGrid(const glm::mat4& P);
+		void assignSlices(unsigned int begin, unsigned int end);
+		void allocateOpenGLResources();
+		void upload();
+	public:
+		static ClusteredLighting& instance();
+		/**
+			The lights of the scene. Change them as you like between frames.
+		*/
+		inline std::vector<PointLight>& getLights() { return lights; }
+		/**
+			Radius beyond which a light of this colour and power is below LIGHT_CUTOFF.
+		*/
+		static float computeRadius(const glm::vec3& colour, float power);
+		static PointLight createLight(const glm::vec3& position, const glm::vec3& colour, float power);
+		/**
+			Renderables using the lights acquire them in allocateOpenGLResources and release them in unallocateAllResources.
+			The buffers are deleted when the last one releases them.
+		*/
+		void acquire();
+		void release();
+		inline bool isInUse() const { return users > 0; }
+		/**
+			Assigns the lights to the clusters of this camera, and uploads the lists. Called by the RenderableVisitor.
+		*/
+		void update(const glm::mat4& P, const glm::mat4& V);
+		/**
+			Lights (indices in the list given by getLights) touching a cluster in the last update.
+		*/
+		std::vector<unsigned int> getClusterLights(unsigned int x, unsigned int y, unsigned int z) const;
+		/**
+			Depth slices of the last update: near plane, far plane, slices per unit (of log depth if w is 1, of depth if it is 0).
+		*/
+		inline glm::vec4 getDepthParameters() const { return glm::vec4(nearPlane, farPlane, sliceScale, logarithmicSlices ? 1.0f : 0.0f); }
+		/**
+			Uniforms of the lists in a program using ClusteredPointLightShading (see ProgramCache::getUniformLocation)...
+		*/
+		static ProgramUniforms getUniformLocations(GLuint program);
+		/**
+			... and binds the lists to them. The program must be in use.
+		*/
+		void bind(const ProgramUniforms& uniforms);
+		inline const Statistics& getStatistics() const { return stats; }
+		/**
+			Limits the threads used by update (0, the default: one per core).
+		*/
+		inline void setMaxThreads(unsigned int threads) { maxThreads = threads; }
+	};
+};
+#endif
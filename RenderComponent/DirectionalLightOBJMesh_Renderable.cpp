@@ -1,57 +1,56 @@
 #include <OpenGLFramework\Components\RenderComponent\DirectionalLightOBJMesh_Renderable.h>
-#include <OpenGLFramework/common/objloader.hpp>
+#include <OpenGLFramework\Components\RenderComponent\ProgramCache.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
 #include <OpenGLFramework\3DUI_Utils\3DUI_Utils.h>
 
 using namespace OpenGLFramework;
 
 bool DirectionalLightOBJMesh_Renderable::loadResourcesToMainMemory(){
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("loadResourcesToMainMemory", getRenderableTypeName());
 
-	// Read our .obj file into our raw data buffers
-	bool res = loadOBJ(model.c_str(), vertices, uvs, normals);
-	this->bb = ThreeDUI_Utils::createAABoundingBox(vertices);
+	// Read our .obj file into our raw data buffers (from its binary cache, if it is up to date. See OBJMeshCache)
+	// If other renderables already loaded this model, we just share their copy (see GPUAssetCache)
+	mesh = GPUAssetCache::instance().acquireMeshData(model);
+	if (!mesh)
+		return false;
+	this->bb = mesh->bb;
 	return true;
 }
 
 bool DirectionalLightOBJMesh_Renderable::allocateOpenGLResources(){
-	/* Load the texture. These methods actually load into main memory, but they also allocate
-	   the texture in the graphics card already, returning a handler for the texture.
-	   We support two formats, one for BMP and ne for DDS.	*/
-	if(		textureName.substr(textureName.find_last_of(".") + 1) == "bmp" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "BMP")
-				Texture = loadBMP_custom(textureName.c_str());  
-	else if(textureName.substr(textureName.find_last_of(".") + 1) == "dds" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "DDS")
-				Texture = loadDDS(textureName.c_str());
-	else if(		textureName.substr(textureName.find_last_of(".") + 1) == "jpg" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "JPG")
-				Texture = loadJPEG(textureName.c_str());  
-	else if(textureName=="")
-		;//The user provided the texture himself/herself. No need to do anything more
-	else //The user did give a name, but it does not have the correct extension...
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("allocateOpenGLResources", getRenderableTypeName());
+	if (!mesh)	//loadResourcesToMainMemory failed (or was not called)
 		return false;
+	/* Load the texture (BMP, DDS or JPEG). If other renderables already loaded the same file, we share theirs (see GPUAssetCache).
+	   These methods actually load into main memory, but they also allocate the texture in the graphics card already, returning a handler for the texture. */
+	if (textureName != "") {
+		Texture = GPUAssetCache::instance().acquireTexture(textureName);
+		if (!Texture)	//The file could not be read, or it does not have a supported extension...
+			return false;
+	}
+	//else: the user provided the texture himself/herself. No need to do anything more
 
-	// Create and compile our GLSL program from the shaders
-	programID = ShaderManager::instance().LoadShaders("OpenGLFramework/shaders/DirectionalLightShading.vertexshader", "OpenGLFramework/shaders/DirectionalLightShading.fragmentshader");
+	// Create and compile our GLSL program from the shaders (shared with other renderables using the same shaders; see ProgramCache)
+	programID = ProgramCache::instance().acquireProgram("OpenGLFramework/shaders/DirectionalLightShading.vertexshader", "OpenGLFramework/shaders/DirectionalLightShading.fragmentshader");
 	// Get a handle for our "MVP" uniform
-	MatrixID = glGetUniformLocation(programID, "MVP");											//MVP matrix (uniform)
-	ModelMatrixID = glGetUniformLocation(programID, "M");										//Model matrix(uniform)
+	MatrixID = ProgramCache::instance().getUniformLocation(programID, "MVP");											//MVP matrix (uniform)
+	ModelMatrixID = ProgramCache::instance().getUniformLocation(programID, "M");										//Model matrix(uniform)
 	// Get a handle for our buffers
-	vertexPosition_modelspaceID = glGetAttribLocation(programID, "vertexPosition_modelspace");	//Array of vertices
-	vertexUVID = glGetAttribLocation(programID, "vertexUV");									//Array of UV coords
-	vertexNormal_modelspaceID = glGetAttribLocation(programID, "vertexNormal_modelspace");		//Array of normals
-	lightID = glGetUniformLocation(programID, "LightDirection_worldspace");						//Direction of light (uniform) 
-	lightColorID = glGetUniformLocation(programID, "LightColor");
-	TextureID  = glGetUniformLocation(programID, "myTextureSampler");							//Texture to use (uniform)
-	// Load object data into OpenGL buffers (VBO)
-	glGenBuffers(1, &vertexbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-	glGenBuffers(1, &uvbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-	glGenBuffers(1, &normalbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+	vertexPosition_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexPosition_modelspace");	//Array of vertices
+	vertexUVID = ProgramCache::instance().getAttribLocation(programID, "vertexUV");									//Array of UV coords
+	vertexNormal_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexNormal_modelspace");		//Array of normals
+	lightID = ProgramCache::instance().getUniformLocation(programID, "LightDirection_worldspace");						//Direction of light (uniform) 
+	lightColorID = ProgramCache::instance().getUniformLocation(programID, "LightColor");
+	TextureID  = ProgramCache::instance().getUniformLocation(programID, "myTextureSampler");							//Texture to use (uniform)
+	// Load object data into OpenGL buffers: a single VBO with the position, UV and normal of each vertex next to each other (interleaved), and the indices.
+	// Renderables using the same model share them (see GPUAssetCache)...
+	meshBuffers = GPUAssetCache::instance().acquireMeshBuffers(model, *mesh, true);
+	if (!meshBuffers.vertexBuffer)	//Empty mesh, or its attribute arrays do not match
+		return false;
+	// ... and a VAO that remembers how our shader attributes read from it. render() only needs to bind it.
+	VertexFormat format;
+	format.add(vertexPosition_modelspaceID, 3).add(vertexUVID, 2).add(vertexNormal_modelspaceID, 3);
+	vertexArrayID = format.createVertexArray(meshBuffers.vertexBuffer, meshBuffers.elementBuffer);
 
 	return true;
 }
@@ -59,71 +58,37 @@ bool DirectionalLightOBJMesh_Renderable::allocateOpenGLResources(){
 bool DirectionalLightOBJMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 	if(!OpenGL_Renderable::render(P, V))return false;
 	// Use our shader
-		glUseProgram(programID);
+		RenderState::instance().useProgram(programID);
 
 		// Send our transformation to the currently bound shader, 
 		// in the "MVP" uniform
-		glm::mat4 MVP = P * V * getOwner()->getFromObjectToWorldCoordinates();
+		glm::mat4 M = getModelMatrix();
+		glm::mat4 MVP = P * V * M;
 		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &getOwner()->getFromObjectToWorldCoordinates()[0][0]);////We need to put our vertices in world coordinates (the light is in world coordinates)
+		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &M[0][0]);////We need to put our vertices in world coordinates (the light is in world coordinates)
 		glUniform3f(lightID, lightDir.x, lightDir.y, lightDir.z);
 		glUniform3f(lightColorID, lightColor.x, lightColor.y, lightColor.z);
-		// Bind our texture in Texture Unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Texture);
+		// Bind our texture in Texture Unit 0 (RenderState skips it if it is already bound)
+		RenderState::instance().bindTexture2D(0, Texture);
 		// Set our "myTextureSampler" sampler to user Texture Unit 0
 		glUniform1i(TextureID, 0);
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(vertexPosition_modelspaceID);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glVertexAttribPointer(
-			vertexPosition_modelspaceID,  // The attribute we want to configure
-			3,                            // size
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(vertexUVID);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glVertexAttribPointer(
-			vertexUVID,                   // The attribute we want to configure
-			2,                            // size : U+V => 2
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(vertexNormal_modelspaceID);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-		glVertexAttribPointer(
-			vertexNormal_modelspaceID,    // The attribute we want to configure
-			3,                            // size
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-		
-		// Draw the triangles !
-		//glPointSize(16);
-		glDrawArrays(getRenderPrimitive(), 0, vertices.size()); //Other primitives: GL_LINE_STRIP, GL_TRIANGLES
-		glDisableVertexAttribArray(vertexPosition_modelspaceID);
-		glDisableVertexAttribArray(vertexUVID);	
-		glDisableVertexAttribArray(vertexNormal_modelspaceID);
+		// Bind our vertices and indices (the VAO has all our attributes configured already)
+		RenderState::instance().bindVertexArray(vertexArrayID);
+		// Draw the triangles (indexed: each vertex is shared by several triangles) of our level of detail (a range of the element buffer, see MeshData)!
+		unsigned int level = lod.getLevel(*mesh);
+		glDrawElements(getRenderPrimitive(), (GLsizei)mesh->getLevelNumIndices(level), GL_UNSIGNED_INT, (void*)(mesh->getLevelFirstIndex(level) * sizeof(unsigned int)));
 	return true;
 }
 
 bool DirectionalLightOBJMesh_Renderable::unallocateAllResources(){
-	// Cleanup VBO and shader
-	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &uvbuffer);
-	glDeleteBuffers(1, &normalbuffer);
-	glDeleteProgram(programID);
-	glDeleteTextures(1, &TextureID);
+	// Cleanup VAO, buffers and shader
+	glDeleteVertexArrays(1, &vertexArrayID);
+	GPUAssetCache::instance().releaseMeshBuffers(meshBuffers);
+	ProgramCache::instance().releaseProgram(programID);
+	// Textures loaded from a file are shared with other renderables: the cache deletes them when nobody uses them.
+	// Textures provided by the user are not ours to delete.
+	if (textureName != "")
+		GPUAssetCache::instance().releaseTexture(Texture);
+	mesh.reset();
 	return true;
 }
@@ -17,6 +17,10 @@ NEXT OBJECT TO CHECK: PhongShadingOBJMesh_Renderable (and that is the last one..
 #ifndef _DIRECTIONAL_LIGHT_OBJ_MESH_RENDERABLE
 #define _DIRECTIONAL_LIGHT_OBJ_MESH_RENDERABLE
 #include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\VertexFormat.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\LODSelector.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshWelder.h>
 #include <vector>
 
 namespace OpenGLFramework {
@@ -24,10 +28,8 @@ namespace OpenGLFramework {
 		//Config parameters
 		std::string textureName, model;
 		//std::string vertexShader, fragmentShader; //This is fixed, as the arguments (see "vertexPosition_modelspace" "myTextureSampler" init) are specific for the shaders, changing programs makes no sense...
-		//Raw data (as read from a file, etc...)
-		std::vector<glm::vec3> vertices;
-		std::vector<glm::vec2> uvs;
-		std::vector<glm::vec3> normals;
+		//Raw data (as read from a file, etc...). Renderables loading the same model share it (see GPUAssetCache)
+		std::shared_ptr<const MeshData> mesh;
 		glm::vec3 lightDir;
 		glm::vec3 lightColor;
 		//float lightPower;	//Power does not affect directional light (Excercise: Why? How is it different from PointLight?)
@@ -43,9 +45,9 @@ namespace OpenGLFramework {
 		GLuint TextureID;
 		//Actual OpenGL data structures
 		GLuint Texture;
-		GLuint vertexbuffer;
-		GLuint uvbuffer;
-		GLuint normalbuffer;
+		GPUAssetCache::MeshBuffers meshBuffers;	//Interleaved positions, UVs, normals and indices (shared, see GPUAssetCache)
+		GLuint vertexArrayID;				//VAO: how our shader attributes read from meshBuffers
+		LODSelector lod;					//Level of detail drawn this frame (see MeshSimplifier)
 
 	public:
 		//Own methods
@@ -55,11 +57,28 @@ namespace OpenGLFramework {
 			;
 		}
 		inline void configureDirectionalLight(glm::vec3 dir, glm::vec3 color) { lightDir = dir; lightColor = color; }		
+		/**
+			Memory used by our buffers, before (one vertex per triangle corner, as read from the file) and after welding the mesh.
+		*/
+		inline MeshWelder::Report getMeshMemoryReport() { return (mesh ? MeshWelder::computeReport(mesh->vertices.size(), mesh->indices.size()) : MeshWelder::computeReport(0, 0)); }
 		//Methods inherited from base class OpenGL_Renderable
 		virtual bool loadResourcesToMainMemory();
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "DirectionalLightOBJMesh_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getTexture() { return Texture; }
+		virtual GLuint getMesh() { return vertexArrayID; }
+		virtual std::shared_ptr<const MeshData> getMeshData() { return mesh; }
+		virtual unsigned int selectLevelOfDetail(float screenSize, float tolerance) { return mesh ? lod.select(*mesh, screenSize, tolerance) : 0; }
+		virtual bool getSurfaceDescription(SurfaceDescription& surface) {
+			surface.lighting = SurfaceDescription::DIRECTIONAL_LIGHT;
+			surface.textureFile = textureName;
+			surface.lightDirection = lightDir;
+			surface.lightColor = lightColor;
+			return true;
+		}
 	};
 };
 #endif
\ No newline at end of file
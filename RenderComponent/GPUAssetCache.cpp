@@ -0,0 +1,263 @@
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\OBJMeshCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\VertexQuantiser.h>
+#include <OpenGLFramework\Components\RenderComponent\VertexFormat.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderState.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <OpenGLFramework/common/texture.hpp>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+
+using namespace OpenGLFramework;
+
+GPUAssetCache::GPUAssetCache() {
+	memset(&stats, 0, sizeof(stats));
+}
+
+GPUAssetCache& GPUAssetCache::instance() {
+	static GPUAssetCache _instance;
+	return _instance;
+}
+
+std::string GPUAssetCache::canonicalPath(const std::string& fileName) {
+	std::string result = fileName;
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, fileName.c_str(), _MAX_PATH))
+		result = buffer;
+	//Windows paths are not case sensitive, and accept both separators
+	for (size_t i = 0; i < result.size(); i++)
+		result[i] = (result[i] == '/') ? '\\' : (char)tolower((unsigned char)result[i]);
+#else
+	char* resolved = realpath(fileName.c_str(), NULL);
+	if (resolved) {
+		result = resolved;
+		free(resolved);
+	}
+#endif
+	return result;
+}
+
+unsigned long long GPUAssetCache::measureTexture(GLuint texture) {
+	unsigned long long bytes = 0;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	for (GLint level = 0; level < 16; level++) {		//Add up all the mipmap levels
+		GLint width = 0, height = 0, compressed = GL_FALSE;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+		if (width == 0 || height == 0)
+			break;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {	//DDS textures (DXT)
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size;
+		}
+		else bytes += (unsigned long long)width * height * 4;	//Assume RGBA8 (the driver usually pads RGB8 to 4 bytes)
+	}
+	RenderState::instance().invalidate();	//We (and the texture loaders) changed the texture bound behind RenderState's back
+	return bytes;
+}
+
+GLuint GPUAssetCache::acquireTexture(const std::string& fileName) {
+	if (fileName == "")
+		return 0;
+	std::string key = canonicalPath(fileName);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (texturesLoading.count(key))		//Somebody else is loading it: wait for their texture
+			texturesLoaded.wait(lock);
+		std::map<std::string, TextureEntry>::iterator it = textures.find(key);
+		if (it != textures.end()) {
+			it->second.users++;
+			stats.textureHits++;
+			stats.bytesShared += it->second.bytes;
+			return it->second.texture;
+		}
+		texturesLoading.insert(key);
+	}
+	//Not loaded yet. We load it without holding the lock (reading and decoding the file can take a while).
+	//We support BMP, DDS and JPEG files. These methods load the file and create the texture in the GPU.
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Load texture");
+	std::string extension = fileName.substr(fileName.find_last_of(".") + 1);
+	for (size_t i = 0; i < extension.size(); i++)
+		extension[i] = (char)tolower((unsigned char)extension[i]);
+	GLuint texture = 0;
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+	if (RecordingGL::instance().getMode() == RecordingGL::HEADLESS)	//No OpenGL to load it into: we do not even read the file
+		texture = RecordingGL::instance().createHeadlessTexture();
+	else
+#endif
+	if (extension == "bmp")
+		texture = loadBMP_custom(fileName.c_str());
+	else if (extension == "dds")
+		texture = loadDDS(fileName.c_str());
+	else if (extension == "jpg" || extension == "jpeg")
+		texture = loadJPEG(fileName.c_str());
+	unsigned long long bytes = texture ? measureTexture(texture) : 0;
+	std::lock_guard<std::mutex> lock(mutex);
+	texturesLoading.erase(key);
+	texturesLoaded.notify_all();
+	if (!texture)
+		return 0;
+	TextureEntry e = { texture, 1, bytes };
+	textures[key] = e;
+	textureFiles[texture] = key;
+	stats.textureMisses++;
+	return texture;
+}
+
+void GPUAssetCache::releaseTexture(GLuint texture) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<GLuint, std::string>::iterator file = textureFiles.find(texture);
+	if (file == textureFiles.end())
+		return;		//Not ours
+	std::map<std::string, TextureEntry>::iterator it = textures.find(file->second);
+	if (--it->second.users == 0) {
+		glDeleteTextures(1, &texture);
+		textures.erase(it);
+		textureFiles.erase(file);
+	}
+}
+
+std::shared_ptr<const MeshData> GPUAssetCache::acquireMeshData(const std::string& objFile) {
+	std::string key = canonicalPath(objFile);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (meshDataLoading.count(key))		//Somebody else is loading it: wait for their copy
+			meshDataLoaded.wait(lock);
+		std::map<std::string, MeshDataEntry>::iterator it = meshData.find(key);
+		if (it != meshData.end()) {
+			std::shared_ptr<const MeshData> data = it->second.data.lock();
+			if (data) {
+				stats.meshDataHits++;
+				stats.bytesShared += it->second.bytes;
+				return data;
+			}
+		}
+		meshDataLoading.insert(key);
+	}
+	//Load it without holding the lock (it can take a while, and other threads may want other meshes)
+	std::shared_ptr<MeshData> data(new MeshData());
+	bool loaded = OBJMeshCache::instance().load(objFile, *data);
+	std::lock_guard<std::mutex> lock(mutex);
+	meshDataLoading.erase(key);
+	meshDataLoaded.notify_all();
+	if (!loaded)
+		return std::shared_ptr<const MeshData>();
+	MeshDataEntry& e = meshData[key];
+	e.data = data;
+	e.bytes = data->getSizeInBytes();
+	stats.meshDataMisses++;
+	return data;
+}
+
+GPUAssetCache::MeshBuffers GPUAssetCache::uploadMeshBuffers(const MeshData& mesh, bool withNormals, bool quantised) {
+	MeshBuffers buffers = { 0, 0 };
+	if (mesh.vertices.empty())
+		return buffers;
+	//The vertex formats count a UV (and a normal, withNormals) for every vertex: arrays that do not have one are an error, 
+	//not something to leave out of the buffer
+	if (mesh.uvs.size() != mesh.vertices.size() || (withNormals && mesh.normals.size() != mesh.vertices.size())) {
+		printf("Mesh has %u vertices but %u UVs and %u normals: cannot upload it\n", (unsigned int)mesh.vertices.size()
+			, (unsigned int)mesh.uvs.size(), (unsigned int)mesh.normals.size());
+		return buffers;
+	}
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Upload mesh buffers");
+	//The element buffer binding is part of the VAO state: make sure we are not modifying somebody else's VAO
+	RenderState::instance().bindVertexArray(0);
+	glGenBuffers(1, &buffers.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+	if (quantised) {
+		std::vector<unsigned char> quantisedData;
+		VertexQuantiser::encode(mesh, withNormals, quantisedData);
+		glBufferData(GL_ARRAY_BUFFER, quantisedData.size(), &quantisedData[0], GL_STATIC_DRAW);
+	}
+	else {
+		std::vector<GLfloat> interleavedData = VertexFormat::interleave(mesh.vertices, &mesh.uvs, withNormals ? &mesh.normals : NULL);
+		glBufferData(GL_ARRAY_BUFFER, interleavedData.size() * sizeof(GLfloat), &interleavedData[0], GL_STATIC_DRAW);
+	}
+	if (!mesh.indices.empty()) {
+		glGenBuffers(1, &buffers.elementBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.elementBuffer);
+		GLsizeiptr fullBytes = mesh.indices.size() * sizeof(unsigned int), lodBytes = mesh.lodIndices.size() * sizeof(unsigned int);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, fullBytes + lodBytes, lodBytes ? NULL : &mesh.indices[0], GL_STATIC_DRAW);
+		if (lodBytes) {		//The levels of detail go right after the full mesh
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, fullBytes, &mesh.indices[0]);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, fullBytes, lodBytes, &mesh.lodIndices[0]);
+		}
+	}
+	return buffers;
+}
+
+void GPUAssetCache::deleteMeshBuffers(const MeshBuffers& buffers) {
+	if (buffers.vertexBuffer) glDeleteBuffers(1, &buffers.vertexBuffer);
+	if (buffers.elementBuffer) glDeleteBuffers(1, &buffers.elementBuffer);
+}
+
+GPUAssetCache::MeshBuffers GPUAssetCache::acquireMeshBuffers(const std::string& objFile, const MeshData& mesh, bool withNormals, bool quantised) {
+	std::string key = canonicalPath(objFile) + (withNormals ? "|pos,uv,normal" : "|pos,uv") + (quantised ? "|quantised" : "");
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<std::string, MeshBufferEntry>::iterator it = meshBuffers.find(key);
+	if (it != meshBuffers.end()) {
+		it->second.users++;
+		stats.meshBufferHits++;
+		stats.bytesShared += it->second.bytes;
+		return it->second.buffers;
+	}
+	MeshBufferEntry e;
+	e.buffers = uploadMeshBuffers(mesh, withNormals, quantised);
+	if (!e.buffers.vertexBuffer)
+		return e.buffers;
+	e.users = 1;
+	e.bytes = mesh.vertices.size() * (quantised ? VertexQuantiser::getBytesPerVertex(withNormals) : sizeof(GLfloat) * (withNormals ? 8 : 5))
+		+ (mesh.indices.size() + mesh.lodIndices.size()) * sizeof(unsigned int);
+	meshBuffers[key] = e;
+	meshBufferFiles[e.buffers.vertexBuffer] = key;
+	stats.meshBufferMisses++;
+	return e.buffers;
+}
+
+void GPUAssetCache::releaseMeshBuffers(const MeshBuffers& buffers) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<GLuint, std::string>::iterator file = meshBufferFiles.find(buffers.vertexBuffer);
+	if (file == meshBufferFiles.end())
+		return;		//Not ours
+	std::map<std::string, MeshBufferEntry>::iterator it = meshBuffers.find(file->second);
+	if (--it->second.users == 0) {
+		deleteMeshBuffers(it->second.buffers);
+		meshBuffers.erase(it);
+		meshBufferFiles.erase(file);
+	}
+}
+
+GPUAssetCache::Statistics GPUAssetCache::getStatistics() {
+	std::lock_guard<std::mutex> lock(mutex);
+	Statistics result = stats;
+	result.textureBytes = result.meshDataBytes = result.meshBufferBytes = 0;
+	for (std::map<std::string, TextureEntry>::iterator it = textures.begin(); it != textures.end(); it++)
+		result.textureBytes += it->second.bytes;
+	result.texturesLoaded = (unsigned int)textures.size();
+	//Forget the meshes nobody is using anymore (their memory was already freed by their last user)
+	result.meshDataLoaded = 0;
+	std::map<std::string, MeshDataEntry>::iterator it = meshData.begin();
+	while (it != meshData.end()) {
+		if (it->second.data.expired())
+			meshData.erase(it++);
+		else {
+			result.meshDataBytes += it->second.bytes;
+			result.meshDataLoaded++;
+			it++;
+		}
+	}
+	for (std::map<std::string, MeshBufferEntry>::iterator it = meshBuffers.begin(); it != meshBuffers.end(); it++)
+		result.meshBufferBytes += it->second.bytes;
+	result.meshBuffersLoaded = (unsigned int)meshBuffers.size();
+	return result;
+}
+
+void GPUAssetCache::resetStatistics() {
+	std::lock_guard<std::mutex> lock(mutex);
+	memset(&stats, 0, sizeof(stats));
+}
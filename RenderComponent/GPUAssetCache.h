@@ -0,0 +1,110 @@
+/**********************************************************************
+NAME: GPUAssetCache
+DESCRIPTION: Shares textures and meshes among the renderables that use the same files. Without it, ten objects showing 
+	rock.obj with rock.dds would each load their own copy of the mesh (in main memory and in the GPU) and of the texture.
+	Assets are identified by the canonical path of their file (so "models/../models/rock.obj" and "models/rock.obj" match),
+	and are reference counted:
+		- Textures and mesh buffers (VBO + element buffer) are acquired in allocateOpenGLResources() and released in 
+		unallocateAllResources(). They are deleted from the GPU when their last user releases them.
+		- Mesh data (the geometry in main memory, see MeshData) is handed out as a std::shared_ptr. It is freed when the 
+		last renderable holding it lets it go.
+	The counters tell how often an asset was found already loaded (hits), and how much memory the loaded assets use.
+	Textures provided directly by the user (a texture handler, a Render To Texture...) are not managed by the cache.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_GPUASSETCACHE
+#define _OPENGLFRAMEWORK_GPUASSETCACHE
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+
+namespace OpenGLFramework {
+	class GPUAssetCache {
+	public:
+		struct MeshBuffers {
+			GLuint vertexBuffer;		//Interleaved positions, UVs (and normals), see VertexFormat::interleave (or VertexQuantiser, if quantised)
+			GLuint elementBuffer;		//Indices
+		};
+		struct Statistics {
+			unsigned int textureHits, textureMisses;
+			unsigned int meshDataHits, meshDataMisses;
+			unsigned int meshBufferHits, meshBufferMisses;
+			unsigned int texturesLoaded, meshDataLoaded, meshBuffersLoaded;		//Assets currently in memory
+			unsigned long long textureBytes;		//GPU memory used by the textures loaded
+			unsigned long long meshDataBytes;		//Main memory used by the mesh data loaded
+			unsigned long long meshBufferBytes;		//GPU memory used by the mesh buffers loaded
+			unsigned long long bytesShared;			//Bytes we did not need to load again, thanks to the hits
+		};
+	private:
+		struct TextureEntry {
+			GLuint texture;
+			unsigned int users;
+			unsigned long long bytes;
+		};
+		struct MeshDataEntry {
+			std::weak_ptr<const MeshData> data;		//Does not keep the mesh alive: its users do
+			unsigned long long bytes;
+		};
+		struct MeshBufferEntry {
+			MeshBuffers buffers;
+			unsigned int users;
+			unsigned long long bytes;
+		};
+		std::map<std::string, TextureEntry> textures;
+		std::map<GLuint, std::string> textureFiles;			//To find the entry of a texture we are releasing
+		std::map<std::string, MeshDataEntry> meshData;
+		std::map<std::string, MeshBufferEntry> meshBuffers;
+		std::map<GLuint, std::string> meshBufferFiles;		//To find the entry of the buffers we are releasing (by their vertex buffer)
+		Statistics stats;
+		std::mutex mutex;									//Mesh data and textures can be loaded from several threads at once
+		std::set<std::string> meshDataLoading;				//Meshes being loaded right now (other threads wait for them)
+		std::condition_variable meshDataLoaded;
+		std::set<std::string> texturesLoading;				//Textures being loaded right now (the same, for textures)
+		std::condition_variable texturesLoaded;
+		GPUAssetCache();
+		static unsigned long long measureTexture(GLuint texture);
+	public:
+		static GPUAssetCache& instance();
+		/**
+			Returns a unique name for a file (absolute path, with the same separators and case for the same file).
+		*/
+		static std::string canonicalPath(const std::string& fileName);
+		/**
+			Loads the texture in the file (.bmp, .dds or .jpg), or returns the one we already loaded. 0 if it could not be loaded.
+			Each successful call must be matched by one call to releaseTexture. The file is read without holding the lock
+			(other threads can use the cache meanwhile); if another thread is loading the same texture, we wait for it.
+		*/
+		GLuint acquireTexture(const std::string& fileName);
+		void releaseTexture(GLuint texture);
+		/**
+			Loads an OBJ model (see OBJMeshCache), or returns the copy already in memory. NULL if it could not be loaded.
+			If another thread is loading the same model, we wait for it instead of loading it twice.
+		*/
+		std::shared_ptr<const MeshData> acquireMeshData(const std::string& objFile);
+		/**
+			Returns the GPU buffers of an OBJ model (loaded with acquireMeshData), uploading mesh if they do not exist yet.
+			Renderables that do not use normals get buffers without them (withNormals = false), so the same model 
+			can have two sets of buffers. Each call must be matched by one call to releaseMeshBuffers.
+			Renderables that decode quantised vertices in their shaders ask for quantised buffers (see VertexQuantiser), which
+			take half the memory. These are also different buffers.
+		*/
+		MeshBuffers acquireMeshBuffers(const std::string& objFile, const MeshData& mesh, bool withNormals, bool quantised = false);
+		void releaseMeshBuffers(const MeshBuffers& buffers);
+		/**
+			Uploads a mesh to new buffers, without sharing them (e.g. geometry provided by the user). 
+			The element buffer has the indices of the full mesh followed by those of its levels of detail (see MeshData).
+			The mesh needs a UV per vertex, and a normal per vertex if withNormals. If it does not (or it is empty), no buffers 
+			are created (vertexBuffer is 0).
+			Delete them with deleteMeshBuffers.
+		*/
+		static MeshBuffers uploadMeshBuffers(const MeshData& mesh, bool withNormals, bool quantised = false);
+		static void deleteMeshBuffers(const MeshBuffers& buffers);
+		Statistics getStatistics();
+		void resetStatistics();		//Resets the hit/miss counters (the memory counters describe what is loaded now)
+	};
+};
+#endif
@@ -0,0 +1,17 @@
+#include <OpenGLFramework\Components\RenderComponent\InstanceBatches.h>
+
+using namespace OpenGLFramework;
+
+InstanceBatches& InstanceBatches::instance() {
+	static InstanceBatches _instance;
+	return _instance;
+}
+
+unsigned int InstanceBatches::getBatchID(const std::string& assetDescription) {
+	std::map<std::string, unsigned int>::iterator it = batchIDs.find(assetDescription);
+	if (it != batchIDs.end())
+		return it->second;
+	unsigned int id = (unsigned int)batchIDs.size() + 1;
+	batchIDs[assetDescription] = id;
+	return id;
+}
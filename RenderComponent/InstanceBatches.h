@@ -0,0 +1,29 @@
+/**********************************************************************
+NAME: InstanceBatches
+DESCRIPTION: Gives a small number (batch ID) to each different asset used by instanceable renderables.
+	An asset is described by a string that includes everything that affects how it looks: the renderable type, 
+	the model and texture files, the material, etc... (e.g. "TexturedOBJ|tree.obj|bark.bmp").
+	Renderables showing the same asset get the same batch ID. The RenderQueue draws all the visible renderables 
+	of a batch with a single instanced draw call (see OpenGL_Renderable::renderInstanced), so the number of draw 
+	calls depends on the number of different assets in view, not on the number of objects.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_INSTANCEBATCHES
+#define _OPENGLFRAMEWORK_INSTANCEBATCHES
+#include "OpenGLFRameworkPrerequisites.h"
+#include <map>
+
+namespace OpenGLFramework {
+	class InstanceBatches {
+		std::map<std::string, unsigned int> batchIDs;
+		InstanceBatches() { ; }
+	public:
+		static InstanceBatches& instance();
+		/**
+			Returns the ID for the asset described (IDs start at 1; 0 means "cannot be instanced").
+		*/
+		unsigned int getBatchID(const std::string& assetDescription);
+		inline size_t getNumBatches() const { return batchIDs.size(); }
+	};
+};
+#endif
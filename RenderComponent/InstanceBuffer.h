@@ -0,0 +1,49 @@
+/**********************************************************************
+NAME: InstanceBuffer
+DESCRIPTION: Vertex buffer with one model matrix per instance, used by renderables that support instanced rendering
+	(see OpenGL_Renderable::renderInstanced). The matrices change every frame (objects move, different objects are 
+	visible...), so the buffer is refilled before each instanced draw. We ask OpenGL for a new storage each time 
+	(buffer "orphaning"), so that it does not need to wait for the GPU to finish drawing with the previous contents.
+	The shader reads the matrix as a mat4 attribute whose divisor is 1 (it advances once per instance, not per vertex).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_INSTANCEBUFFER
+#define _OPENGLFRAMEWORK_INSTANCEBUFFER
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\VertexFormat.h>
+
+namespace OpenGLFramework {
+	class InstanceBuffer {
+		GLuint buffer;
+		GLsizeiptr capacity;		//Bytes allocated in the GPU
+	public:
+		InstanceBuffer() : buffer(0), capacity(0) { ; }
+		/**
+			Makes the attribute at modelMatrixLocation (a mat4 in the shader) read from this buffer, one matrix per instance.
+			This is stored in the VAO currently bound.
+		*/
+		inline void setupAttributes(GLuint modelMatrixLocation) {
+			if (!buffer)
+				glGenBuffers(1, &buffer);
+			VertexFormat().addMatrix4(modelMatrixLocation).setDivisor(1).setupAttributes(buffer);
+		}
+		/**
+			Copies the matrices to the GPU (replacing the previous ones).
+		*/
+		inline void upload(const glm::mat4* modelMatrices, unsigned int count) {
+			GLsizeiptr bytes = count * sizeof(glm::mat4);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			if (bytes > capacity)
+				capacity = bytes + bytes / 2;	//Grow with some slack, so we do not reallocate every time one more object is visible
+			glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);	//Orphan the old storage
+			glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, modelMatrices);
+		}
+		inline void release() {
+			if (buffer)
+				glDeleteBuffers(1, &buffer);
+			buffer = 0;
+			capacity = 0;
+		}
+	};
+};
+#endif
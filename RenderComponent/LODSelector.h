@@ -0,0 +1,61 @@
+/**********************************************************************
+NAME: LODSelector
+DESCRIPTION: Chooses the level of detail of a mesh (see MeshData and MeshSimplifier) that a renderable draws this frame.
+	The RenderableVisitor tells each renderable how big it is on screen (screenSize: the diameter of its bounding sphere,
+	as a fraction of the screen's height; see computeScreenSize). The error of a level (how far its surface is from the
+	full mesh) shrinks on screen by the same amount, so we pick the simplest level whose error on screen is below a
+	tolerance (about a pixel, by default).
+	An object right where two levels meet would keep switching between them as the camera moves a little (popping).
+	To avoid it, we only move to a simpler level once its error is clearly below the tolerance, and only go back to a
+	finer one once the current error is clearly above it (HYSTERESIS).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_LODSELECTOR
+#define _OPENGLFRAMEWORK_LODSELECTOR
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <cfloat>
+
+namespace OpenGLFramework {
+	class LODSelector {
+		unsigned int level;
+	public:
+		LODSelector() : level(0) { ; }
+		/**
+			Diameter (on screen, as a fraction of the screen's height) of a sphere of this radius, viewDepth units in front
+			of the camera. Spheres around the camera get FLT_MAX (they are always drawn in full detail).
+		*/
+		static inline float computeScreenSize(float radius, float viewDepth, const glm::mat4& P) {
+			if (P[2][3] == 0)			//Orthographic projection: sizes do not depend on the distance
+				return radius * P[1][1];
+			if (viewDepth <= radius)
+				return FLT_MAX;
+			return radius * P[1][1] / viewDepth;
+		}
+		/**
+			Chooses (and returns) the level to draw, for a mesh this big on screen. tolerance: the error allowed on screen,
+			as a fraction of its height (0 = always the full mesh).
+		*/
+		inline unsigned int select(const MeshData& mesh, float screenSize, float tolerance) {
+			const float HYSTERESIS = 0.25f;
+			const BoundingBox& bb = mesh.bb;
+			float diameter = glm::length(glm::vec3(bb.xmax - bb.xmin, bb.ymax - bb.ymin, bb.zmax - bb.zmin));
+			if (mesh.getNumLevelsOfDetail() == 1 || !(tolerance > 0) || !(diameter > 0) || screenSize >= FLT_MAX)
+				return level = 0;
+			float errorToScreen = screenSize / diameter;
+			unsigned int best = 0;
+			for (unsigned int l = 1; l < mesh.getNumLevelsOfDetail(); l++) {	//Errors grow with the level
+				float limit = tolerance * (l <= level ? 1 + HYSTERESIS : 1 - HYSTERESIS);
+				if (mesh.getLevelError(l) * errorToScreen > limit)
+					break;
+				best = l;
+			}
+			return level = best;
+		}
+		/**
+			Level chosen by the last select() (the full mesh if that level does not exist in this mesh).
+		*/
+		inline unsigned int getLevel(const MeshData& mesh) const { return level < mesh.getNumLevelsOfDetail() ? level : 0; }
+	};
+};
+#endif
@@ -0,0 +1,38 @@
+/**********************************************************************
+NAME: MappedFile
+DESCRIPTION: Read-only memory mapping of a whole file. The operating system pages the file in on demand,
+	so large binary assets (e.g. the mesh cache, see OBJMeshCache) can be accessed as a plain array of bytes
+	without reading them into our own buffers first.
+	The mapping is released when the object is destroyed (or when close() is called).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MAPPEDFILE
+#define _OPENGLFRAMEWORK_MAPPEDFILE
+#include <string>
+#include <cstddef>
+
+namespace OpenGLFramework {
+	class MappedFile {
+		const char* data;				//Start of the mapped view (NULL if nothing is mapped)
+		size_t size;					//Size of the file (and of the view), in bytes
+#ifdef _WIN32
+		void* fileHandle, *mappingHandle;
+#endif
+		//Mappings cannot be copied (they would be released twice)
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+	public:
+		MappedFile();
+		~MappedFile();
+		/**
+			Maps the file for reading. Returns false if the file does not exist or cannot be mapped.
+			Empty files cannot be mapped either.
+		*/
+		bool open(const std::string& fileName);
+		void close();
+		inline bool isOpen() const { return data != NULL; }
+		inline const char* getData() const { return data; }
+		inline size_t getSize() const { return size; }
+	};
+};
+#endif
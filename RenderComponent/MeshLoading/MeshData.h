@@ -0,0 +1,45 @@
+/**********************************************************************
+NAME: MeshData
+DESCRIPTION: Geometry of a mesh in main memory: an indexed triangle list (unique vertices with their UVs and normals,
+	plus 3 indices per triangle) and its bounding box. 
+	Renderables loading the same model share one MeshData (see GPUAssetCache), so they hold it through a 
+	std::shared_ptr to a const MeshData: nobody may modify geometry that other objects could be using.
+	Meshes can also have levels of detail (see MeshSimplifier): simpler versions of the mesh, made of triangles that
+	index the same vertices. Their indices go after the full mesh's ones in the element buffer (indices, then 
+	lodIndices), so each level is just a range of that buffer. Level 0 is the full mesh.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MESHDATA
+#define _OPENGLFRAMEWORK_MESHDATA
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	struct MeshData {
+		struct LevelOfDetail {
+			unsigned int firstIndex;			//In lodIndices
+			unsigned int numIndices;
+			float error;						//How far (approximately, in local units) its surface is from the full mesh
+		};
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<unsigned int> indices;		//Triangles (3 indices per triangle), see MeshWelder
+		BoundingBox bb;
+		std::vector<unsigned int> lodIndices;	//Triangles of all the simplified levels
+		std::vector<LevelOfDetail> levels;		//Simplified levels (levels[0] is level 1), from finest to coarsest
+
+		inline unsigned int getNumLevelsOfDetail() const { return 1 + (unsigned int)levels.size(); }
+		//Range of the element buffer (indices followed by lodIndices) with the triangles of a level, and its error
+		inline unsigned int getLevelFirstIndex(unsigned int level) const { return level == 0 ? 0 : (unsigned int)indices.size() + levels[level - 1].firstIndex; }
+		inline unsigned int getLevelNumIndices(unsigned int level) const { return level == 0 ? (unsigned int)indices.size() : levels[level - 1].numIndices; }
+		inline float getLevelError(unsigned int level) const { return level == 0 ? 0 : levels[level - 1].error; }
+		//Bytes used by the arrays
+		inline unsigned long long getSizeInBytes() const {
+			return vertices.size() * sizeof(glm::vec3) + uvs.size() * sizeof(glm::vec2) 
+				+ normals.size() * sizeof(glm::vec3) + (indices.size() + lodIndices.size()) * sizeof(unsigned int)
+				+ levels.size() * sizeof(LevelOfDetail);
+		}
+	};
+};
+#endif
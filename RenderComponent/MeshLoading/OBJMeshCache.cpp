@@ -0,0 +1,244 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\OBJMeshCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MappedFile.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\ParallelOBJLoader.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshWelder.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshSimplifier.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshOptimiser.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Layout of the cache file: header, followed by the arrays (each one starting at a 16 byte aligned offset).
+	//Increase the version whenever this layout (or the way the arrays are produced) changes.
+	const char MESH_CACHE_MAGIC[8] = { 'O', 'G', 'L', 'F', 'M', 'E', 'S', 'H' };
+	const unsigned int MESH_CACHE_VERSION = 4;	//2: welded (indexed) meshes. 3: levels of detail. 4: optimised triangle and vertex order
+
+	struct MeshCacheHeader {
+		char magic[8];
+		unsigned int version;
+		unsigned int headerSize;				//sizeof(MeshCacheHeader), detects builds with different struct packing
+		unsigned long long sourcePathHash;		//Hash of the OBJ path (the cache is keyed by path, size and modification time)
+		long long sourceSize;
+		long long sourceModificationTime;
+		unsigned long long numVertices, numUVs, numNormals, numIndices, numLODIndices, numLevels;
+		unsigned long long verticesOffset, uvsOffset, normalsOffset, indicesOffset, lodIndicesOffset, levelsOffset;	//In bytes, from the start of the file
+		float bb[6];							//xmin, xmax, ymin, ymax, zmin, zmax
+		unsigned int levelsRequested;			//OBJMeshCache::setLevelsOfDetail when the file was built
+	};
+
+	inline unsigned long long alignTo16(unsigned long long offset) { return (offset + 15) & ~15ULL; }
+
+	//Pads the file with zeros up to offset, and writes the array there
+	bool writeArray(FILE* f, unsigned long long offset, const void* data, unsigned long long bytes, unsigned long long& written) {
+		static const char padding[16] = { 0 };
+		if (offset < written || fwrite(padding, 1, (size_t)(offset - written), f) != offset - written)
+			return false;
+		written = offset + bytes;
+		return bytes == 0 || fwrite(data, 1, (size_t)bytes, f) == bytes;
+	}
+
+	//FNV-1a, good enough to tell paths apart
+	unsigned long long hashPath(const std::string& path) {
+		unsigned long long h = 14695981039346656037ULL;
+		for (size_t i = 0; i < path.size(); i++) {
+			h ^= (unsigned char)path[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	bool getFileInfo(const std::string& fileName, long long& size, long long& modificationTime) {
+#ifdef _WIN32
+		struct _stat64 st;
+		if (_stat64(fileName.c_str(), &st) != 0) return false;
+#else
+		struct stat st;
+		if (stat(fileName.c_str(), &st) != 0) return false;
+#endif
+		size = (long long)st.st_size;
+		modificationTime = (long long)st.st_mtime;
+		return true;
+	}
+
+	double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+};
+
+OBJMeshCache::OBJMeshCache() : enabled(true), levelsOfDetail(MeshSimplifier::DEFAULT_LEVELS) {
+	memset(&stats, 0, sizeof(stats));
+}
+
+OBJMeshCache& OBJMeshCache::instance() {
+	static OBJMeshCache _instance;
+	return _instance;
+}
+
+std::string OBJMeshCache::getCacheFileName(const std::string& objFile) {
+	return objFile + ".meshcache";
+}
+
+bool OBJMeshCache::load(const std::string& objFile, MeshData& mesh) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Load OBJ");
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	long long objSize = 0, objTime = 0;
+	bool objExists = getFileInfo(objFile, objSize, objTime);
+	std::string cacheFile = getCacheFileName(objFile);
+	//1. Try the cache first
+	if (enabled && objExists && readCache(cacheFile, objFile, objSize, objTime, mesh)) {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.hits++;
+		stats.cachedLoadSeconds += secondsSince(start);
+		return true;
+	}
+	//2. Cache missing or out of date: parse the OBJ file (on all cores, see ParallelOBJLoader)...
+	mesh = MeshData();
+	if (!loadOBJParallel(objFile.c_str(), mesh.vertices, mesh.uvs, mesh.normals))
+		return false;
+	// ... merge identical corners into an indexed mesh...
+	MeshWelder::Report report;
+	if (!MeshWelder::weld(mesh.vertices, mesh.uvs, mesh.normals, mesh.indices, &report))
+		return false;
+	printf("Welded %s: %u -> %u vertices (%.2f MB -> %.2f MB)\n", objFile.c_str(), (unsigned int)report.verticesBefore, (unsigned int)report.verticesAfter
+		, report.bytesBefore / (1024.0*1024.0), report.bytesAfter / (1024.0*1024.0));
+	// ... get its bounding box, checking the data on the way (exported files often have NaN coordinates or triangles with no area)...
+	MeshStatistics::Result statistics = MeshStatistics::compute(mesh.vertices, mesh.indices);
+	mesh.bb = statistics.bb;
+	if (statistics.invalidVertices || statistics.degenerateTriangles)
+		printf("Warning: %s has %u vertices with NaN/infinite coordinates and %u degenerate triangles\n", objFile.c_str()
+			, (unsigned int)statistics.invalidVertices, (unsigned int)statistics.degenerateTriangles);
+	// ... build its levels of detail...
+	if (levelsOfDetail > 0 && MeshSimplifier::buildLevelsOfDetail(mesh, levelsOfDetail) > 0)
+		printf("Simplified %s: %u levels of detail, down to %u triangles\n", objFile.c_str(), (unsigned int)mesh.levels.size()
+			, mesh.levels.back().numIndices / 3);
+	// ... reorder its triangles and vertices for the GPU's caches...
+	MeshOptimiser::Report optimisation = MeshOptimiser::optimise(mesh);
+	printf("Optimised %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", objFile.c_str(), optimisation.before.acmr, optimisation.after.acmr
+		, optimisation.before.atvr, optimisation.after.atvr);
+	//3. ... and store the result for next time (failing to write the cache is not an error; we just parse again next time)
+	if (enabled && objExists)
+		writeCache(cacheFile, objFile, objSize, objTime, mesh);
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.misses++;
+	stats.objLoadSeconds += secondsSince(start);
+	return true;
+}
+
+bool OBJMeshCache::load(const std::string& objFile, std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, BoundingBox& bb) {
+	MeshData mesh;
+	if (!load(objFile, mesh))
+		return false;
+	vertices.swap(mesh.vertices);
+	uvs.swap(mesh.uvs);
+	normals.swap(mesh.normals);
+	indices.swap(mesh.indices);
+	bb = mesh.bb;
+	return true;
+}
+
+bool OBJMeshCache::readCache(const std::string& cacheFile, const std::string& objFile, long long objSize, long long objTime, MeshData& mesh) {
+	MappedFile file;
+	if (!file.open(cacheFile) || file.getSize() < sizeof(MeshCacheHeader))
+		return false;
+	//1. Validate the header (format, and whether it still describes the current OBJ file)
+	MeshCacheHeader header;
+	memcpy(&header, file.getData(), sizeof(header));
+	if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0
+		|| header.version != MESH_CACHE_VERSION || header.headerSize != sizeof(MeshCacheHeader)
+		|| header.sourcePathHash != hashPath(objFile) || header.sourceSize != objSize || header.sourceModificationTime != objTime
+		|| header.levelsRequested != levelsOfDetail)
+		return false;
+	//2. Make sure the arrays are really there (a truncated file must not crash us)
+	if (header.verticesOffset + header.numVertices * sizeof(glm::vec3) > file.getSize()
+		|| header.uvsOffset + header.numUVs * sizeof(glm::vec2) > file.getSize()
+		|| header.normalsOffset + header.numNormals * sizeof(glm::vec3) > file.getSize()
+		|| header.indicesOffset + header.numIndices * sizeof(unsigned int) > file.getSize()
+		|| header.lodIndicesOffset + header.numLODIndices * sizeof(unsigned int) > file.getSize()
+		|| header.levelsOffset + header.numLevels * sizeof(MeshData::LevelOfDetail) > file.getSize())
+		return false;
+	//3. The arrays are stored exactly as they live in memory: a single bulk copy out of the mapping each (no parsing)
+	const glm::vec3* v = (const glm::vec3*)(file.getData() + header.verticesOffset);
+	const glm::vec2* uv = (const glm::vec2*)(file.getData() + header.uvsOffset);
+	const glm::vec3* n = (const glm::vec3*)(file.getData() + header.normalsOffset);
+	const unsigned int* idx = (const unsigned int*)(file.getData() + header.indicesOffset);
+	const unsigned int* lodIdx = (const unsigned int*)(file.getData() + header.lodIndicesOffset);
+	const MeshData::LevelOfDetail* levels = (const MeshData::LevelOfDetail*)(file.getData() + header.levelsOffset);
+	mesh.vertices.assign(v, v + header.numVertices);
+	mesh.uvs.assign(uv, uv + header.numUVs);
+	mesh.normals.assign(n, n + header.numNormals);
+	mesh.indices.assign(idx, idx + header.numIndices);
+	mesh.lodIndices.assign(lodIdx, lodIdx + header.numLODIndices);
+	mesh.levels.assign(levels, levels + header.numLevels);
+	mesh.bb.xmin = header.bb[0]; mesh.bb.xmax = header.bb[1];
+	mesh.bb.ymin = header.bb[2]; mesh.bb.ymax = header.bb[3];
+	mesh.bb.zmin = header.bb[4]; mesh.bb.zmax = header.bb[5];
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.bytesMapped += file.getSize();
+	return true;
+}
+
+bool OBJMeshCache::writeCache(const std::string& cacheFile, const std::string& objFile, long long objSize, long long objTime, const MeshData& mesh) {
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.headerSize = sizeof(MeshCacheHeader);
+	header.sourcePathHash = hashPath(objFile);
+	header.sourceSize = objSize;
+	header.sourceModificationTime = objTime;
+	header.levelsRequested = levelsOfDetail;
+	header.numVertices = mesh.vertices.size();
+	header.numUVs = mesh.uvs.size();
+	header.numNormals = mesh.normals.size();
+	header.numIndices = mesh.indices.size();
+	header.numLODIndices = mesh.lodIndices.size();
+	header.numLevels = mesh.levels.size();
+	header.verticesOffset = alignTo16(sizeof(MeshCacheHeader));
+	header.uvsOffset = alignTo16(header.verticesOffset + mesh.vertices.size() * sizeof(glm::vec3));
+	header.normalsOffset = alignTo16(header.uvsOffset + mesh.uvs.size() * sizeof(glm::vec2));
+	header.indicesOffset = alignTo16(header.normalsOffset + mesh.normals.size() * sizeof(glm::vec3));
+	header.lodIndicesOffset = alignTo16(header.indicesOffset + mesh.indices.size() * sizeof(unsigned int));
+	header.levelsOffset = alignTo16(header.lodIndicesOffset + mesh.lodIndices.size() * sizeof(unsigned int));
+	header.bb[0] = mesh.bb.xmin; header.bb[1] = mesh.bb.xmax;
+	header.bb[2] = mesh.bb.ymin; header.bb[3] = mesh.bb.ymax;
+	header.bb[4] = mesh.bb.zmin; header.bb[5] = mesh.bb.zmax;
+
+	//Write to a temporary file and rename it at the end, so that a crash (or another process reading the cache)
+	//never sees a half written file.
+	std::string tmpFile = cacheFile + ".tmp";
+	FILE* f = fopen(tmpFile.c_str(), "wb");
+	if (!f)
+		return false;
+	unsigned long long written = 0;
+	bool ok = writeArray(f, 0, &header, sizeof(header), written);
+	ok = ok && writeArray(f, header.verticesOffset, mesh.vertices.empty() ? NULL : &mesh.vertices[0], mesh.vertices.size() * sizeof(glm::vec3), written);
+	ok = ok && writeArray(f, header.uvsOffset, mesh.uvs.empty() ? NULL : &mesh.uvs[0], mesh.uvs.size() * sizeof(glm::vec2), written);
+	ok = ok && writeArray(f, header.normalsOffset, mesh.normals.empty() ? NULL : &mesh.normals[0], mesh.normals.size() * sizeof(glm::vec3), written);
+	ok = ok && writeArray(f, header.indicesOffset, mesh.indices.empty() ? NULL : &mesh.indices[0], mesh.indices.size() * sizeof(unsigned int), written);
+	ok = ok && writeArray(f, header.lodIndicesOffset, mesh.lodIndices.empty() ? NULL : &mesh.lodIndices[0], mesh.lodIndices.size() * sizeof(unsigned int), written);
+	ok = ok && writeArray(f, header.levelsOffset, mesh.levels.empty() ? NULL : &mesh.levels[0], mesh.levels.size() * sizeof(MeshData::LevelOfDetail), written);
+	ok = (fclose(f) == 0) && ok;
+	if (ok) {
+		remove(cacheFile.c_str());	//rename() does not overwrite existing files on Windows
+		ok = rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+	}
+	if (!ok)
+		remove(tmpFile.c_str());
+	return ok;
+}
+
+OBJMeshCache::Statistics OBJMeshCache::getStatistics() {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+void OBJMeshCache::resetStatistics() {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,73 @@
+/**********************************************************************
+NAME: OBJMeshCache
+DESCRIPTION: Binary cache for the meshes read from OBJ files (see loadOBJParallel). Parsing a large OBJ file (text) is slow,
+	so the first time a model is loaded we weld it into an indexed mesh (see MeshWelder) and store the resulting arrays 
+	(vertices, uvs, normals, indices) and its bounding box in a binary file next to the model (<model>.meshcache). Later loads memory-map that file (see MappedFile) and read the arrays
+	straight from it, without parsing anything.
+	The levels of detail of the mesh (see MeshSimplifier) are also built the first time, and stored in the same file.
+	Before storing it, the triangles and vertices are reordered so the GPU draws them faster (see MeshOptimiser).
+	The cache file is versioned and remembers the path, size and modification time of the OBJ file it was built
+	from. If any of them changes (or the format version does), the cache is ignored and rebuilt from the OBJ file.
+	The OBJ renderables (TexturedOBJMesh_Renderable, DirectionalLightOBJMesh_Renderable and
+	PhongShadingOBJMesh_Renderable) use this through GPUAssetCache, which shares the result among renderables.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_OBJMESHCACHE
+#define _OPENGLFRAMEWORK_OBJMESHCACHE
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <vector>
+#include <mutex>
+
+namespace OpenGLFramework {
+	class OBJMeshCache {
+	public:
+		/**
+			Counters describing how meshes were loaded (from the OBJ file or from the cache) and how long it took.
+			Comparing the average time of both paths tells how much the cache is saving us.
+		*/
+		struct Statistics {
+			unsigned int hits, misses;				//Loads served from the cache / parsed from the OBJ file
+			double cachedLoadSeconds;				//Total time spent in loads served from the cache
+			double objLoadSeconds;					//Total time spent in loads parsed from the OBJ file (includes writing the cache)
+			unsigned long long bytesMapped;			//Total size of the cache files read
+		};
+	private:
+		bool enabled;
+		unsigned int levelsOfDetail;
+		Statistics stats;
+		std::mutex statsMutex;						//Meshes can be loaded from several threads at once
+		OBJMeshCache();
+		bool readCache(const std::string& cacheFile, const std::string& objFile, long long objSize, long long objTime, MeshData& mesh);
+		bool writeCache(const std::string& cacheFile, const std::string& objFile, long long objSize, long long objTime, const MeshData& mesh);
+	public:
+		static OBJMeshCache& instance();
+		/**
+			Loads the OBJ file as an indexed mesh (unique vertices + 3 indices per triangle) and computes its bounding box
+			and levels of detail. The binary cache is used if it is up to date; otherwise the OBJ file is parsed, welded,
+			simplified, optimised and the cache (re)written.
+			Returns false if the model could not be read.
+		*/
+		bool load(const std::string& objFile, MeshData& mesh);
+		/**
+			Same, without the levels of detail.
+		*/
+		bool load(const std::string& objFile, std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, BoundingBox& bb);
+		/**
+			Disabling the cache makes load() always parse the OBJ file (and never write cache files).
+		*/
+		inline void setEnabled(bool enable) { enabled = enable; }
+		inline bool isEnabled() const { return enabled; }
+		/**
+			Simplified levels built for each mesh (MeshSimplifier::DEFAULT_LEVELS by default; 0 = none). Cache files built
+			with a different number are rebuilt.
+		*/
+		inline void setLevelsOfDetail(unsigned int levels) { levelsOfDetail = levels; }
+		inline unsigned int getLevelsOfDetail() const { return levelsOfDetail; }
+		Statistics getStatistics();
+		void resetStatistics();
+		//Name of the cache file used for a given model.
+		static std::string getCacheFileName(const std::string& objFile);
+	};
+};
+#endif
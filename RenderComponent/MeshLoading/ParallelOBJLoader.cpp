@@ -0,0 +1,214 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\ParallelOBJLoader.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MappedFile.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Files smaller than this are not worth splitting
+	const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+	enum RecordType { RECORD_OTHER, RECORD_VERTEX, RECORD_UV, RECORD_NORMAL, RECORD_FACE };
+
+	struct Chunk {
+		const char* begin, *end;
+		size_t numVertices, numUVs, numNormals, numFaces;	//Records in this chunk (step 2)
+		size_t firstVertex, firstUV, firstNormal, firstFace;	//Where this chunk's results go (prefix sums)
+		bool failed;
+	};
+
+	//Type of record in the line [begin, end). Like loadOBJ, the keyword is the first word in the line.
+	RecordType getRecordType(const char* begin, const char* end, const char** afterKeyword) {
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) begin++;
+		const char* word = begin;
+		while (begin < end && *begin != ' ' && *begin != '\t' && *begin != '\r') begin++;
+		*afterKeyword = begin;
+		size_t length = begin - word;
+		if (length == 1 && word[0] == 'v') return RECORD_VERTEX;
+		if (length == 1 && word[0] == 'f') return RECORD_FACE;
+		if (length == 2 && word[0] == 'v' && word[1] == 't') return RECORD_UV;
+		if (length == 2 && word[0] == 'v' && word[1] == 'n') return RECORD_NORMAL;
+		return RECORD_OTHER;
+	}
+
+	/**
+		The mapping is not null terminated, so each record is copied into a small local buffer before scanning it.
+		This also lets us use the very same scanf formats as loadOBJ, which guarantees identical results.
+	*/
+	class LineBuffer {
+		char local[256];
+		std::string big;
+	public:
+		const char* set(const char* begin, const char* end) {
+			size_t length = end - begin;
+			if (length < sizeof(local)) {
+				memcpy(local, begin, length);
+				local[length] = '\0';
+				return local;
+			}
+			big.assign(begin, end);
+			return big.c_str();
+		}
+	};
+
+	//Calls f(type, recordBegin, lineEnd) for each line in the chunk.
+	template <class Function> void forEachLine(const Chunk& c, Function f) {
+		const char* line = c.begin;
+		while (line < c.end) {
+			const char* lineEnd = (const char*)memchr(line, '\n', c.end - line);
+			if (!lineEnd) lineEnd = c.end;
+			const char* record;
+			RecordType type = getRecordType(line, lineEnd, &record);
+			if (type != RECORD_OTHER && !f(type, record, lineEnd))
+				return;
+			line = lineEnd + 1;
+		}
+	}
+
+	//Step 2: Count records
+	void countRecords(Chunk* c) {
+		forEachLine(*c, [c](RecordType type, const char*, const char*) {
+			switch (type) {
+			case RECORD_VERTEX: c->numVertices++; break;
+			case RECORD_UV: c->numUVs++; break;
+			case RECORD_NORMAL: c->numNormals++; break;
+			case RECORD_FACE: c->numFaces++; break;
+			default: break;
+			}
+			return true;
+		});
+	}
+
+	//Step 3: Parse positions, uvs and normals into their tables
+	void parseAttributes(Chunk* c, glm::vec3* vertices, glm::vec2* uvs, glm::vec3* normals) {
+		vertices += c->firstVertex; uvs += c->firstUV; normals += c->firstNormal;
+		LineBuffer buffer;
+		forEachLine(*c, [&](RecordType type, const char* begin, const char* end) {
+			if (type == RECORD_VERTEX) {
+				glm::vec3 vertex;
+				sscanf(buffer.set(begin, end), "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+				*(vertices++) = vertex;
+			}
+			else if (type == RECORD_UV) {
+				glm::vec2 uv;
+				sscanf(buffer.set(begin, end), "%f %f\n", &uv.x, &uv.y);
+				uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders (same as loadOBJ).
+				*(uvs++) = uv;
+			}
+			else if (type == RECORD_NORMAL) {
+				glm::vec3 normal;
+				sscanf(buffer.set(begin, end), "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+				*(normals++) = normal;
+			}
+			return true;
+		});
+	}
+
+	//Step 4: Parse faces and write the vertices of each corner into the output arrays
+	void parseFaces(Chunk* c, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals
+		, glm::vec3* out_vertices, glm::vec2* out_uvs, glm::vec3* out_normals) {
+		size_t out = 3 * c->firstFace;
+		LineBuffer buffer;
+		forEachLine(*c, [&](RecordType type, const char* begin, const char* end) {
+			if (type != RECORD_FACE) return true;
+			int vertexIndex[3], uvIndex[3], normalIndex[3];
+			int matches = sscanf(buffer.set(begin, end), "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+			if (matches != 9) {
+				printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+				c->failed = true;
+				return false;
+			}
+			for (int i = 0; i < 3; i++, out++) {
+				//OBJ indices start at 1
+				if (vertexIndex[i] < 1 || (size_t)vertexIndex[i] > vertices.size() || uvIndex[i] < 1 || (size_t)uvIndex[i] > uvs.size()
+					|| normalIndex[i] < 1 || (size_t)normalIndex[i] > normals.size()) {
+					printf("Face refers to a vertex that does not exist\n");
+					c->failed = true;
+					return false;
+				}
+				out_vertices[out] = vertices[vertexIndex[i] - 1];
+				out_uvs[out] = uvs[uvIndex[i] - 1];
+				out_normals[out] = normals[normalIndex[i] - 1];
+			}
+			return true;
+		});
+	}
+
+	//Runs f(chunk) for every chunk, one thread each
+	template <class Function> void runOnChunks(std::vector<Chunk>& chunks, Function f) {
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < chunks.size(); i++)
+			threads.push_back(std::thread(f, &chunks[i]));
+		f(&chunks[0]);	//This thread does its share too
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+};
+
+bool OpenGLFramework::loadOBJParallel(const char* path, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec2>& out_uvs, std::vector<glm::vec3>& out_normals, unsigned int numThreads) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Parse OBJ");
+	printf("Loading OBJ file %s...\n", path);
+	out_vertices.clear(); out_uvs.clear(); out_normals.clear();
+	MappedFile file;
+	if (!file.open(path)) {
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+	//1. Split the file in chunks that end at the end of a line
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	size_t numChunks = file.getSize() / MIN_CHUNK_SIZE + 1;
+	if (numChunks > numThreads) numChunks = numThreads;
+	if (numChunks < 1) numChunks = 1;
+	std::vector<Chunk> chunks;
+	const char* begin = file.getData(), *fileEnd = file.getData() + file.getSize();
+	for (size_t i = 0; i < numChunks && begin < fileEnd; i++) {
+		const char* end = (i == numChunks - 1) ? fileEnd : begin + (fileEnd - begin) / (numChunks - i);
+		if (end < fileEnd) {
+			const char* newLine = (const char*)memchr(end, '\n', fileEnd - end);
+			end = newLine ? newLine + 1 : fileEnd;
+		}
+		Chunk c;
+		memset(&c, 0, sizeof(c));
+		c.begin = begin; c.end = end;
+		chunks.push_back(c);
+		begin = end;
+	}
+	if (chunks.empty())
+		return true;
+	//2. Count the records in each chunk, and work out where each chunk's results go
+	runOnChunks(chunks, countRecords);
+	size_t numVertices = 0, numUVs = 0, numNormals = 0, numFaces = 0;
+	for (size_t i = 0; i < chunks.size(); i++) {
+		chunks[i].firstVertex = numVertices; numVertices += chunks[i].numVertices;
+		chunks[i].firstUV = numUVs;			 numUVs += chunks[i].numUVs;
+		chunks[i].firstNormal = numNormals;  numNormals += chunks[i].numNormals;
+		chunks[i].firstFace = numFaces;		 numFaces += chunks[i].numFaces;
+	}
+	//3. Parse the tables of positions, uvs and normals
+	std::vector<glm::vec3> temp_vertices(numVertices);
+	std::vector<glm::vec2> temp_uvs(numUVs);
+	std::vector<glm::vec3> temp_normals(numNormals);
+	glm::vec3* vertices = temp_vertices.empty() ? NULL : &temp_vertices[0];
+	glm::vec2* uvs = temp_uvs.empty() ? NULL : &temp_uvs[0];
+	glm::vec3* normals = temp_normals.empty() ? NULL : &temp_normals[0];
+	runOnChunks(chunks, [=](Chunk* c) { parseAttributes(c, vertices, uvs, normals); });
+	//4. Parse the faces, straight into the final arrays
+	if (numFaces == 0)
+		return true;
+	out_vertices.resize(3 * numFaces);
+	out_uvs.resize(3 * numFaces);
+	out_normals.resize(3 * numFaces);
+	glm::vec3* outV = &out_vertices[0]; glm::vec2* outUV = &out_uvs[0]; glm::vec3* outN = &out_normals[0];
+	runOnChunks(chunks, [&](Chunk* c) { parseFaces(c, temp_vertices, temp_uvs, temp_normals, outV, outUV, outN); });
+	for (size_t i = 0; i < chunks.size(); i++)
+		if (chunks[i].failed) {
+			out_vertices.clear(); out_uvs.clear(); out_normals.clear();
+			return false;
+		}
+	return true;
+}
@@ -0,0 +1,27 @@
+/**********************************************************************
+NAME: ParallelOBJLoader
+DESCRIPTION: Multithreaded replacement for loadOBJ (common/objloader). It produces exactly the same arrays 
+	(one vertex, uv and normal per face corner, with the V coordinate flipped), but parses the file on all cores:
+		1. The file is memory-mapped and split into chunks, each ending at the end of a line.
+		2. Each thread counts the records (v, vt, vn, f) in its chunk. This tells us the final size of every
+		array and where the results of each chunk must go.
+		3. Each thread parses the v/vt/vn records of its chunk into the (shared) tables of positions, uvs and normals.
+		4. Each thread parses the faces of its chunk, writing the de-indexed vertices straight into the output arrays.
+	No per-chunk buffers are merged afterwards, so peak memory is the output arrays plus the (much smaller) 
+	tables of unique positions/uvs/normals.
+	Like loadOBJ, only triangles described as "f v/vt/vn v/vt/vn v/vt/vn" are supported.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_PARALLELOBJLOADER
+#define _OPENGLFRAMEWORK_PARALLELOBJLOADER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	/**
+		Loads the OBJ file into the arrays provided (their previous contents are discarded).
+		numThreads=0 uses all the cores available. Returns false if the file cannot be read or is not supported.
+	*/
+	bool loadOBJParallel(const char* path, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec2>& out_uvs, std::vector<glm::vec3>& out_normals, unsigned int numThreads = 0);
+};
+#endif
@@ -0,0 +1,84 @@
+/**********************************************************************
+NAME: DirtyRanges
+DESCRIPTION: Remembers which parts of a vertex buffer changed since it was last uploaded to the GPU, so that we only 
+	upload those (glBufferSubData) instead of the whole buffer (glBufferData). 
+	When we edit a few vertices of a big mesh, the bytes sent to the GPU grow with the size of the edit, not of the mesh.
+	Ranges are measured in elements (e.g. vertices). Several edits can be done before uploading (e.g. during a frame): 
+	ranges that overlap or touch each other are merged, so they are uploaded with a single call.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_DIRTYRANGES
+#define _OPENGLFRAMEWORK_DIRTYRANGES
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>	//Replaces the OpenGL calls, if OPENGLFRAMEWORK_RECORDING_GL is defined
+#include <vector>
+#include <algorithm>
+
+namespace OpenGLFramework {
+	class DirtyRanges {
+	public:
+		struct Statistics {
+			unsigned int edits;				//Ranges marked as dirty
+			unsigned int uploads;			//glBufferSubData calls (after merging)
+			double bytesUploaded;
+		};
+	private:
+		struct Range {
+			size_t begin, end;				//[begin, end) in elements
+			bool operator<(const Range& other) const { return begin < other.begin; }
+		};
+		std::vector<Range> ranges;
+		Statistics stats;
+	public:
+		DirtyRanges() { clear(); resetStatistics(); }
+		/**
+			Elements [offset, offset + count) changed.
+		*/
+		inline void add(size_t offset, size_t count) {
+			if (count == 0) return;
+			Range r = { offset, offset + count };
+			ranges.push_back(r);
+			stats.edits++;
+		}
+		inline bool empty() const { return ranges.empty(); }
+		/**
+			Forget the pending ranges (e.g. the whole buffer was uploaded again).
+		*/
+		inline void clear() { ranges.clear(); }
+		/**
+			Sorts the ranges, and merges the ones that overlap or are next to each other.
+		*/
+		inline void merge() {
+			if (ranges.size() < 2) return;
+			std::sort(ranges.begin(), ranges.end());
+			size_t last = 0;
+			for (size_t i = 1; i < ranges.size(); i++) {
+				if (ranges[i].begin <= ranges[last].end)
+					ranges[last].end = std::max(ranges[last].end, ranges[i].end);
+				else
+					ranges[++last] = ranges[i];
+			}
+			ranges.resize(last + 1);
+		}
+		/**
+			Uploads the dirty ranges from data (the whole buffer, in main memory) to the buffer bound to target.
+			elementBytes is the size of each element (e.g. 3*sizeof(GLfloat) for a position). Returns the bytes uploaded.
+		*/
+		inline size_t upload(GLenum target, const void* data, size_t elementBytes) {
+			merge();
+			size_t bytes = 0;
+			for (size_t i = 0; i < ranges.size(); i++) {
+				size_t rangeBytes = (ranges[i].end - ranges[i].begin) * elementBytes;
+				glBufferSubData(target, ranges[i].begin * elementBytes, rangeBytes, (const char*)data + ranges[i].begin * elementBytes);
+				bytes += rangeBytes;
+			}
+			stats.uploads += (unsigned int)ranges.size();
+			stats.bytesUploaded += (double)bytes;
+			ranges.clear();
+			return bytes;
+		}
+		inline const Statistics& getStatistics() const { return stats; }
+		inline void resetStatistics() { stats.edits = stats.uploads = 0; stats.bytesUploaded = 0; }
+	};
+};
+#endif
@@ -0,0 +1,43 @@
+/**********************************************************************
+NAME: IncrementalBounds
+DESCRIPTION: Keeps the bounding box of a renderable up to date when some of its vertices move, without going through 
+	all of them again. New positions can only make the box bigger, so we just grow it. The box only needs to shrink if 
+	a vertex that was touching one of its sides moves inwards: only then we need to recompute it from all the vertices.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_INCREMENTALBOUNDS
+#define _OPENGLFRAMEWORK_INCREMENTALBOUNDS
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+
+namespace OpenGLFramework {
+	class IncrementalBounds {
+	public:
+		/**
+			Updates bb for count vertices (xyz floats) that change from oldVertices to newVertices.
+			Returns false if the box could be too big now: the caller must recompute it from all the vertices.
+		*/
+		static inline bool update(BoundingBox& bb, const GLfloat* oldVertices, const GLfloat* newVertices, size_t count) {
+			//1. Did any vertex on the surface of the box move inwards?
+			for (size_t i = 0; i < count; i++) {
+				const GLfloat* o = oldVertices + 3 * i;
+				const GLfloat* n = newVertices + 3 * i;
+				if ((o[0] == bb.xmin && n[0] > o[0]) || (o[0] == bb.xmax && n[0] < o[0])
+					|| (o[1] == bb.ymin && n[1] > o[1]) || (o[1] == bb.ymax && n[1] < o[1])
+					|| (o[2] == bb.zmin && n[2] > o[2]) || (o[2] == bb.zmax && n[2] < o[2]))
+					return false;
+			}
+			//2. Otherwise, the box can only grow
+			for (size_t i = 0; i < count; i++) {
+				const GLfloat* n = newVertices + 3 * i;
+				if (n[0] < bb.xmin) bb.xmin = n[0];
+				if (n[0] > bb.xmax) bb.xmax = n[0];
+				if (n[1] < bb.ymin) bb.ymin = n[1];
+				if (n[1] > bb.ymax) bb.ymax = n[1];
+				if (n[2] < bb.zmin) bb.zmin = n[2];
+				if (n[2] > bb.zmax) bb.zmax = n[2];
+			}
+			return true;
+		}
+	};
+};
+#endif
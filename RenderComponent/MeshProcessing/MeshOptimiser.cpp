@@ -0,0 +1,265 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshOptimiser.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+const float MeshOptimiser::OVERDRAW_THRESHOLD = 1.05f;
+
+namespace {
+	//FIFO cache simulation: a vertex is in the cache if fewer than cacheSize vertices were transformed after it.
+	//Clearing the cache is just moving time forward by cacheSize + 1.
+	struct CacheSimulation {
+		std::vector<unsigned int> timestamps;	//When each vertex was last transformed
+		unsigned int time;
+		unsigned int cacheSize;
+		CacheSimulation(size_t numVertices, unsigned int cacheSize) : timestamps(numVertices, 0), time(cacheSize + 1), cacheSize(cacheSize) { ; }
+		inline bool isCached(unsigned int v) const { return time - timestamps[v] <= cacheSize; }
+		inline unsigned int transform(unsigned int v) {	//Returns 1 if it was a miss
+			if (isCached(v))
+				return 0;
+			timestamps[v] = time++;
+			return 1;
+		}
+		inline unsigned int drawTriangle(const unsigned int* t) { return transform(t[0]) + transform(t[1]) + transform(t[2]); }
+		inline void clear() { time += cacheSize + 1; }
+	};
+
+	//Triangles around each vertex (compressed: the triangles of vertex v are triangles[first[v]] to triangles[first[v + 1] - 1])
+	struct Adjacency {
+		std::vector<unsigned int> first, triangles;
+		Adjacency(const std::vector<unsigned int>& indices, size_t numVertices) : first(numVertices + 1, 0), triangles(indices.size()) {
+			for (size_t i = 0; i < indices.size(); i++)
+				first[indices[i] + 1]++;
+			for (size_t v = 0; v < numVertices; v++)
+				first[v + 1] += first[v];
+			std::vector<unsigned int> next(first.begin(), first.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				triangles[next[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	};
+
+	bool indicesAreValid(const std::vector<unsigned int>& indices, size_t numVertices) {
+		for (size_t i = 0; i < indices.size(); i++)
+			if (indices[i] >= numVertices)
+				return false;
+		return indices.size() % 3 == 0;
+	}
+};
+
+MeshOptimiser::Metrics MeshOptimiser::analyse(const std::vector<unsigned int>& indices, size_t numVertices, unsigned int cacheSize) {
+	Metrics result = { 0, 0 };
+	if (indices.size() < 3 || numVertices == 0 || !indicesAreValid(indices, numVertices))
+		return result;
+	CacheSimulation cache(numVertices, cacheSize);
+	unsigned long long misses = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		misses += cache.drawTriangle(&indices[i]);
+	std::vector<bool> used(numVertices, false);
+	size_t numUsed = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+		if (!used[indices[i]]) { used[indices[i]] = true; numUsed++; }
+	result.acmr = (float)((double)misses / (indices.size() / 3));
+	result.atvr = (float)((double)misses / numUsed);
+	return result;
+}
+
+void MeshOptimiser::optimiseVertexCache(std::vector<unsigned int>& indices, size_t numVertices, std::vector<unsigned int>* clusters, unsigned int cacheSize) {
+	if (clusters)
+		clusters->clear();
+	size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0)
+		return;
+	Adjacency adjacency(indices, numVertices);
+	std::vector<unsigned int> liveTriangles(numVertices);		//Triangles of each vertex not drawn yet
+	for (size_t v = 0; v < numVertices; v++)
+		liveTriangles[v] = adjacency.first[v + 1] - adjacency.first[v];
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<unsigned int> deadEnds;			//Vertices of the triangles drawn, most recent last: where to go when we get stuck
+	std::vector<unsigned int> candidates;		//Vertices of the last fan
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	CacheSimulation cache(numVertices, cacheSize);
+	unsigned int cursor = 0;					//Vertices before it have no triangles left
+	const unsigned int NONE = (unsigned int)-1;
+	unsigned int fanning = 0;
+	if (clusters)
+		clusters->push_back(0);
+	while (fanning != NONE) {
+		//1. Draw all the triangles left around the current vertex
+		candidates.clear();
+		for (unsigned int a = adjacency.first[fanning]; a < adjacency.first[fanning + 1]; a++) {
+			unsigned int t = adjacency.triangles[a];
+			if (emitted[t])
+				continue;
+			for (int c = 0; c < 3; c++) {
+				unsigned int v = indices[3 * t + c];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				cache.transform(v);
+			}
+			emitted[t] = true;
+		}
+		//2. Next, the vertex of that fan that has been longest in the cache, if it will still be there after its own fan
+		// (2 new vertices per triangle, at most). Older vertices would be transformed again, so we prefer younger ones.
+		unsigned int next = NONE;
+		int bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++) {
+			unsigned int v = candidates[i];
+			if (liveTriangles[v] == 0)
+				continue;
+			int priority = 0;
+			if (cache.time - cache.timestamps[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = (int)(cache.time - cache.timestamps[v]);
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = v;
+			}
+		}
+		//3. Dead end (nothing left around us): the most recent vertex with triangles left, or else the first one in the mesh.
+		// The cache is mostly lost here, so it is also where a new cluster starts (see optimiseOverdraw).
+		if (next == NONE) {
+			while (!deadEnds.empty() && next == NONE) {
+				unsigned int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[v] > 0)
+					next = v;
+			}
+			while (next == NONE && cursor < numVertices) {
+				if (liveTriangles[cursor] > 0)
+					next = cursor;
+				else
+					cursor++;
+			}
+			if (clusters && next != NONE && result.size() / 3 > clusters->back())
+				clusters->push_back((unsigned int)(result.size() / 3));
+		}
+		fanning = next;
+	}
+	indices.swap(result);
+}
+
+void MeshOptimiser::optimiseOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& clusters, float threshold, unsigned int cacheSize) {
+	size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0 || clusters.empty())
+		return;
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Optimise overdraw");
+	//1. Split the clusters further, wherever the part we have gone through so far already has an ACMR as good as the
+	// whole cluster's (threshold times it, at most): cutting there costs little in the vertex cache.
+	CacheSimulation cache(vertices.size(), cacheSize);
+	std::vector<unsigned int> starts;
+	for (size_t c = 0; c < clusters.size(); c++) {
+		unsigned int begin = clusters[c], end = (c + 1 < clusters.size()) ? clusters[c + 1] : (unsigned int)numTriangles;
+		cache.clear();
+		unsigned int clusterMisses = 0;
+		for (unsigned int t = begin; t < end; t++)
+			clusterMisses += cache.drawTriangle(&indices[3 * t]);
+		float clusterACMR = (float)clusterMisses / (end - begin);
+		cache.clear();
+		starts.push_back(begin);
+		unsigned int misses = 0, triangles = 0;
+		for (unsigned int t = begin; t < end; t++) {
+			misses += cache.drawTriangle(&indices[3 * t]);
+			triangles++;
+			if ((float)misses / triangles <= clusterACMR * threshold && t + 1 < end) {
+				starts.push_back(t + 1);
+				cache.clear();
+				misses = triangles = 0;
+			}
+		}
+	}
+	//2. Centre of the mesh (triangles weighted by their area)...
+	glm::vec3 meshCentroid(0, 0, 0);
+	float meshArea = 0;
+	for (size_t t = 0; t < numTriangles; t++) {
+		const glm::vec3 &a = vertices[indices[3 * t]], &b = vertices[indices[3 * t + 1]], &c = vertices[indices[3 * t + 2]];
+		float area = glm::length(glm::cross(b - a, c - a));
+		meshCentroid += (a + b + c) * (area / 3);
+		meshArea += area;
+	}
+	if (meshArea > 0)
+		meshCentroid /= meshArea;
+	//3. ... and how much each cluster faces away from it: (centre of the cluster - centre of the mesh) . average normal of the cluster
+	std::vector<std::pair<float, unsigned int> > sortKeys(starts.size());
+	for (size_t s = 0; s < starts.size(); s++) {
+		unsigned int end = (s + 1 < starts.size()) ? starts[s + 1] : (unsigned int)numTriangles;
+		glm::vec3 centroid(0, 0, 0), normal(0, 0, 0);
+		float area = 0;
+		for (unsigned int t = starts[s]; t < end; t++) {
+			const glm::vec3 &a = vertices[indices[3 * t]], &b = vertices[indices[3 * t + 1]], &c = vertices[indices[3 * t + 2]];
+			glm::vec3 n = glm::cross(b - a, c - a);		//Its length is twice the area
+			float triangleArea = glm::length(n);
+			centroid += (a + b + c) * (triangleArea / 3);
+			normal += n;
+			area += triangleArea;
+		}
+		float outwards = 0;
+		float normalLength = glm::length(normal);
+		if (area > 0 && normalLength > 0)
+			outwards = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+		sortKeys[s] = std::make_pair(-outwards, (unsigned int)s);	//Most outwards first; ties keep their order
+	}
+	//4. Draw the clusters in that order
+	std::sort(sortKeys.begin(), sortKeys.end());
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t k = 0; k < sortKeys.size(); k++) {
+		unsigned int s = sortKeys[k].second;
+		unsigned int end = (s + 1 < starts.size()) ? starts[s + 1] : (unsigned int)numTriangles;
+		result.insert(result.end(), indices.begin() + 3 * starts[s], indices.begin() + 3 * end);
+	}
+	indices.swap(result);
+}
+
+std::vector<unsigned int> MeshOptimiser::optimiseVertexFetch(std::vector<unsigned int>& indices, size_t numVertices) {
+	const unsigned int NONE = (unsigned int)-1;
+	std::vector<unsigned int> remap(numVertices, NONE);
+	unsigned int next = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (remap[indices[i]] == NONE)
+			remap[indices[i]] = next++;
+		indices[i] = remap[indices[i]];
+	}
+	for (size_t v = 0; v < numVertices; v++)		//Vertices no triangle uses go at the end
+		if (remap[v] == NONE)
+			remap[v] = next++;
+	return remap;
+}
+
+MeshOptimiser::Report MeshOptimiser::optimise(MeshData& mesh) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Optimise mesh");
+	size_t numVertices = mesh.vertices.size();
+	Report report;
+	report.before = report.after = analyse(mesh.indices, numVertices);
+	if (!indicesAreValid(mesh.indices, numVertices) || !indicesAreValid(mesh.lodIndices, numVertices))
+		return report;
+	//1. Triangle order of each level: vertex cache first, then overdraw (clusters that keep most of the cache's benefit)
+	std::vector<unsigned int> clusters;
+	optimiseVertexCache(mesh.indices, numVertices, &clusters);
+	optimiseOverdraw(mesh.indices, mesh.vertices, clusters);
+	for (size_t l = 0; l < mesh.levels.size(); l++) {
+		std::vector<unsigned int>::iterator first = mesh.lodIndices.begin() + mesh.levels[l].firstIndex;
+		std::vector<unsigned int> level(first, first + mesh.levels[l].numIndices);
+		optimiseVertexCache(level, numVertices, &clusters);
+		optimiseOverdraw(level, mesh.vertices, clusters);
+		std::copy(level.begin(), level.end(), first);
+	}
+	//2. Vertex order: the order in which the full mesh uses them (the levels of detail use a subset of them, in a similar order)
+	std::vector<unsigned int> remap = optimiseVertexFetch(mesh.indices, numVertices);
+	for (size_t i = 0; i < mesh.lodIndices.size(); i++)
+		mesh.lodIndices[i] = remap[mesh.lodIndices[i]];
+	std::vector<glm::vec3> vertices(numVertices), normals(mesh.normals.size() == numVertices ? numVertices : 0);
+	std::vector<glm::vec2> uvs(mesh.uvs.size() == numVertices ? numVertices : 0);
+	for (size_t v = 0; v < numVertices; v++) {
+		vertices[remap[v]] = mesh.vertices[v];
+		if (!uvs.empty()) uvs[remap[v]] = mesh.uvs[v];
+		if (!normals.empty()) normals[remap[v]] = mesh.normals[v];
+	}
+	mesh.vertices.swap(vertices);
+	if (!uvs.empty()) mesh.uvs.swap(uvs);
+	if (!normals.empty()) mesh.normals.swap(normals);
+	report.after = analyse(mesh.indices, numVertices);
+	return report;
+}
@@ -0,0 +1,62 @@
+/**********************************************************************
+NAME: MeshOptimiser
+DESCRIPTION: Reorders the triangles and vertices of an indexed mesh so the GPU draws it faster, without changing
+	what it looks like. OBJ files list triangles in whatever order the modelling tool wrote them, which wastes work:
+		- Vertex cache: the GPU keeps the last few vertices it transformed (the post-transform cache). A vertex shared
+		by triangles far apart in the index buffer is transformed again each time. We reorder the triangles with
+		Tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"): it draws the
+		triangles around a vertex (a fan), then moves to a neighbour that is still in the cache.
+		- Overdraw: pixels covered by several triangles of the mesh are shaded several times, unless the closest triangle
+		is drawn first (early-Z discards the others). Tipsify's order is cut into clusters (where the cache was going to
+		be lost anyway), and clusters facing away from the centre of the mesh are drawn first: from most viewpoints, they
+		are the ones in front.
+		- Vertex fetch: vertices are renumbered in the order the triangles first use them, so the GPU reads the
+		vertex buffer almost sequentially.
+	Each level of detail (see MeshSimplifier) is reordered the same way. Everything is deterministic: the same mesh
+	always produces the same result.
+	The cost of an order is measured by simulating a FIFO cache of CACHE_SIZE vertices (see analyse):
+		- ACMR (average cache miss ratio): vertices transformed per triangle (0.5 is ideal for big regular meshes, 3 is the worst).
+		- ATVR (average transformed vertex ratio): vertices transformed per vertex in the mesh (1 is ideal).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MESHOPTIMISER
+#define _OPENGLFRAMEWORK_MESHOPTIMISER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	class MeshOptimiser {
+	public:
+		static const unsigned int CACHE_SIZE = 16;			//Vertices in the simulated post-transform cache
+		static const float OVERDRAW_THRESHOLD;				//How much worse than its cluster's ACMR a part can be and still be split off
+		struct Metrics {
+			float acmr;
+			float atvr;
+		};
+		/**
+			Metrics of the full mesh (level 0), before and after optimise().
+		*/
+		struct Report {
+			Metrics before, after;
+		};
+		/**
+			Cache metrics of the triangles in indices (3 per triangle), drawn from vertices numbered 0 to numVertices-1.
+		*/
+		static Metrics analyse(const std::vector<unsigned int>& indices, size_t numVertices, unsigned int cacheSize = CACHE_SIZE);
+		/**
+			Reorders the triangles of every level of detail (vertex cache, then overdraw), and then the vertices (fetch).
+			Meshes with indices outside their vertices are left as they are.
+		*/
+		static Report optimise(MeshData& mesh);
+		/**
+			The steps of optimise(), for a single list of triangles. optimiseVertexCache can also tell where its clusters
+			start (the index of their first triangle), for optimiseOverdraw.
+			optimiseVertexFetch returns, for each old vertex, its new number (apply it to the other index lists of the mesh).
+		*/
+		static void optimiseVertexCache(std::vector<unsigned int>& indices, size_t numVertices, std::vector<unsigned int>* clusters = NULL, unsigned int cacheSize = CACHE_SIZE);
+		static void optimiseOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& clusters, float threshold = OVERDRAW_THRESHOLD, unsigned int cacheSize = CACHE_SIZE);
+		static std::vector<unsigned int> optimiseVertexFetch(std::vector<unsigned int>& indices, size_t numVertices);
+	};
+};
+#endif
@@ -0,0 +1,329 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshSimplifier.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace OpenGLFramework;
+
+namespace {
+	const unsigned int NONE = 0xFFFFFFFFu;
+	//Planes added along seams and borders weigh this much more than the triangles (relative to the edge's length squared)
+	const double BORDER_WEIGHT = 10.0;
+	//Collapses that turn a triangle further than this (cosine of the angle between its normals) are rejected
+	const double MIN_NORMAL_COSINE = 0.25;
+	//Each pass only tries the cheapest part of the candidates. The rest get a new (more accurate) cost in the next pass.
+	const double CANDIDATES_PER_PASS = 0.33;
+
+	//Weighted sum of squared distances to a set of planes: Q(p) = p^T A p + 2 b^T p + c
+	struct Quadric {
+		double a00, a01, a02, a11, a12, a22, b0, b1, b2, c;
+		double weight;
+		inline void addPlane(const glm::vec3& n, double d, double w) {
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+			b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+			c += w * d * d;
+			weight += w;
+		}
+		inline void add(const Quadric& q) {
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+			weight += q.weight;
+		}
+		inline double evaluate(const glm::vec3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			return a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+		}
+	};
+
+	enum VertexKind { MANIFOLD, BORDER, SEAM, LOCKED };
+
+	//Merges 'from' into 'to' (and, on seams, the other copy of 'from' into the other copy of 'to')
+	struct Collapse {
+		unsigned int from, to;
+		unsigned int twinFrom, twinTo;		//NONE if the vertex is not on a seam
+		unsigned int triangles;				//Triangles that disappear
+		double cost;
+		inline bool operator<(const Collapse& other) const { return cost < other.cost; }
+	};
+
+	//Triangles around each vertex (or around each position, if map is given), as a compressed list: the triangles of v are
+	//triangles[start[v]] ... triangles[start[v + 1] - 1]
+	void buildAdjacency(const std::vector<unsigned int>& indices, const unsigned int* map, size_t n
+		, std::vector<unsigned int>& start, std::vector<unsigned int>& triangles) {
+		start.assign(n + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++)
+			start[(map ? map[indices[i]] : indices[i]) + 1]++;
+		for (size_t v = 0; v < n; v++)
+			start[v + 1] += start[v];
+		triangles.resize(indices.size());
+		std::vector<unsigned int> next(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			triangles[next[map ? map[indices[i]] : indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	inline bool hasDirectedEdge(const unsigned int* t, unsigned int from, unsigned int to) {
+		return (t[0] == from && t[1] == to) || (t[1] == from && t[2] == to) || (t[2] == from && t[0] == to);
+	}
+
+	//Copies of a vertex (same position, different UV or normal) get the same position ID: the first vertex at that position
+	void findPositions(const std::vector<glm::vec3>& vertices, std::vector<unsigned int>& position) {
+		size_t tableSize = 1;
+		while (tableSize < vertices.size() * 2) tableSize <<= 1;
+		std::vector<unsigned int> table(tableSize, NONE);
+		position.resize(vertices.size());
+		for (size_t v = 0; v < vertices.size(); v++) {
+			unsigned int words[3];
+			memcpy(words, &vertices[v].x, sizeof(words));
+			unsigned long long h = 14695981039346656037ULL;
+			for (int i = 0; i < 3; i++) {
+				h ^= words[i];
+				h *= 1099511628211ULL;
+			}
+			size_t slot = (size_t)(h ^ (h >> 29)) & (tableSize - 1);
+			while (table[slot] != NONE && memcmp(&vertices[table[slot]].x, &vertices[v].x, sizeof(glm::vec3)) != 0)
+				slot = (slot + 1) & (tableSize - 1);
+			if (table[slot] == NONE)
+				table[slot] = (unsigned int)v;
+			position[v] = table[slot];
+		}
+	}
+};
+
+float MeshSimplifier::simplify(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, size_t targetTriangles
+	, std::vector<unsigned int>& result, float maxError) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Simplify mesh");
+	size_t numVertices = vertices.size();
+	result.clear();
+	if (numVertices == 0)
+		return 0;
+	std::vector<unsigned int> position;
+	findPositions(vertices, position);
+	//Triangles with two corners at the same position have no area: they would only confuse the topology
+	result.reserve(indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		unsigned int p0 = position[indices[i]], p1 = position[indices[i + 1]], p2 = position[indices[i + 2]];
+		if (p0 != p1 && p1 != p2 && p2 != p0)
+			result.insert(result.end(), &indices[i], &indices[i] + 3);
+	}
+	//1. Quadric of each position: the planes of the triangles around it, weighted by their area
+	std::vector<Quadric> quadrics(numVertices);
+	memset(&quadrics[0], 0, numVertices * sizeof(Quadric));
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const glm::vec3& p0 = vertices[result[i]];
+		glm::vec3 n = glm::cross(vertices[result[i + 1]] - p0, vertices[result[i + 2]] - p0);
+		float length = glm::length(n);
+		if (!(length > 0))
+			continue;
+		n = n / length;
+		double d = -glm::dot(n, p0);
+		for (int k = 0; k < 3; k++)
+			quadrics[position[result[i + k]]].addPlane(n, d, length * 0.5);
+	}
+
+	std::vector<unsigned int> vertexStart, vertexTriangles, positionStart, positionTriangles;
+	std::vector<unsigned int> positionVertexStart, positionVertices;		//Copies of each position
+	{
+		positionVertexStart.assign(numVertices + 1, 0);
+		for (size_t v = 0; v < numVertices; v++) positionVertexStart[position[v] + 1]++;
+		for (size_t v = 0; v < numVertices; v++) positionVertexStart[v + 1] += positionVertexStart[v];
+		positionVertices.resize(numVertices);
+		std::vector<unsigned int> next(positionVertexStart.begin(), positionVertexStart.end() - 1);
+		for (size_t v = 0; v < numVertices; v++) positionVertices[next[position[v]]++] = (unsigned int)v;
+	}
+	std::vector<unsigned char> openOut(numVertices), openIn(numVertices), kind(numVertices), locked(numVertices);
+	std::vector<unsigned int> openNext(numVertices), openPrev(numVertices), twin(numVertices), remap(numVertices), stamp(numVertices, 0);
+	std::vector<Collapse> candidates;
+	unsigned int currentStamp = 0;
+	double maxCost = 0, maxAllowedCost = (double)maxError * maxError;
+	for (int pass = 0; result.size() / 3 > targetTriangles; pass++) {
+		//2. Topology: triangles around each vertex and position, and the edges with no triangle on the other side
+		//   (borders of the mesh, or seams: the other side uses other copies of the vertices)
+		buildAdjacency(result, NULL, numVertices, vertexStart, vertexTriangles);
+		buildAdjacency(result, &position[0], numVertices, positionStart, positionTriangles);
+		memset(&openOut[0], 0, numVertices);
+		memset(&openIn[0], 0, numVertices);
+		for (size_t i = 0; i < result.size(); i++) {
+			unsigned int from = result[i], to = result[i - i % 3 + (i % 3 + 1) % 3];
+			bool closed = false;
+			for (unsigned int k = vertexStart[to]; k < vertexStart[to + 1] && !closed; k++)
+				closed = hasDirectedEdge(&result[3 * vertexTriangles[k]], to, from);
+			if (closed)
+				continue;
+			openOut[from] = (unsigned char)std::min(openOut[from] + 1, 2);
+			openIn[to] = (unsigned char)std::min(openIn[to] + 1, 2);
+			openNext[from] = to;
+			openPrev[to] = from;
+			if (pass == 0) {	//Extra planes along the edge (perpendicular to its triangle), so seams and borders keep their shape
+				const unsigned int* t = &result[i - i % 3];
+				glm::vec3 edge = vertices[to] - vertices[from];
+				glm::vec3 n = glm::cross(edge, glm::cross(vertices[t[1]] - vertices[t[0]], vertices[t[2]] - vertices[t[0]]));
+				float length = glm::length(n);
+				if (length > 0) {
+					n = n / length;
+					double d = -glm::dot(n, vertices[from]);
+					double w = BORDER_WEIGHT * glm::dot(edge, edge);
+					quadrics[position[from]].addPlane(n, d, w);
+					quadrics[position[to]].addPlane(n, d, w);
+				}
+			}
+		}
+		//3. What each vertex is allowed to do
+		for (size_t v = 0; v < numVertices; v++) {
+			kind[v] = LOCKED;
+			if (vertexStart[v] == vertexStart[v + 1])
+				continue;		//Not used (anymore)
+			unsigned int copies = 0, other = NONE;
+			for (unsigned int k = positionVertexStart[position[v]]; k < positionVertexStart[position[v] + 1]; k++) {
+				unsigned int w = positionVertices[k];
+				if (vertexStart[w] != vertexStart[w + 1]) {
+					copies++;
+					if (w != v) other = w;
+				}
+			}
+			if (copies == 1) {
+				if (openOut[v] == 0 && openIn[v] == 0) kind[v] = MANIFOLD;
+				else if (openOut[v] == 1 && openIn[v] == 1) kind[v] = BORDER;
+			}
+			else if (copies == 2 && openOut[v] == 1 && openIn[v] == 1 && openOut[other] == 1 && openIn[other] == 1
+				&& position[openNext[v]] == position[openPrev[other]] && position[openPrev[v]] == position[openNext[other]]) {
+				kind[v] = SEAM;		//One seam going through: each copy has the seam on one side
+				twin[v] = other;
+			}
+		}
+		//4. The cheapest valid collapse of each vertex
+		candidates.clear();
+		for (size_t a = 0; a < numVertices; a++) {
+			if (kind[a] == LOCKED || (kind[a] == SEAM && twin[a] < a))
+				continue;		//Seams are handled from one of their copies
+			unsigned int pa = position[a];
+			unsigned int targets[2] = { openNext[a], openPrev[a] };
+			unsigned int numTargets = (kind[a] == MANIFOLD) ? 3 * (vertexStart[a + 1] - vertexStart[a]) : 2;
+			Collapse best = { NONE, NONE, NONE, NONE, 0, DBL_MAX };
+			for (unsigned int k = 0; k < numTargets; k++) {
+				unsigned int b = (kind[a] == MANIFOLD) ? result[3 * vertexTriangles[vertexStart[a] + k / 3] + k % 3] : targets[k];
+				unsigned int pb = position[b];
+				if (pb == pa)
+					continue;
+				double cost = (quadrics[pa].evaluate(vertices[b]) + quadrics[pb].evaluate(vertices[b]))
+					/ std::max(quadrics[pa].weight + quadrics[pb].weight, 1e-30);
+				if (cost >= best.cost)
+					continue;
+				unsigned int twinTo = NONE;
+				if (kind[a] == SEAM) {		//The other copy must slide along the seam to the same position
+					unsigned int o = twin[a];
+					if (position[openNext[o]] == pb) twinTo = openNext[o];
+					else if (position[openPrev[o]] == pb) twinTo = openPrev[o];
+					else continue;
+				}
+				//a. Triangles that keep existing must not flip (or turn too much)
+				bool valid = true;
+				unsigned int shared = 0;
+				currentStamp += 2;
+				for (unsigned int j = positionStart[pa]; j < positionStart[pa + 1] && valid; j++) {
+					const unsigned int* t = &result[3 * positionTriangles[j]];
+					unsigned int p[3] = { position[t[0]], position[t[1]], position[t[2]] };
+					for (int c = 0; c < 3; c++)
+						if (p[c] != pa) stamp[p[c]] = currentStamp;
+					if (p[0] == pb || p[1] == pb || p[2] == pb) {
+						shared++;
+						continue;
+					}
+					glm::vec3 corners[3] = { vertices[t[0]], vertices[t[1]], vertices[t[2]] };
+					glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+					for (int c = 0; c < 3; c++)
+						if (p[c] == pa) corners[c] = vertices[b];
+					glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+					double lengths = (double)glm::length(before) * glm::length(after);
+					valid = lengths > 0 && glm::dot(before, after) >= MIN_NORMAL_COSINE * lengths;
+				}
+				if (!valid || shared == 0)
+					continue;
+				//b. a and b must only share the neighbours of the triangles that disappear, or the surface gets pinched
+				unsigned int common = 0;
+				for (unsigned int j = positionStart[pb]; j < positionStart[pb + 1]; j++) {
+					const unsigned int* t = &result[3 * positionTriangles[j]];
+					for (int c = 0; c < 3; c++)
+						if (stamp[position[t[c]]] == currentStamp && position[t[c]] != pb) {
+							stamp[position[t[c]]] = currentStamp + 1;
+							common++;
+						}
+				}
+				if (common != shared)
+					continue;
+				Collapse candidate = { (unsigned int)a, b, kind[a] == SEAM ? twin[a] : NONE, twinTo, shared, cost };
+				best = candidate;
+			}
+			if (best.from != NONE)
+				candidates.push_back(best);
+		}
+		//5. Do the cheapest ones, as long as they do not touch each other (their costs and checks would be out of date)
+		size_t numCandidates = std::max((size_t)1, (size_t)(candidates.size() * CANDIDATES_PER_PASS));
+		numCandidates = std::min(numCandidates, candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + numCandidates, candidates.end());
+		size_t triangles = result.size() / 3, removed = 0, collapsed = 0;
+		memset(&locked[0], 0, numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+			remap[v] = (unsigned int)v;
+		for (size_t i = 0; i < numCandidates && triangles - removed > targetTriangles; i++) {
+			const Collapse& c = candidates[i];
+			if (c.cost > maxAllowedCost)
+				break;
+			unsigned int pa = position[c.from], pb = position[c.to];
+			if (locked[pa] || locked[pb])
+				continue;
+			for (unsigned int j = positionStart[pa]; j < positionStart[pa + 1]; j++) {
+				const unsigned int* t = &result[3 * positionTriangles[j]];
+				locked[position[t[0]]] = locked[position[t[1]]] = locked[position[t[2]]] = 1;
+			}
+			remap[c.from] = c.to;
+			if (c.twinFrom != NONE)
+				remap[c.twinFrom] = c.twinTo;
+			quadrics[pb].add(quadrics[pa]);
+			removed += c.triangles;
+			maxCost = std::max(maxCost, c.cost);
+			collapsed++;
+		}
+		if (collapsed == 0)
+			break;		//Nothing else can be collapsed (or it would move the surface too much)
+		//6. Rewrite the triangles, dropping the ones that collapsed
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			unsigned int v0 = remap[result[i]], v1 = remap[result[i + 1]], v2 = remap[result[i + 2]];
+			if (position[v0] == position[v1] || position[v1] == position[v2] || position[v2] == position[v0])
+				continue;
+			result[kept++] = v0; result[kept++] = v1; result[kept++] = v2;
+		}
+		result.resize(kept);
+	}
+	return (float)std::sqrt(maxCost);
+}
+
+unsigned int MeshSimplifier::buildLevelsOfDetail(MeshData& mesh, unsigned int numLevels, float reduction) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Build levels of detail");
+	mesh.lodIndices.clear();
+	mesh.levels.clear();
+	//Each level is simplified from the previous one (much faster than starting from the full mesh every time).
+	//Errors add up, so the error of a level is the sum of the errors of all the steps.
+	std::vector<unsigned int> previous, simplified;
+	const std::vector<unsigned int>* input = &mesh.indices;
+	float error = 0;
+	for (unsigned int level = 0; level < numLevels; level++) {
+		size_t inputTriangles = input->size() / 3;
+		size_t target = (size_t)(inputTriangles * reduction);
+		if (target < MIN_TRIANGLES)
+			break;
+		error += simplify(mesh.vertices, *input, target, simplified);
+		//Not worth a level of its own if we could barely simplify it (e.g. most of its vertices are on seams)
+		if (simplified.size() / 3 > inputTriangles * (1 + reduction) / 2)
+			break;
+		MeshData::LevelOfDetail lod = { (unsigned int)mesh.lodIndices.size(), (unsigned int)simplified.size(), error };
+		mesh.lodIndices.insert(mesh.lodIndices.end(), simplified.begin(), simplified.end());
+		mesh.levels.push_back(lod);
+		previous.swap(simplified);
+		input = &previous;
+	}
+	return (unsigned int)mesh.levels.size();
+}
@@ -0,0 +1,49 @@
+/**********************************************************************
+NAME: MeshSimplifier
+DESCRIPTION: Builds simpler versions (levels of detail) of an indexed mesh, so that objects far from the camera can
+	be drawn with far fewer triangles (see MeshData::levels and LODSelector).
+	We use quadric error metrics (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics"):
+		- Each vertex accumulates the planes of the triangles around it (as a quadric, a 4x4 symmetric matrix). The
+		quadric tells the (squared) distance from any point to those planes, which is how far the surface moves if we
+		move the vertex there.
+		- We repeatedly collapse the edge that moves the surface the least: one of its vertices is merged into the other
+		(a "half-edge" collapse), and the triangles that shared the edge disappear. The merged vertex keeps the planes
+		of both.
+	Half-edge collapses never create vertices: the simplified triangles index the same vertex arrays as the full
+	mesh, so every level shares one vertex buffer and keeps the original UVs and normals untouched.
+	Vertices where the UVs or normals are discontinuous (UV seams, hard edges) appear several times in the welded
+	mesh (one copy per side, see MeshWelder). Those vertices, and the ones on the border of open meshes, may only
+	slide along their seam or border (both copies together), and the edges there get extra planes so they keep
+	their shape. Anything more complicated (e.g. where several seams meet) is never moved.
+	Collapses that would flip triangles (or fold them too much) are rejected.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MESHSIMPLIFIER
+#define _OPENGLFRAMEWORK_MESHSIMPLIFIER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <vector>
+#include <cfloat>
+
+namespace OpenGLFramework {
+	class MeshSimplifier {
+	public:
+		static const unsigned int DEFAULT_LEVELS = 3;		//Simplified levels, besides the full mesh
+		static const unsigned int MIN_TRIANGLES = 64;		//We do not simplify below this
+		/**
+			Simplifies the triangles in indices (3 per triangle, indexing vertices) until there are at most targetTriangles,
+			or until any other collapse would move the surface further than maxError. The triangles left are written to
+			result (they index the same vertices).
+			Returns the distance the surface moved (approximately, in the units of the vertices).
+		*/
+		static float simplify(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, size_t targetTriangles
+			, std::vector<unsigned int>& result, float maxError = FLT_MAX);
+		/**
+			Replaces the levels of detail of the mesh with up to numLevels simplified ones, each with about 'reduction' times
+			the triangles of the previous one. We stop early if a level would have less than MIN_TRIANGLES, or if the mesh
+			cannot be simplified much more. Returns the number of levels built.
+		*/
+		static unsigned int buildLevelsOfDetail(MeshData& mesh, unsigned int numLevels = DEFAULT_LEVELS, float reduction = 0.5f);
+	};
+};
+#endif
@@ -0,0 +1,278 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
+#include <thread>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define MESHSTATISTICS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define MESHSTATISTICS_SSE
+#endif
+
+using namespace OpenGLFramework;
+
+namespace {
+	unsigned int maxThreads = 0;
+	bool useSIMD = true;
+	const size_t MIN_VERTICES_PER_THREAD = 64 * 1024;
+
+	//Minimum, maximum and sum of the valid vertices in a range. Each thread fills one; then we merge them.
+	struct Partial {
+		float minimum[3], maximum[3];
+		double sum[3];
+		float radiusSquared;
+		size_t valid, invalid, degenerate;
+		Partial() : radiusSquared(0), valid(0), invalid(0), degenerate(0) {
+			for (int c = 0; c < 3; c++) {
+				minimum[c] = std::numeric_limits<float>::infinity();
+				maximum[c] = -std::numeric_limits<float>::infinity();
+				sum[c] = 0;
+			}
+		}
+		void merge(const Partial& other) {
+			for (int c = 0; c < 3; c++) {
+				minimum[c] = std::min(minimum[c], other.minimum[c]);
+				maximum[c] = std::max(maximum[c], other.maximum[c]);
+				sum[c] += other.sum[c];
+			}
+			radiusSquared = std::max(radiusSquared, other.radiusSquared);
+			valid += other.valid; invalid += other.invalid; degenerate += other.degenerate;
+		}
+	};
+
+	inline bool isValid(const GLfloat* v) {
+		return std::isfinite(v[0]) && std::isfinite(v[1]) && std::isfinite(v[2]);
+	}
+
+	//Runs f(begin, end, partial) over [0, count), split between threads. Returns the partials merged.
+	template <class Function> Partial parallelFor(size_t count, Function f) {
+		unsigned int threads = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+		size_t byWork = count / MIN_VERTICES_PER_THREAD;
+		if (threads == 0) threads = 1;
+		if (byWork < threads) threads = (unsigned int)std::max<size_t>(byWork, 1);
+		std::vector<Partial> partials(threads);
+		std::vector<std::thread> workers;
+		size_t chunk = (count + threads - 1) / threads;
+		for (unsigned int t = 1; t < threads; t++)
+			workers.push_back(std::thread(f, std::min(count, t * chunk), std::min(count, (t + 1) * chunk), &partials[t]));
+		f(0, std::min(count, chunk), &partials[0]);	//This thread does its share too
+		for (size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+		for (size_t t = 1; t < partials.size(); t++)
+			partials[0].merge(partials[t]);
+		return partials[0];
+	}
+
+	// 1. Box and centroid (scalar version, also used for the vertices that do not fill a SIMD block)
+	void accumulateScalar(const GLfloat* vertices, size_t begin, size_t end, Partial& p) {
+		for (size_t i = begin; i < end; i++) {
+			const GLfloat* v = vertices + 3 * i;
+			if (!isValid(v)) { p.invalid++; continue; }
+			for (int c = 0; c < 3; c++) {
+				p.minimum[c] = std::min(p.minimum[c], v[c]);
+				p.maximum[c] = std::max(p.maximum[c], v[c]);
+				p.sum[c] += v[c];
+			}
+			p.valid++;
+		}
+	}
+
+	// 2. Bounding sphere radius, around centre. This needs a second pass over the vertices: the sphere is centred in the 
+	// box, which we only know once we have seen every vertex (growing a sphere as we go would not give the same one)
+	void radiusScalar(const GLfloat* vertices, size_t begin, size_t end, const float centre[3], Partial& p) {
+		for (size_t i = begin; i < end; i++) {
+			const GLfloat* v = vertices + 3 * i;
+			if (!isValid(v)) continue;
+			float dx = v[0] - centre[0], dy = v[1] - centre[1], dz = v[2] - centre[2];
+			p.radiusSquared = std::max(p.radiusSquared, dx*dx + dy*dy + dz*dz);
+		}
+	}
+
+#if defined(MESHSTATISTICS_AVX) || defined(MESHSTATISTICS_SSE)
+	//The same code works for SSE (4 floats per register) and AVX (8 floats). 
+	//A block of LANES vertices (3*LANES floats) fills exactly 3 registers: e.g. with SSE, [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3].
+	//Position j of the block (register j/LANES, lane j%LANES) always holds coordinate j%3 of some vertex.
+	#if defined(MESHSTATISTICS_AVX)
+	typedef __m256 Register;
+	const size_t LANES = 8;
+	inline Register load(const float* p) { return _mm256_loadu_ps(p); }
+	inline void store(float* p, Register r) { _mm256_storeu_ps(p, r); }
+	inline Register set1(float f) { return _mm256_set1_ps(f); }
+	inline Register minimum(Register a, Register b) { return _mm256_min_ps(a, b); }
+	inline Register maximum(Register a, Register b) { return _mm256_max_ps(a, b); }
+	inline Register add(Register a, Register b) { return _mm256_add_ps(a, b); }
+	inline Register sub(Register a, Register b) { return _mm256_sub_ps(a, b); }
+	inline Register mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+	//Non zero if any float is NaN or infinite (|x| not less than infinity)
+	inline int anyInvalid(Register r) {
+		Register absolute = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), r);
+		return _mm256_movemask_ps(_mm256_cmp_ps(absolute, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _CMP_NLT_UQ));
+	}
+	#else
+	typedef __m128 Register;
+	const size_t LANES = 4;
+	inline Register load(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, Register r) { _mm_storeu_ps(p, r); }
+	inline Register set1(float f) { return _mm_set1_ps(f); }
+	inline Register minimum(Register a, Register b) { return _mm_min_ps(a, b); }
+	inline Register maximum(Register a, Register b) { return _mm_max_ps(a, b); }
+	inline Register add(Register a, Register b) { return _mm_add_ps(a, b); }
+	inline Register sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+	inline Register mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+	inline int anyInvalid(Register r) {
+		Register absolute = _mm_andnot_ps(_mm_set1_ps(-0.0f), r);
+		return _mm_movemask_ps(_mm_cmpnlt_ps(absolute, _mm_set1_ps(std::numeric_limits<float>::infinity())));
+	}
+	#endif
+	const size_t BLOCK_FLOATS = 3 * LANES;
+	const size_t BLOCKS_PER_SUM = 1024;		//Float sums are moved to the (double) partial this often, to keep their precision
+
+	void accumulate(const GLfloat* vertices, size_t begin, size_t end, Partial* p) {
+		if (!useSIMD) { accumulateScalar(vertices, begin, end, *p); return; }
+		size_t numBlocks = (end - begin) / LANES;
+		const GLfloat* block = vertices + 3 * begin;
+		Register lo[3], hi[3], sum[3];
+		for (int k = 0; k < 3; k++) { lo[k] = set1(std::numeric_limits<float>::infinity()); hi[k] = set1(-std::numeric_limits<float>::infinity()); sum[k] = set1(0); }
+		float lanes[BLOCK_FLOATS];
+		for (size_t b = 0; b < numBlocks; b++, block += BLOCK_FLOATS) {
+			Register r0 = load(block), r1 = load(block + LANES), r2 = load(block + 2 * LANES);
+			if (anyInvalid(r0) | anyInvalid(r1) | anyInvalid(r2)) {		//Rare: let the scalar code sort out which vertices are valid
+				size_t first = begin + b * LANES;
+				accumulateScalar(vertices, first, first + LANES, *p);
+				continue;
+			}
+			lo[0] = minimum(lo[0], r0); lo[1] = minimum(lo[1], r1); lo[2] = minimum(lo[2], r2);
+			hi[0] = maximum(hi[0], r0); hi[1] = maximum(hi[1], r1); hi[2] = maximum(hi[2], r2);
+			sum[0] = add(sum[0], r0); sum[1] = add(sum[1], r1); sum[2] = add(sum[2], r2);
+			p->valid += LANES;
+			if ((b + 1) % BLOCKS_PER_SUM == 0) {
+				for (int k = 0; k < 3; k++) {
+					store(lanes, sum[k]);
+					for (size_t i = 0; i < LANES; i++) p->sum[(LANES*k + i) % 3] += lanes[i];
+					sum[k] = set1(0);
+				}
+			}
+		}
+		//Sort out which coordinate each register position had
+		for (int k = 0; k < 3; k++) {
+			store(lanes, lo[k]);
+			for (size_t i = 0; i < LANES; i++) p->minimum[(LANES*k + i) % 3] = std::min(p->minimum[(LANES*k + i) % 3], lanes[i]);
+			store(lanes, hi[k]);
+			for (size_t i = 0; i < LANES; i++) p->maximum[(LANES*k + i) % 3] = std::max(p->maximum[(LANES*k + i) % 3], lanes[i]);
+			store(lanes, sum[k]);
+			for (size_t i = 0; i < LANES; i++) p->sum[(LANES*k + i) % 3] += lanes[i];
+		}
+		accumulateScalar(vertices, begin + numBlocks * LANES, end, *p);
+	}
+
+	void radius(const GLfloat* vertices, size_t begin, size_t end, const float centre[3], Partial* p) {
+		if (!useSIMD) { radiusScalar(vertices, begin, end, centre, *p); return; }
+		size_t numBlocks = (end - begin) / LANES;
+		const GLfloat* block = vertices + 3 * begin;
+		//The centre, laid out as the vertices are in each register: cx cy cz cx | cy cz cx cy | cz cx cy cz (SSE)
+		float pattern[BLOCK_FLOATS];
+		for (size_t j = 0; j < BLOCK_FLOATS; j++) pattern[j] = centre[j % 3];
+		Register c0 = load(pattern), c1 = load(pattern + LANES), c2 = load(pattern + 2 * LANES);
+		float squares[BLOCK_FLOATS];
+		for (size_t b = 0; b < numBlocks; b++, block += BLOCK_FLOATS) {
+			Register r0 = load(block), r1 = load(block + LANES), r2 = load(block + 2 * LANES);
+			if (anyInvalid(r0) | anyInvalid(r1) | anyInvalid(r2)) {
+				size_t first = begin + b * LANES;
+				radiusScalar(vertices, first, first + LANES, centre, *p);
+				continue;
+			}
+			Register d0 = sub(r0, c0), d1 = sub(r1, c1), d2 = sub(r2, c2);
+			store(squares, mul(d0, d0)); store(squares + LANES, mul(d1, d1)); store(squares + 2 * LANES, mul(d2, d2));
+			for (size_t i = 0; i < LANES; i++)
+				p->radiusSquared = std::max(p->radiusSquared, squares[3 * i] + squares[3 * i + 1] + squares[3 * i + 2]);
+		}
+		radiusScalar(vertices, begin + numBlocks * LANES, end, centre, *p);
+	}
+#else
+	void accumulate(const GLfloat* vertices, size_t begin, size_t end, Partial* p) { accumulateScalar(vertices, begin, end, *p); }
+	void radius(const GLfloat* vertices, size_t begin, size_t end, const float centre[3], Partial* p) { radiusScalar(vertices, begin, end, centre, *p); }
+#endif
+
+	// 3. Degenerate triangles: (almost) no area compared to their edges, or indices outside the mesh. They do not need 
+	// the box, so they are counted in the same pass as 1
+	void countDegenerate(const GLfloat* vertices, size_t numVertices, const unsigned int* indices, size_t begin, size_t end, Partial* p) {
+		for (size_t t = begin; t < end; t++) {
+			size_t a = indices ? indices[3 * t] : 3 * t, b = indices ? indices[3 * t + 1] : 3 * t + 1, c = indices ? indices[3 * t + 2] : 3 * t + 2;
+			if (a >= numVertices || b >= numVertices || c >= numVertices || a == b || b == c || a == c) { p->degenerate++; continue; }
+			glm::vec3 A(vertices[3 * a], vertices[3 * a + 1], vertices[3 * a + 2]);
+			glm::vec3 AB = glm::vec3(vertices[3 * b], vertices[3 * b + 1], vertices[3 * b + 2]) - A;
+			glm::vec3 AC = glm::vec3(vertices[3 * c], vertices[3 * c + 1], vertices[3 * c + 2]) - A;
+			glm::vec3 n = glm::cross(AB, AC);
+			//|AB x AC|^2 = |AB|^2 |AC|^2 sin^2(angle): degenerate if the angle is (almost) 0, or an edge has no length
+			float area2 = glm::dot(n, n);
+			if (!(area2 > 1e-12f * glm::dot(AB, AB) * glm::dot(AC, AC)))	//Also true if any of them is NaN
+				p->degenerate++;
+		}
+	}
+
+	BoundingBox toBoundingBox(const Partial& p) {
+		BoundingBox bb;
+		if (p.valid == 0) {
+			bb.xmin = bb.xmax = bb.ymin = bb.ymax = bb.zmin = bb.zmax = 0;
+			return bb;
+		}
+		bb.xmin = p.minimum[0]; bb.xmax = p.maximum[0];
+		bb.ymin = p.minimum[1]; bb.ymax = p.maximum[1];
+		bb.zmin = p.minimum[2]; bb.zmax = p.maximum[2];
+		return bb;
+	}
+};
+
+BoundingBox MeshStatistics::computeBoundingBox(size_t numVertices, const GLfloat* vertices) {
+	Partial p = parallelFor(numVertices, [vertices](size_t begin, size_t end, Partial* p) { accumulate(vertices, begin, end, p); });
+	return toBoundingBox(p);
+}
+
+MeshStatistics::Result MeshStatistics::compute(size_t numVertices, const GLfloat* vertices, const unsigned int* indices, size_t numIndices) {
+	Result result;
+	//1. Box, centroid and degenerate triangles, in one pass. Each thread takes the triangles in the same share of the 
+	//mesh as its vertices (the ones using them, if the mesh is not indexed)
+	result.numTriangles = indices ? numIndices / 3 : numVertices / 3;
+	size_t numTriangles = result.numTriangles;
+	Partial p = parallelFor(numVertices, [vertices, numVertices, indices, numTriangles](size_t begin, size_t end, Partial* p) {
+		accumulate(vertices, begin, end, p);
+		if (numVertices)
+			countDegenerate(vertices, numVertices, indices, begin * numTriangles / numVertices, end * numTriangles / numVertices, p);
+	});
+	if (numVertices == 0)
+		p.degenerate = numTriangles;	//Their indices are all outside the mesh
+	result.degenerateTriangles = p.degenerate;
+	result.bb = toBoundingBox(p);
+	result.numVertices = numVertices;
+	result.invalidVertices = p.invalid;
+	result.centroid = p.valid ? glm::vec3(p.sum[0] / p.valid, p.sum[1] / p.valid, p.sum[2] / p.valid) : glm::vec3(0);
+	//2. Sphere around the centre of the box (second and last pass)
+	float centre[3] = { 0.5f*(result.bb.xmin + result.bb.xmax), 0.5f*(result.bb.ymin + result.bb.ymax), 0.5f*(result.bb.zmin + result.bb.zmax) };
+	result.sphereCentre = glm::vec3(centre[0], centre[1], centre[2]);
+	Partial r = parallelFor(numVertices, [vertices, &centre](size_t begin, size_t end, Partial* p) { radius(vertices, begin, end, centre, p); });
+	result.sphereRadius = std::sqrt(r.radiusSquared);
+	return result;
+}
+
+const char* MeshStatistics::getInstructionSet() {
+	if (!useSIMD)
+		return "scalar";
+#if defined(MESHSTATISTICS_AVX)
+	return "AVX";
+#elif defined(MESHSTATISTICS_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+void MeshStatistics::setMaxThreads(unsigned int threads) {
+	maxThreads = threads;
+}
+
+void MeshStatistics::setUseSIMD(bool enabled) {
+	useSIMD = enabled;
+}
@@ -0,0 +1,66 @@
+/**********************************************************************
+NAME: MeshStatistics
+DESCRIPTION: Fast computation of the bounding volumes of a mesh (bounding box, bounding sphere and centroid), 
+	checking its data at the same time (vertices with NaN or infinite coordinates, degenerate triangles).
+	Renderables compute their bounding box every time they are created or loaded (and every time their vertices 
+	change), which for big meshes means going through millions of vertices. These kernels are much faster than a 
+	simple loop:
+		- They use SIMD instructions: 4 floats at a time with SSE, 8 with AVX (if the compiler is allowed to use it, 
+		e.g. /arch:AVX or -mavx). Vertices are stored as x,y,z,x,y,z..., so each register holds parts of several 
+		vertices. We keep the minimum, maximum and sum of each register position and only sort out which coordinate 
+		each position was at the very end, so there is no shuffling in the inner loop.
+		- Big meshes are split between several threads.
+	Vertices with NaN or infinite coordinates are not taken into account for the bounding volumes (they would break 
+	the frustum culling), but they are counted.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MESHSTATISTICS
+#define _OPENGLFRAMEWORK_MESHSTATISTICS
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	class MeshStatistics {
+	public:
+		struct Result {
+			BoundingBox bb;						//Box of the valid vertices
+			glm::vec3 centroid;					//Average of the valid vertices
+			glm::vec3 sphereCentre;				//Sphere containing all valid vertices (centred in the box)
+			float sphereRadius;
+			size_t numVertices;
+			size_t invalidVertices;				//Vertices with NaN or infinite coordinates
+			size_t numTriangles;
+			size_t degenerateTriangles;			//Triangles with (almost) no area, or indices outside the mesh
+		};
+		/**
+			Bounding box of numVertices vertices (x,y,z floats). If there are no valid vertices, the box is all 0.
+		*/
+		static BoundingBox computeBoundingBox(size_t numVertices, const GLfloat* vertices);
+		static inline BoundingBox computeBoundingBox(const std::vector<glm::vec3>& vertices) {
+			return computeBoundingBox(vertices.size(), vertices.empty() ? (const GLfloat*)NULL : &vertices[0].x);
+		}
+		/**
+			All the statistics of a mesh. Triangles are given by indices (3 per triangle) or, if indices is NULL, 
+			by every three consecutive vertices (as glDrawArrays(GL_TRIANGLES,...) would draw them).
+		*/
+		static Result compute(size_t numVertices, const GLfloat* vertices, const unsigned int* indices = NULL, size_t numIndices = 0);
+		static inline Result compute(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices) {
+			return compute(vertices.size(), vertices.empty() ? (const GLfloat*)NULL : &vertices[0].x
+				, indices.empty() ? (const unsigned int*)NULL : &indices[0], indices.size());
+		}
+		/**
+			Instruction set the kernels use ("AVX", "SSE" or "scalar").
+		*/
+		static const char* getInstructionSet();
+		/**
+			Maximum number of threads used (0 = one per core). Meshes below ~128K vertices always use one thread.
+		*/
+		static void setMaxThreads(unsigned int threads);
+		/**
+			false runs the scalar kernels even if SIMD ones were compiled (e.g. to compare them; see the MeshStatistics 
+			benchmark). true by default.
+		*/
+		static void setUseSIMD(bool enabled);
+	};
+};
+#endif
@@ -0,0 +1,90 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshWelder.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <cstring>
+#include <cstdio>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//A vertex is compared bit by bit (position, uv and normal), so only exact duplicates are merged
+	struct WeldKey {
+		float data[8];
+		bool operator==(const WeldKey& other) const { return memcmp(data, other.data, sizeof(data)) == 0; }
+	};
+
+	inline WeldKey makeKey(const glm::vec3& v, const glm::vec2* uv, const glm::vec3* n) {
+		WeldKey k;
+		memset(&k, 0, sizeof(k));
+		k.data[0] = v.x; k.data[1] = v.y; k.data[2] = v.z;
+		if (uv) { k.data[3] = uv->x; k.data[4] = uv->y; }
+		if (n) { k.data[5] = n->x; k.data[6] = n->y; k.data[7] = n->z; }
+		return k;
+	}
+
+	inline size_t hashKey(const WeldKey& k) {
+		unsigned int words[8];
+		memcpy(words, k.data, sizeof(words));
+		unsigned long long h = 14695981039346656037ULL;
+		for (int i = 0; i < 8; i++) {
+			h ^= words[i];
+			h *= 1099511628211ULL;
+		}
+		return (size_t)(h ^ (h >> 29));
+	}
+
+	const unsigned int EMPTY_SLOT = 0xFFFFFFFFu;
+};
+
+MeshWelder::Report MeshWelder::computeReport(size_t numVertices, size_t numIndices, bool hasUVs, bool hasNormals) {
+	size_t vertexSize = sizeof(glm::vec3) + (hasUVs ? sizeof(glm::vec2) : 0) + (hasNormals ? sizeof(glm::vec3) : 0);
+	Report r;
+	r.verticesBefore = numIndices;
+	r.verticesAfter = numVertices;
+	r.bytesBefore = numIndices * vertexSize;
+	r.bytesAfter = numVertices * vertexSize + numIndices * sizeof(unsigned int);
+	return r;
+}
+
+bool MeshWelder::weld(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, Report* report) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Weld mesh");
+	size_t numCorners = vertices.size();
+	if ((!uvs.empty() && uvs.size() != numCorners) || (!normals.empty() && normals.size() != numCorners)) {
+		printf("Mesh has %u vertices but %u UVs and %u normals: cannot weld it\n", (unsigned int)numCorners, (unsigned int)uvs.size(), (unsigned int)normals.size());
+		return false;
+	}
+	bool hasUVs = !uvs.empty() && numCorners > 0;
+	bool hasNormals = !normals.empty() && numCorners > 0;
+	indices.resize(numCorners);
+	//1. Open addressing hash table (linear probing), sized to a power of two with at most 50% load.
+	//   Each slot holds the index of a unique vertex (already compacted at the front of the arrays).
+	size_t tableSize = 16;
+	while (tableSize < 2 * numCorners) tableSize <<= 1;
+	std::vector<unsigned int> table(tableSize, EMPTY_SLOT);
+	std::vector<WeldKey> keys;			//Key of each unique vertex, so we do not need to rebuild it while probing
+	keys.reserve(numCorners / 4 + 16);
+	unsigned int numUnique = 0;
+	//2. Traverse corners in order. The write position (numUnique) never overtakes the read position (i), so we can compact in place.
+	for (size_t i = 0; i < numCorners; i++) {
+		WeldKey k = makeKey(vertices[i], hasUVs ? &uvs[i] : NULL, hasNormals ? &normals[i] : NULL);
+		size_t slot = hashKey(k) & (tableSize - 1);
+		while (table[slot] != EMPTY_SLOT && !(keys[table[slot]] == k))
+			slot = (slot + 1) & (tableSize - 1);
+		if (table[slot] == EMPTY_SLOT) {
+			//New vertex
+			table[slot] = numUnique;
+			keys.push_back(k);
+			vertices[numUnique] = vertices[i];
+			if (hasUVs) uvs[numUnique] = uvs[i];
+			if (hasNormals) normals[numUnique] = normals[i];
+			numUnique++;
+		}
+		indices[i] = table[slot];
+	}
+	//3. Drop the space we do not need anymore
+	std::vector<glm::vec3>(vertices.begin(), vertices.begin() + numUnique).swap(vertices);
+	if (hasUVs) std::vector<glm::vec2>(uvs.begin(), uvs.begin() + numUnique).swap(uvs);
+	if (hasNormals) std::vector<glm::vec3>(normals.begin(), normals.begin() + numUnique).swap(normals);
+	if (report)
+		*report = computeReport(numUnique, numCorners, hasUVs, hasNormals);
+	return true;
+}
@@ -0,0 +1,39 @@
+/**********************************************************************
+NAME: MeshWelder
+DESCRIPTION: Turns a de-indexed mesh (one position, uv and normal per triangle corner, as loadOBJ produces them)
+	into an indexed mesh. Corners with exactly the same (position, uv, normal) are merged into a single vertex, 
+	and an index buffer describes the triangles. Rendering with glDrawElements then needs much smaller vertex 
+	buffers (each vertex is usually shared by ~6 triangles), and the GPU can reuse vertices it already transformed
+	(post-transform cache).
+	Vertices are kept in the order they first appear, so the result is deterministic.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MESHWELDER
+#define _OPENGLFRAMEWORK_MESHWELDER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	class MeshWelder {
+	public:
+		/**
+			Memory used by a mesh, before (de-indexed) and after welding (indexed).
+		*/
+		struct Report {
+			size_t verticesBefore, verticesAfter;	//Number of vertices in the vertex buffers
+			size_t bytesBefore, bytesAfter;			//Bytes used by the vertex buffers (plus the index buffer, after welding)
+		};
+		/**
+			Welds the mesh in place: identical corners are merged and the arrays only keep unique vertices.
+			The index buffer (3 indices per triangle, same order as the input) is returned in indices.
+			uvs and normals can be empty (the mesh does not have them); otherwise they must have one entry per vertex.
+			If they do not, the mesh is left untouched and false is returned. The memory report goes to report (if not NULL).
+		*/
+		static bool weld(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, Report* report = NULL);
+		/**
+			Memory report for an indexed mesh (numIndices corners, numVertices unique vertices).
+		*/
+		static Report computeReport(size_t numVertices, size_t numIndices, bool hasUVs = true, bool hasNormals = true);
+	};
+};
+#endif
@@ -0,0 +1,298 @@
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\VertexQuantiser.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define VERTEXQUANTISER_SSE
+	#if defined(__F16C__) || defined(__AVX2__)
+		#include <immintrin.h>
+		#define VERTEXQUANTISER_F16C
+	#endif
+#endif
+
+using namespace OpenGLFramework;
+
+namespace {
+	unsigned int maxThreads = 0;
+	const size_t MIN_VERTICES_PER_THREAD = 64 * 1024;
+	const float UNORM16_MAX = 65535.0f, SNORM16_MAX = 32767.0f;
+
+	//Runs f(begin, end) over [0, count), split between threads
+	template <class Function> void parallelFor(size_t count, Function f) {
+		unsigned int threads = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+		size_t byWork = count / MIN_VERTICES_PER_THREAD;
+		if (threads == 0) threads = 1;
+		if (byWork < threads) threads = (unsigned int)std::max<size_t>(byWork, 1);
+		std::vector<std::thread> workers;
+		size_t chunk = (count + threads - 1) / threads;
+		for (unsigned int t = 1; t < threads; t++)
+			workers.push_back(std::thread(f, std::min(count, t * chunk), std::min(count, (t + 1) * chunk)));
+		f(0, std::min(count, chunk));	//This thread does its share too
+		for (size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+	}
+
+	//Position coordinate to [0,65535] (factor = 65535 / size of the box). NaN goes to 0.
+	inline unsigned short quantisePosition(float v, float offset, float factor) {
+		float q = (v - offset) * factor + 0.5f;
+		return (unsigned short)(q > 0 ? (q < UNORM16_MAX ? q : UNORM16_MAX) : 0);
+	}
+
+	//Float to half float. Values too small for a normal half become 0, and too big ones infinity (we do not need more for UVs).
+	inline unsigned short floatToHalf(float f) {
+		unsigned int bits;
+		memcpy(&bits, &f, sizeof(bits));
+		unsigned int sign = (bits >> 16) & 0x8000, magnitude = bits & 0x7FFFFFFF;
+		if (magnitude < 0x38800000)			//Below 2^-14
+			return (unsigned short)sign;
+		if (magnitude >= 0x477FF000)		//Rounds above 65504 (the largest half)
+			return (unsigned short)(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));	//NaN stays NaN
+		magnitude += 0xFFF + ((magnitude >> 13) & 1);	//Round to nearest (even) the 13 mantissa bits we drop
+		return (unsigned short)(sign | ((magnitude - 0x38000000) >> 13));	//Exponent bias: 127 -> 15
+	}
+
+	inline float halfToFloat(unsigned short h) {
+		unsigned int sign = (unsigned int)(h & 0x8000) << 16, exponent = (h >> 10) & 0x1F, mantissa = h & 0x3FF, bits;
+		if (exponent == 0) {				//0 or denormal
+			float f = mantissa * (1.0f / 16777216.0f);
+			return sign ? -f : f;
+		}
+		bits = sign | (exponent == 31 ? 0x7F800000 : (exponent + 112) << 23) | (mantissa << 13);
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	//Unit vector to the octahedron, unfolded onto [-1,1]^2
+	inline void encodeOctahedral(const glm::vec3& n, short result[2]) {
+		float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		float x = (l1 > 0) ? n.x / l1 : 0, y = (l1 > 0) ? n.y / l1 : 0;	//Zero (or NaN) normals point towards +z
+		if (n.z < 0) {		//Lower half: fold it over the corners
+			float foldedX = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+			y = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+			x = foldedX;
+		}
+		result[0] = (short)lrintf(x * SNORM16_MAX);
+		result[1] = (short)lrintf(y * SNORM16_MAX);
+	}
+
+	//Same as decodeOctahedral in the shaders
+	inline glm::vec3 decodeOctahedral(const short e[2]) {
+		glm::vec3 n(std::max(e[0] / SNORM16_MAX, -1.0f), std::max(e[1] / SNORM16_MAX, -1.0f), 0);
+		n.z = 1 - fabsf(n.x) - fabsf(n.y);
+		float t = std::max(-n.z, 0.0f);
+		n.x += (n.x >= 0) ? -t : t;
+		n.y += (n.y >= 0) ? -t : t;
+		return glm::normalize(n);
+	}
+
+	struct Encoder {
+		const MeshData* mesh;
+		unsigned char* out;
+		size_t stride;
+		bool withUVs, withNormals;
+		float offset[3], factor[3];
+
+		inline unsigned short* position(size_t i) const { return (unsigned short*)(out + i * stride + VertexQuantiser::POSITION_OFFSET); }
+		inline unsigned short* uv(size_t i) const { return (unsigned short*)(out + i * stride + VertexQuantiser::UV_OFFSET); }
+		inline short* normal(size_t i) const { return (short*)(out + i * stride + VertexQuantiser::NORMAL_OFFSET); }
+
+		void encodeScalar(size_t begin, size_t end) const {
+			for (size_t i = begin; i < end; i++) {
+				const glm::vec3& v = mesh->vertices[i];
+				unsigned short* p = position(i);
+				p[0] = quantisePosition(v.x, offset[0], factor[0]);
+				p[1] = quantisePosition(v.y, offset[1], factor[1]);
+				p[2] = quantisePosition(v.z, offset[2], factor[2]);
+				p[3] = 0;
+				unsigned short* t = uv(i);
+				t[0] = withUVs ? floatToHalf(mesh->uvs[i].x) : 0;
+				t[1] = withUVs ? floatToHalf(mesh->uvs[i].y) : 0;
+				if (withNormals)
+					encodeOctahedral(mesh->normals[i], normal(i));
+			}
+		}
+
+#ifdef VERTEXQUANTISER_SSE
+		//4 values (0 to 65535, in 32 bit lanes) of a and b packed into 8 unsigned shorts (packs_epi32 saturates to signed shorts: shift them first)
+		static inline __m128i packUnsigned16(__m128i a, __m128i b) {
+			const __m128i bias32 = _mm_set1_epi32(32768), bias16 = _mm_set1_epi16((short)0x8000);
+			return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32)), bias16);
+		}
+
+		static inline __m128i quantisePositions(__m128 v, __m128 offset, __m128 factor) {
+			__m128 q = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v, offset), factor), _mm_set1_ps(0.5f));
+			q = _mm_min_ps(_mm_max_ps(q, _mm_setzero_ps()), _mm_set1_ps(UNORM16_MAX));		//max returns 0 for NaN
+			return _mm_cvttps_epi32(q);
+		}
+
+		//Same as floatToHalf, for 4 floats (one half in the low 16 bits of each 32 bit lane)
+		static inline __m128i floatToHalf4(__m128 f) {
+	#ifdef VERTEXQUANTISER_F16C
+			return _mm_unpacklo_epi16(_mm_cvtps_ph(f, 0), _mm_setzero_si128());
+	#else
+			__m128i bits = _mm_castps_si128(f);
+			__m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+			__m128i magnitude = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+			__m128i tooSmall = _mm_cmplt_epi32(magnitude, _mm_set1_epi32(0x38800000));
+			__m128i tooBig = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x477FEFFF));
+			__m128i isNaN = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7F800000));
+			__m128i rounding = _mm_add_epi32(_mm_set1_epi32(0xFFF), _mm_and_si128(_mm_srli_epi32(magnitude, 13), _mm_set1_epi32(1)));
+			__m128i h = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(magnitude, rounding), _mm_set1_epi32(0x38000000)), 13);
+			__m128i infinity = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNaN, _mm_set1_epi32(0x0200)));
+			h = _mm_or_si128(_mm_and_si128(tooBig, infinity), _mm_andnot_si128(tooBig, h));
+			return _mm_or_si128(_mm_andnot_si128(tooSmall, h), sign);
+	#endif
+		}
+
+		//4 normals (x, y and z of each in a register) to octahedral coordinates, as signed shorts: x0..x3, y0..y3
+		static inline __m128i encodeOctahedral4(__m128 x, __m128 y, __m128 z) {
+			const __m128 signBit = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+			__m128 l1 = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signBit, x), _mm_andnot_ps(signBit, y)), _mm_andnot_ps(signBit, z));
+			__m128 valid = _mm_cmpgt_ps(l1, zero);
+			__m128 ox = _mm_and_ps(valid, _mm_div_ps(x, l1)), oy = _mm_and_ps(valid, _mm_div_ps(y, l1));
+			//Lower half folded over the corners: ((1-|y|)*sign(x), (1-|x|)*sign(y)). sign(0) is 1, as in the scalar version
+			__m128 signX = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(ox, zero), signBit), one), signY = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(oy, zero), signBit), one);
+			__m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signBit, oy)), signX);
+			__m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signBit, ox)), signY);
+			__m128 lower = _mm_cmplt_ps(z, zero);
+			ox = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, ox));
+			oy = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, oy));
+			const __m128 scale = _mm_set1_ps(SNORM16_MAX);
+			return _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(ox, scale)), _mm_cvtps_epi32(_mm_mul_ps(oy, scale)));	//Rounds to nearest, like lrintf
+		}
+
+		//4 vertices per iteration. The arrays are x,y,z,x,y,z... so the 3 registers of positions hold x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3:
+		//each register position always has the same coordinate, and we only need 3 (rotated) offset and factor registers.
+		void encodeSIMD(size_t begin, size_t end) const {
+			const __m128 offset0 = _mm_setr_ps(offset[0], offset[1], offset[2], offset[0]);
+			const __m128 offset1 = _mm_setr_ps(offset[1], offset[2], offset[0], offset[1]);
+			const __m128 offset2 = _mm_setr_ps(offset[2], offset[0], offset[1], offset[2]);
+			const __m128 factor0 = _mm_setr_ps(factor[0], factor[1], factor[2], factor[0]);
+			const __m128 factor1 = _mm_setr_ps(factor[1], factor[2], factor[0], factor[1]);
+			const __m128 factor2 = _mm_setr_ps(factor[2], factor[0], factor[1], factor[2]);
+			unsigned short positions[16], uvs[8];
+			short normals[8];
+			size_t i = begin;
+			for (; i + 4 <= end; i += 4) {
+				const float* p = &mesh->vertices[i].x;
+				__m128i q01 = packUnsigned16(quantisePositions(_mm_loadu_ps(p), offset0, factor0), quantisePositions(_mm_loadu_ps(p + 4), offset1, factor1));
+				__m128i q2 = packUnsigned16(quantisePositions(_mm_loadu_ps(p + 8), offset2, factor2), _mm_setzero_si128());
+				_mm_storeu_si128((__m128i*)positions, q01);
+				_mm_storeu_si128((__m128i*)(positions + 8), q2);
+				if (withUVs) {
+					const float* t = &mesh->uvs[i].x;
+					_mm_storeu_si128((__m128i*)uvs, packUnsigned16(floatToHalf4(_mm_loadu_ps(t)), floatToHalf4(_mm_loadu_ps(t + 4))));
+				}
+				else memset(uvs, 0, sizeof(uvs));
+				if (withNormals) {
+					const float* n = &mesh->normals[i].x;
+					_mm_storeu_si128((__m128i*)normals, encodeOctahedral4(_mm_setr_ps(n[0], n[3], n[6], n[9]), _mm_setr_ps(n[1], n[4], n[7], n[10]), _mm_setr_ps(n[2], n[5], n[8], n[11])));
+				}
+				//Scatter the 4 vertices to their place in the buffer
+				for (size_t k = 0; k < 4; k++) {
+					unsigned short* pos = position(i + k);
+					pos[0] = positions[3 * k]; pos[1] = positions[3 * k + 1]; pos[2] = positions[3 * k + 2]; pos[3] = 0;
+					unsigned short* t = uv(i + k);
+					t[0] = uvs[2 * k]; t[1] = uvs[2 * k + 1];
+					if (withNormals) {
+						short* n = normal(i + k);
+						n[0] = normals[k]; n[1] = normals[4 + k];
+					}
+				}
+			}
+			encodeScalar(i, end);	//The last (up to 3) vertices
+		}
+#endif
+
+		void operator()(size_t begin, size_t end) const {
+#ifdef VERTEXQUANTISER_SSE
+			encodeSIMD(begin, end);
+#else
+			encodeScalar(begin, end);
+#endif
+		}
+	};
+}
+
+void VertexQuantiser::getPositionDecode(const BoundingBox& bb, glm::vec3& offset, glm::vec3& scale) {
+	offset = glm::vec3(bb.xmin, bb.ymin, bb.zmin);
+	scale = glm::vec3(bb.xmax - bb.xmin, bb.ymax - bb.ymin, bb.zmax - bb.zmin);
+	for (int c = 0; c < 3; c++)
+		if (!std::isfinite(offset[c]) || !(scale[c] > 0 && std::isfinite(scale[c])))	//Flat (or broken) box along this axis
+			scale[c] = 0;
+}
+
+void VertexQuantiser::encode(const MeshData& mesh, bool withNormals, std::vector<unsigned char>& result) {
+	Encoder encoder;
+	encoder.mesh = &mesh;
+	encoder.stride = getBytesPerVertex(withNormals);
+	encoder.withUVs = (mesh.uvs.size() == mesh.vertices.size());
+	result.assign(mesh.vertices.size() * encoder.stride, 0);
+	if (result.empty())
+		return;
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Quantise vertices");
+	encoder.out = &result[0];
+	if (withNormals && mesh.normals.size() != mesh.vertices.size())
+		withNormals = false;	//The normals stay 0 (they decode to +z)
+	encoder.withNormals = withNormals;
+	glm::vec3 offset, scale;
+	getPositionDecode(mesh.bb, offset, scale);
+	for (int c = 0; c < 3; c++) {
+		encoder.offset[c] = offset[c];
+		encoder.factor[c] = scale[c] > 0 ? UNORM16_MAX / scale[c] : 0;
+	}
+	parallelFor(mesh.vertices.size(), encoder);
+}
+
+VertexQuantiser::Report VertexQuantiser::measure(const MeshData& mesh, bool withNormals, const std::vector<unsigned char>& encoded) {
+	Report report;
+	size_t stride = getBytesPerVertex(withNormals);
+	report.numVertices = std::min(mesh.vertices.size(), encoded.size() / stride);
+	report.bytesBefore = report.numVertices * sizeof(GLfloat) * (withNormals ? 8 : 5);
+	report.bytesAfter = report.numVertices * stride;
+	report.maxPositionError = report.maxUVError = report.maxNormalErrorDegrees = 0;
+	bool withUVs = (mesh.uvs.size() == mesh.vertices.size());
+	withNormals = withNormals && (mesh.normals.size() == mesh.vertices.size());
+	glm::vec3 offset, scale;
+	getPositionDecode(mesh.bb, offset, scale);
+	for (size_t i = 0; i < report.numVertices; i++) {
+		const unsigned char* vertex = &encoded[i * stride];
+		const unsigned short* p = (const unsigned short*)(vertex + POSITION_OFFSET);
+		glm::vec3 position = offset + scale * glm::vec3(p[0] / UNORM16_MAX, p[1] / UNORM16_MAX, p[2] / UNORM16_MAX);
+		float positionError = glm::length(position - mesh.vertices[i]);
+		if (positionError > report.maxPositionError)	//Skips NaN vertices
+			report.maxPositionError = positionError;
+		if (withUVs) {
+			const unsigned short* t = (const unsigned short*)(vertex + UV_OFFSET);
+			float uvError = std::max(fabsf(halfToFloat(t[0]) - mesh.uvs[i].x), fabsf(halfToFloat(t[1]) - mesh.uvs[i].y));
+			if (uvError > report.maxUVError)
+				report.maxUVError = uvError;
+		}
+		if (withNormals) {
+			float length = glm::length(mesh.normals[i]);
+			if (!(length > 0) || !std::isfinite(length))
+				continue;		//Nothing to compare with
+			//The angle from its sine and cosine (acos alone loses all the precision of such small angles)
+			glm::vec3 original = mesh.normals[i] / length, decoded = decodeOctahedral((const short*)(vertex + NORMAL_OFFSET));
+			float degrees = atan2f(glm::length(glm::cross(original, decoded)), glm::dot(original, decoded)) * 57.2957795f;
+			if (degrees > report.maxNormalErrorDegrees)
+				report.maxNormalErrorDegrees = degrees;
+		}
+	}
+	return report;
+}
+
+VertexQuantiser::Report VertexQuantiser::computeReport(const MeshData& mesh, bool withNormals) {
+	std::vector<unsigned char> encoded;
+	encode(mesh, withNormals, encoded);
+	return measure(mesh, withNormals, encoded);
+}
+
+void VertexQuantiser::setMaxThreads(unsigned int threads) {
+	maxThreads = threads;
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+NAME: VertexQuantiser
+DESCRIPTION: Compact encoding of the vertices of a mesh for the GPU. Floats have far more precision than a model needs:
+	a vertex with a position, UV and normal takes 32 bytes (8 floats), but looks the same on screen in 16:
+		- Positions: 16 bit integers, normalised (0 is the minimum of the bounding box of the mesh and 65535 its maximum).
+		The error is at most 1/131070 of the size of the box (about 0.1mm on a 10m building).
+		- UVs: half floats (1 sign bit, 5 exponent bits, 10 mantissa bits), which the GPU converts to floats by itself.
+		UVs between -1 and 1 keep an error below 1/4096 (a quarter of a texel in a 1024x1024 texture).
+		- Normals: octahedral encoding, in 2 signed normalised 16 bit integers. The unit sphere is projected onto an
+		octahedron (dividing by |x|+|y|+|z|), and the octahedron unfolded onto a square (the lower half folds over the
+		corners), so a direction becomes just 2 numbers in [-1,1]. The error is around 0.005 degrees.
+	Layout of each quantised vertex (every attribute is 4 byte aligned, see VertexFormat::add):
+		bytes 0-7:		position (x,y,z: GL_UNSIGNED_SHORT normalised, plus 2 bytes of padding)
+		bytes 8-11:		uv (u,v: GL_HALF_FLOAT)
+		bytes 12-15:	normal (octahedral x,y: GL_SHORT normalised). Only if the mesh is encoded with normals.
+	Shaders decode them (see shaders/QuantisedMVPVertexShader and shaders/QuantisedPointLightShading): UVs need nothing,
+	positions are PositionOffset + PositionScale * position (see getPositionDecode) and normals are unfolded back.
+	Encoding runs once per mesh, when it is uploaded (see GPUAssetCache). Like MeshStatistics, it processes 4 vertices
+	at a time with SSE2 (F16C converts the UVs, if the compiler is allowed to use it, e.g. /arch:AVX2 or -mf16c), and
+	big meshes are split between several threads.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_VERTEXQUANTISER
+#define _OPENGLFRAMEWORK_VERTEXQUANTISER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	class VertexQuantiser {
+	public:
+		static const GLsizei POSITION_OFFSET = 0, UV_OFFSET = 8, NORMAL_OFFSET = 12;	//Bytes from the start of a quantised vertex
+		/**
+			How much memory we save, and how far the decoded vertices are from the original ones.
+		*/
+		struct Report {
+			size_t numVertices;
+			size_t bytesBefore, bytesAfter;		//Vertex buffer with floats, and quantised
+			float maxPositionError;				//Largest distance between a position and its decoded version (units of the mesh)
+			float maxUVError;					//Largest difference between a UV coordinate and its decoded version
+			float maxNormalErrorDegrees;		//Largest angle between a normal and its decoded version
+		};
+		static inline GLsizei getBytesPerVertex(bool withNormals) { return withNormals ? 16 : 12; }
+		/**
+			Decoding of the positions of a mesh with this bounding box: position = offset + scale * quantised position (in [0,1]).
+		*/
+		static void getPositionDecode(const BoundingBox& bb, glm::vec3& offset, glm::vec3& scale);
+		/**
+			Quantises the vertices of the mesh (positions, UVs and, if withNormals, normals), with the layout above.
+			Meshes without UVs (or normals) get them as 0. The result can be uploaded to a VBO straight away.
+		*/
+		static void encode(const MeshData& mesh, bool withNormals, std::vector<unsigned char>& result);
+		/**
+			Decodes the vertices in encoded (as the shaders do) and compares them with those of the mesh.
+		*/
+		static Report measure(const MeshData& mesh, bool withNormals, const std::vector<unsigned char>& encoded);
+		/**
+			Encodes the mesh and measures the result.
+		*/
+		static Report computeReport(const MeshData& mesh, bool withNormals);
+		/**
+			Limits the threads used by encode (0, the default: one per core).
+		*/
+		static void setMaxThreads(unsigned int threads);
+	};
+};
+#endif
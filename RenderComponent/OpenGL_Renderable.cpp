@@ -0,0 +1,10 @@
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\SceneNodes\IVirtualObject.h>
+
+using namespace OpenGLFramework;
+
+glm::mat4 OpenGL_Renderable::getModelMatrix() {
+	if (drawModelMatrix)
+		return *drawModelMatrix;
+	return getOwner()->getFromObjectToWorldCoordinates();
+}
@@ -21,10 +21,50 @@ NEXT OBJECT TO CHECK: SingleColourMesh_Renderable
 #include <OpenGLFramework/common/ShaderManager.hpp>
 #include <OpenGLFramework/common/texture.hpp>
 #include <OpenGLFramework\Components\IComponent.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderState.h>
+#include <atomic>
+#include <memory>
 
 namespace OpenGLFramework {
+	struct MeshData;		//Forward declaration
+
 	class OpenGL_Renderable : public IComponent {
+	public:
+		/**
+			How a renderable looks, for renderers that do not use OpenGL (see RayTracer). It describes the inputs of its shaders.
+		*/
+		struct SurfaceDescription {
+			enum Lighting {
+				UNLIT,					//Colour = texture * Kd
+				POINT_LIGHT,			//Phong shading (ambient, diffuse, specular), with a point light (see PhongShadingOBJMesh_Renderable)
+				DIRECTIONAL_LIGHT		//Ambient and diffuse, with a directional light (see DirectionalLightOBJMesh_Renderable)
+			};
+			Lighting lighting;
+			std::string textureFile;	//"" if the texture was not loaded from a file (then only Kd is used)
+			glm::vec3 Ka, Kd, Ks;		//Ambient, diffuse and specular components of the material
+			float shininess;
+			glm::vec3 lightPosition;	//World space (POINT_LIGHT)
+			glm::vec3 lightDirection;	//World space, the direction the light travels (DIRECTIONAL_LIGHT)
+			glm::vec3 lightColor;
+			float lightPower;
+			SurfaceDescription() : lighting(UNLIT), Ka(0), Kd(1), Ks(0), shininess(1), lightPosition(0), lightDirection(0, -1, 0), lightColor(1), lightPower(1) { ; }
+		};
+		/**
+			Renderables loaded by the AsyncResourceLoader go through these states. Renderables that are loaded by hand
+			(calling loadResourcesToMainMemory and allocateOpenGLResources yourself) stay UNMANAGED, and are always rendered.
+		*/
+		enum ResourceState {
+			UNMANAGED,		//Not loaded by the AsyncResourceLoader
+			LOADING,		//Waiting for (or running) loadResourcesToMainMemory, in a worker thread
+			LOADED,			//In main memory, waiting for allocateOpenGLResources (in the OpenGL thread)
+			READY,			//Ready to render
+			FAILED			//One of the two phases failed
+		};
+	private:
 		GLuint renderPrimitive;					//How do we want to render (which primitive? GL_LINES, GL_TRIANGLES, GL_POINTS, etc...) 
+		bool transparent;						//Transparent renderables are drawn after opaque ones, sorted back to front
+		std::atomic<int> resourceState;			//See ResourceState. Written by the loader threads, read while rendering
+		const glm::mat4* drawModelMatrix;		//Model matrix for the current render() call (NULL: ask the owner)
 	protected: 
 		/**
 			This is a bounding box (local to the object). Thus, it does not need to be recomputed each time we move the object (or parent nodes)
@@ -32,6 +72,12 @@ namespace OpenGLFramework {
 			If the renderable changes its geometry (e.g. changes local position of a vertex in its buffers), this should be updated.
 		*/
 		BoundingBox bb;
+		/**
+			Model matrix to render with (from object to world coordinates). The RenderQueue gives us the one the 
+			RenderableVisitor got when it visited our owner, so render() does not walk up the scene graph again to compute it.
+			Outside of the queue, we ask our owner.
+		*/
+		glm::mat4 getModelMatrix();
 	public:
 		//Functionality related to base class Component
 		virtual std::string getComponentType() const { 
@@ -40,7 +86,7 @@ namespace OpenGLFramework {
 		}
 
 		//Own behaviour
-		OpenGL_Renderable() :renderPrimitive(GL_TRIANGLES) { 
+		OpenGL_Renderable() :renderPrimitive(GL_TRIANGLES), transparent(false), resourceState(UNMANAGED), drawModelMatrix(NULL) { 
 			bb.xmin = bb.ymin = bb.zmin = -1;
 			bb.xmax = bb.ymax = bb.zmax = 1;
 		}
@@ -48,13 +94,15 @@ namespace OpenGLFramework {
 			This is the first step of the initialization of any content we render in the GPU. 
 			This method will load the data (from files, textures, etc...), do any initial processing (adapt format), compute normals (if not in the file) etc...
 			At the end of the method, all information is ready in main memory to be used, but nothing has been transfered to the GPU yet.
+			It must not call OpenGL: the AsyncResourceLoader runs it in worker threads, for many renderables at once.
 		*/
 		virtual bool loadResourcesToMainMemory() = 0;
 		/**
 			Second step in the initialization. In this stage:
 				- we will create the required data structures in the GPU through OpenGL calls (e.g. attributes, buffers, textures handlers, etc...).
 				- we will also copy the data from maiin memory into GPU memory.
-				- our shaders will also be compiled and ready to run in the GPU.
+				- the layout of our vertex buffers is captured in a VAO (see VertexFormat), so render() only needs to bind it.
+				- our shaders will also be compiled and ready to run in the GPU (see ProgramCache: renderables using the same shaders share them).
 				- at the end of the process, our content is ready to be rendered.
 
 		*/
@@ -74,6 +122,11 @@ namespace OpenGLFramework {
 		*/
 		virtual bool unallocateAllResources() = 0;
 
+		/**
+			Name of the class of the renderable (e.g. to group statistics by type of renderable, see RecordingGL).
+		*/
+		virtual const char* getRenderableTypeName() const { return "OpenGL_Renderable"; }
+
 		/**
 			This method sets the OpeGL rendering primitive to use, when interpreting our vertex buffers. This will alow us to render them as triangles, lines, points, etc...
 		*/
@@ -91,10 +144,64 @@ namespace OpenGLFramework {
 		/**
 			Return a copy of the Bounding box for the renderable. The bounding bos is aligned to the object's local system of reference (not world). 
 			This can be combined with rayCastingCollision and isInsideBB methods in 3DUI_Utils, to interact with objects. 
+			For large scenes, SceneBVH keeps these boxes (in world coordinates) in a tree, so you do not need to test objects one by one.
 		*/
 		inline BoundingBox getLocalBoundingBox() {
 			return this->bb;
 		}
+
+		/**
+			The RenderableVisitor does not render objects straight away. It collects all the renderables in the frame and 
+			sorts them, so that renderables using the same shader, texture and mesh are drawn one after the other 
+			(see RenderQueue and RenderState). These methods describe what each renderable uses (0 = nothing/unknown).
+		*/
+		virtual GLuint getShaderProgram() { return 0; }
+		virtual GLuint getTexture() { return 0; }
+		virtual GLuint getMesh() { return 0; }
+		/**
+			Transparent renderables are drawn after all opaque ones, from back to front (so that they blend correctly).
+		*/
+		inline void setTransparent(bool isTransparent) { transparent = isTransparent; }
+		inline bool isTransparent() { return transparent; }
+		/**
+			Renderables whose bounding box is outside the camera's frustum are not rendered (see FrustumCuller).
+			Renderables that do not use the model/view/projection matrices (e.g. they work in clip space) must return false.
+		*/
+		virtual bool isCullable() { return true; }
+		/**
+			Scenes often show the same asset (same mesh, texture and material) many times. Renderables that can draw 
+			several copies of their asset with one draw call return its batch ID here (see InstanceBatches), or 0 otherwise.
+			The RenderQueue then calls renderInstanced on one of the renderables of each batch, with the model matrices of 
+			all of them. It returns false if it could not draw them (the queue then renders them one by one).
+		*/
+		virtual unsigned int getInstancingBatch() { return 0; }
+		/**
+			Renderables whose mesh has levels of detail (simpler versions of it, see MeshSimplifier) choose the one they will
+			draw here. The RenderableVisitor calls it every frame before queueing the renderable, with its size on screen and 
+			the error allowed on screen (see LODSelector). Returns the level chosen (0 = full detail).
+			It is called before getInstancingBatch: renderables drawing different levels must not share a batch.
+		*/
+		virtual unsigned int selectLevelOfDetail(float screenSize, float tolerance) { return 0; }
+
+		inline ResourceState getResourceState() const { return (ResourceState)resourceState.load(); }
+		inline void setResourceState(ResourceState state) { resourceState.store(state); }
+		/**
+			Renderables still being loaded (see AsyncResourceLoader) are not rendered yet.
+		*/
+		inline bool isReadyToRender() const { int state = resourceState.load(); return state == UNMANAGED || state == READY; }
+		virtual bool renderInstanced(glm::mat4 P, glm::mat4 V, const glm::mat4* modelMatrices, unsigned int count) { return false; }
+		/**
+			The RenderQueue sets the model matrix of the next render() call here (and NULL after it). See getModelMatrix.
+		*/
+		inline void setModelMatrix(const glm::mat4* M) { drawModelMatrix = M; }
+		/**
+			Renderers that do not use OpenGL (e.g. the RayTracer, on machines without a GPU) read the geometry of the renderable
+			(as loaded by loadResourcesToMainMemory, in local coordinates) and its surface from here. 
+			The MeshPicker also uses the geometry, to pick the exact triangle under the mouse. 
+			Renderables that cannot describe themselves this way return an empty pointer/false.
+		*/
+		virtual std::shared_ptr<const MeshData> getMeshData() { return std::shared_ptr<const MeshData>(); }
+		virtual bool getSurfaceDescription(SurfaceDescription& surface) { return false; }
 	};
 };
 #endif
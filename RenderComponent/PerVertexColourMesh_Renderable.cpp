@@ -1,9 +1,14 @@
 #include <OpenGLFramework/Components/RenderComponent/PerVertexColourMesh_Renderable.h>
-#include <OpenGLFramework\3DUI_Utils\3DUI_Utils.h>
+#include <OpenGLFramework/Components/RenderComponent/ProgramCache.h>
+#include <OpenGLFramework/Components/RenderComponent/Profiler.h>
+#include <OpenGLFramework/Components/RenderComponent/MeshProcessing/IncrementalBounds.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
 
 using namespace OpenGLFramework;
 
- PerVertexColourMesh_Renderable::PerVertexColourMesh_Renderable( const int numVertex, const GLfloat vertex_buffer_data[], const GLfloat colour_buffer_data[], bool allocateOwnBuffers):numVertex(numVertex), localBuffers(allocateOwnBuffers){
+ PerVertexColourMesh_Renderable::PerVertexColourMesh_Renderable( const int numVertex, const GLfloat vertex_buffer_data[], const GLfloat colour_buffer_data[], bool allocateOwnBuffers):numVertex(numVertex), localBuffers(allocateOwnBuffers)
+	, streaming(false), maxVertices(0), streamingSegments(3), pendingVertices(NULL), pendingColours(NULL)
+	, pendingVerticesWritten(false), pendingColoursWritten(false), pendingFromSetters(false), pendingNumVertex(numVertex), boundsKnown(true) {
 	if (allocateOwnBuffers)
 	{
 		//This is the most usual scenario. The object is defined and stores its own copy of the data
@@ -20,7 +25,7 @@ using namespace OpenGLFramework;
 		g_vertex_buffer_data =(GLfloat*) &(vertex_buffer_data[0]);
 		g_colour_buffer_data =(GLfloat*) &(colour_buffer_data[0]);
 	}
-	this->bb = ThreeDUI_Utils::createAABoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
+	this->bb = MeshStatistics::computeBoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
 }
 
 bool  PerVertexColourMesh_Renderable::loadResourcesToMainMemory(){
@@ -28,13 +33,35 @@ bool  PerVertexColourMesh_Renderable::loadResourcesToMainMemory(){
 }
 
 bool  PerVertexColourMesh_Renderable::allocateOpenGLResources(){
-	// Create and compile our GLSL program from the shaders
-	programID = ShaderManager::instance().LoadShaders("OpenGLFramework/shaders/MVP_PerVertexColor.vertexshader", "OpenGLFramework/shaders/PerVertexColorFragmentShader.fragmentshader");
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("allocateOpenGLResources", getRenderableTypeName());
+	// Create and compile our GLSL program from the shaders (shared with other renderables using the same shaders; see ProgramCache)
+	programID = ProgramCache::instance().acquireProgram("OpenGLFramework/shaders/MVP_PerVertexColor.vertexshader", "OpenGLFramework/shaders/PerVertexColorFragmentShader.fragmentshader");
 	// Get a handle for our buffers
-	vertexPosition_modelspaceID = glGetAttribLocation(programID, "vertexPosition_modelspace");
-	vertexColourID = glGetAttribLocation(programID, "vertexColor");
+	vertexPosition_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexPosition_modelspace");
+	vertexColourID = ProgramCache::instance().getAttribLocation(programID, "vertexColor");
 	// Get a handle for our "MVP" uniform
-	MatrixID = glGetUniformLocation(programID, "MVP");
+	MatrixID = ProgramCache::instance().getUniformLocation(programID, "MVP");
+	if (streaming) {
+		//One buffer split in segments (see StreamingRingBuffer). Each segment has all the positions, followed by all the colours.
+		if (numVertex > maxVertices) maxVertices = numVertex;
+		GLsizeiptr streamBytes = 3 * maxVertices*sizeof(GLfloat);
+		if (!ring.allocate(2 * streamBytes, streamingSegments))
+			return false;
+		//The VAO reads the positions and colours of the first segment. To draw segment s, we just start drawing 
+		//at vertex 2*s*maxVertices (see getFirstStreamedVertex), so we never need to reconfigure the VAO.
+		glGenVertexArrays(1, &vertexArrayID);
+		glBindVertexArray(vertexArrayID);
+		VertexFormat().add(vertexPosition_modelspaceID, 3).setupAttributes(ring.getBuffer());
+		VertexFormat().add(vertexColourID, 3).setupAttributes(ring.getBuffer(), streamBytes);
+		//Stream the data we were created with as our first frame
+		GLfloat* vertices, *colours;
+		if (beginUpdate(vertices, colours)) {
+			memcpy(vertices, g_vertex_buffer_data, 3 * numVertex*sizeof(GLfloat));
+			memcpy(colours, g_colour_buffer_data, 3 * numVertex*sizeof(GLfloat));
+			endUpdate(numVertex, &bb);
+		}
+		return true;
+	}
 	//Load raw data in OpenGL buffers...
 	glGenBuffers(1, &vertexbuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
@@ -43,6 +70,12 @@ bool  PerVertexColourMesh_Renderable::allocateOpenGLResources(){
 	glGenBuffers(1, &colourbuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, colourbuffer);
 	glBufferData(GL_ARRAY_BUFFER, 3*numVertex*sizeof(GLfloat), g_colour_buffer_data, GL_STATIC_DRAW);	
+	//Capture how our attributes read from these buffers in a VAO. We keep one buffer (and one VertexFormat) per attribute, 
+	//as vertices and colours can be updated separately (see setVertices and setColours).
+	glGenVertexArrays(1, &vertexArrayID);
+	glBindVertexArray(vertexArrayID);
+	VertexFormat().add(vertexPosition_modelspaceID, 3).setupAttributes(vertexbuffer);
+	VertexFormat().add(vertexColourID, 3).setupAttributes(colourbuffer);
 	return true;
 
 }
@@ -51,56 +84,67 @@ bool  PerVertexColourMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 	if (!OpenGL_Renderable::render(P, V))return false;
 
 	//1. Tell OpenGL to use our shader
-	glUseProgram(programID);
+	RenderState::instance().useProgram(programID);
 
 	//2. Configure our attributes:
 	// 2.1. Configure our MVP matrix first, and set its value (it is a "uniform"-> same value for all vertices)
-	glm::mat4 MVP        = P * V * getOwner()->getFromObjectToWorldCoordinates();
+	glm::mat4 MVP        = P * V * getModelMatrix();
 	glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
 	
-	// 2.2. Enable and configure our 2nd attribute: vertices
-	glEnableVertexAttribArray(vertexPosition_modelspaceID);
-	// Connect our attribute to the buffer of vertices (this will feed the data in the buffer to the shader's input attribute vertexPosition_modelspaceID)
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glVertexAttribPointer(
-		vertexPosition_modelspaceID,  // The attribute we want to configure
-		3,                            // size
-		GL_FLOAT,                     // type
-		GL_FALSE,                     // normalized?
-		0,                            // stride
-		(void*)0                      // array buffer offset
-	);
-	// 2.3. Enable and configure our 3rd attribute: colors
-	glEnableVertexAttribArray(vertexColourID);
-	glBindBuffer(GL_ARRAY_BUFFER, colourbuffer);
-	glVertexAttribPointer(
-		vertexColourID,               // The attribute we want to configure
-		3,                           // size
-		GL_FLOAT,                    // type
-		GL_FALSE,                    // normalized?
-		0,                           // stride
-		(void*)0                     // array buffer offset
-	);
+	// 2.2. Bind our VAO: it feeds our buffers of vertices and colours to the shader's input attributes
+	RenderState::instance().bindVertexArray(vertexArrayID);
 	
 	// 3. Draw it!
-	glDrawArrays(getRenderPrimitive(), 0, numVertex);
-
-	//4. Let's disable our attributes now, we would not want someone to use them by accident.
-	glDisableVertexAttribArray(vertexPosition_modelspaceID);
-	glDisableVertexAttribArray(vertexColourID);
+	if (streaming) {
+		//Data given through setVertices/setColours this frame is ready to be used (updates started with beginUpdate 
+		//are finished by whoever started them. Until then, we keep drawing the previous frame).
+		if (pendingVertices && pendingFromSetters)
+			endUpdate(pendingNumVertex, pendingVerticesWritten ? &bb : NULL);
+		glDrawArrays(getRenderPrimitive(), getFirstStreamedVertex(), numVertex);
+		ring.fenceCurrent();	//We cannot write into this segment again until the GPU finishes this draw
+	}
+	else {
+		//Send the data changed since the last frame (only that, see updateVertices/updateColours)
+		if (!dirtyVertices.empty()) {
+			glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+			dirtyVertices.upload(GL_ARRAY_BUFFER, g_vertex_buffer_data, 3 * sizeof(GLfloat));
+		}
+		if (!dirtyColours.empty()) {
+			glBindBuffer(GL_ARRAY_BUFFER, colourbuffer);
+			dirtyColours.upload(GL_ARRAY_BUFFER, g_colour_buffer_data, 3 * sizeof(GLfloat));
+		}
+		glDrawArrays(getRenderPrimitive(), 0, numVertex);
+	}
 	return true;
 }
 
 bool  PerVertexColourMesh_Renderable::unallocateAllResources(){
 	// Cleanup what we allocated in the GPU: VBOs and shader (the attribute handler vertexPosition_clipspaceID is part of the shader, will be deleted with it)
-	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &colourbuffer);
-	glDeleteProgram(programID);
+	glDeleteVertexArrays(1, &vertexArrayID);
+	if (streaming) {
+		ring.release();
+		pendingVertices = pendingColours = NULL;
+	}
+	else {
+		glDeleteBuffers(1, &vertexbuffer);
+		glDeleteBuffers(1, &colourbuffer);
+	}
+	ProgramCache::instance().releaseProgram(programID);
 	return true;
 }
 
 
 void  PerVertexColourMesh_Renderable::setVertices(const int numVertex, const GLfloat vertex_buffer_data[]){
+	if (streaming) {
+		//Copy straight into the segment we are writing (the GPU will read it from there)
+		if (!pendingVertices) beginPendingUpdate();
+		if (!pendingVertices) return;
+		pendingNumVertex = (numVertex < maxVertices) ? numVertex : maxVertices;
+		memcpy(pendingVertices, vertex_buffer_data, 3 * pendingNumVertex*sizeof(GLfloat));
+		pendingVerticesWritten = true;
+		this->bb = MeshStatistics::computeBoundingBox(pendingNumVertex, (GLfloat*)&(vertex_buffer_data[0]));
+		return;
+	}
 	//The number of vertices should remain constant
 	if (localBuffers)
 		memcpy(g_vertex_buffer_data, vertex_buffer_data, 3 * numVertex*sizeof(GLfloat));
@@ -108,10 +152,21 @@ void  PerVertexColourMesh_Renderable::setVertices(const int numVertex, const GLf
 		g_vertex_buffer_data = (GLfloat*)&(vertex_buffer_data[0]);
 	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
 	glBufferData(GL_ARRAY_BUFFER, 3*numVertex*sizeof(GLfloat), g_vertex_buffer_data, GL_DYNAMIC_DRAW);	
+	dirtyVertices.clear();	//Everything was uploaded
+	//Our geometry changed, so does our bounding box (the frustum culling uses it)
+	this->bb = MeshStatistics::computeBoundingBox(numVertex, g_vertex_buffer_data);
 
 }
 
 void  PerVertexColourMesh_Renderable::setColours(const int numVertex, const GLfloat colour_buffer_data[]){
+	if (streaming) {
+		if (!pendingVertices) beginPendingUpdate();
+		if (!pendingVertices) return;
+		pendingNumVertex = (numVertex < maxVertices) ? numVertex : maxVertices;
+		memcpy(pendingColours, colour_buffer_data, 3 * pendingNumVertex*sizeof(GLfloat));
+		pendingColoursWritten = true;
+		return;
+	}
 	//The number of vertices should remain constant
 	if (localBuffers)
 		memcpy(g_colour_buffer_data, colour_buffer_data, 3 * numVertex*sizeof(GLfloat));
@@ -119,5 +174,99 @@ void  PerVertexColourMesh_Renderable::setColours(const int numVertex, const GLfl
 		g_colour_buffer_data = (GLfloat*)&(colour_buffer_data[0]);
 	glBindBuffer(GL_ARRAY_BUFFER, colourbuffer);
 	glBufferData(GL_ARRAY_BUFFER, 3 * numVertex*sizeof(GLfloat), g_colour_buffer_data, GL_DYNAMIC_DRAW);
+	dirtyColours.clear();
+
+}
+
+bool PerVertexColourMesh_Renderable::updateVertices(int offset, int count, const GLfloat vertex_buffer_data[]) {
+	if (streaming || offset < 0 || count <= 0 || offset + count > numVertex)
+		return false;
+	GLfloat* changed = g_vertex_buffer_data + 3 * offset;
+	if (changed == vertex_buffer_data)	//Edited in place (shared buffers): we do not know the old positions anymore
+		this->bb = MeshStatistics::computeBoundingBox(numVertex, g_vertex_buffer_data);
+	else {
+		//The bounding box needs the old positions, so we update it before copying the new ones
+		bool boundsUpdated = IncrementalBounds::update(bb, changed, vertex_buffer_data, count);
+		memmove(changed, vertex_buffer_data, 3 * count*sizeof(GLfloat));
+		if (!boundsUpdated)		//A vertex on the surface of the box moved inwards: the box might need to shrink
+			this->bb = MeshStatistics::computeBoundingBox(numVertex, g_vertex_buffer_data);
+	}
+	dirtyVertices.add(offset, count);
+	return true;
+}
 
-}
\ No newline at end of file
+bool PerVertexColourMesh_Renderable::updateColours(int offset, int count, const GLfloat colour_buffer_data[]) {
+	if (streaming || offset < 0 || count <= 0 || offset + count > numVertex)
+		return false;
+	GLfloat* changed = g_colour_buffer_data + 3 * offset;
+	if (changed != colour_buffer_data)
+		memmove(changed, colour_buffer_data, 3 * count*sizeof(GLfloat));
+	dirtyColours.add(offset, count);
+	return true;
+}
+
+void PerVertexColourMesh_Renderable::enableStreaming(int maxVertices, unsigned int numSegments) {
+	this->streaming = true;
+	this->maxVertices = maxVertices;
+	this->streamingSegments = numSegments;
+}
+
+GLint PerVertexColourMesh_Renderable::getFirstStreamedVertex() {
+	return (GLint)(2 * ring.getCurrentSegment() * maxVertices);
+}
+
+void PerVertexColourMesh_Renderable::beginPendingUpdate() {
+	GLfloat* memory = (GLfloat*)ring.beginWrite();
+	if (!memory)
+		return;
+	pendingVertices = memory;
+	pendingColours = memory + 3 * maxVertices;
+	pendingVerticesWritten = pendingColoursWritten = false;
+	pendingFromSetters = true;
+}
+
+bool PerVertexColourMesh_Renderable::beginUpdate(GLfloat*& vertices, GLfloat*& colours) {
+	if (!streaming)
+		return false;
+	if (!pendingVertices) beginPendingUpdate();
+	if (!pendingVertices) return false;
+	//We expect the caller to fill both
+	pendingVerticesWritten = pendingColoursWritten = true;
+	pendingFromSetters = false;
+	vertices = pendingVertices;
+	colours = pendingColours;
+	return true;
+}
+
+void PerVertexColourMesh_Renderable::endUpdate(int numVertex, const BoundingBox* bounds) {
+	if (!pendingVertices)
+		return;
+	if (numVertex > maxVertices) numVertex = maxVertices;
+	unsigned int previous = ring.getCurrentSegment();
+	unsigned int current = ring.endWrite();
+	//Data not updated this time (e.g. only setColours was called) stays as it was: copy it from the previous segment.
+	//The copy happens in the GPU, no need to bring anything back to main memory.
+	if (!pendingVerticesWritten || !pendingColoursWritten) {
+		GLsizeiptr streamBytes = 3 * maxVertices*sizeof(GLfloat);
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.getBuffer());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ring.getBuffer());
+		for (int stream = 0; stream < 2; stream++) {
+			if (stream == 0 ? pendingVerticesWritten : pendingColoursWritten)
+				continue;
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER
+				, previous * ring.getSegmentSize() + stream * streamBytes
+				, current * ring.getSegmentSize() + stream * streamBytes
+				, 3 * numVertex*sizeof(GLfloat));
+		}
+	}
+	this->numVertex = numVertex;
+	//Our geometry changed, so does our bounding box (the frustum culling uses it)
+	if (bounds) {
+		this->bb = *bounds;
+		boundsKnown = true;
+	}
+	else if (pendingVerticesWritten)
+		boundsKnown = false;	//We do not know where the new points are: we will not cull this renderable
+	pendingVertices = pendingColours = NULL;
+	pendingNumVertex = numVertex;
+}
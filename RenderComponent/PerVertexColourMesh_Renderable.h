@@ -13,6 +13,15 @@ SHADERS:
 	- PerVertexColourFragentShader.fragmentshader: Simple fragment shader that renders each fragment according to its
 	attribute fragmentColor. DIFFERENCE TO PREVIOUS: It does not use a fixed colour, it reads it from an attribute, which
 	came from the vertex shader (actually, it is an interpolated value).
+STREAMING: For data that changes every frame (e.g. a Kinect depth cloud), call enableStreaming() before allocating the
+	renderable. Vertices and colours then live in a StreamingRingBuffer: each update is written straight into memory 
+	mapped from the GPU (no reallocations, no copies in our own buffers), while the GPU is still drawing previous frames.
+	A producer thread can fill the points itself:
+		GLfloat *vertices, *colours;
+		renderable->beginUpdate(vertices, colours);		//OpenGL thread
+		... fill up to maxVertices points (any thread) ...
+		renderable->endUpdate(numPoints, &bounds);		//OpenGL thread, once the points are written
+	setVertices/setColours also work in this mode (they copy straight into the mapped memory).
 NEXT OBJECT TO CHECK: PerVertexColourMesh_Renderable
 ************************************************************************/
 
@@ -20,6 +29,9 @@ NEXT OBJECT TO CHECK: PerVertexColourMesh_Renderable
 #ifndef _OPENGL_MANUAL_PERVERTEXCOLOUR
 #define _OPENGL_MANUAL_PERVERTEXCOLOUR
 #include <OpenGLFramework/Components/RenderComponent/OpenGL_Renderable.h>
+#include <OpenGLFramework/Components/RenderComponent/VertexFormat.h>
+#include <OpenGLFramework/Components/RenderComponent/StreamingRingBuffer.h>
+#include <OpenGLFramework/Components/RenderComponent/MeshProcessing/DirtyRanges.h>
 
 
 
@@ -40,17 +52,62 @@ namespace OpenGLFramework {
 		bool localBuffers;
 		GLuint vertexbuffer;
 		GLuint colourbuffer;
+		GLuint vertexArrayID;	//VAO: how our shader attributes read from vertexbuffer and colourbuffer
+		DirtyRanges dirtyVertices, dirtyColours;	//Changed by updateVertices/updateColours, waiting to be uploaded
+		//Streaming mode: each segment of the ring holds maxVertices positions, followed by maxVertices colours
+		bool streaming;
+		int maxVertices;
+		unsigned int streamingSegments;
+		StreamingRingBuffer ring;
+		GLfloat* pendingVertices, *pendingColours;		//Mapped memory of the segment being updated
+		bool pendingVerticesWritten, pendingColoursWritten;
+		bool pendingFromSetters;		//The update was started by setVertices/setColours (render() finishes it)
+		int pendingNumVertex;
+		bool boundsKnown;				//False if the last update did not tell us its bounding box (we cannot cull it)
+		void beginPendingUpdate();
+		GLint getFirstStreamedVertex();
 
 	public:
 		//Own methods
 		PerVertexColourMesh_Renderable(const int numVertex, const GLfloat vertex_buffer_data[], const GLfloat colour_buffer_data[], bool allocateOwnBuffers = true);
 		void setVertices(const int numVertex, const GLfloat vertex_buffer_data[]);
 		void setColours(const int numVertex, const GLfloat colour_buffer_data[]);
+		/**
+			Change count vertices (or colours), starting at vertex offset. Only the data changed is sent to the GPU (in the 
+			next render), and the bounding box is updated incrementally (see IncrementalBounds). Use them to edit parts of 
+			big meshes. They return false if the range is outside the mesh, or in streaming mode (each frame is written whole).
+			With shared buffers, the data can be edited in place by the client, and then given to us at its own address.
+		*/
+		bool updateVertices(int offset, int count, const GLfloat vertex_buffer_data[]);
+		bool updateColours(int offset, int count, const GLfloat colour_buffer_data[]);
+		inline const DirtyRanges::Statistics& getVertexUploadStatistics() const { return dirtyVertices.getStatistics(); }
+		inline const DirtyRanges::Statistics& getColourUploadStatistics() const { return dirtyColours.getStatistics(); }
+		/**
+			Stream vertices and colours through a ring of numSegments buffers (see StreamingRingBuffer), up to maxVertices 
+			points per frame. Call it before allocateOpenGLResources().
+		*/
+		void enableStreaming(int maxVertices, unsigned int numSegments = 3);
+		inline bool isStreaming() { return streaming; }
+		/**
+			Streaming mode: returns where to write the next frame (maxVertices xyz positions and maxVertices rgb colours).
+			The memory can be filled from any thread, until endUpdate is called.
+		*/
+		bool beginUpdate(GLfloat*& vertices, GLfloat*& colours);
+		/**
+			Streaming mode: the next frame is written, with numVertex points. Passing its bounding box allows frustum 
+			culling it (computing it here would mean reading back the mapped memory, which is very slow).
+		*/
+		void endUpdate(int numVertex, const BoundingBox* bounds = NULL);
+		inline const StreamingRingBuffer::Statistics& getStreamingStatistics() const { return ring.getStatistics(); }
 		//Methods inherited from base class OpenGL_Renderable
 		virtual bool loadResourcesToMainMemory();
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "PerVertexColourMesh_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getMesh() { return vertexArrayID; }
+		virtual bool isCullable() { return !streaming || boundsKnown; }
 	};
 };
 #endif
@@ -1,142 +1,255 @@
 #include <OpenGLFramework\Components\RenderComponent\PhongShadingOBJMesh_Renderable.h>
-#include <OpenGLFramework/common/objloader.hpp>
-#include <OpenGLFramework\3DUI_Utils\3DUI_Utils.h>
+#include <OpenGLFramework\Components\RenderComponent\ProgramCache.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <OpenGLFramework\Components\RenderComponent\InstanceBatches.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshOptimiser.h>
+#include <cstdio>
 
 using namespace OpenGLFramework;
 
+namespace {
+	//Appends a value to a batch description, as text. Values that look the same must give the same description, which 
+	//their bytes do not (-0 and 0, or NaNs with different payloads, have different bytes)
+	void appendValue(std::string& description, float value) {
+		char text[32];
+		if (value != value)
+			sprintf(text, "nan|");
+		else
+			sprintf(text, "%.9g|", value + 0.0f);	//-0 + 0 is 0
+		description += text;
+	}
+};
+
+void PhongShadingOBJMesh_Renderable::setDefaultMaterial() {
+	for (int i = 0; i < 3; i++) {
+		Ka[i] = 0.1f;
+		Kd[i] = 1.0f;
+		Ks[i] = 0.3f;
+	}
+	Ns = 5.0f;
+}
+
 bool PhongShadingOBJMesh_Renderable::loadResourcesToMainMemory(){
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("loadResourcesToMainMemory", getRenderableTypeName());
 
 	// Read our .obj file into our raw data buffers
-	bool res; 
-	if(model!="")
-		res= loadOBJ(model.c_str(), vertices, uvs, normals);
-	this->bb = ThreeDUI_Utils::createAABoundingBox(vertices);
+	if(model!="")	// Read it from its binary cache, if it is up to date (see OBJMeshCache). The cache also gives us the bounding box.
+		mesh = GPUAssetCache::instance().acquireMeshData(model);	// Renderables loading the same model share it (see GPUAssetCache)
+	else if (providedMesh) {	// The geometry was provided in the constructor. We still index it, to render it with glDrawElements
+		providedMesh->bb = MeshStatistics::computeBoundingBox(providedMesh->vertices);
+		if (!MeshWelder::weld(providedMesh->vertices, providedMesh->uvs, providedMesh->normals, providedMesh->indices))
+			return false;	// The arrays provided do not match (e.g. fewer normals than vertices)
+		MeshOptimiser::optimise(*providedMesh);	// ... and reorder it for the GPU's caches (OBJ files get this in OBJMeshCache)
+		mesh = providedMesh;
+		providedMesh.reset();	//From now on, it is read only
+	}
+	if (!mesh)
+		return false;
+	this->bb = mesh->bb;
 	return true;
 }
 
 bool PhongShadingOBJMesh_Renderable::allocateOpenGLResources(){
-	/* Load the texture. These methods actually load into main memory, but they also allocate
-	   the texture in the graphics card already, returning a handler for the texture.
-	   We support two formats, one for BMP and ne for DDS.	*/
-	if(		textureName.substr(textureName.find_last_of(".") + 1) == "bmp" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "BMP")
-				Texture = loadBMP_custom(textureName.c_str());  
-	else if(textureName.substr(textureName.find_last_of(".") + 1) == "dds" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "DDS")
-				Texture = loadDDS(textureName.c_str());
-	else if(		textureName.substr(textureName.find_last_of(".") + 1) == "jpg" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "JPG")
-				Texture = loadJPEG(textureName.c_str());  else if(textureName=="")
-		;//The user provided the texture himself/herself. No need to do anything more
-	else //The user did give a name, but it does not have the correct extension...
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("allocateOpenGLResources", getRenderableTypeName());
+	if (!mesh)	//loadResourcesToMainMemory failed (or was not called)
 		return false;
+	/* Load the texture (BMP, DDS or JPEG). If other renderables already loaded the same file, we share theirs (see GPUAssetCache).
+	   These methods actually load into main memory, but they also allocate the texture in the graphics card already, returning a handler for the texture. */
+	if (textureName != "") {
+		Texture = GPUAssetCache::instance().acquireTexture(textureName);
+		if (!Texture)	//The file could not be read, or it does not have a supported extension...
+			return false;
+	}
+	//else: the user provided the texture himself/herself. No need to do anything more
 
-	// Create and compile our GLSL program from the shaders
-	programID = ShaderManager::instance().LoadShaders("OpenGLFramework/shaders/PointLightShading.vertexshader", "OpenGLFramework/shaders/PointLightShading.fragmentshader");
-	// Get a handle for our "MVP" uniform
-	MatrixID = glGetUniformLocation(programID, "MVP");			//MVP matrix (uniform)
-	ViewMatrixID = glGetUniformLocation(programID, "V");		//View matrix(uniform)
-	ModelMatrixID = glGetUniformLocation(programID, "M");		//Model matrix(uniform)
+	// Create and compile our GLSL program from the shaders (shared with other renderables using the same shaders; see ProgramCache)
+	// Quantised vertices need a vertex shader that decodes them (see VertexQuantiser), and the lights of the scene a fragment shader that loops over them (see ClusteredLighting)
+	std::string vertexShader = quantised ? "OpenGLFramework/Components/RenderComponent/shaders/QuantisedPointLightShading.vertexshader" : "OpenGLFramework/Components/RenderComponent/shaders/PointLightShading.vertexshader";
+	std::string fragmentShader = clustered ? "OpenGLFramework/Components/RenderComponent/shaders/ClusteredPointLightShading.fragmentshader" : "OpenGLFramework/Components/RenderComponent/shaders/PointLightShading.fragmentshader";
+	programID = ProgramCache::instance().acquireProgram(vertexShader, fragmentShader);
+	// Our matrices, material and light are in the ObjectConstants uniform block, and the camera in FrameConstants (see UniformBlocks)
+	UniformBlocks::instance().acquire();
 	// Get a handle for our buffers
-	vertexPosition_modelspaceID = glGetAttribLocation(programID, "vertexPosition_modelspace");	//Array of vertices
-	vertexUVID = glGetAttribLocation(programID, "vertexUV");									//Array of UV coords
-	vertexNormal_modelspaceID = glGetAttribLocation(programID, "vertexNormal_modelspace");		//Array of normals
-	lightID = glGetUniformLocation(programID, "LightPosition_worldspace");						//Location of light (uniform) 
-	lightColorID = glGetUniformLocation(programID, "LightColor");	
-	lightPowerID=glGetUniformLocation(programID, "LightPower");
-	ShininessID=glGetUniformLocation(programID, "Shininess");;
-	Ka_ID = glGetUniformLocation(programID, "Ka");
-	Kd_ID = glGetUniformLocation(programID, "Kd");
-	Ks_ID = glGetUniformLocation(programID, "Ks");
-	TextureID  = glGetUniformLocation(programID, "myTextureSampler");							//Texture to use (uniform)
-	// Load object data into OpenGL buffers (VBO)
-	glGenBuffers(1, &vertexbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-	glGenBuffers(1, &uvbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-	glGenBuffers(1, &normalbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+	vertexPosition_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexPosition_modelspace");	//Array of vertices
+	vertexUVID = ProgramCache::instance().getAttribLocation(programID, "vertexUV");									//Array of UV coords
+	vertexNormal_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexNormal_modelspace");		//Array of normals
+	TextureID  = ProgramCache::instance().getUniformLocation(programID, "myTextureSampler");							//Texture to use (uniform)
+	// Our "myTextureSampler" always reads Texture Unit 0. The program keeps it, so we set it once here, not in every render()
+	RenderState::instance().useProgram(programID);
+	glUniform1i(TextureID, 0);
+	VertexQuantiser::getPositionDecode(mesh->bb, positionOffset, positionScale);
+	if (clustered) {	//The lists of lights of each cluster (uniforms). The RenderableVisitor fills them every frame while we use them
+		ClusteredLighting::instance().acquire();
+		clusterUniforms = ClusteredLighting::getUniformLocations(programID);
+	}
+	// Load object data into OpenGL buffers: a single VBO with the position, UV and normal of each vertex next to each other (interleaved), and the indices.
+	// Renderables using the same model share them (see GPUAssetCache). Geometry provided by the user is not shared...
+	if (model != "")
+		meshBuffers = GPUAssetCache::instance().acquireMeshBuffers(model, *mesh, true, quantised);
+	else
+		meshBuffers = GPUAssetCache::uploadMeshBuffers(*mesh, true, quantised);
+	if (!meshBuffers.vertexBuffer)	//Empty mesh, or its attribute arrays do not match
+		return false;
+	// ... and a VAO that remembers how our shader attributes read from it. render() only needs to bind it.
+	VertexFormat format;
+	if (quantised)	//16 bit positions (normalised to [0,1] inside the bounding box), half float UVs and octahedral normals (2 normalised shorts)
+		format.add(vertexPosition_modelspaceID, 3, GL_UNSIGNED_SHORT, GL_TRUE).add(vertexUVID, 2, GL_HALF_FLOAT).add(vertexNormal_modelspaceID, 2, GL_SHORT, GL_TRUE);
+	else
+		format.add(vertexPosition_modelspaceID, 3).add(vertexUVID, 2).add(vertexNormal_modelspaceID, 3);
+	vertexArrayID = format.createVertexArray(meshBuffers.vertexBuffer, meshBuffers.elementBuffer);
 
 	return true;
 }
 
+void PhongShadingOBJMesh_Renderable::fillObjectConstants() {
+	constants.Ka = glm::vec4(Ka[0], Ka[1], Ka[2], 0);
+	constants.Kd = glm::vec4(Kd[0], Kd[1], Kd[2], 0);
+	constants.Ks = glm::vec4(Ks[0], Ks[1], Ks[2], Ns);
+	constants.lightPosition = glm::vec4(lightPos, 1);
+	constants.lightColor = glm::vec4(lightColor, lightPower);
+	constants.positionOffset = glm::vec4(positionOffset, 0);	//Where the quantised positions are (our bounding box)
+	constants.positionScale = glm::vec4(positionScale, 0);
+}
+
 bool PhongShadingOBJMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 	if(!OpenGL_Renderable::render(P, V))return false;
 	// Use our shader
-		glUseProgram(programID);
-
-		// Send our transformation to the currently bound shader, 
-		// in the "MVP" uniform
-		glm::mat4 MVP = P * V * getOwner()->getFromObjectToWorldCoordinates();
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);										
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &(getOwner()->getFromObjectToWorldCoordinates())[0][0]);////We need to put our vertices in world coordinates (the light is in world coordinates)
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &V[0][0]);
-		glUniform3f(lightID, lightPos.x, lightPos.y, lightPos.z);
-		glUniform3f(lightColorID, lightColor.x, lightColor.y, lightColor.z);
-		glUniform1f(lightPowerID,lightPower);
-		glUniform1f(ShininessID,Ns);
-		glUniform3f(Ka_ID, Ka[0],Ka[1],Ka[2]);
-		glUniform3f(Kd_ID, Kd[0],Kd[1],Kd[2]);
-		glUniform3f(Ks_ID, Ks[0],Ks[1],Ks[2]);
-		// Bind our texture in Texture Unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Texture);
-		// Set our "myTextureSampler" sampler to user Texture Unit 0
-		glUniform1i(TextureID, 0);
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(vertexPosition_modelspaceID);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glVertexAttribPointer(
-			vertexPosition_modelspaceID,  // The attribute we want to configure
-			3,                            // size
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(vertexUVID);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glVertexAttribPointer(
-			vertexUVID,                   // The attribute we want to configure
-			2,                            // size : U+V => 2
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(vertexNormal_modelspaceID);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-		glVertexAttribPointer(
-			vertexNormal_modelspaceID,    // The attribute we want to configure
-			3,                            // size
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-		
-		// Draw the triangles !
-		glDrawArrays(getRenderPrimitive(), 0, vertices.size()); // 12*3 indices starting at 0 -> 12 triangles
-
-		glDisableVertexAttribArray(vertexPosition_modelspaceID);
-		glDisableVertexAttribArray(vertexUVID);	
-		glDisableVertexAttribArray(vertexNormal_modelspaceID);
+		RenderState::instance().useProgram(programID);
+
+		// Send our transformation, material and light to the currently bound shader, all at once, in our "ObjectConstants" block.
+		// We need the model matrix too: we put our vertices in world coordinates (the light is in world coordinates)
+		constants.M = getModelMatrix();
+		constants.MVP = P * V * constants.M;
+		fillObjectConstants();
+		UniformBlocks::instance().bindObject(&constants, sizeof(constants));
+		if (clustered)	//The lights of the scene (in texture units 1 to 3)
+			ClusteredLighting::instance().bind(clusterUniforms);
+		// Bind our texture in Texture Unit 0, which our sampler reads (RenderState skips it if it is already bound)
+		RenderState::instance().bindTexture2D(0, Texture);
+		// Bind our vertices and indices (the VAO has all our attributes configured already)
+		RenderState::instance().bindVertexArray(vertexArrayID);
+		// Draw the triangles (indexed: each vertex is shared by several triangles) of our level of detail (a range of the element buffer, see MeshData)!
+		unsigned int level = lod.getLevel(*mesh);
+		glDrawElements(getRenderPrimitive(), (GLsizei)mesh->getLevelNumIndices(level), GL_UNSIGNED_INT, (void*)(mesh->getLevelFirstIndex(level) * sizeof(unsigned int)));
+	return true;
+}
+
+unsigned int PhongShadingOBJMesh_Renderable::getInstancingBatch() {
+	if (!mesh)
+		return 0;
+	if (instancingBatchDirty) {
+		// Only renderables reading their mesh and texture from files can be compared (geometry or textures provided by the user could be anything)
+		instancingBatches.clear();
+		if (model != "" && textureName != "") {
+			// The material and light are part of the asset: their values are appended to the description
+			std::string asset = "PhongOBJ|" + GPUAssetCache::canonicalPath(model) + "|" + GPUAssetCache::canonicalPath(textureName) + "|";
+			for (int i = 0; i < 3; i++) appendValue(asset, Ka[i]);
+			for (int i = 0; i < 3; i++) appendValue(asset, Kd[i]);
+			for (int i = 0; i < 3; i++) appendValue(asset, Ks[i]);
+			appendValue(asset, Ns);
+			for (int i = 0; i < 3; i++) appendValue(asset, lightPos[i]);
+			for (int i = 0; i < 3; i++) appendValue(asset, lightColor[i]);
+			appendValue(asset, lightPower);
+			if (quantised)
+				asset += "|quantised";
+			if (clustered)
+				asset += "|clustered";
+			// Each level of detail is a different asset
+			for (unsigned int level = 0; level < mesh->getNumLevelsOfDetail(); level++) {
+				char suffix[16];
+				sprintf(suffix, "|LOD%u", level);
+				instancingBatches.push_back(InstanceBatches::instance().getBatchID(level == 0 ? asset : asset + suffix));
+			}
+		}
+		instancingBatchDirty = false;
+	}
+	return instancingBatches.empty() ? 0 : instancingBatches[lod.getLevel(*mesh)];
+}
+
+bool PhongShadingOBJMesh_Renderable::allocateInstancedResources() {
+	std::string vertexShader = quantised ? "OpenGLFramework/Components/RenderComponent/shaders/QuantisedPointLightShading.vertexshader" : "OpenGLFramework/Components/RenderComponent/shaders/PointLightShading.vertexshader";
+	std::string fragmentShader = clustered ? "OpenGLFramework/Components/RenderComponent/shaders/ClusteredPointLightShading.fragmentshader" : "OpenGLFramework/Components/RenderComponent/shaders/PointLightShading.fragmentshader";
+	instancedProgramID = ProgramCache::instance().acquireProgram(vertexShader, fragmentShader, "INSTANCED");
+	if (!instancedProgramID)
+		return false;
+	instancedTextureID = ProgramCache::instance().getUniformLocation(instancedProgramID, "myTextureSampler");
+	RenderState::instance().useProgram(instancedProgramID);
+	glUniform1i(instancedTextureID, 0);		//Texture Unit 0, set once (as in allocateOpenGLResources)
+	if (clustered)
+		instancedClusterUniforms = ClusteredLighting::getUniformLocations(instancedProgramID);
+	// Same vertices and indices as usual (the attribute locations can differ in this shader), plus one model matrix per instance
+	GLuint positionID = ProgramCache::instance().getAttribLocation(instancedProgramID, "vertexPosition_modelspace");
+	GLuint uvID = ProgramCache::instance().getAttribLocation(instancedProgramID, "vertexUV");
+	GLuint normalID = ProgramCache::instance().getAttribLocation(instancedProgramID, "vertexNormal_modelspace");
+	VertexFormat format;
+	if (quantised)
+		format.add(positionID, 3, GL_UNSIGNED_SHORT, GL_TRUE).add(uvID, 2, GL_HALF_FLOAT).add(normalID, 2, GL_SHORT, GL_TRUE);
+	else
+		format.add(positionID, 3).add(uvID, 2).add(normalID, 3);
+	instancedVertexArrayID = format.createVertexArray(meshBuffers.vertexBuffer, meshBuffers.elementBuffer);
+	instanceBuffer.setupAttributes(ProgramCache::instance().getAttribLocation(instancedProgramID, "instanceModelMatrix"));
+	RenderState::instance().invalidate();	//We bound a VAO and a buffer behind RenderState's back
+	return true;
+}
+
+bool PhongShadingOBJMesh_Renderable::renderInstanced(glm::mat4 P, glm::mat4 V, const glm::mat4* modelMatrices, unsigned int count) {
+	if (!instancedProgramID && !allocateInstancedResources())
+		return false;
+	RenderState::instance().useProgram(instancedProgramID);
+	// The view and projection (FrameConstants), light and material (our ObjectConstants) are the same for all instances.
+	// Their model matrices go into a buffer
+	fillObjectConstants();
+	UniformBlocks::instance().bindObject(&constants, sizeof(constants));
+	if (clustered)
+		ClusteredLighting::instance().bind(instancedClusterUniforms);
+	instanceBuffer.upload(modelMatrices, count);
+	RenderState::instance().bindTexture2D(0, Texture);
+	RenderState::instance().bindVertexArray(instancedVertexArrayID);
+	// Draw the mesh 'count' times, in one call (all the renderables in our batch use our level of detail)
+	unsigned int level = lod.getLevel(*mesh);
+	glDrawElementsInstanced(getRenderPrimitive(), (GLsizei)mesh->getLevelNumIndices(level), GL_UNSIGNED_INT, (void*)(mesh->getLevelFirstIndex(level) * sizeof(unsigned int)), count);
 	return true;
 }
 
 bool PhongShadingOBJMesh_Renderable::unallocateAllResources(){
-	// Cleanup VBO and shader
-	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &uvbuffer);
-	glDeleteBuffers(1, &normalbuffer);
-	glDeleteProgram(programID);
-	glDeleteTextures(1, &TextureID);
+	// Cleanup VAO, buffers and shader (allocateOpenGLResources may have failed before creating the VAO)
+	if (vertexArrayID) {
+		glDeleteVertexArrays(1, &vertexArrayID);
+		vertexArrayID = 0;
+	}
+	if (model != "")
+		GPUAssetCache::instance().releaseMeshBuffers(meshBuffers);
+	else
+		GPUAssetCache::deleteMeshBuffers(meshBuffers);
+	ProgramCache::instance().releaseProgram(programID);
+	UniformBlocks::instance().release();
+	if (clustered)
+		ClusteredLighting::instance().release();
+	if (instancedProgramID) {
+		glDeleteVertexArrays(1, &instancedVertexArrayID);
+		ProgramCache::instance().releaseProgram(instancedProgramID);
+		instanceBuffer.release();
+		instancedProgramID = instancedVertexArrayID = 0;
+	}
+	// Textures loaded from a file are shared with other renderables: the cache deletes them when nobody uses them.
+	// Textures provided by the user are not ours to delete.
+	if (textureName != "")
+		GPUAssetCache::instance().releaseTexture(Texture);
+	instancingBatchDirty = true;	//The mesh (and its levels of detail) could be different when we load again
+	mesh.reset();
+	return true;
+}
+
+bool PhongShadingOBJMesh_Renderable::getSurfaceDescription(SurfaceDescription& surface) {
+	surface.lighting = SurfaceDescription::POINT_LIGHT;
+	surface.textureFile = textureName;
+	surface.Ka = glm::vec3(Ka[0], Ka[1], Ka[2]);
+	surface.Kd = glm::vec3(Kd[0], Kd[1], Kd[2]);
+	surface.Ks = glm::vec3(Ks[0], Ks[1], Ks[2]);
+	surface.shininess = Ns;
+	surface.lightPosition = lightPos;
+	surface.lightColor = lightColor;
+	surface.lightPower = lightPower;
 	return true;
 }
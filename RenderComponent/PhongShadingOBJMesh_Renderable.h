@@ -6,7 +6,15 @@ The texture can be either a file (.bmp or .dds) or externally generated (other f
 The object is described in local coordinates, but its model matrix can be used to move it within the world. 
 The lighting and the shaders are very explained in detail in the lectures, 
 but you can check http://www.opengl-tutorial.org/beginners-tutorials/tutorial-8-basic-shading/, in case you missed this.
-Shaders can be found in: shaders/PointLightShading.vertexshader and shaders/PointLightShading.fragmentshader 
+Shaders can be found in: RenderComponent/shaders/PointLightShading.vertexshader and RenderComponent/shaders/PointLightShading.fragmentshader 
+The camera comes from the FrameConstants uniform block, and our model matrix, material and light are sent in one go, in
+our ObjectConstants block (see UniformBlocks), instead of setting a uniform for each of them.
+Objects using the same model, texture, material and light are drawn together, with one instanced draw call (see renderInstanced).
+This uses the same shaders with INSTANCED defined, where the model matrix is a per instance attribute.
+Vertices can also be quantised, to take half the memory (see setQuantisedVertices and VertexQuantiser). They are decoded
+by RenderComponent/shaders/QuantisedPointLightShading.vertexshader (with the fragment shader of PointLightShading).
+Instead of its own light, it can be lit by all the point lights of the scene (see setClusteredLighting and ClusteredLighting),
+with RenderComponent/shaders/ClusteredPointLightShading.fragmentshader.
 
 NEXT OBJECT TO CHECK: NONE. You made it to the end. I hope you had fun and learnt quite a bit. 
 	Now you are ready to create your own shaders and extend this framework! 
@@ -15,6 +23,14 @@ NEXT OBJECT TO CHECK: NONE. You made it to the end. I hope you had fun and learn
 #ifndef _PHONG_OBJ_MESH_RENDERABLE
 #define _PHONG_OBJ_MESH_RENDERABLE
 #include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\VertexFormat.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\InstanceBuffer.h>
+#include <OpenGLFramework\Components\RenderComponent\LODSelector.h>
+#include <OpenGLFramework\Components\RenderComponent\ClusteredLighting.h>
+#include <OpenGLFramework\Components\RenderComponent\UniformBlocks.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshWelder.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\VertexQuantiser.h>
 #include <vector>
 
 namespace OpenGLFramework {
@@ -22,50 +38,77 @@ namespace OpenGLFramework {
 		//Config parameters
 		std::string textureName, model;
 		//std::string vertexShader, fragmentShader; //This is fixed, as the arguments (see "vertexPosition_modelspace" "myTextureSampler" init) are specific for the shaders, changing programs makes no sense...
-		//Raw data (as read from a file, etc...)
-		std::vector<glm::vec3> vertices;
-		std::vector<glm::vec2> uvs;
-		std::vector<glm::vec3> normals;
+		//Raw data (as read from a file, etc...). Renderables loading the same model share it (see GPUAssetCache)
+		std::shared_ptr<const MeshData> mesh;
+		std::shared_ptr<MeshData> providedMesh;	//Geometry given in the constructor, until loadResourcesToMainMemory() indexes it
 		glm::vec3 lightPos;
 		glm::vec3 lightColor;
 		float Ka[3], Kd[3], Ks[3], Ns, lightPower;
+		//Until setMaterial is called, the material of the original shader: ambient 0.1, diffuse 1 (just the texture), 
+		//specular 0.3 and shininess 5. The light is white.
+		void setDefaultMaterial();
+		//Our block of uniforms (ObjectConstants in shaders/PointLightShading, std140 layout): filled and copied to the GPU for each draw (see UniformBlocks)
+		struct ObjectConstants {
+			glm::mat4 M, MVP;					//We also need the intermediate matrixes, not only the final MVP
+			glm::vec4 Ka, Kd, Ks;				//Phong components of the material (Ks.w: shininess)
+			glm::vec4 lightPosition, lightColor;	//lightColor.w: power of the light
+			glm::vec4 positionOffset, positionScale;	//Decoding of quantised positions (see VertexQuantiser)
+		};
+		ObjectConstants constants;
+		void fillObjectConstants();
 		//OpenGL handlers
 		GLuint programID;
-		GLuint MatrixID, ViewMatrixID, ModelMatrixID; //We also need the intermediate matrixes, not only the final MVP
 		GLuint vertexPosition_modelspaceID;
 		GLuint vertexUVID;
 		GLuint vertexNormal_modelspaceID;
-		GLuint lightID;							//Position of the light.
-		GLuint lightColorID, lightPowerID, ShininessID;
-		GLuint Ka_ID, Kd_ID, Ks_ID;				//Phong components of the material.
 		GLuint TextureID;
+		bool quantised;						//16 bit positions, half float UVs and octahedral normals, instead of floats
+		glm::vec3 positionOffset, positionScale;
+		bool clustered;						//Lit by the lights of the scene (see ClusteredLighting), instead of our own light
+		ClusteredLighting::ProgramUniforms clusterUniforms, instancedClusterUniforms;
 		//Actual OpenGL data structures
 		GLuint Texture;
-		GLuint vertexbuffer;
-		GLuint uvbuffer;
-		GLuint normalbuffer;
+		GPUAssetCache::MeshBuffers meshBuffers;	//Interleaved positions, UVs, normals and indices (shared, see GPUAssetCache)
+		GLuint vertexArrayID;				//VAO: how our shader attributes read from meshBuffers
+		LODSelector lod;					//Level of detail drawn this frame (see MeshSimplifier)
+		//Instanced rendering (see renderInstanced). The shader and VAO are only created if we ever draw several instances.
+		std::vector<unsigned int> instancingBatches;	//One per level of detail: renderables with the same model, texture, material, light and level share it
+		bool instancingBatchDirty;			//Material or light changed: we need to look for our batch again
+		GLuint instancedProgramID;
+		GLuint instancedTextureID;
+		GLuint instancedVertexArrayID;		//VAO reading our meshBuffers and the model matrices in instanceBuffer
+		InstanceBuffer instanceBuffer;
+		bool allocateInstancedResources();
 
 	public:
 		//Own methods
 		PhongShadingOBJMesh_Renderable(std::string model, std::string texture, glm::vec3 lightPos = glm::vec3(4, 4, 4), float lightPower = 75.0f)
-			: TextureID(-1), textureName(texture), model(model), lightPos(lightPos), lightPower(lightPower)
+			: TextureID(-1), textureName(texture), model(model), lightPos(lightPos), lightColor(1.0f), lightPower(lightPower), quantised(false), clustered(false), vertexArrayID(0)
+			, instancingBatchDirty(true), instancedProgramID(0), instancedVertexArrayID(0)
 		{
-			;
+			setDefaultMaterial();
 		}
 
 		PhongShadingOBJMesh_Renderable(std::vector<glm::vec3>vertices, std::vector<glm::vec2> uvs, std::vector<glm::vec3> normals, std::string texture, glm::vec3 lightPos = glm::vec3(4, 4, 4), float lightPower = 75.0f)
-			: vertices(vertices), uvs(uvs), normals(normals)
-			, TextureID(-1), textureName(texture), model(""), lightPos(lightPos), lightPower(lightPower)
+			: providedMesh(new MeshData())
+			, TextureID(-1), textureName(texture), model(""), lightPos(lightPos), lightColor(1.0f), lightPower(lightPower), quantised(false), clustered(false), vertexArrayID(0)
+			, instancingBatchDirty(true), instancedProgramID(0), instancedVertexArrayID(0)
 		{
-			;
+			setDefaultMaterial();
+			providedMesh->vertices = vertices;
+			providedMesh->uvs = uvs;
+			providedMesh->normals = normals;
 		}
 		PhongShadingOBJMesh_Renderable(const int numVertex, const GLfloat vertex_buffer_data[], const GLfloat uv_buffer_data[], const GLfloat normal_buffer_data[], std::string texture, glm::vec3 lightPos = glm::vec3(4, 4, 4), float lightPower = 75.0f)
-			: TextureID(-1), textureName(texture), model(""), lightPos(lightPos), lightPower(lightPower)
+			: providedMesh(new MeshData())
+			, TextureID(-1), textureName(texture), model(""), lightPos(lightPos), lightColor(1.0f), lightPower(lightPower), quantised(false), clustered(false), vertexArrayID(0)
+			, instancingBatchDirty(true), instancedProgramID(0), instancedVertexArrayID(0)
 		{
+			setDefaultMaterial();
 			for (int i = 0; i < numVertex; i++) {
-				vertices.push_back(glm::vec3(vertex_buffer_data[3 * i], vertex_buffer_data[3 * i + 1], vertex_buffer_data[3 * i + 2]));
-				uvs.push_back(glm::vec2(uv_buffer_data[2 * i], uv_buffer_data[2 * i + 1]));
-				normals.push_back(glm::vec3(normal_buffer_data[3 * i], normal_buffer_data[3 * i + 1], normal_buffer_data[3 * i + 2]));
+				providedMesh->vertices.push_back(glm::vec3(vertex_buffer_data[3 * i], vertex_buffer_data[3 * i + 1], vertex_buffer_data[3 * i + 2]));
+				providedMesh->uvs.push_back(glm::vec2(uv_buffer_data[2 * i], uv_buffer_data[2 * i + 1]));
+				providedMesh->normals.push_back(glm::vec3(normal_buffer_data[3 * i], normal_buffer_data[3 * i + 1], normal_buffer_data[3 * i + 2]));
 			}
 		}
 		void setMaterial(float _Ka[3], float _Kd[3], float _Ks[3], float _Ns) {
@@ -73,14 +116,43 @@ namespace OpenGLFramework {
 			Kd[0] = _Kd[0]; Kd[1] = _Kd[1]; Kd[2] = _Kd[2];
 			Ks[0] = _Ks[0]; Ks[1] = _Ks[1]; Ks[2] = _Ks[2];
 			Ns = _Ns;
+			instancingBatchDirty = true;
 		}
 
-		inline void setLight(glm::vec3 pos, glm::vec3 color, float intensity) { lightPos = pos; lightColor = color; lightPower = intensity; }
+		inline void setLight(glm::vec3 pos, glm::vec3 color, float intensity) { lightPos = pos; lightColor = color; lightPower = intensity; instancingBatchDirty = true; }
+		/**
+			Uploads our vertices quantised (see VertexQuantiser): 16 bytes per vertex instead of 32. Call it before allocateOpenGLResources.
+		*/
+		inline void setQuantisedVertices(bool enabled) { quantised = enabled; instancingBatchDirty = true; }
+		inline bool hasQuantisedVertices() const { return quantised; }
+		/**
+			Lights us with all the lights in ClusteredLighting::getLights(), instead of the one given by setLight (only the 
+			material is used). Call it before allocateOpenGLResources.
+		*/
+		inline void setClusteredLighting(bool enabled) { clustered = enabled; instancingBatchDirty = true; }
+		inline bool hasClusteredLighting() const { return clustered; }
+		/**
+			Memory used by our buffers, before (one vertex per triangle corner, as read from the file) and after welding the mesh.
+		*/
+		inline MeshWelder::Report getMeshMemoryReport() { return (mesh ? MeshWelder::computeReport(mesh->vertices.size(), mesh->indices.size()) : MeshWelder::computeReport(0, 0)); }
+		/**
+			Memory saved, and errors introduced, by quantising our vertices (whether we use them quantised or not).
+		*/
+		inline VertexQuantiser::Report getQuantisationReport() { return (mesh ? VertexQuantiser::computeReport(*mesh, true) : VertexQuantiser::computeReport(MeshData(), true)); }
 		//Methods inherited from base class OpenGL_Renderable
 		virtual bool loadResourcesToMainMemory();
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "PhongShadingOBJMesh_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getTexture() { return Texture; }
+		virtual GLuint getMesh() { return vertexArrayID; }
+		virtual unsigned int getInstancingBatch();
+		virtual unsigned int selectLevelOfDetail(float screenSize, float tolerance) { return mesh ? lod.select(*mesh, screenSize, tolerance) : 0; }
+		virtual bool renderInstanced(glm::mat4 P, glm::mat4 V, const glm::mat4* modelMatrices, unsigned int count);
+		virtual std::shared_ptr<const MeshData> getMeshData() { return mesh; }
+		virtual bool getSurfaceDescription(SurfaceDescription& surface);
 	};
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#ifdef OPENGLFRAMEWORK_PROFILING
+#include <algorithm>
+#include <cstdio>
+
+using namespace OpenGLFramework;
+
+std::atomic<bool> Profiler::enabled(true);
+std::chrono::steady_clock::time_point Profiler::epoch = std::chrono::steady_clock::now();
+
+namespace {
+	thread_local void* threadBuffer = NULL;		//This thread's ThreadBuffer (created the first time it records something)
+
+	std::string historyKey(const char* name, const char* category) {
+		return std::string(name) + "|" + (category ? category : "");
+	}
+
+	double percentile(std::vector<double>& sorted, double p) {
+		if (sorted.empty()) return 0;
+		size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+
+	//Chrome's trace format is JSON: names must be escaped
+	void writeJSONString(FILE* file, const char* text) {
+		fputc('"', file);
+		for (const char* c = text; *c; c++) {
+			if (*c == '"' || *c == '\\') fputc('\\', file);
+			if ((unsigned char)*c >= 32) fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+};
+
+Profiler::Profiler() : lastFrameEnd(0) {
+}
+
+Profiler& Profiler::instance() {
+	static Profiler _instance;
+	return _instance;
+}
+
+Profiler::ThreadBuffer& Profiler::localBuffer() {
+	if (!threadBuffer) {
+		ThreadBuffer* buffer = new ThreadBuffer();
+		buffer->events.resize(EVENTS_PER_THREAD);
+		buffer->written.store(0);
+		buffer->frameStartEvent = 0;
+		buffer->clearedUpTo.store(0);
+		Profiler& p = instance();
+		std::lock_guard<std::mutex> lock(p.mutex);
+		buffer->id = (unsigned int)p.threads.size();
+		p.threads.push_back(std::unique_ptr<ThreadBuffer>(buffer));
+		threadBuffer = buffer;
+	}
+	return *(ThreadBuffer*)threadBuffer;
+}
+
+void Profiler::record(const char* name, const char* category, unsigned long long start, unsigned long long duration) {
+	ThreadBuffer& buffer = localBuffer();
+	unsigned long long index = buffer.written.load(std::memory_order_relaxed);
+	Event& e = buffer.events[index % EVENTS_PER_THREAD];
+	e.name = name;
+	e.category = category;
+	e.start = start;
+	e.duration = duration;
+	buffer.written.store(index + 1, std::memory_order_release);		//Readers only look at events before this one
+}
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadBuffer& buffer = localBuffer();
+	std::lock_guard<std::mutex> lock(instance().mutex);
+	buffer.name = name;
+}
+
+void Profiler::copyEvents(const ThreadBuffer& buffer, unsigned long long from, std::vector<Event>& result) {
+	unsigned long long end = buffer.written.load(std::memory_order_acquire);
+	unsigned long long begin = std::max(from, (end > EVENTS_PER_THREAD) ? end - EVENTS_PER_THREAD : 0ULL);
+	size_t first = result.size();
+	for (unsigned long long i = begin; i < end; i++)
+		result.push_back(buffer.events[i % EVENTS_PER_THREAD]);
+	//The thread kept writing while we copied: the oldest events we copied could have been overwritten. Discard them.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	unsigned long long after = buffer.written.load(std::memory_order_relaxed);
+	unsigned long long safe = (after + 1 > EVENTS_PER_THREAD) ? after + 1 - EVENTS_PER_THREAD : 0;
+	if (safe > begin)
+		result.erase(result.begin() + first, result.begin() + first + (size_t)std::min(safe - begin, end - begin));
+}
+
+void Profiler::endFrame() {
+	unsigned long long frameEnd = now();
+	ThreadBuffer& buffer = localBuffer();
+	std::vector<Event> events;
+	copyEvents(buffer, std::max(buffer.frameStartEvent, buffer.clearedUpTo.load()), events);
+	buffer.frameStartEvent = buffer.written.load(std::memory_order_relaxed);
+	//1. Time of each scope (and category) in this frame. Names are string literals: we can group them by their pointers
+	std::map<std::pair<const char*, const char*>, std::pair<double, unsigned int> > byPointer;		//Milliseconds, calls
+	for (size_t i = 0; i < events.size(); i++) {
+		std::pair<double, unsigned int>& f = byPointer[std::make_pair(events[i].name, events[i].category)];
+		f.first += events[i].duration * 1e-6;
+		f.second++;
+	}
+	std::map<std::string, std::pair<double, unsigned int> > frame;		//The same literal can have several copies (e.g. one per .cpp)
+	for (std::map<std::pair<const char*, const char*>, std::pair<double, unsigned int> >::iterator it = byPointer.begin(); it != byPointer.end(); it++) {
+		std::string key = historyKey(it->first.first, it->first.second);
+		std::pair<double, unsigned int>& f = frame[key];
+		f.first += it->second.first;
+		f.second += it->second.second;
+		History& h = history[key];
+		if (h.name.empty()) {
+			h.name = it->first.first;
+			h.category = it->first.second ? it->first.second : "";
+		}
+	}
+	if (lastFrameEnd) {
+		std::pair<double, unsigned int>& f = frame[historyKey("Frame", NULL)];
+		f.first = (frameEnd - lastFrameEnd) * 1e-6;
+		f.second = 1;
+		history[historyKey("Frame", NULL)].name = "Frame";
+	}
+	lastFrameEnd = frameEnd;
+	//2. Add it to their history
+	for (std::map<std::string, std::pair<double, unsigned int> >::iterator it = frame.begin(); it != frame.end(); it++) {
+		History& h = history[it->first];
+		h.frameMs.push_back(it->second.first);
+		h.frameCalls.push_back(it->second.second);
+		if (h.frameMs.size() > FRAMES_IN_SUMMARY) {
+			h.frameMs.pop_front();
+			h.frameCalls.pop_front();
+		}
+	}
+}
+
+std::vector<Profiler::Summary> Profiler::getFrameSummaries() {
+	std::vector<Summary> result;
+	std::vector<double> sorted;
+	for (std::map<std::string, History>::iterator it = history.begin(); it != history.end(); it++) {
+		const History& h = it->second;
+		if (h.frameMs.empty())
+			continue;
+		Summary s;
+		s.name = h.name;
+		s.category = h.category;
+		s.frames = (unsigned int)h.frameMs.size();
+		sorted.assign(h.frameMs.begin(), h.frameMs.end());
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0, calls = 0;
+		for (size_t i = 0; i < sorted.size(); i++) {
+			total += sorted[i];
+			calls += h.frameCalls[i];
+		}
+		s.averageMs = total / sorted.size();
+		s.callsPerFrame = calls / sorted.size();
+		s.p50Ms = percentile(sorted, 0.50);
+		s.p99Ms = percentile(sorted, 0.99);
+		s.maxMs = sorted.back();
+		result.push_back(s);
+	}
+	return result;
+}
+
+bool Profiler::writeChromeTrace(const std::string& fileName) {
+	FILE* file = fopen(fileName.c_str(), "w");
+	if (!file)
+		return false;
+	std::vector<ThreadBuffer*> buffers;
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t t = 0; t < threads.size(); t++) {
+			buffers.push_back(threads[t].get());
+			names.push_back(threads[t]->name);
+		}
+	}
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	std::vector<Event> events;
+	for (size_t t = 0; t < buffers.size(); t++) {
+		//Name of the thread's row
+		char defaultName[32];
+		sprintf(defaultName, "Thread %u", buffers[t]->id);
+		fprintf(file, "%s{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",\n", buffers[t]->id);
+		writeJSONString(file, names[t].empty() ? defaultName : names[t].c_str());
+		fprintf(file, "}}");
+		first = false;
+		//Its events ("complete" events: start and duration, in microseconds)
+		events.clear();
+		copyEvents(*buffers[t], buffers[t]->clearedUpTo.load(), events);
+		for (size_t i = 0; i < events.size(); i++) {
+			fprintf(file, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", buffers[t]->id, events[i].start * 1e-3, events[i].duration * 1e-3);
+			writeJSONString(file, events[i].name);
+			if (events[i].category) {
+				fprintf(file, ",\"cat\":");
+				writeJSONString(file, events[i].category);
+			}
+			fprintf(file, "}");
+		}
+	}
+	fprintf(file, "\n]}\n");
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+void Profiler::clear() {
+	history.clear();
+	lastFrameEnd = 0;
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t t = 0; t < threads.size(); t++)		//Other threads keep writing to their buffers: we only move where they start
+		threads[t]->clearedUpTo.store(threads[t]->written.load());
+}
+
+double Profiler::getScopeCostNanoseconds() {
+	static double cost = -1;
+	if (cost < 0) {
+		//The scopes go to a scratch buffer, in place of this thread's own (it is only used by this thread)
+		ThreadBuffer scratch;
+		scratch.events.resize(EVENTS_PER_THREAD);
+		scratch.written.store(0);
+		scratch.clearedUpTo.store(0);
+		scratch.frameStartEvent = 0;
+		scratch.id = 0;
+		void* ownBuffer = threadBuffer;
+		threadBuffer = &scratch;
+		const unsigned int SCOPES = 20000;
+		unsigned long long start = now();
+		for (unsigned int i = 0; i < SCOPES; i++) {
+			Scope scope("Profiler calibration", NULL);
+		}
+		cost = (double)(now() - start) / SCOPES;
+		threadBuffer = ownBuffer;
+	}
+	return cost;
+}
+#endif
@@ -0,0 +1,152 @@
+/**********************************************************************
+NAME: Profiler
+DESCRIPTION: Measures where the CPU time goes: loading renderables (loadResourcesToMainMemory, OBJ and texture files),
+	allocating them (allocateOpenGLResources) and rendering them (the RenderableVisitor traversal, culling, sorting,
+	and each type of renderable). Code is measured by scopes:
+		void something() {
+			OPENGLFRAMEWORK_PROFILE_SCOPE("Something");		//Measures from here to the end of the block
+			...
+		}
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY(name, category) also gives a category (e.g. the type of renderable).
+	Names and categories must be string literals (or strings that live for the whole program): only the pointer is kept.
+	The scopes are only compiled in if OPENGLFRAMEWORK_PROFILING is defined. Otherwise they are empty macros (no cost).
+	How it works:
+		- Each thread writes its events (name, category, start and duration) to its own ring buffer, so threads never
+		wait for each other. Old events are overwritten when the buffer is full.
+		- writeChromeTrace() saves the events in the buffers as a JSON file that chrome://tracing (or https://ui.perfetto.dev)
+		shows as a timeline, one row per thread.
+		- endFrame() (called by the RenderableVisitor after each frame) adds up the time of each scope (and category)
+		in the frame, on the thread that renders. getFrameSummaries() gives their median (p50), p99 and maximum
+		over the last frames, e.g. how long rendering each type of renderable takes.
+	A scope costs two reads of the clock and writing one event of 32 bytes (see getScopeCostNanoseconds). We only place 
+	them around work that takes microseconds at least, so the overhead stays well below 1% of the frame.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_PROFILER
+#define _OPENGLFRAMEWORK_PROFILER
+#include "OpenGLFRameworkPrerequisites.h"
+
+#ifdef OPENGLFRAMEWORK_PROFILING
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OpenGLFramework {
+	class Profiler {
+	public:
+		struct Event {
+			const char* name;
+			const char* category;			//NULL if none
+			unsigned long long start;		//Nanoseconds since the profiler started
+			unsigned long long duration;	//Nanoseconds
+		};
+		struct Summary {
+			std::string name, category;
+			unsigned int frames;			//Frames (of the last ones) in which the scope ran
+			double callsPerFrame;
+			double averageMs, p50Ms, p99Ms, maxMs;	//Time per frame (all the calls of the frame added up)
+		};
+		static const unsigned int EVENTS_PER_THREAD = 1 << 16;
+		static const unsigned int FRAMES_IN_SUMMARY = 240;
+		/**
+			Measures the time between its creation and its destruction (use the macros below).
+		*/
+		class Scope {
+			const char* name;
+			const char* category;
+			bool active;
+			unsigned long long start;
+		public:
+			inline Scope(const char* name, const char* category) : name(name), category(category), active(Profiler::isEnabled()) {
+				if (active) start = now();
+			}
+			inline ~Scope() {
+				if (active) record(name, category, start, now() - start);
+			}
+		};
+	private:
+		//Events of one thread. Only that thread writes; written counts all the events ever written (the ring index is written % EVENTS_PER_THREAD).
+		struct ThreadBuffer {
+			std::vector<Event> events;
+			std::atomic<unsigned long long> written;
+			unsigned int id;
+			std::string name;
+			unsigned long long frameStartEvent;	//First event of the current frame (endFrame). Only that thread uses it
+			std::atomic<unsigned long long> clearedUpTo;	//Events before this one were forgotten (clear), by any thread
+		};
+		//Time per frame of a scope/category, over the last FRAMES_IN_SUMMARY frames
+		struct History {
+			std::string name, category;
+			std::deque<double> frameMs;
+			std::deque<unsigned int> frameCalls;
+		};
+		static std::atomic<bool> enabled;
+		static std::chrono::steady_clock::time_point epoch;
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer> > threads;		//Never removed: events of finished threads can still be exported
+		std::map<std::string, History> history;
+		unsigned long long lastFrameEnd;
+		Profiler();
+		Profiler(const Profiler&);
+		Profiler& operator=(const Profiler&);
+		static ThreadBuffer& localBuffer();
+		static void record(const char* name, const char* category, unsigned long long start, unsigned long long duration);
+		//Copies the events of a buffer still in it (some might be overwritten while we copy them: we discard those)
+		static void copyEvents(const ThreadBuffer& buffer, unsigned long long from, std::vector<Event>& result);
+	public:
+		static Profiler& instance();
+		static inline unsigned long long now() {
+			return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+		}
+		/**
+			Scopes can also be switched off (and on) while the program runs. They are on by default.
+		*/
+		static inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+		static inline void setEnabled(bool on) { enabled.store(on); }
+		/**
+			Name of the calling thread in the trace (e.g. "Loader 2").
+		*/
+		static void setThreadName(const std::string& name);
+		/**
+			Ends a frame of the calling thread (the one rendering): adds its events to the frame summaries.
+		*/
+		void endFrame();
+		/**
+			Median, p99 and maximum time per frame of each scope (and category), sorted by name and category.
+			The frame time itself (between endFrame calls) is under the name "Frame".
+		*/
+		std::vector<Summary> getFrameSummaries();
+		/**
+			Saves the events still in the buffers of all threads in Chrome's trace format. Returns false if the file could not be written.
+		*/
+		bool writeChromeTrace(const std::string& fileName);
+		/**
+			Forgets the frame summaries, and the events recorded so far.
+		*/
+		void clear();
+		/**
+			Average cost of a scope (measured the first time this is called, with scopes that do nothing). The scopes
+			measured are written to a scratch buffer, so they do not push out events nor show up in the trace.
+		*/
+		double getScopeCostNanoseconds();
+	};
+};
+
+#define OPENGLFRAMEWORK_PROFILER_CONCATENATE_(a, b) a##b
+#define OPENGLFRAMEWORK_PROFILER_CONCATENATE(a, b) OPENGLFRAMEWORK_PROFILER_CONCATENATE_(a, b)
+#define OPENGLFRAMEWORK_PROFILE_SCOPE(name) OpenGLFramework::Profiler::Scope OPENGLFRAMEWORK_PROFILER_CONCATENATE(_profilerScope, __LINE__)(name, NULL)
+#define OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY(name, category) OpenGLFramework::Profiler::Scope OPENGLFRAMEWORK_PROFILER_CONCATENATE(_profilerScope, __LINE__)(name, category)
+#define OPENGLFRAMEWORK_PROFILE_END_FRAME() OpenGLFramework::Profiler::instance().endFrame()
+#define OPENGLFRAMEWORK_PROFILE_THREAD_NAME(name) OpenGLFramework::Profiler::setThreadName(name)
+#else
+#define OPENGLFRAMEWORK_PROFILE_SCOPE(name)
+#define OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY(name, category)
+#define OPENGLFRAMEWORK_PROFILE_END_FRAME()
+#define OPENGLFRAMEWORK_PROFILE_THREAD_NAME(name)
+#endif
+#endif
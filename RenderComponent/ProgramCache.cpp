@@ -0,0 +1,295 @@
+#include <OpenGLFramework\Components\RenderComponent\ProgramCache.h>
+#include <OpenGLFramework\Components\RenderComponent\UniformBlocks.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MappedFile.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderState.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Layout of a program binary file: header followed by the binary returned by glGetProgramBinary.
+	const char PROGRAM_CACHE_MAGIC[8] = { 'O', 'G', 'L', 'F', 'P', 'R', 'O', 'G' };
+	const unsigned int PROGRAM_CACHE_VERSION = 1;
+
+	struct ProgramCacheHeader {
+		char magic[8];
+		unsigned int version;
+		unsigned int headerSize;			//sizeof(ProgramCacheHeader), detects builds with different struct packing
+		unsigned long long hash;			//Hash of the sources, defines and driver the binary was built with
+		unsigned int binaryFormat;			//As returned by glGetProgramBinary
+		unsigned int binarySize;
+	};
+
+	//FNV-1a
+	unsigned long long hashString(const std::string& s, unsigned long long h = 14695981039346656037ULL) {
+		for (size_t i = 0; i < s.size(); i++) {
+			h ^= (unsigned char)s[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	bool readTextFile(const std::string& fileName, std::string& contents) {
+		std::ifstream file(fileName.c_str(), std::ios::in);
+		if (!file.is_open())
+			return false;
+		std::stringstream ss;
+		ss << file.rdbuf();
+		contents = ss.str();
+		return true;
+	}
+
+	//Adds the defines ("A;B 2") right after the #version line (which must be the first statement in the shader)
+	std::string addDefines(const std::string& source, const std::string& defines) {
+		if (defines == "")
+			return source;
+		std::string defineLines;
+		std::stringstream ss(defines);
+		std::string define;
+		while (std::getline(ss, define, ';'))
+			if (define != "")
+				defineLines += "#define " + define + "\n";
+		size_t insertAt = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos) {
+			insertAt = source.find('\n', version);
+			insertAt = (insertAt == std::string::npos) ? source.size() : insertAt + 1;
+		}
+		return source.substr(0, insertAt) + defineLines + source.substr(insertAt);
+	}
+
+	GLuint compileShader(GLenum type, const std::string& source, const std::string& fileName) {
+		GLuint shader = glCreateShader(type);
+		const char* sourcePointer = source.c_str();
+		glShaderSource(shader, 1, &sourcePointer, NULL);
+		glCompileShader(shader);
+		GLint result = GL_FALSE, infoLogLength = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+		if (infoLogLength > 1) {
+			std::vector<char> message(infoLogLength + 1);
+			glGetShaderInfoLog(shader, infoLogLength, NULL, &message[0]);
+			printf("%s: %s\n", fileName.c_str(), &message[0]);
+		}
+		if (result != GL_TRUE) {
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+
+	double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+};
+
+ProgramCache::ProgramCache() : binaryCacheEnabled(true) {
+	memset(&stats, 0, sizeof(stats));
+}
+
+ProgramCache& ProgramCache::instance() {
+	static ProgramCache _instance;
+	return _instance;
+}
+
+GLuint ProgramCache::acquireProgram(const std::string& vertexShader, const std::string& fragmentShader, const std::string& defines) {
+	//1. Is it loaded already?
+	std::string key = GPUAssetCache::canonicalPath(vertexShader) + "|" + GPUAssetCache::canonicalPath(fragmentShader) + "|" + defines;
+	std::map<std::string, GLuint>::iterator it = programsByKey.find(key);
+	if (it != programsByKey.end()) {
+		programs[it->second].users++;
+		stats.hits++;
+		return it->second;
+	}
+	//2. Read the sources. Their contents (not their dates) decide if a binary on disk is still valid
+	std::string vertexSource, fragmentSource;
+	if (!readTextFile(vertexShader, vertexSource) || !readTextFile(fragmentShader, fragmentSource)) {
+		printf("Impossible to open %s or %s. Are you in the right directory?\n", vertexShader.c_str(), fragmentShader.c_str());
+		return 0;
+	}
+	vertexSource = addDefines(vertexSource, defines);
+	fragmentSource = addDefines(fragmentSource, defines);
+	GLuint program = 0;
+	std::string binaryFile;
+	unsigned long long hash = 0;
+	GLint numBinaryFormats = 0;
+	if (binaryCacheEnabled)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+	if (numBinaryFormats > 0) {
+		//Binaries only work with the driver that created them
+		const char* vendor = (const char*)glGetString(GL_VENDOR);
+		const char* renderer = (const char*)glGetString(GL_RENDERER);
+		const char* version = (const char*)glGetString(GL_VERSION);
+		hash = hashString(vertexSource);
+		hash = hashString(fragmentSource, hash);
+		hash = hashString(std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : ""), hash);
+		char hashText[17];
+		sprintf(hashText, "%016llx", hash);
+		binaryFile = vertexShader + "." + hashText + ".glprogram";
+		//3. Try the binary on disk...
+		program = loadBinary(binaryFile, hash);
+	}
+	//4. ... or compile the sources (and store the result for next time)
+	if (!program) {
+		program = compile(vertexSource, fragmentSource, vertexShader, fragmentShader, numBinaryFormats > 0);
+		if (!program)
+			return 0;
+		if (numBinaryFormats > 0)
+			storeBinary(binaryFile, hash, program);
+	}
+	//5. Connect its uniform blocks (camera, lights, object constants; see UniformBlocks) to the buffers shared by all programs
+	UniformBlocks::setupProgram(program);
+	Program& p = programs[program];
+	p.key = key;
+	p.users = 1;
+	programsByKey[key] = program;
+	return program;
+}
+
+GLuint ProgramCache::compile(const std::string& vertexSource, const std::string& fragmentSource, const std::string& vertexShader, const std::string& fragmentShader, bool retrievable) {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("Compile program");
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	GLuint vertexShaderID = compileShader(GL_VERTEX_SHADER, vertexSource, vertexShader);
+	GLuint fragmentShaderID = compileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentShader);
+	if (!vertexShaderID || !fragmentShaderID) {
+		if (vertexShaderID) glDeleteShader(vertexShaderID);
+		if (fragmentShaderID) glDeleteShader(fragmentShaderID);
+		return 0;
+	}
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderID);
+	glAttachShader(program, fragmentShaderID);
+	if (retrievable)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);	//We want to store it on disk
+	glLinkProgram(program);
+	GLint result = GL_FALSE, infoLogLength = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if (infoLogLength > 1) {
+		std::vector<char> message(infoLogLength + 1);
+		glGetProgramInfoLog(program, infoLogLength, NULL, &message[0]);
+		printf("%s + %s: %s\n", vertexShader.c_str(), fragmentShader.c_str(), &message[0]);
+	}
+	glDetachShader(program, vertexShaderID);
+	glDetachShader(program, fragmentShaderID);
+	glDeleteShader(vertexShaderID);
+	glDeleteShader(fragmentShaderID);
+	if (result != GL_TRUE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	stats.compiled++;
+	stats.compileSeconds += secondsSince(start);
+	return program;
+}
+
+GLuint ProgramCache::loadBinary(const std::string& fileName, unsigned long long hash) {
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	MappedFile file;
+	if (!file.open(fileName) || file.getSize() < sizeof(ProgramCacheHeader))
+		return 0;
+	ProgramCacheHeader header;
+	memcpy(&header, file.getData(), sizeof(header));
+	if (memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != PROGRAM_CACHE_VERSION
+		|| header.headerSize != sizeof(ProgramCacheHeader) || header.hash != hash
+		|| file.getSize() < sizeof(ProgramCacheHeader) + header.binarySize) {
+		//Another version of the cache, or a damaged file: nobody will load it, so we delete it (storeBinary writes a new one)
+		file.close();
+		remove(fileName.c_str());
+		return 0;
+	}
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binaryFormat, (const char*)file.getData() + sizeof(ProgramCacheHeader), header.binarySize);
+	GLint result = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	if (result != GL_TRUE) {	//E.g. the driver changed in a way its version string does not show
+		glDeleteProgram(program);
+		stats.binariesRejected++;
+		file.close();			//Windows cannot delete a file while it is mapped
+		remove(fileName.c_str());
+		return 0;
+	}
+	stats.loadedFromDisk++;
+	stats.binaryLoadSeconds += secondsSince(start);
+	return program;
+}
+
+void ProgramCache::storeBinary(const std::string& fileName, unsigned long long hash, GLuint program) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, &binary[0]);
+	ProgramCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+	header.version = PROGRAM_CACHE_VERSION;
+	header.headerSize = sizeof(ProgramCacheHeader);
+	header.hash = hash;
+	header.binaryFormat = format;
+	header.binarySize = (unsigned int)length;
+	//Write to a temporary file and rename it at the end, so that nobody reads a half written binary
+	std::string tmpFile = fileName + ".tmp";
+	FILE* f = fopen(tmpFile.c_str(), "wb");
+	if (!f)
+		return;		//Read only folder? We just do not cache it
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(&binary[0], binary.size(), 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	if (ok) {
+		remove(fileName.c_str());	//rename() does not overwrite existing files on Windows
+		ok = rename(tmpFile.c_str(), fileName.c_str()) == 0;
+	}
+	if (!ok)
+		remove(tmpFile.c_str());
+}
+
+void ProgramCache::releaseProgram(GLuint program) {
+	std::map<GLuint, Program>::iterator it = programs.find(program);
+	if (it == programs.end())
+		return;		//Not ours
+	if (--it->second.users == 0) {
+		programsByKey.erase(it->second.key);
+		programs.erase(it);
+		glDeleteProgram(program);
+		RenderState::instance().invalidate();	//The name could be reused by a new program
+	}
+}
+
+GLint ProgramCache::getUniformLocation(GLuint program, const std::string& name) {
+	std::map<GLuint, Program>::iterator it = programs.find(program);
+	if (it == programs.end())
+		return glGetUniformLocation(program, name.c_str());
+	std::map<std::string, GLint>::iterator location = it->second.uniforms.find(name);
+	if (location != it->second.uniforms.end())
+		return location->second;
+	return it->second.uniforms[name] = glGetUniformLocation(program, name.c_str());
+}
+
+GLint ProgramCache::getAttribLocation(GLuint program, const std::string& name) {
+	std::map<GLuint, Program>::iterator it = programs.find(program);
+	if (it == programs.end())
+		return glGetAttribLocation(program, name.c_str());
+	std::map<std::string, GLint>::iterator location = it->second.attributes.find(name);
+	if (location != it->second.attributes.end())
+		return location->second;
+	return it->second.attributes[name] = glGetAttribLocation(program, name.c_str());
+}
+
+ProgramCache::Statistics ProgramCache::getStatistics() const {
+	Statistics result = stats;
+	result.programsLoaded = (unsigned int)programs.size();
+	return result;
+}
+
+void ProgramCache::resetStatistics() {
+	memset(&stats, 0, sizeof(stats));
+}
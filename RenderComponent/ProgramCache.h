@@ -0,0 +1,73 @@
+/**********************************************************************
+NAME: ProgramCache
+DESCRIPTION: Creates the shader programs used by the renderables, sharing them and remembering them between runs.
+	- Renderables using the same shaders (same vertex shader, fragment shader and defines) get the same program. 
+	  Programs are reference counted: acquireProgram() in allocateOpenGLResources(), releaseProgram() in 
+	  unallocateAllResources(). The program is deleted when its last user releases it.
+	- The location of each uniform and attribute is looked up in OpenGL only once per program (getUniformLocation, 
+	  getAttribLocation), instead of once per renderable.
+	- Linked programs are stored on disk (glGetProgramBinary), next to the vertex shader (<vertexShader>.<hash>.glprogram).
+	  The next run loads that binary (glProgramBinary) instead of compiling and linking the shaders again. The hash 
+	  covers the shader sources, the defines and the driver (vendor, renderer, version): changing any of them creates 
+	  a new binary. If the driver rejects a binary anyway (or it is not valid), we delete it, compile the shaders and replace it.
+	Uniform blocks named FrameConstants and ObjectConstants are connected to the buffers of UniformBlocks.
+	Defines are given as a list separated by ';' (e.g. "INSTANCED;MAX_LIGHTS 8"). They are added to both shaders, 
+	right after their #version line.
+	This plays the role of ShaderManager::LoadShaders (common/ShaderManager.hpp), which compiles every program it is asked for.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_PROGRAMCACHE
+#define _OPENGLFRAMEWORK_PROGRAMCACHE
+#include "OpenGLFRameworkPrerequisites.h"
+#include <map>
+
+namespace OpenGLFramework {
+	class ProgramCache {
+	public:
+		struct Statistics {
+			unsigned int hits;					//Programs that were already loaded (shared)
+			unsigned int compiled;				//Programs compiled and linked from their sources
+			unsigned int loadedFromDisk;		//Programs loaded from a binary on disk
+			unsigned int binariesRejected;		//Binaries on disk the driver did not accept
+			unsigned int programsLoaded;		//Programs currently loaded
+			double compileSeconds;				//Time spent compiling and linking
+			double binaryLoadSeconds;			//Time spent loading binaries
+		};
+	private:
+		struct Program {
+			std::string key;
+			unsigned int users;
+			std::map<std::string, GLint> uniforms, attributes;		//Locations already looked up
+		};
+		std::map<std::string, GLuint> programsByKey;
+		std::map<GLuint, Program> programs;
+		bool binaryCacheEnabled;
+		Statistics stats;
+		ProgramCache();
+		//retrievable: we will store its binary. Otherwise we do not ask for it (the hint can cost the driver memory and optimisations)
+		GLuint compile(const std::string& vertexSource, const std::string& fragmentSource, const std::string& vertexShader, const std::string& fragmentShader, bool retrievable);
+		//Deletes the file if it is not a valid binary of this hash (or the driver rejects it): it would never be loaded
+		GLuint loadBinary(const std::string& fileName, unsigned long long hash);
+		void storeBinary(const std::string& fileName, unsigned long long hash, GLuint program);
+	public:
+		static ProgramCache& instance();
+		/**
+			Returns a program made of these shaders (file names), compiled with the defines given. 0 if it could not be built.
+			Each successful call must be matched by one call to releaseProgram.
+		*/
+		GLuint acquireProgram(const std::string& vertexShader, const std::string& fragmentShader, const std::string& defines = "");
+		void releaseProgram(GLuint program);
+		/**
+			Same as glGetUniformLocation/glGetAttribLocation, but only asks OpenGL the first time.
+		*/
+		GLint getUniformLocation(GLuint program, const std::string& name);
+		GLint getAttribLocation(GLuint program, const std::string& name);
+		/**
+			Disabling the binary cache makes every new program compile from its sources (and never write binaries).
+		*/
+		inline void setBinaryCacheEnabled(bool enable) { binaryCacheEnabled = enable; }
+		Statistics getStatistics() const;
+		void resetStatistics();
+	};
+};
+#endif
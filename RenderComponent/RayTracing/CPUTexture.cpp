@@ -0,0 +1,50 @@
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\CPUTexture.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MappedFile.h>
+#include <cmath>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+bool CPUTexture::loadBMP(const std::string& file) {
+	width = height = 0;
+	texels.clear();
+	MappedFile bmp;
+	if (!bmp.open(file) || bmp.getSize() < 54)
+		return false;
+	const unsigned char* header = (const unsigned char*)bmp.getData();
+	if (header[0] != 'B' || header[1] != 'M')
+		return false;
+	unsigned int dataPos, w, h, bitsPerPixel;
+	memcpy(&dataPos, header + 0x0A, 4);
+	memcpy(&w, header + 0x12, 4);
+	memcpy(&h, header + 0x16, 4);
+	bitsPerPixel = header[0x1C] | (header[0x1D] << 8);
+	if (bitsPerPixel != 24 || w == 0 || h == 0)
+		return false;
+	if (dataPos == 0) dataPos = 54;
+	size_t rowBytes = (3 * w + 3) & ~3u;	//Rows are padded to 4 bytes
+	if (dataPos + rowBytes * h > bmp.getSize())
+		return false;
+	width = (int)w; height = (int)h;
+	texels.resize(w * h);
+	for (unsigned int y = 0; y < h; y++) {
+		const unsigned char* row = header + dataPos + y * rowBytes;
+		for (unsigned int x = 0; x < w; x++)	//BMP stores blue, green, red
+			texels[y * w + x] = glm::vec3(row[3 * x + 2], row[3 * x + 1], row[3 * x]) / 255.0f;
+	}
+	return true;
+}
+
+glm::vec3 CPUTexture::sample(glm::vec2 uv) const {
+	if (!isValid())
+		return glm::vec3(1);
+	float x = (uv.x - std::floor(uv.x)) * width - 0.5f;
+	float y = (uv.y - std::floor(uv.y)) * height - 0.5f;
+	int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+	float fx = x - x0, fy = y - y0;
+	int x1 = (x0 + 1) % width, y1 = (y0 + 1) % height;
+	x0 = (x0 + width) % width; y0 = (y0 + height) % height;
+	glm::vec3 bottom = glm::mix(texels[y0 * width + x0], texels[y0 * width + x1], fx);
+	glm::vec3 top = glm::mix(texels[y1 * width + x0], texels[y1 * width + x1], fx);
+	return glm::mix(bottom, top, fy);
+}
@@ -0,0 +1,29 @@
+/**********************************************************************
+NAME: CPUTexture
+DESCRIPTION: A texture in main memory, for renderers that do not use OpenGL (see RayTracer). 
+	It reads the same uncompressed 24 bit BMP files the OpenGL renderables load with loadBMP_custom, and samples them 
+	as OpenGL would with GL_REPEAT (v = 0 is the first row stored in the file, i.e. the bottom of the image).
+	Other formats (DDS, JPEG) need a decoder we do not have here: isValid() returns false for them.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_CPUTEXTURE
+#define _OPENGLFRAMEWORK_CPUTEXTURE
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+#include <string>
+
+namespace OpenGLFramework {
+	class CPUTexture {
+		int width, height;
+		std::vector<glm::vec3> texels;		//Rows from bottom to top, colours in [0,1]
+	public:
+		CPUTexture() : width(0), height(0) { ; }
+		bool loadBMP(const std::string& file);
+		inline bool isValid() const { return width > 0 && height > 0; }
+		/**
+			Bilinear sample at uv (wrapping around, as GL_REPEAT).
+		*/
+		glm::vec3 sample(glm::vec2 uv) const;
+	};
+};
+#endif
@@ -0,0 +1,324 @@
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\RayTracer.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\FrustumCuller.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\SceneNodes\IVirtualObject.h>
+#include <OpenGLFramework\SceneNodes\IScenenode.h>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+namespace {
+	const float AMBIENT_DIRECTIONAL = 0.1f;		//Ambient light for surfaces lit by a directional light
+
+	double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Tiles waiting to be rendered by one thread. Other threads can steal them, from the opposite end.
+	struct TileQueue {
+		std::mutex mutex;
+		std::deque<unsigned int> tiles;
+	};
+};
+
+RayTracer::RayTracer() : visitDepth(0), sceneTree(0.0f), numThreads(0), tileSize(32), shadows(true), backgroundColour(0) {
+	memset(&stats, 0, sizeof(stats));
+}
+
+bool RayTracer::visitVirtualObject(IVirtualObject* vo) {
+	if (visitDepth == 0) sceneObjects.clear();		//Visiting a single object
+	std::list<IComponent*> l = vo->getAllComponentsOfType("Renderable");
+	glm::mat4 M = vo->getFromObjectToWorldCoordinates();
+	for (std::list<IComponent*>::iterator it = l.begin(); it != l.end(); it++) {
+		OpenGL_Renderable* renderable = dynamic_cast<OpenGL_Renderable*>(*it);
+		if (renderable)
+			addRenderable(renderable, M);
+	}
+	return true;
+}
+
+bool RayTracer::addRenderable(OpenGL_Renderable* renderable, const glm::mat4& M) {
+	if (!renderable->isEnabled())
+		return false;
+	SceneObject object;
+	object.mesh = renderable->getMeshData();
+	if (!object.mesh || object.mesh->indices.empty() || !renderable->getSurfaceDescription(object.surface))
+		return false;		//Not loaded, or the renderable cannot describe itself without OpenGL
+	object.M = M;
+	sceneObjects.push_back(object);
+	return true;
+}
+
+bool RayTracer::visitSceneNode(ISceneNode* node) {
+	if (visitDepth == 0) sceneObjects.clear();		//A new visit to the scene starts
+	visitDepth++;
+	std::map<unsigned int, IVirtualObject*>& children = node->getAllChildren();
+	for (std::map<unsigned int, IVirtualObject*>::iterator it = children.begin(); it != children.end(); it++)
+		it->second->visit(*((ISceneVisitor*)this));
+	visitDepth--;
+	return true;
+}
+
+void RayTracer::clearCaches() {
+	bvhs.clear();
+	textures.clear();
+}
+
+void RayTracer::prepareScene() {
+	instances.clear();
+	sceneTree.clear();
+	std::map<const MeshData*, std::pair<std::shared_ptr<const MeshData>, std::shared_ptr<TriangleBVH> > > used;
+	for (size_t i = 0; i < sceneObjects.size(); i++) {
+		SceneObject& object = sceneObjects[i];
+		//1. BVH of the mesh (built the first time we see it)
+		const MeshData* mesh = object.mesh.get();
+		if (bvhs.find(mesh) == bvhs.end()) {
+			std::shared_ptr<TriangleBVH> bvh(new TriangleBVH());
+			bvh->build(*mesh);
+			bvhs[mesh] = std::make_pair(object.mesh, bvh);
+		}
+		if (used.find(mesh) == used.end()) {
+			used[mesh] = bvhs[mesh];
+			stats.triangles += mesh->indices.size() / 3;	//Once per mesh, however many instances show it
+		}
+		//2. Texture (only BMP files can be read without OpenGL)
+		const CPUTexture* texture = NULL;
+		if (object.surface.textureFile != "") {
+			std::string key = GPUAssetCache::canonicalPath(object.surface.textureFile);
+			if (textures.find(key) == textures.end()) {
+				std::shared_ptr<CPUTexture> loaded(new CPUTexture());
+				if (!loaded->loadBMP(object.surface.textureFile))
+					printf("RayTracer: cannot read texture %s without OpenGL (only 24 bit BMP). Using its material colour.\n", object.surface.textureFile.c_str());
+				textures[key] = loaded;
+			}
+			if (textures[key]->isValid())
+				texture = textures[key].get();
+		}
+		Instance instance;
+		instance.mesh = mesh;
+		instance.bvh = bvhs[mesh].second.get();
+		instance.texture = texture;
+		instance.surface = &object.surface;
+		instance.M = object.M;
+		instance.invM = glm::inverse(object.M);
+		instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.M)));
+		instances.push_back(instance);
+	}
+	//Meshes no longer in the scene are released
+	bvhs.swap(used);
+	stats.instances = (unsigned int)instances.size();
+	stats.meshes = (unsigned int)bvhs.size();
+	//3. World boxes of the objects (user data: index of the instance)
+	for (size_t i = 0; i < instances.size(); i++) {
+		glm::vec3 centre, extent;
+		FrustumCuller::transformBox(instances[i].mesh->bb, instances[i].M, centre, extent);
+		sceneTree.createProxy(AABB(centre - extent, centre + extent), (void*)i);
+	}
+}
+
+bool RayTracer::occluded(const glm::vec3& origin, const glm::vec3& dir, float maxT) const {
+	bool blocked = false;
+	sceneTree.rayCast(origin, dir, maxT, [&](int proxy, float currentMaxT) -> float {
+		const Instance& instance = instances[(size_t)sceneTree.getUserData(proxy)];
+		glm::vec3 localOrigin(instance.invM * glm::vec4(origin, 1)), localDir(instance.invM * glm::vec4(dir, 0));
+		if (instance.bvh->occluded(localOrigin, localDir, currentMaxT)) {
+			blocked = true;
+			return 0;		//Stop
+		}
+		return currentMaxT;
+	});
+	return blocked;
+}
+
+glm::vec3 RayTracer::trace(const glm::vec3& origin, const glm::vec3& dir, ThreadCounters& counters) const {
+	const Instance* closest = NULL;
+	TriangleBVH::Hit closestHit;
+	//Objects are visited closest first; each hit shortens the ray, so objects behind it are skipped
+	sceneTree.rayCast(origin, dir, FLT_MAX, [&](int proxy, float maxT) -> float {
+		const Instance& instance = instances[(size_t)sceneTree.getUserData(proxy)];
+		//The ray in local coordinates. The direction is not normalized, so t means the same in both spaces
+		glm::vec3 localOrigin(instance.invM * glm::vec4(origin, 1)), localDir(instance.invM * glm::vec4(dir, 0));
+		TriangleBVH::Hit hit;
+		if (!instance.bvh->intersect(localOrigin, localDir, maxT, hit))
+			return maxT;
+		closest = &instance;
+		closestHit = hit;
+		return hit.t;
+	});
+	if (!closest)
+		return backgroundColour;
+	return shade(*closest, closestHit, origin, dir, counters);
+}
+
+glm::vec3 RayTracer::shade(const Instance& instance, const TriangleBVH::Hit& hit, const glm::vec3& origin, const glm::vec3& dir, ThreadCounters& counters) const {
+	const MeshData& mesh = *instance.mesh;
+	const OpenGL_Renderable::SurfaceDescription& surface = *instance.surface;
+	unsigned int i0 = mesh.indices[3 * hit.triangle], i1 = mesh.indices[3 * hit.triangle + 1], i2 = mesh.indices[3 * hit.triangle + 2];
+	float w = 1 - hit.u - hit.v;
+	//1. Interpolate what the vertex shader would have given us: UVs and normal (in world space)
+	glm::vec2 uv(0, 0);
+	if (mesh.uvs.size() == mesh.vertices.size())
+		uv = mesh.uvs[i0] * w + mesh.uvs[i1] * hit.u + mesh.uvs[i2] * hit.v;
+	glm::vec3 textureColour = instance.texture ? instance.texture->sample(uv) : glm::vec3(1);
+	if (surface.lighting == OpenGL_Renderable::SurfaceDescription::UNLIT)
+		return surface.Kd * textureColour;
+	glm::vec3 normal;
+	if (mesh.normals.size() == mesh.vertices.size())
+		normal = mesh.normals[i0] * w + mesh.normals[i1] * hit.u + mesh.normals[i2] * hit.v;
+	else
+		normal = glm::cross(mesh.vertices[i1] - mesh.vertices[i0], mesh.vertices[i2] - mesh.vertices[i0]);
+	glm::vec3 n = glm::normalize(instance.normalMatrix * normal);
+	glm::vec3 position = origin + dir * hit.t;
+	//Shadow rays start slightly off the surface, so they do not hit it again
+	float epsilon = 1e-4f * (1.0f + std::max(std::fabs(position.x), std::max(std::fabs(position.y), std::fabs(position.z))));
+
+	//2. Light, as the fragment shaders compute it
+	if (surface.lighting == OpenGL_Renderable::SurfaceDescription::DIRECTIONAL_LIGHT) {
+		glm::vec3 l = glm::normalize(-surface.lightDirection);
+		float cosTheta = glm::clamp(glm::dot(n, l), 0.0f, 1.0f);
+		if (cosTheta > 0 && shadows) {
+			counters.shadowRays++;
+			if (occluded(position + n * epsilon, l, FLT_MAX)) cosTheta = 0;
+		}
+		return textureColour * (glm::vec3(AMBIENT_DIRECTIONAL) + surface.lightColor * cosTheta);
+	}
+	// Point light (PhongShadingOBJMesh_Renderable)
+	glm::vec3 diffuseColour = surface.Kd * textureColour;
+	glm::vec3 ambientColour = surface.Ka * diffuseColour;
+	glm::vec3 toLight = surface.lightPosition - position;
+	float distance = glm::length(toLight);
+	glm::vec3 l = toLight / distance;
+	float cosTheta = glm::clamp(glm::dot(n, l), 0.0f, 1.0f);
+	if (cosTheta > 0 && shadows) {
+		counters.shadowRays++;
+		if (occluded(position + n * epsilon, l, distance - epsilon)) 
+			return ambientColour;
+	}
+	glm::vec3 E = glm::normalize(-dir);
+	glm::vec3 R = glm::reflect(-l, n);
+	float cosAlpha = glm::clamp(glm::dot(E, R), 0.0f, 1.0f);
+	float attenuation = surface.lightPower / (distance*distance);
+	return ambientColour
+		+ diffuseColour * surface.lightColor * cosTheta * attenuation
+		+ surface.Ks * surface.lightColor * std::pow(cosAlpha, surface.shininess) * attenuation;
+}
+
+bool RayTracer::render(glm::mat4 P, glm::mat4 V, unsigned int width, unsigned int height, std::vector<unsigned char>& image) {
+	if (width == 0 || height == 0)
+		return false;
+	memset(&stats, 0, sizeof(stats));
+	stats.width = width; stats.height = height;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	prepareScene();
+	stats.prepareSeconds = secondsSince(start);
+	start = std::chrono::high_resolution_clock::now();
+	image.assign(3 * width * height, 0);
+	//Rays go from the near plane to the far plane, through the centre of each pixel
+	glm::mat4 invVP = glm::inverse(P * V);
+	unsigned int tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+	unsigned int numTiles = tilesX * tilesY;
+	unsigned int threads = numThreads ? numThreads : std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	threads = std::min(threads, numTiles);
+	//Each thread starts with a band of consecutive tiles (nearby pixels hit the same objects: better use of the caches)
+	std::vector<TileQueue> queues(threads);
+	for (unsigned int t = 0; t < numTiles; t++)
+		queues[(unsigned long long)t * threads / numTiles].tiles.push_back(t);
+	std::atomic<unsigned int> stolen(0);
+	std::vector<ThreadCounters> counters(threads);
+	auto worker = [&](unsigned int self) {
+		ThreadCounters& myCounters = counters[self];
+		myCounters.shadowRays = 0;
+		while (true) {
+			//1. Take a tile from our queue...
+			bool found = false;
+			unsigned int tile = 0;
+			{
+				std::lock_guard<std::mutex> lock(queues[self].mutex);
+				if (!queues[self].tiles.empty()) { tile = queues[self].tiles.front(); queues[self].tiles.pop_front(); found = true; }
+			}
+			// ... or steal one from the end of someone else's
+			for (unsigned int k = 1; k < threads && !found; k++) {
+				TileQueue& victim = queues[(self + k) % threads];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.tiles.empty()) { tile = victim.tiles.back(); victim.tiles.pop_back(); found = true; stolen++; }
+			}
+			if (!found)
+				return;		//No tiles left anywhere
+			//2. Render it
+			unsigned int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+			unsigned int x1 = std::min(width, x0 + tileSize), y1 = std::min(height, y0 + tileSize);
+			for (unsigned int y = y0; y < y1; y++) {
+				for (unsigned int x = x0; x < x1; x++) {
+					float ndcX = 2.0f * (x + 0.5f) / width - 1.0f, ndcY = 1.0f - 2.0f * (y + 0.5f) / height;
+					glm::vec4 nearPoint = invVP * glm::vec4(ndcX, ndcY, -1, 1), farPoint = invVP * glm::vec4(ndcX, ndcY, 1, 1);
+					glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+					glm::vec3 dir = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+					glm::vec3 colour = glm::clamp(trace(origin, dir, myCounters), 0.0f, 1.0f);
+					unsigned char* pixel = &image[3 * (y * width + x)];
+					pixel[0] = (unsigned char)(colour.x * 255.0f + 0.5f);
+					pixel[1] = (unsigned char)(colour.y * 255.0f + 0.5f);
+					pixel[2] = (unsigned char)(colour.z * 255.0f + 0.5f);
+				}
+			}
+		}
+	};
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < threads; t++)
+		workers.push_back(std::thread(worker, t));
+	worker(0);		//This thread does its share too
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	stats.renderSeconds = secondsSince(start);
+	stats.threads = threads;
+	stats.tiles = numTiles;
+	stats.tilesStolen = stolen.load();
+	stats.primaryRays = (double)width * height;
+	for (size_t t = 0; t < counters.size(); t++)
+		stats.shadowRays += counters[t].shadowRays;
+	stats.raysPerSecond = (stats.renderSeconds > 0) ? (stats.primaryRays + stats.shadowRays) / stats.renderSeconds : 0;
+	return true;
+}
+
+bool RayTracer::render(glm::mat4 P, glm::mat4 V, unsigned int width, unsigned int height, const std::string& bmpFile) {
+	std::vector<unsigned char> image;
+	return render(P, V, width, height, image) && writeBMP(bmpFile, width, height, image);
+}
+
+bool RayTracer::writeBMP(const std::string& file, unsigned int width, unsigned int height, const std::vector<unsigned char>& image) {
+	if (image.size() < 3 * (size_t)width * height)
+		return false;
+	FILE* f = fopen(file.c_str(), "wb");
+	if (!f)
+		return false;
+	unsigned int rowBytes = (3 * width + 3) & ~3u;		//Rows are padded to 4 bytes
+	unsigned int dataSize = rowBytes * height, fileSize = 54 + dataSize;
+	unsigned char header[54] = { 'B', 'M' };
+	memcpy(header + 2, &fileSize, 4);
+	header[10] = 54;							//Offset of the pixels
+	header[14] = 40;							//Size of the info header
+	memcpy(header + 18, &width, 4);
+	memcpy(header + 22, &height, 4);
+	header[26] = 1;								//Planes
+	header[28] = 24;							//Bits per pixel
+	memcpy(header + 34, &dataSize, 4);
+	bool ok = fwrite(header, 1, 54, f) == 54;
+	std::vector<unsigned char> row(rowBytes, 0);
+	for (unsigned int y = 0; y < height && ok; y++) {
+		const unsigned char* src = &image[3 * (size_t)(height - 1 - y) * width];	//BMP rows go from the bottom up...
+		for (unsigned int x = 0; x < width; x++) {		//... and pixels are stored as blue, green, red
+			row[3 * x] = src[3 * x + 2]; row[3 * x + 1] = src[3 * x + 1]; row[3 * x + 2] = src[3 * x];
+		}
+		ok = fwrite(&row[0], 1, rowBytes, f) == rowBytes;
+	}
+	fclose(f);
+	return ok;
+}
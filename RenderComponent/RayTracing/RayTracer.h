@@ -0,0 +1,121 @@
+/**********************************************************************
+NAME: RayTracer
+DESCRIPTION: Renders the scene on the CPU, by ray tracing, without OpenGL (e.g. on render farm machines with no GPU).
+	It is a visitor, like the RenderableVisitor: visiting a scene with it (scene->visit(rayTracer)) collects the 
+	renderables that can describe their geometry and surface (see OpenGL_Renderable::getMeshData and 
+	getSurfaceDescription), with their model matrices. render() then traces one ray per pixel and writes the image.
+	The renderables only need their first loading phase (loadResourcesToMainMemory), which does not use OpenGL.
+	How it works:
+		- Each mesh gets a TriangleBVH (built once, in local coordinates, and shared by all the objects using it).
+		Objects are kept in a DynamicAABBTree with their world boxes; a ray is transformed into the local coordinates 
+		of each object whose box it crosses, and tested against its BVH.
+		- Surfaces are shaded as their shaders do: Phong shading with a point light (PhongShadingOBJMesh_Renderable), 
+		a directional light (DirectionalLightOBJMesh_Renderable) or just the texture (TexturedOBJMesh_Renderable).
+		Shadow rays are cast towards each light (this is something OpenGL renderables do not do).
+		- The image is split in tiles (32x32 pixels). Each thread starts with a band of tiles and, when it finishes its own, 
+		steals tiles from the others (work stealing), so all cores keep busy even if some regions are more expensive.
+	Only 24 bit BMP textures can be read without OpenGL (see CPUTexture); surfaces with other textures use their Kd colour.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_RAYTRACER
+#define _OPENGLFRAMEWORK_RAYTRACER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\ISceneVisitor.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\TriangleBVH.h>
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\CPUTexture.h>
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\DynamicAABBTree.h>
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace OpenGLFramework {
+	class IVirtualObject;			//Forward declaration
+	class ISceneNode;				//Forward declaration
+
+	class RayTracer : public ISceneVisitor {
+	public:
+		struct Statistics {
+			unsigned int width, height;
+			unsigned int threads;
+			unsigned int tiles, tilesStolen;		//Tiles rendered by a thread that did not own them
+			unsigned int instances, meshes;			//Objects rendered, and different meshes among them
+			size_t triangles;						//Triangles in those meshes
+			double primaryRays, shadowRays;
+			double prepareSeconds;					//Building BVHs and loading textures (only new meshes/textures)
+			double renderSeconds;
+			double raysPerSecond;
+		};
+	private:
+		//Renderables found in the last visit
+		struct SceneObject {
+			std::shared_ptr<const MeshData> mesh;
+			OpenGL_Renderable::SurfaceDescription surface;
+			glm::mat4 M;
+		};
+		std::vector<SceneObject> sceneObjects;
+		int visitDepth;
+		//What render() uses
+		struct Instance {
+			const MeshData* mesh;
+			const TriangleBVH* bvh;
+			const CPUTexture* texture;			//NULL: no texture
+			const OpenGL_Renderable::SurfaceDescription* surface;
+			glm::mat4 M, invM;
+			glm::mat3 normalMatrix;				//Transforms normals to world space
+		};
+		std::vector<Instance> instances;
+		DynamicAABBTree sceneTree;				//World boxes of the instances (user data: index in instances)
+		//Kept between frames
+		std::map<const MeshData*, std::pair<std::shared_ptr<const MeshData>, std::shared_ptr<TriangleBVH> > > bvhs;
+		std::map<std::string, std::shared_ptr<CPUTexture> > textures;
+		//Settings
+		unsigned int numThreads;
+		unsigned int tileSize;
+		bool shadows;
+		glm::vec3 backgroundColour;
+		Statistics stats;
+
+		struct ThreadCounters { double shadowRays; };
+		void prepareScene();
+		glm::vec3 trace(const glm::vec3& origin, const glm::vec3& dir, ThreadCounters& counters) const;
+		bool occluded(const glm::vec3& origin, const glm::vec3& dir, float maxT) const;
+		glm::vec3 shade(const Instance& instance, const TriangleBVH::Hit& hit, const glm::vec3& origin, const glm::vec3& dir, ThreadCounters& counters) const;
+	public:
+		RayTracer();
+		/**
+			Number of threads (0 = one per core). Useful to measure how rendering scales with the number of cores.
+		*/
+		inline void setNumThreads(unsigned int threads) { numThreads = threads; }
+		inline void setTileSize(unsigned int pixels) { tileSize = pixels ? pixels : 1; }
+		inline void setShadows(bool enabled) { shadows = enabled; }
+		inline void setBackgroundColour(glm::vec3 colour) { backgroundColour = colour; }
+		/**
+			Builds the scene without visiting one (e.g. objects that are not in a scene graph, or the benchmarks): 
+			clearScene() and then add each renderable with its model matrix. Returns false if the renderable is disabled 
+			or cannot be ray traced (see OpenGL_Renderable::getMeshData).
+		*/
+		inline void clearScene() { sceneObjects.clear(); }
+		bool addRenderable(OpenGL_Renderable* renderable, const glm::mat4& M);
+		/**
+			Renders the scene visited (or built) last, seen from a camera with projection P and view V, into image 
+			(width*height RGB pixels, from the top row down). 
+		*/
+		bool render(glm::mat4 P, glm::mat4 V, unsigned int width, unsigned int height, std::vector<unsigned char>& image);
+		/**
+			Same, writing the image to a (24 bit) BMP file.
+		*/
+		bool render(glm::mat4 P, glm::mat4 V, unsigned int width, unsigned int height, const std::string& bmpFile);
+		static bool writeBMP(const std::string& file, unsigned int width, unsigned int height, const std::vector<unsigned char>& image);
+		/**
+			Forget the meshes and textures kept from previous frames.
+		*/
+		void clearCaches();
+		inline const Statistics& getStatistics() const { return stats; }
+
+		//ISceneVisitor interface. A visit that does not start inside another one replaces the scene we had.
+		virtual bool visitVirtualObject(IVirtualObject* vo);
+		virtual bool visitSceneNode(ISceneNode* vo);
+	};
+};
+#endif
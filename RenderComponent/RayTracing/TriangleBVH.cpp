@@ -0,0 +1,320 @@
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\TriangleBVH.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define TRIANGLEBVH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define TRIANGLEBVH_SSE
+#endif
+
+using namespace OpenGLFramework;
+
+namespace {
+	inline float surfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		glm::vec3 d = boxMax - boxMin;
+		return (d.x < 0) ? 0 : 2.0f * (d.x*d.y + d.y*d.z + d.z*d.x);
+	}
+
+	//Slab test. Returns the distance at which the ray enters the box, or FLT_MAX if it misses it (or enters after maxT)
+	inline float intersectBox(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& origin, const glm::vec3& invDir, float maxT) {
+		glm::vec3 t0 = (boxMin - origin) * invDir, t1 = (boxMax - origin) * invDir;
+		glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+		return (enter <= exit) ? enter : FLT_MAX;
+	}
+
+	/*
+		Moller-Trumbore ray/triangle intersection, for all the triangles of a packet at once. Lanes wraps the SIMD 
+		register we use (8 floats with AVX, 4 with SSE, or a plain loop if we have neither).
+		Returns a bit mask with the triangles hit with t in (0, maxT), and their t, u, v.
+	*/
+#if defined(TRIANGLEBVH_AVX)
+	typedef __m256 Lanes;
+	inline Lanes set1(float f) { return _mm256_set1_ps(f); }
+	inline Lanes load(const float* p) { return _mm256_loadu_ps(p); }
+	inline void store(float* p, Lanes a) { _mm256_storeu_ps(p, a); }
+	inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+	inline Lanes sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+	inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+	inline Lanes div(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+	inline Lanes both(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+	inline Lanes less(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline Lanes lessEqual(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline Lanes absolute(Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	inline int toMask(Lanes a) { return _mm256_movemask_ps(a); }
+#elif defined(TRIANGLEBVH_SSE)
+	typedef __m128 Lanes;
+	inline Lanes set1(float f) { return _mm_set1_ps(f); }
+	inline Lanes load(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+	inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+	inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+	inline Lanes both(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+	inline Lanes less(Lanes a, Lanes b) { return _mm_cmplt_ps(a, b); }
+	inline Lanes lessEqual(Lanes a, Lanes b) { return _mm_cmple_ps(a, b); }
+	inline Lanes absolute(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	inline int toMask(Lanes a) { return _mm_movemask_ps(a); }
+#endif
+
+#if defined(TRIANGLEBVH_AVX) || defined(TRIANGLEBVH_SSE)
+	//The ray, copied to all the lanes (once per ray)
+	struct PacketRay {
+		Lanes origin[3], dir[3];
+		PacketRay(const glm::vec3& o, const glm::vec3& d) {
+			for (int c = 0; c < 3; c++) { origin[c] = set1(o[c]); dir[c] = set1(d[c]); }
+		}
+	};
+
+	template <class Packet> inline int intersectPacket(const Packet& packet, const PacketRay& ray, float maxT, float* t, float* u, float* v) {
+		Lanes e1[3] = { load(packet.edge1[0]), load(packet.edge1[1]), load(packet.edge1[2]) };
+		Lanes e2[3] = { load(packet.edge2[0]), load(packet.edge2[1]), load(packet.edge2[2]) };
+		//p = cross(dir, edge2)
+		Lanes p[3] = { sub(mul(ray.dir[1], e2[2]), mul(ray.dir[2], e2[1]))
+					 , sub(mul(ray.dir[2], e2[0]), mul(ray.dir[0], e2[2]))
+					 , sub(mul(ray.dir[0], e2[1]), mul(ray.dir[1], e2[0])) };
+		Lanes det = add(add(mul(e1[0], p[0]), mul(e1[1], p[1])), mul(e1[2], p[2]));
+		Lanes invDet = div(set1(1.0f), det);
+		//s = origin - v0
+		Lanes s[3] = { sub(ray.origin[0], load(packet.v0[0])), sub(ray.origin[1], load(packet.v0[1])), sub(ray.origin[2], load(packet.v0[2])) };
+		Lanes U = mul(add(add(mul(s[0], p[0]), mul(s[1], p[1])), mul(s[2], p[2])), invDet);
+		//q = cross(s, edge1)
+		Lanes q[3] = { sub(mul(s[1], e1[2]), mul(s[2], e1[1]))
+					 , sub(mul(s[2], e1[0]), mul(s[0], e1[2]))
+					 , sub(mul(s[0], e1[1]), mul(s[1], e1[0])) };
+		Lanes V = mul(add(add(mul(ray.dir[0], q[0]), mul(ray.dir[1], q[1])), mul(ray.dir[2], q[2])), invDet);
+		Lanes T = mul(add(add(mul(e2[0], q[0]), mul(e2[1], q[1])), mul(e2[2], q[2])), invDet);
+		//Not parallel to the triangle (padding triangles have no area, so they are never hit), inside it, and within (0, maxT)
+		Lanes zero = set1(0.0f);
+		Lanes hit = both(less(set1(1e-12f), absolute(det)), both(lessEqual(zero, U), lessEqual(zero, V)));
+		hit = both(hit, both(lessEqual(add(U, V), set1(1.0f)), both(less(zero, T), less(T, set1(maxT)))));
+		int mask = toMask(hit);
+		if (mask) { store(t, T); store(u, U); store(v, V); }
+		return mask;
+	}
+#else
+	struct PacketRay {
+		glm::vec3 origin, dir;
+		PacketRay(const glm::vec3& o, const glm::vec3& d) : origin(o), dir(d) { ; }
+	};
+
+	template <class Packet> inline int intersectPacket(const Packet& packet, const PacketRay& ray, float maxT, float* t, float* u, float* v) {
+		int mask = 0;
+		for (unsigned int i = 0; i < TRIANGLEBVH_PACKET_WIDTH; i++) {
+			glm::vec3 edge1(packet.edge1[0][i], packet.edge1[1][i], packet.edge1[2][i]);
+			glm::vec3 edge2(packet.edge2[0][i], packet.edge2[1][i], packet.edge2[2][i]);
+			glm::vec3 p = glm::cross(ray.dir, edge2);
+			float det = glm::dot(edge1, p);
+			if (std::fabs(det) < 1e-12f) continue;		//Parallel to the triangle (or a padding triangle)
+			float invDet = 1.0f / det;
+			glm::vec3 s = ray.origin - glm::vec3(packet.v0[0][i], packet.v0[1][i], packet.v0[2][i]);
+			u[i] = glm::dot(s, p) * invDet;
+			if (u[i] < 0 || u[i] > 1) continue;
+			glm::vec3 q = glm::cross(s, edge1);
+			v[i] = glm::dot(ray.dir, q) * invDet;
+			if (v[i] < 0 || u[i] + v[i] > 1) continue;
+			t[i] = glm::dot(edge2, q) * invDet;
+			if (t[i] > 0 && t[i] < maxT)
+				mask |= 1 << i;
+		}
+		return mask;
+	}
+#endif
+};
+
+void TriangleBVH::build(const MeshData& mesh) {
+	nodes.clear();
+	packets.clear();
+	numTriangles = mesh.indices.size() / 3;
+	if (numTriangles == 0)
+		return;
+	//Boxes and centroids of the triangles
+	std::vector<glm::vec3> boxMin(numTriangles), boxMax(numTriangles), centroid(numTriangles);
+	std::vector<unsigned int> order(numTriangles);
+	for (size_t i = 0; i < numTriangles; i++) {
+		const glm::vec3& a = mesh.vertices[mesh.indices[3 * i]];
+		const glm::vec3& b = mesh.vertices[mesh.indices[3 * i + 1]];
+		const glm::vec3& c = mesh.vertices[mesh.indices[3 * i + 2]];
+		boxMin[i] = glm::min(a, glm::min(b, c));
+		boxMax[i] = glm::max(a, glm::max(b, c));
+		centroid[i] = (a + b + c) / 3.0f;
+		order[i] = (unsigned int)i;
+	}
+	//Top-down build. Each pending node covers order[first, first+count)
+	nodes.reserve(2 * numTriangles);
+	Node root = { glm::vec3(0), glm::vec3(0), 0, (unsigned int)numTriangles };
+	nodes.push_back(root);
+	std::vector<std::pair<unsigned int, unsigned int> > pending(1, std::make_pair(0u, 0u));	//Node, depth
+	while (!pending.empty()) {
+		unsigned int nodeIndex = pending.back().first, depth = pending.back().second;
+		pending.pop_back();
+		unsigned int first = nodes[nodeIndex].first, count = nodes[nodeIndex].count;
+		//1. Box of the triangles, and box of their centroids (we split along the centroids)
+		glm::vec3 nodeMin(FLT_MAX), nodeMax(-FLT_MAX), centreMin(FLT_MAX), centreMax(-FLT_MAX);
+		for (unsigned int i = first; i < first + count; i++) {
+			nodeMin = glm::min(nodeMin, boxMin[order[i]]); nodeMax = glm::max(nodeMax, boxMax[order[i]]);
+			centreMin = glm::min(centreMin, centroid[order[i]]); centreMax = glm::max(centreMax, centroid[order[i]]);
+		}
+		nodes[nodeIndex].boxMin = nodeMin;
+		nodes[nodeIndex].boxMax = nodeMax;
+		if (count <= MAX_LEAF_TRIANGLES || depth >= MAX_DEPTH)	//The traversal stacks have room for MAX_DEPTH levels
+			continue;
+		int axis = 0;
+		glm::vec3 extent = centreMax - centreMin;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+		if (extent[axis] <= 0)		//All centroids in the same place: we cannot split them
+			continue;
+		//2. Put the triangles in bins along the axis...
+		struct Bin { glm::vec3 boxMin, boxMax; unsigned int count; };
+		Bin bins[NUM_BINS];
+		for (unsigned int b = 0; b < NUM_BINS; b++) { bins[b].boxMin = glm::vec3(FLT_MAX); bins[b].boxMax = glm::vec3(-FLT_MAX); bins[b].count = 0; }
+		float scale = NUM_BINS / extent[axis];
+		for (unsigned int i = first; i < first + count; i++) {
+			unsigned int t = order[i];
+			unsigned int b = std::min(NUM_BINS - 1, (unsigned int)((centroid[t][axis] - centreMin[axis]) * scale));
+			bins[b].count++;
+			bins[b].boxMin = glm::min(bins[b].boxMin, boxMin[t]); bins[b].boxMax = glm::max(bins[b].boxMax, boxMax[t]);
+		}
+		//3. ... and evaluate the SAH cost of splitting after each bin: sum over both sides of (area * triangles)
+		float leftCost[NUM_BINS - 1];
+		glm::vec3 accMin(FLT_MAX), accMax(-FLT_MAX);
+		unsigned int accCount = 0;
+		for (unsigned int b = 0; b < NUM_BINS - 1; b++) {
+			accMin = glm::min(accMin, bins[b].boxMin); accMax = glm::max(accMax, bins[b].boxMax); accCount += bins[b].count;
+			leftCost[b] = surfaceArea(accMin, accMax) * accCount;
+		}
+		accMin = glm::vec3(FLT_MAX); accMax = glm::vec3(-FLT_MAX); accCount = 0;
+		float bestCost = FLT_MAX; unsigned int bestSplit = 0;
+		for (unsigned int b = NUM_BINS - 1; b > 0; b--) {
+			accMin = glm::min(accMin, bins[b].boxMin); accMax = glm::max(accMax, bins[b].boxMax); accCount += bins[b].count;
+			float cost = leftCost[b - 1] + surfaceArea(accMin, accMax) * accCount;
+			if (cost < bestCost) { bestCost = cost; bestSplit = b; }
+		}
+		//Not splitting costs testing all the triangles. Keep a leaf if the split is not cheaper
+		if (bestCost >= surfaceArea(nodeMin, nodeMax) * count && count <= 4 * MAX_LEAF_TRIANGLES)
+			continue;
+		//4. Partition the triangles: bins before bestSplit go to the left child
+		unsigned int* middle = std::partition(&order[first], &order[first] + count, [&](unsigned int t) {
+			return std::min(NUM_BINS - 1, (unsigned int)((centroid[t][axis] - centreMin[axis]) * scale)) < bestSplit;
+		});
+		unsigned int leftCount = (unsigned int)(middle - &order[first]);
+		if (leftCount == 0 || leftCount == count)
+			continue;
+		unsigned int leftIndex = (unsigned int)nodes.size();
+		Node left = { glm::vec3(0), glm::vec3(0), first, leftCount };
+		Node right = { glm::vec3(0), glm::vec3(0), first + leftCount, count - leftCount };
+		nodes.push_back(left);
+		nodes.push_back(right);
+		nodes[nodeIndex].first = leftIndex;
+		nodes[nodeIndex].count = 0;
+		pending.push_back(std::make_pair(leftIndex, depth + 1));
+		pending.push_back(std::make_pair(leftIndex + 1, depth + 1));
+	}
+	//Copy the triangles in the order the leaves use them, in packets. Leaves now point to their packets.
+	packets.reserve(numTriangles / PACKET_WIDTH + nodes.size() / 2 + 1);
+	for (size_t n = 0; n < nodes.size(); n++) {
+		Node& node = nodes[n];
+		if (node.count == 0)
+			continue;
+		unsigned int firstPacket = (unsigned int)packets.size();
+		for (unsigned int i = 0; i < node.count; i += PACKET_WIDTH) {
+			TrianglePacket packet;
+			memset(&packet, 0, sizeof(packet));		//Unused lanes are triangles with no area
+			for (unsigned int lane = 0; lane < PACKET_WIDTH && i + lane < node.count; lane++) {
+				unsigned int t = order[node.first + i + lane];
+				const glm::vec3& a = mesh.vertices[mesh.indices[3 * t]];
+				glm::vec3 edge1 = mesh.vertices[mesh.indices[3 * t + 1]] - a;
+				glm::vec3 edge2 = mesh.vertices[mesh.indices[3 * t + 2]] - a;
+				for (int c = 0; c < 3; c++) {
+					packet.v0[c][lane] = a[c];
+					packet.edge1[c][lane] = edge1[c];
+					packet.edge2[c][lane] = edge2[c];
+				}
+				packet.index[lane] = t;
+			}
+			packets.push_back(packet);
+		}
+		node.first = firstPacket;
+		node.count = (unsigned int)packets.size() - firstPacket;
+	}
+}
+
+bool TriangleBVH::intersect(const glm::vec3& origin, const glm::vec3& dir, float maxT, Hit& hit) const {
+	if (nodes.empty()) return false;
+	glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	PacketRay ray(origin, dir);
+	float t[PACKET_WIDTH], u[PACKET_WIDTH], v[PACKET_WIDTH];
+	bool found = false;
+	unsigned int stack[MAX_DEPTH + 2]; int top = 0;
+	if (intersectBox(nodes[0].boxMin, nodes[0].boxMax, origin, invDir, maxT) == FLT_MAX) return false;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& n = nodes[stack[--top]];
+		if (n.count > 0) {
+			for (unsigned int i = n.first; i < n.first + n.count; i++) {
+				int mask = intersectPacket(packets[i], ray, maxT, t, u, v);
+				for (unsigned int lane = 0; mask; lane++, mask >>= 1) {
+					if (!(mask & 1) || t[lane] >= maxT)
+						continue;
+					maxT = t[lane];		//From now on, only closer triangles matter
+					hit.t = t[lane]; hit.u = u[lane]; hit.v = v[lane]; hit.triangle = packets[i].index[lane];
+					found = true;
+				}
+			}
+			continue;
+		}
+		//Visit the closest child first (push it last). Children farther than the closest hit so far are skipped.
+		float t1 = intersectBox(nodes[n.first].boxMin, nodes[n.first].boxMax, origin, invDir, maxT);
+		float t2 = intersectBox(nodes[n.first + 1].boxMin, nodes[n.first + 1].boxMax, origin, invDir, maxT);
+		if (t1 <= t2) {
+			if (t2 != FLT_MAX) stack[top++] = n.first + 1;
+			if (t1 != FLT_MAX) stack[top++] = n.first;
+		}
+		else {
+			if (t1 != FLT_MAX) stack[top++] = n.first;
+			stack[top++] = n.first + 1;
+		}
+	}
+	return found;
+}
+
+bool TriangleBVH::occluded(const glm::vec3& origin, const glm::vec3& dir, float maxT) const {
+	if (nodes.empty()) return false;
+	glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	PacketRay ray(origin, dir);
+	float t[PACKET_WIDTH], u[PACKET_WIDTH], v[PACKET_WIDTH];
+	unsigned int stack[MAX_DEPTH + 2]; int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& n = nodes[stack[--top]];
+		if (intersectBox(n.boxMin, n.boxMax, origin, invDir, maxT) == FLT_MAX)
+			continue;
+		if (n.count > 0) {
+			for (unsigned int i = n.first; i < n.first + n.count; i++)
+				if (intersectPacket(packets[i], ray, maxT, t, u, v))
+					return true;		//Any hit will do
+			continue;
+		}
+		stack[top++] = n.first + 1;
+		stack[top++] = n.first;
+	}
+	return false;
+}
+
+const char* TriangleBVH::getInstructionSet() {
+#if defined(TRIANGLEBVH_AVX)
+	return "AVX";
+#elif defined(TRIANGLEBVH_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
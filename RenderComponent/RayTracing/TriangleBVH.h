@@ -0,0 +1,81 @@
+/**********************************************************************
+NAME: TriangleBVH
+DESCRIPTION: Bounding volume hierarchy over the triangles of a mesh, used by the RayTracer and the MeshPicker to find 
+	which triangle a ray hits without testing all of them. Each node has the box of its triangles; a ray that misses the box skips 
+	them all. The tree is built once per mesh (meshes shared by several objects share their tree), in local coordinates.
+	It is built top-down: each node is split where the Surface Area Heuristic (SAH) estimates the cheapest traversal 
+	(triangles are put in a few bins along the longest axis, and we try the boundaries between bins). 
+	Nodes are stored in one array (the two children of a node are next to each other), and the triangles are 
+	copied in the order the leaves use them, so the traversal reads memory mostly sequentially.
+	The triangles of a leaf are stored in packets of 4 (SSE) or 8 (AVX, if the compiler is allowed to use it), 
+	with each coordinate of the packet next to each other (x of 4 triangles, then y...), so one ray is tested against 
+	all the triangles of a packet at once (Moller-Trumbore, in SIMD). Packets are padded with empty triangles.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_TRIANGLEBVH
+#define _OPENGLFRAMEWORK_TRIANGLEBVH
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshLoading\MeshData.h>
+#include <vector>
+
+#if defined(__AVX__)
+	#define TRIANGLEBVH_PACKET_WIDTH 8
+#else
+	#define TRIANGLEBVH_PACKET_WIDTH 4
+#endif
+
+namespace OpenGLFramework {
+	class TriangleBVH {
+	public:
+		struct Hit {
+			float t;					//Distance along the ray (in units of the ray direction)
+			float u, v;					//Barycentric coordinates (of the second and third vertex)
+			unsigned int triangle;		//Index of the triangle in the mesh (indices[3*triangle...])
+		};
+	private:
+		struct Node {
+			glm::vec3 boxMin, boxMax;
+			unsigned int first;			//Leaves: first packet (in packets). Inner nodes: index of the first child
+			unsigned int count;			//Leaves: number of packets. Inner nodes: 0
+		};
+		static const unsigned int PACKET_WIDTH = TRIANGLEBVH_PACKET_WIDTH;
+		struct TrianglePacket {
+			float v0[3][PACKET_WIDTH];		//Precomputed for the Moller-Trumbore intersection: [coordinate][triangle]
+			float edge1[3][PACKET_WIDTH];
+			float edge2[3][PACKET_WIDTH];
+			unsigned int index[PACKET_WIDTH];	//Triangle in the mesh
+		};
+		std::vector<Node> nodes;
+		std::vector<TrianglePacket> packets;
+		size_t numTriangles;
+		static const unsigned int MAX_LEAF_TRIANGLES = PACKET_WIDTH;
+		static const unsigned int NUM_BINS = 12;
+		static const unsigned int MAX_DEPTH = 62;
+	public:
+		TriangleBVH() : numTriangles(0) { ; }
+		/**
+			Builds the tree for the triangles of the mesh (its indices).
+		*/
+		void build(const MeshData& mesh);
+		/**
+			Closest triangle hit by origin + t*dir, with t in (0, maxT). Returns false if none.
+		*/
+		bool intersect(const glm::vec3& origin, const glm::vec3& dir, float maxT, Hit& hit) const;
+		/**
+			True if any triangle is hit with t in (0, maxT) (e.g. shadow rays: we do not care which one).
+		*/
+		bool occluded(const glm::vec3& origin, const glm::vec3& dir, float maxT) const;
+		inline size_t getNodeCount() const { return nodes.size(); }
+		inline size_t getTriangleCount() const { return numTriangles; }
+		inline size_t getPacketCount() const { return packets.size(); }
+		/**
+			Memory used by the nodes and packets
+		*/
+		inline size_t getSizeInBytes() const { return nodes.size() * sizeof(Node) + packets.size() * sizeof(TrianglePacket); }
+		/**
+			Instruction set the triangle tests were compiled with ("AVX", "SSE" or "scalar").
+		*/
+		static const char* getInstructionSet();
+	};
+};
+#endif
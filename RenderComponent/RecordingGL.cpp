@@ -0,0 +1,420 @@
+#define OPENGLFRAMEWORK_RECORDING_GL_IMPLEMENTATION	//This file calls the real OpenGL functions
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//We use this value to say "we do not know what is bound" (no OpenGL object has this name)
+	const GLuint UNKNOWN_STATE = (GLuint)-1;
+	const char* NO_RENDERABLE = "(none)";
+
+	GLuint& boundSlot(std::map<GLuint, GLuint>& bound, GLuint key) {
+		std::map<GLuint, GLuint>::iterator it = bound.find(key);
+		if (it == bound.end())
+			it = bound.insert(std::make_pair(key, UNKNOWN_STATE)).first;
+		return it->second;
+	}
+};
+
+void RecordingGL::Counters::add(const Counters& other) {
+	drawCalls += other.drawCalls; instancedDrawCalls += other.instancedDrawCalls;
+	instances += other.instances; vertices += other.vertices;
+	programBinds += other.programBinds; vertexArrayBinds += other.vertexArrayBinds;
+	bufferBinds += other.bufferBinds; textureBinds += other.textureBinds;
+	redundantBinds += other.redundantBinds; otherStateChanges += other.otherStateChanges;
+	uniformUpdates += other.uniformUpdates;
+	uploads += other.uploads; bytesUploaded += other.bytesUploaded;
+}
+
+RecordingGL::RecordingGL() : mode(FORWARD), inFrame(false), nextName(1) {
+	current.frame = lastFrame.frame = 0;
+	reset();
+}
+
+RecordingGL& RecordingGL::instance() {
+	static RecordingGL _instance;
+	return _instance;
+}
+
+void RecordingGL::reset() {
+	currentProgram = currentVertexArray = activeTextureUnit = UNKNOWN_STATE;
+	boundBuffers.clear();
+	boundTextures.clear();
+	current.submitSeconds = lastFrame.submitSeconds = 0;
+	memset(&current.total, 0, sizeof(Counters));
+	memset(&lastFrame.total, 0, sizeof(Counters));
+	current.byRenderableType.clear();
+	lastFrame.byRenderableType.clear();
+	setCurrentRenderableType(NULL);
+}
+
+void RecordingGL::beginFrame() {
+	current.byRenderableType.clear();
+	setCurrentRenderableType(NULL);
+	inFrame = true;
+	frameStart = std::chrono::high_resolution_clock::now();
+}
+
+void RecordingGL::endFrame() {
+	if (!inFrame)
+		return;
+	inFrame = false;
+	current.submitSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - frameStart).count();
+	memset(&current.total, 0, sizeof(Counters));
+	for (std::map<std::string, Counters>::iterator it = current.byRenderableType.begin(); it != current.byRenderableType.end(); it++)
+		current.total.add(it->second);
+	current.frame++;
+	lastFrame = current;
+}
+
+void RecordingGL::setCurrentRenderableType(const char* type) {
+	std::string name(type ? type : NO_RENDERABLE);
+	std::map<std::string, Counters>::iterator it = current.byRenderableType.find(name);
+	if (it == current.byRenderableType.end()) {
+		Counters empty;
+		memset(&empty, 0, sizeof(empty));
+		it = current.byRenderableType.insert(std::make_pair(name, empty)).first;
+	}
+	counters = &(it->second);
+}
+
+GLuint RecordingGL::createHeadlessTexture() {
+	return nextName++;
+}
+
+void RecordingGL::countBind(GLuint& current, GLuint value, unsigned int& binds) {
+	binds++;
+	if (current == value)
+		count().redundantBinds++;
+	current = value;
+}
+
+void RecordingGL::countDraw(GLsizei vertices, GLsizei instances, bool instanced) {
+	Counters& c = count();
+	c.drawCalls++;
+	if (instanced) c.instancedDrawCalls++;
+	c.instances += instances;
+	c.vertices += (unsigned long long)vertices * instances;
+}
+
+void RecordingGL::countUpload(GLsizeiptr bytes) {
+	count().uploads++;
+	count().bytesUploaded += bytes;
+}
+
+//1. State
+void RecordingGL::UseProgram(GLuint program) {
+	countBind(r().currentProgram, program, count().programBinds);
+	if (!headless()) glUseProgram(program);
+}
+
+void RecordingGL::BindBuffer(GLenum target, GLuint buffer) {
+	countBind(boundSlot(r().boundBuffers, target), buffer, count().bufferBinds);
+	if (!headless()) glBindBuffer(target, buffer);
+}
+
+//Binding a buffer to an indexed target (e.g. a uniform block) also binds it to the target itself
+void RecordingGL::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	count().bufferBinds++;
+	boundSlot(r().boundBuffers, target) = buffer;
+	if (!headless()) glBindBufferBase(target, index, buffer);
+}
+
+void RecordingGL::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	count().bufferBinds++;
+	boundSlot(r().boundBuffers, target) = buffer;
+	if (!headless()) glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void RecordingGL::BindVertexArray(GLuint vertexArray) {
+	countBind(r().currentVertexArray, vertexArray, count().vertexArrayBinds);
+	r().boundBuffers.erase(GL_ELEMENT_ARRAY_BUFFER);	//Each VAO has its own element buffer
+	if (!headless()) glBindVertexArray(vertexArray);
+}
+
+void RecordingGL::BindTexture(GLenum target, GLuint texture) {
+	countBind(boundSlot(r().boundTextures, r().activeTextureUnit), texture, count().textureBinds);
+	if (!headless()) glBindTexture(target, texture);
+}
+
+void RecordingGL::ActiveTexture(GLenum unit) {
+	count().otherStateChanges++;
+	r().activeTextureUnit = unit;
+	if (!headless()) glActiveTexture(unit);
+}
+
+void RecordingGL::Enable(GLenum capability) {
+	count().otherStateChanges++;
+	if (!headless()) glEnable(capability);
+}
+
+void RecordingGL::Disable(GLenum capability) {
+	count().otherStateChanges++;
+	if (!headless()) glDisable(capability);
+}
+
+void RecordingGL::PointSize(GLfloat size) {
+	count().otherStateChanges++;
+	if (!headless()) glPointSize(size);
+}
+
+void RecordingGL::EnableVertexAttribArray(GLuint index) {
+	count().otherStateChanges++;
+	if (!headless()) glEnableVertexAttribArray(index);
+}
+
+void RecordingGL::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+	count().otherStateChanges++;
+	if (!headless()) glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void RecordingGL::VertexAttribDivisor(GLuint index, GLuint divisor) {
+	count().otherStateChanges++;
+	if (!headless()) glVertexAttribDivisor(index, divisor);
+}
+
+//2. Uniforms
+void RecordingGL::UniformMatrix4fv(GLint location, GLsizei n, GLboolean transpose, const GLfloat* value) {
+	count().uniformUpdates++;
+	if (!headless()) glUniformMatrix4fv(location, n, transpose, value);
+}
+
+void RecordingGL::Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+	count().uniformUpdates++;
+	if (!headless()) glUniform3f(location, v0, v1, v2);
+}
+
+void RecordingGL::Uniform1i(GLint location, GLint v0) {
+	count().uniformUpdates++;
+	if (!headless()) glUniform1i(location, v0);
+}
+
+void RecordingGL::Uniform1f(GLint location, GLfloat v0) {
+	count().uniformUpdates++;
+	if (!headless()) glUniform1f(location, v0);
+}
+
+//3. Draw calls
+void RecordingGL::DrawArrays(GLenum mode, GLint first, GLsizei n) {
+	countDraw(n, 1, false);
+	if (!headless()) glDrawArrays(mode, first, n);
+}
+
+void RecordingGL::DrawElements(GLenum mode, GLsizei n, GLenum type, const void* indices) {
+	countDraw(n, 1, false);
+	if (!headless()) glDrawElements(mode, n, type, indices);
+}
+
+void RecordingGL::DrawArraysInstanced(GLenum mode, GLint first, GLsizei n, GLsizei instanceCount) {
+	countDraw(n, instanceCount, true);
+	if (!headless()) glDrawArraysInstanced(mode, first, n, instanceCount);
+}
+
+void RecordingGL::DrawElementsInstanced(GLenum mode, GLsizei n, GLenum type, const void* indices, GLsizei instanceCount) {
+	countDraw(n, instanceCount, true);
+	if (!headless()) glDrawElementsInstanced(mode, n, type, indices, instanceCount);
+}
+
+//4. Buffers and VAOs. In HEADLESS mode, buffers live in main memory
+void RecordingGL::GenBuffers(GLsizei n, GLuint* buffers) {
+	if (!headless()) { glGenBuffers(n, buffers); return; }
+	for (GLsizei i = 0; i < n; i++)
+		buffers[i] = r().nextName++;
+}
+
+void RecordingGL::DeleteBuffers(GLsizei n, const GLuint* buffers) {
+	for (GLsizei i = 0; i < n; i++) {
+		for (std::map<GLuint, GLuint>::iterator it = r().boundBuffers.begin(); it != r().boundBuffers.end(); it++)
+			if (it->second == buffers[i]) it->second = 0;		//Deleting a bound buffer unbinds it
+		r().bufferStorage.erase(buffers[i]);
+	}
+	if (!headless()) glDeleteBuffers(n, buffers);
+}
+
+void RecordingGL::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+	if (data) countUpload(size);
+	if (!headless()) { glBufferData(target, size, data, usage); return; }
+	std::vector<unsigned char>& storage = r().bufferStorage[boundSlot(r().boundBuffers, target)];
+	storage.assign((size_t)size, 0);
+	if (data && size > 0) memcpy(&storage[0], data, (size_t)size);
+}
+
+void RecordingGL::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+	countUpload(size);
+	if (!headless()) { glBufferSubData(target, offset, size, data); return; }
+	std::vector<unsigned char>& storage = r().bufferStorage[boundSlot(r().boundBuffers, target)];
+	if (size > 0 && (size_t)(offset + size) <= storage.size())
+		memcpy(&storage[(size_t)offset], data, (size_t)size);
+}
+
+void RecordingGL::BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) {
+	if (data) countUpload(size);
+	if (!headless()) { glBufferStorage(target, size, data, flags); return; }
+	std::vector<unsigned char>& storage = r().bufferStorage[boundSlot(r().boundBuffers, target)];
+	storage.assign((size_t)size, 0);
+	if (data && size > 0) memcpy(&storage[0], data, (size_t)size);
+}
+
+void* RecordingGL::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	if (access & GL_MAP_WRITE_BIT) countUpload(length);	//Persistently mapped buffers are only counted once (when they are mapped)
+	if (!headless()) return glMapBufferRange(target, offset, length, access);
+	std::vector<unsigned char>& storage = r().bufferStorage[boundSlot(r().boundBuffers, target)];
+	if (length <= 0 || (size_t)(offset + length) > storage.size())
+		return NULL;
+	return &storage[(size_t)offset];
+}
+
+GLboolean RecordingGL::UnmapBuffer(GLenum target) {
+	if (!headless()) return glUnmapBuffer(target);
+	return GL_TRUE;
+}
+
+void RecordingGL::CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) {
+	if (!headless()) { glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size); return; }
+	std::vector<unsigned char>& source = r().bufferStorage[boundSlot(r().boundBuffers, readTarget)];
+	std::vector<unsigned char>& destination = r().bufferStorage[boundSlot(r().boundBuffers, writeTarget)];
+	if (size > 0 && (size_t)(readOffset + size) <= source.size() && (size_t)(writeOffset + size) <= destination.size())
+		memmove(&destination[(size_t)writeOffset], &source[(size_t)readOffset], (size_t)size);
+}
+
+void RecordingGL::GenVertexArrays(GLsizei n, GLuint* arrays) {
+	if (!headless()) { glGenVertexArrays(n, arrays); return; }
+	for (GLsizei i = 0; i < n; i++)
+		arrays[i] = r().nextName++;
+}
+
+void RecordingGL::DeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+	for (GLsizei i = 0; i < n; i++)
+		if (r().currentVertexArray == arrays[i]) r().currentVertexArray = 0;
+	if (!headless()) glDeleteVertexArrays(n, arrays);
+}
+
+//5. Textures (loaded from files outside the framework, see GPUAssetCache; buffer textures, see ClusteredLighting)
+void RecordingGL::GenTextures(GLsizei n, GLuint* textures) {
+	if (!headless()) { glGenTextures(n, textures); return; }
+	for (GLsizei i = 0; i < n; i++)
+		textures[i] = r().nextName++;
+}
+
+void RecordingGL::DeleteTextures(GLsizei n, const GLuint* textures) {
+	if (!headless()) glDeleteTextures(n, textures);
+}
+
+void RecordingGL::TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) {
+	count().otherStateChanges++;
+	if (!headless()) glTexBuffer(target, internalFormat, buffer);
+}
+
+void RecordingGL::GetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params) {
+	if (!headless()) { glGetTexLevelParameteriv(target, level, pname, params); return; }
+	*params = 0;
+}
+
+//6. Synchronization: in HEADLESS mode, the "GPU" is always done
+GLsync RecordingGL::FenceSync(GLenum condition, GLbitfield flags) {
+	if (!headless()) return glFenceSync(condition, flags);
+	return (GLsync)(size_t)(r().nextName++);
+}
+
+GLenum RecordingGL::ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+	if (!headless()) return glClientWaitSync(sync, flags, timeout);
+	return GL_ALREADY_SIGNALED;
+}
+
+void RecordingGL::DeleteSync(GLsync sync) {
+	if (!headless()) glDeleteSync(sync);
+}
+
+//7. Shaders and programs: in HEADLESS mode they always compile and link
+GLuint RecordingGL::CreateShader(GLenum type) {
+	if (!headless()) return glCreateShader(type);
+	return r().nextName++;
+}
+
+void RecordingGL::ShaderSource(GLuint shader, GLsizei n, const GLchar* const* string, const GLint* length) {
+	if (!headless()) glShaderSource(shader, n, string, length);
+}
+
+void RecordingGL::CompileShader(GLuint shader) {
+	if (!headless()) glCompileShader(shader);
+}
+
+void RecordingGL::GetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+	if (!headless()) { glGetShaderiv(shader, pname, params); return; }
+	*params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+void RecordingGL::DeleteShader(GLuint shader) {
+	if (!headless()) glDeleteShader(shader);
+}
+
+GLuint RecordingGL::CreateProgram() {
+	if (!headless()) return glCreateProgram();
+	return r().nextName++;
+}
+
+void RecordingGL::AttachShader(GLuint program, GLuint shader) {
+	if (!headless()) glAttachShader(program, shader);
+}
+
+void RecordingGL::DetachShader(GLuint program, GLuint shader) {
+	if (!headless()) glDetachShader(program, shader);
+}
+
+void RecordingGL::ProgramParameteri(GLuint program, GLenum pname, GLint value) {
+	if (!headless()) glProgramParameteri(program, pname, value);
+}
+
+void RecordingGL::LinkProgram(GLuint program) {
+	if (!headless()) glLinkProgram(program);
+}
+
+void RecordingGL::GetProgramiv(GLuint program, GLenum pname, GLint* params) {
+	if (!headless()) { glGetProgramiv(program, pname, params); return; }
+	*params = (pname == GL_LINK_STATUS) ? GL_TRUE : 0;
+}
+
+void RecordingGL::DeleteProgram(GLuint program) {
+	if (r().currentProgram == program) r().currentProgram = 0;
+	if (!headless()) glDeleteProgram(program);
+}
+
+GLint RecordingGL::GetUniformLocation(GLuint program, const GLchar* name) {
+	if (!headless()) return glGetUniformLocation(program, name);
+	std::map<std::pair<GLuint, std::string>, GLint>::iterator it = r().locations.find(std::make_pair(program, std::string(name)));
+	if (it != r().locations.end()) return it->second;
+	return r().locations[std::make_pair(program, std::string(name))] = r().numLocations[program]++;
+}
+
+GLint RecordingGL::GetAttribLocation(GLuint program, const GLchar* name) {
+	if (!headless()) return glGetAttribLocation(program, name);
+	return GetUniformLocation(program, name);	//Made-up locations work the same way
+}
+
+GLuint RecordingGL::GetUniformBlockIndex(GLuint program, const GLchar* name) {
+	if (!headless()) return glGetUniformBlockIndex(program, name);
+	return (GLuint)GetUniformLocation(program, name);
+}
+
+void RecordingGL::UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) {
+	if (!headless()) glUniformBlockBinding(program, blockIndex, binding);
+}
+
+//8. Queries: in HEADLESS mode there are no extensions, binary formats, etc.
+void RecordingGL::GetIntegerv(GLenum pname, GLint* data) {
+	if (!headless()) { glGetIntegerv(pname, data); return; }
+	*data = 0;
+}
+
+const GLubyte* RecordingGL::GetString(GLenum name) {
+	if (!headless()) return glGetString(name);
+	return (const GLubyte*)"RecordingGL";
+}
+
+const GLubyte* RecordingGL::GetStringi(GLenum name, GLuint index) {
+	if (!headless()) return glGetStringi(name, index);
+	return (const GLubyte*)"";
+}
+#endif
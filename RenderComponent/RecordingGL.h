@@ -0,0 +1,278 @@
+/**********************************************************************
+NAME: RecordingGL
+DESCRIPTION: Stand-in for the OpenGL functions used by the renderables, which records what they do each frame:
+	draw calls, state changes (and how many of them were redundant, binding what was already bound), uniforms set
+	and bytes uploaded to buffers, grouped by type of renderable (see OpenGL_Renderable::getRenderableTypeName).
+	It is only compiled in if OPENGLFRAMEWORK_RECORDING_GL is defined (e.g. /D or -D in the compiler options). Then,
+	this header replaces the gl... functions the framework calls with the ones in this class (as GLEW does with its
+	function pointers), so neither the renderables nor the RenderableVisitor need to change. Without the define,
+	renderables call OpenGL directly, and this costs nothing.
+	It works in two modes:
+		- FORWARD: every call is recorded and then passed on to OpenGL (to measure a real application).
+		- HEADLESS: nothing reaches OpenGL, so no context (nor GPU) is needed. Buffers, VAOs, shaders and programs get
+		made-up names, buffers are kept in main memory (so they can still be mapped), and queries return harmless
+		values (programs always link; no binary formats, extensions or persistent mapping).
+		This lets us build scenes on machines without a GPU and measure how long the CPU takes to submit a frame.
+		Textures loaded from files are not read in this mode (GPUAssetCache gives them made-up names).
+	The RenderableVisitor starts and ends a frame each time it renders a scene; getLastFrame() returns its counters.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_RECORDINGGL
+#define _OPENGLFRAMEWORK_RECORDINGGL
+#include "OpenGLFRameworkPrerequisites.h"
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+
+namespace OpenGLFramework {
+	class RecordingGL {
+	public:
+		enum Mode {
+			FORWARD,		//Record, and call OpenGL
+			HEADLESS		//Record only (no OpenGL context needed)
+		};
+		struct Counters {
+			unsigned int drawCalls, instancedDrawCalls;
+			unsigned long long instances;			//Copies drawn (1 per non instanced draw call)
+			unsigned long long vertices;			//Vertices (or indices) submitted, times their instances
+			unsigned int programBinds, vertexArrayBinds, bufferBinds, textureBinds;
+			unsigned int redundantBinds;			//Binds of what was already bound (included in the four above)
+			unsigned int otherStateChanges;			//glEnable/glDisable, active texture unit, attribute setup, point size...
+			unsigned int uniformUpdates;
+			unsigned int uploads;					//glBufferData/glBufferSubData calls, and buffers mapped for writing
+			unsigned long long bytesUploaded;
+			void add(const Counters& other);
+		};
+		struct FrameStatistics {
+			unsigned int frame;						//Frames recorded so far
+			double submitSeconds;					//CPU time between beginFrame and endFrame
+			Counters total;
+			std::map<std::string, Counters> byRenderableType;	//Calls made outside renderables are under "(none)"
+		};
+	private:
+		Mode mode;
+		bool inFrame;
+		std::chrono::high_resolution_clock::time_point frameStart;
+		FrameStatistics current, lastFrame;
+		Counters* counters;						//Counters of the renderable type being rendered
+		//What is bound, to spot redundant binds
+		GLuint currentProgram, currentVertexArray, activeTextureUnit;
+		std::map<GLenum, GLuint> boundBuffers;	//By target
+		std::map<GLuint, GLuint> boundTextures;	//By texture unit
+		//HEADLESS mode
+		GLuint nextName;
+		std::map<GLuint, std::vector<unsigned char> > bufferStorage;
+		std::map<std::pair<GLuint, std::string>, GLint> locations;
+		std::map<GLuint, GLint> numLocations;
+		RecordingGL();
+		static inline RecordingGL& r() { return instance(); }
+		static inline bool headless() { return instance().mode == HEADLESS; }
+		static inline Counters& count() { return *instance().counters; }
+		static void countBind(GLuint& current, GLuint value, unsigned int& binds);
+		static void countDraw(GLsizei vertices, GLsizei instances, bool instanced);
+		static void countUpload(GLsizeiptr bytes);
+	public:
+		static RecordingGL& instance();
+		inline void setMode(Mode newMode) { mode = newMode; }
+		inline Mode getMode() const { return mode; }
+		/**
+			Called by the RenderableVisitor around each frame it renders.
+		*/
+		void beginFrame();
+		void endFrame();
+		inline const FrameStatistics& getLastFrame() const { return lastFrame; }
+		/**
+			Calls made from now on are counted for this type of renderable (NULL: "(none)"). Used by the RenderQueue.
+		*/
+		void setCurrentRenderableType(const char* type);
+		/**
+			Made-up name for a texture (HEADLESS mode, see GPUAssetCache).
+		*/
+		GLuint createHeadlessTexture();
+		/**
+			Forgets the bound state (e.g. the application changed it behind our back) and the statistics.
+		*/
+		void reset();
+
+		//The OpenGL functions we replace (see the #defines at the end of this file)
+		static void UseProgram(GLuint program);
+		static void BindBuffer(GLenum target, GLuint buffer);
+		static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+		static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+		static void BindVertexArray(GLuint vertexArray);
+		static void BindTexture(GLenum target, GLuint texture);
+		static void ActiveTexture(GLenum unit);
+		static void Enable(GLenum capability);
+		static void Disable(GLenum capability);
+		static void PointSize(GLfloat size);
+		static void EnableVertexAttribArray(GLuint index);
+		static void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+		static void VertexAttribDivisor(GLuint index, GLuint divisor);
+		static void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+		static void Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+		static void Uniform1i(GLint location, GLint v0);
+		static void Uniform1f(GLint location, GLfloat v0);
+		static void DrawArrays(GLenum mode, GLint first, GLsizei count);
+		static void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+		static void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+		static void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount);
+		static void GenBuffers(GLsizei n, GLuint* buffers);
+		static void DeleteBuffers(GLsizei n, const GLuint* buffers);
+		static void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+		static void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+		static void BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+		static void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+		static GLboolean UnmapBuffer(GLenum target);
+		static void CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+		static void GenVertexArrays(GLsizei n, GLuint* arrays);
+		static void DeleteVertexArrays(GLsizei n, const GLuint* arrays);
+		static void GenTextures(GLsizei n, GLuint* textures);
+		static void DeleteTextures(GLsizei n, const GLuint* textures);
+		static void TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer);
+		static void GetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params);
+		static GLsync FenceSync(GLenum condition, GLbitfield flags);
+		static GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+		static void DeleteSync(GLsync sync);
+		static GLuint CreateShader(GLenum type);
+		static void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+		static void CompileShader(GLuint shader);
+		static void GetShaderiv(GLuint shader, GLenum pname, GLint* params);
+		static void DeleteShader(GLuint shader);
+		static GLuint CreateProgram();
+		static void AttachShader(GLuint program, GLuint shader);
+		static void DetachShader(GLuint program, GLuint shader);
+		static void ProgramParameteri(GLuint program, GLenum pname, GLint value);
+		static void LinkProgram(GLuint program);
+		static void GetProgramiv(GLuint program, GLenum pname, GLint* params);
+		static void DeleteProgram(GLuint program);
+		static GLint GetUniformLocation(GLuint program, const GLchar* name);
+		static GLint GetAttribLocation(GLuint program, const GLchar* name);
+		static GLuint GetUniformBlockIndex(GLuint program, const GLchar* name);
+		static void UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding);
+		static void GetIntegerv(GLenum pname, GLint* data);
+		static const GLubyte* GetString(GLenum name);
+		static const GLubyte* GetStringi(GLenum name, GLuint index);
+	};
+};
+
+//Replace the OpenGL functions (RecordingGL.cpp defines OPENGLFRAMEWORK_RECORDING_GL_IMPLEMENTATION, as it calls the real ones)
+#ifndef OPENGLFRAMEWORK_RECORDING_GL_IMPLEMENTATION
+	#undef glUseProgram
+	#define glUseProgram OpenGLFramework::RecordingGL::UseProgram
+	#undef glBindBuffer
+	#define glBindBuffer OpenGLFramework::RecordingGL::BindBuffer
+	#undef glBindBufferBase
+	#define glBindBufferBase OpenGLFramework::RecordingGL::BindBufferBase
+	#undef glBindBufferRange
+	#define glBindBufferRange OpenGLFramework::RecordingGL::BindBufferRange
+	#undef glBindVertexArray
+	#define glBindVertexArray OpenGLFramework::RecordingGL::BindVertexArray
+	#undef glBindTexture
+	#define glBindTexture OpenGLFramework::RecordingGL::BindTexture
+	#undef glActiveTexture
+	#define glActiveTexture OpenGLFramework::RecordingGL::ActiveTexture
+	#undef glEnable
+	#define glEnable OpenGLFramework::RecordingGL::Enable
+	#undef glDisable
+	#define glDisable OpenGLFramework::RecordingGL::Disable
+	#undef glPointSize
+	#define glPointSize OpenGLFramework::RecordingGL::PointSize
+	#undef glEnableVertexAttribArray
+	#define glEnableVertexAttribArray OpenGLFramework::RecordingGL::EnableVertexAttribArray
+	#undef glVertexAttribPointer
+	#define glVertexAttribPointer OpenGLFramework::RecordingGL::VertexAttribPointer
+	#undef glVertexAttribDivisor
+	#define glVertexAttribDivisor OpenGLFramework::RecordingGL::VertexAttribDivisor
+	#undef glUniformMatrix4fv
+	#define glUniformMatrix4fv OpenGLFramework::RecordingGL::UniformMatrix4fv
+	#undef glUniform3f
+	#define glUniform3f OpenGLFramework::RecordingGL::Uniform3f
+	#undef glUniform1i
+	#define glUniform1i OpenGLFramework::RecordingGL::Uniform1i
+	#undef glUniform1f
+	#define glUniform1f OpenGLFramework::RecordingGL::Uniform1f
+	#undef glDrawArrays
+	#define glDrawArrays OpenGLFramework::RecordingGL::DrawArrays
+	#undef glDrawElements
+	#define glDrawElements OpenGLFramework::RecordingGL::DrawElements
+	#undef glDrawArraysInstanced
+	#define glDrawArraysInstanced OpenGLFramework::RecordingGL::DrawArraysInstanced
+	#undef glDrawElementsInstanced
+	#define glDrawElementsInstanced OpenGLFramework::RecordingGL::DrawElementsInstanced
+	#undef glGenBuffers
+	#define glGenBuffers OpenGLFramework::RecordingGL::GenBuffers
+	#undef glDeleteBuffers
+	#define glDeleteBuffers OpenGLFramework::RecordingGL::DeleteBuffers
+	#undef glBufferData
+	#define glBufferData OpenGLFramework::RecordingGL::BufferData
+	#undef glBufferSubData
+	#define glBufferSubData OpenGLFramework::RecordingGL::BufferSubData
+	#undef glBufferStorage
+	#define glBufferStorage OpenGLFramework::RecordingGL::BufferStorage
+	#undef glMapBufferRange
+	#define glMapBufferRange OpenGLFramework::RecordingGL::MapBufferRange
+	#undef glUnmapBuffer
+	#define glUnmapBuffer OpenGLFramework::RecordingGL::UnmapBuffer
+	#undef glCopyBufferSubData
+	#define glCopyBufferSubData OpenGLFramework::RecordingGL::CopyBufferSubData
+	#undef glGenVertexArrays
+	#define glGenVertexArrays OpenGLFramework::RecordingGL::GenVertexArrays
+	#undef glDeleteVertexArrays
+	#define glDeleteVertexArrays OpenGLFramework::RecordingGL::DeleteVertexArrays
+	#undef glGenTextures
+	#define glGenTextures OpenGLFramework::RecordingGL::GenTextures
+	#undef glTexBuffer
+	#define glTexBuffer OpenGLFramework::RecordingGL::TexBuffer
+	#undef glDeleteTextures
+	#define glDeleteTextures OpenGLFramework::RecordingGL::DeleteTextures
+	#undef glGetTexLevelParameteriv
+	#define glGetTexLevelParameteriv OpenGLFramework::RecordingGL::GetTexLevelParameteriv
+	#undef glFenceSync
+	#define glFenceSync OpenGLFramework::RecordingGL::FenceSync
+	#undef glClientWaitSync
+	#define glClientWaitSync OpenGLFramework::RecordingGL::ClientWaitSync
+	#undef glDeleteSync
+	#define glDeleteSync OpenGLFramework::RecordingGL::DeleteSync
+	#undef glCreateShader
+	#define glCreateShader OpenGLFramework::RecordingGL::CreateShader
+	#undef glShaderSource
+	#define glShaderSource OpenGLFramework::RecordingGL::ShaderSource
+	#undef glCompileShader
+	#define glCompileShader OpenGLFramework::RecordingGL::CompileShader
+	#undef glGetShaderiv
+	#define glGetShaderiv OpenGLFramework::RecordingGL::GetShaderiv
+	#undef glDeleteShader
+	#define glDeleteShader OpenGLFramework::RecordingGL::DeleteShader
+	#undef glCreateProgram
+	#define glCreateProgram OpenGLFramework::RecordingGL::CreateProgram
+	#undef glAttachShader
+	#define glAttachShader OpenGLFramework::RecordingGL::AttachShader
+	#undef glDetachShader
+	#define glDetachShader OpenGLFramework::RecordingGL::DetachShader
+	#undef glProgramParameteri
+	#define glProgramParameteri OpenGLFramework::RecordingGL::ProgramParameteri
+	#undef glLinkProgram
+	#define glLinkProgram OpenGLFramework::RecordingGL::LinkProgram
+	#undef glGetProgramiv
+	#define glGetProgramiv OpenGLFramework::RecordingGL::GetProgramiv
+	#undef glDeleteProgram
+	#define glDeleteProgram OpenGLFramework::RecordingGL::DeleteProgram
+	#undef glGetUniformLocation
+	#define glGetUniformLocation OpenGLFramework::RecordingGL::GetUniformLocation
+	#undef glGetAttribLocation
+	#define glGetAttribLocation OpenGLFramework::RecordingGL::GetAttribLocation
+	#undef glGetUniformBlockIndex
+	#define glGetUniformBlockIndex OpenGLFramework::RecordingGL::GetUniformBlockIndex
+	#undef glUniformBlockBinding
+	#define glUniformBlockBinding OpenGLFramework::RecordingGL::UniformBlockBinding
+	#undef glGetIntegerv
+	#define glGetIntegerv OpenGLFramework::RecordingGL::GetIntegerv
+	#undef glGetString
+	#define glGetString OpenGLFramework::RecordingGL::GetString
+	#undef glGetStringi
+	#define glGetStringi OpenGLFramework::RecordingGL::GetStringi
+#endif
+#endif
+#endif
@@ -0,0 +1,63 @@
+#include <OpenGLFramework\Components\RenderComponent\RenderState.h>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+//We use this value to say "we do not know what is bound" (no OpenGL object has this name)
+static const GLuint UNKNOWN_STATE = (GLuint)-1;
+
+RenderState::RenderState() {
+	invalidate();
+	resetStatistics();
+}
+
+RenderState& RenderState::instance() {
+	static RenderState _instance;
+	return _instance;
+}
+
+void RenderState::invalidate() {
+	currentProgram = currentVertexArray = UNKNOWN_STATE;
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		currentTexture[i] = UNKNOWN_STATE;
+	currentTextureUnit = UNKNOWN_STATE;
+}
+
+void RenderState::resetStatistics() {
+	memset(&stats, 0, sizeof(stats));
+}
+
+void RenderState::useProgram(GLuint program) {
+	if (program == currentProgram) {
+		stats.programChangesSaved++;
+		return;
+	}
+	glUseProgram(program);
+	currentProgram = program;
+	stats.programChanges++;
+}
+
+void RenderState::bindTexture(GLenum target, GLuint unit, GLuint texture) {
+	if (unit < MAX_TEXTURE_UNITS && texture == currentTexture[unit]) {
+		stats.textureChangesSaved++;
+		return;
+	}
+	if (GL_TEXTURE0 + unit != currentTextureUnit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		currentTextureUnit = GL_TEXTURE0 + unit;
+	}
+	glBindTexture(target, texture);
+	if (unit < MAX_TEXTURE_UNITS)
+		currentTexture[unit] = texture;
+	stats.textureChanges++;
+}
+
+void RenderState::bindVertexArray(GLuint vertexArray) {
+	if (vertexArray == currentVertexArray) {
+		stats.vertexArrayChangesSaved++;
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	currentVertexArray = vertexArray;
+	stats.vertexArrayChanges++;
+}
@@ -0,0 +1,50 @@
+/**********************************************************************
+NAME: RenderState
+DESCRIPTION: Remembers the OpenGL state set by the renderables (shader program, textures and VAO bound), so that 
+	we only call OpenGL when the state really changes. Renderables call RenderState::instance().useProgram(...) 
+	instead of glUseProgram(...), and so on.
+	This pays off when similar renderables are drawn one after the other: the RenderableVisitor sorts the draws 
+	of each frame (see RenderQueue), so consecutive renderables often share the same shader, texture or mesh.
+	The counters tell how many state changes were actually issued, and how many were skipped.
+	If some code outside the renderables changes this state directly, it must call invalidate() afterwards.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_RENDERSTATE
+#define _OPENGLFRAMEWORK_RENDERSTATE
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>	//Replaces the OpenGL calls, if OPENGLFRAMEWORK_RECORDING_GL is defined
+
+namespace OpenGLFramework {
+	class RenderState {
+	public:
+		struct Statistics {
+			unsigned int programChanges, programChangesSaved;
+			unsigned int textureChanges, textureChangesSaved;
+			unsigned int vertexArrayChanges, vertexArrayChangesSaved;
+		};
+		static const unsigned int MAX_TEXTURE_UNITS = 16;
+	private:
+		GLuint currentProgram, currentVertexArray;
+		GLuint currentTexture[MAX_TEXTURE_UNITS];
+		GLenum currentTextureUnit;
+		Statistics stats;
+		RenderState();
+	public:
+		static RenderState& instance();
+		/**
+			Forget what we know about the OpenGL state (the next calls will always reach OpenGL).
+		*/
+		void invalidate();
+		void useProgram(GLuint program);
+		/**
+			Binds the texture to its target (GL_TEXTURE_2D, GL_TEXTURE_BUFFER...) in that texture unit. Each texture has its
+			own name, whatever its target, so we only remember the name: keep each unit for textures of one target.
+		*/
+		void bindTexture(GLenum target, GLuint unit, GLuint texture);
+		inline void bindTexture2D(GLuint unit, GLuint texture) { bindTexture(GL_TEXTURE_2D, unit, texture); }
+		void bindVertexArray(GLuint vertexArray);
+		inline const Statistics& getStatistics() const { return stats; }
+		void resetStatistics();
+	};
+};
+#endif
@@ -0,0 +1,96 @@
+#include <OpenGLFramework\Components\RenderComponent\RenderableRegistry.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\SceneNodes\IVirtualObject.h>
+
+using namespace OpenGLFramework;
+
+unsigned int RenderableRegistry::add(const IVirtualObject* owner, OpenGL_Renderable* renderable) {
+	unsigned int handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (unsigned int)slots.size();
+		slots.push_back(0);
+	}
+	slots[handle] = (unsigned int)renderables.size();
+	renderables.push_back(renderable);
+	owners.push_back(owner);
+	handles.push_back(handle);
+	ObjectEntry& entry = objects[owner];
+	entry.renderables.push_back(renderable);
+	entry.handles.push_back(handle);
+	return handle;
+}
+
+unsigned int RenderableRegistry::addObject(IVirtualObject* vo) {
+	objects[vo];	//Registered, even without renderables
+	unsigned int added = 0;
+	std::list<IComponent*> l = vo->getAllComponentsOfType("Renderable");
+	for (std::list<IComponent*>::iterator it = l.begin(); it != l.end(); it++) {
+		OpenGL_Renderable* renderable = dynamic_cast<OpenGL_Renderable*>(*it);
+		if (renderable) {
+			add(vo, renderable);
+			added++;
+		}
+	}
+	return added;
+}
+
+bool RenderableRegistry::remove(unsigned int handle) {
+	if (handle >= slots.size() || slots[handle] == INVALID_HANDLE)
+		return false;
+	unsigned int slot = slots[handle];
+	//1. Out of its object (keeping the order of the others)
+	ObjectEntry& entry = objects[owners[slot]];
+	for (size_t i = 0; i < entry.handles.size(); i++)
+		if (entry.handles[i] == handle) {
+			entry.handles.erase(entry.handles.begin() + i);
+			entry.renderables.erase(entry.renderables.begin() + i);
+			break;
+		}
+	//2. Out of the dense arrays: the last renderable takes its place
+	unsigned int last = (unsigned int)renderables.size() - 1;
+	renderables[slot] = renderables[last];
+	owners[slot] = owners[last];
+	handles[slot] = handles[last];
+	slots[handles[slot]] = slot;
+	renderables.pop_back(); owners.pop_back(); handles.pop_back();
+	slots[handle] = INVALID_HANDLE;
+	freeHandles.push_back(handle);
+	return true;
+}
+
+void RenderableRegistry::removeObject(const IVirtualObject* owner) {
+	std::unordered_map<const IVirtualObject*, ObjectEntry>::iterator it = objects.find(owner);
+	if (it == objects.end())
+		return;
+	std::vector<unsigned int> objectHandles = it->second.handles;
+	for (size_t i = 0; i < objectHandles.size(); i++)
+		remove(objectHandles[i]);
+	objects.erase(owner);
+}
+
+OpenGL_Renderable* const* RenderableRegistry::getRenderables(const IVirtualObject* owner, size_t& count) const {
+	std::unordered_map<const IVirtualObject*, ObjectEntry>::const_iterator it = objects.find(owner);
+	if (it == objects.end()) {
+		count = 0;
+		return NULL;
+	}
+	count = it->second.renderables.size();
+	static OpenGL_Renderable* const none = NULL;	//Registered objects without renderables get an empty (but not NULL) array
+	return count ? &it->second.renderables[0] : &none;
+}
+
+OpenGL_Renderable* RenderableRegistry::getRenderable(unsigned int handle) const {
+	if (handle >= slots.size() || slots[handle] == INVALID_HANDLE)
+		return NULL;
+	return renderables[slots[handle]];
+}
+
+void RenderableRegistry::clear() {
+	renderables.clear(); owners.clear(); handles.clear();
+	slots.clear(); freeHandles.clear();
+	objects.clear();
+}
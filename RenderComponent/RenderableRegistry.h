@@ -0,0 +1,80 @@
+/**********************************************************************
+NAME: RenderableRegistry
+DESCRIPTION: The renderables of the objects of a scene, kept in arrays, so that rendering does not have to ask each
+	object for them every frame. Asking an object (getAllComponentsOfType("Renderable")) compares the type of each of
+	its components as a string, builds a new std::list with the ones found (allocating memory), and each of them must
+	then be cast to OpenGL_Renderable (dynamic_cast). Done for every object in every frame, this adds up.
+	Here, renderables are registered once (e.g. when the object is added to the scene), and stored:
+		- By object: the renderables of each object one after the other, so the RenderableVisitor reads them as a plain
+		array (getRenderables), with no allocation, string comparison or cast.
+		- All together, in one dense array (getAllRenderables), for code that needs to go through all of them.
+	Each renderable registered gets a handle, which stays valid until it is removed (the dense array is compacted
+	when renderables are removed, but handles do not change).
+	The registry does not know when components are added to or removed from an object: whoever changes them must update
+	the registry too. Objects that are not registered are still rendered, asking the object (see
+	RenderableVisitor::setRenderableRegistry).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_RENDERABLEREGISTRY
+#define _OPENGLFRAMEWORK_RENDERABLEREGISTRY
+#include "OpenGLFRameworkPrerequisites.h"
+#include <vector>
+#include <unordered_map>
+
+namespace OpenGLFramework {
+	class IVirtualObject;			//Forward declaration
+	class OpenGL_Renderable;		//Forward declaration
+
+	class RenderableRegistry {
+	public:
+		static const unsigned int INVALID_HANDLE = 0xFFFFFFFF;
+	private:
+		//All the renderables (dense), with the owner and the handle of each one
+		std::vector<OpenGL_Renderable*> renderables;
+		std::vector<const IVirtualObject*> owners;
+		std::vector<unsigned int> handles;
+		//Position in the arrays above of each handle (INVALID_HANDLE: free, to be reused)
+		std::vector<unsigned int> slots;
+		std::vector<unsigned int> freeHandles;
+		//Renderables of each object (in the order they were registered), and their handles
+		struct ObjectEntry {
+			std::vector<OpenGL_Renderable*> renderables;
+			std::vector<unsigned int> handles;
+		};
+		std::unordered_map<const IVirtualObject*, ObjectEntry> objects;
+	public:
+		/**
+			Registers a renderable of an object, and returns its handle. The object is registered too, if it was not.
+		*/
+		unsigned int add(const IVirtualObject* owner, OpenGL_Renderable* renderable);
+		/**
+			Registers an object, with all its renderable components (this asks the object for them, once). Objects without
+			renderables can be registered too: the RenderableVisitor then knows there is nothing to render in them.
+			Returns the number of renderables registered.
+		*/
+		unsigned int addObject(IVirtualObject* vo);
+		/**
+			Removes a renderable (its object stays registered, even if it has no renderables left).
+		*/
+		bool remove(unsigned int handle);
+		/**
+			Removes an object and all its renderables.
+		*/
+		void removeObject(const IVirtualObject* owner);
+		inline bool contains(const IVirtualObject* owner) const { return objects.find(owner) != objects.end(); }
+		/**
+			Renderables of an object (count of them in count), or NULL if the object is not registered.
+		*/
+		OpenGL_Renderable* const* getRenderables(const IVirtualObject* owner, size_t& count) const;
+		OpenGL_Renderable* getRenderable(unsigned int handle) const;
+		/**
+			All the renderables registered, getNumRenderables() of them (in no particular order).
+		*/
+		inline OpenGL_Renderable* const* getAllRenderables() const { return renderables.empty() ? NULL : &renderables[0]; }
+		inline const IVirtualObject* const* getAllOwners() const { return owners.empty() ? NULL : &owners[0]; }
+		inline size_t getNumRenderables() const { return renderables.size(); }
+		inline size_t getNumObjects() const { return objects.size(); }
+		void clear();
+	};
+};
+#endif
@@ -0,0 +1,111 @@
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\FrustumCuller.h>
+#include <cmath>
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define FRUSTUM_CULLER_SSE
+#endif
+
+using namespace OpenGLFramework;
+
+//Arrays are padded to a multiple of this, so that the SIMD loops never need a scalar tail
+static const size_t BATCH_SIZE = 8;
+
+FrustumCuller::FrustumCuller() : numBoxes(0) {
+	for (int p = 0; p < 6; p++)
+		planes[p][0] = planes[p][1] = planes[p][2] = 0, planes[p][3] = 1;	//Everything is inside
+}
+
+void FrustumCuller::setFrustum(const glm::mat4& P, const glm::mat4& V) {
+	glm::mat4 PV = P * V;
+	//glm matrices are column-major: PV[column][row]
+	for (int i = 0; i < 3; i++) {
+		for (int c = 0; c < 4; c++) {
+			planes[2 * i][c] = PV[c][3] + PV[c][i];		//left, bottom, near
+			planes[2 * i + 1][c] = PV[c][3] - PV[c][i];	//right, top, far
+		}
+	}
+	for (int p = 0; p < 6; p++) {
+		float length = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		if (length > 0)
+			for (int c = 0; c < 4; c++) planes[p][c] /= length;
+	}
+}
+
+void FrustumCuller::transformBox(const BoundingBox& bb, const glm::mat4& M, glm::vec3& centre, glm::vec3& extent) {
+	glm::vec3 localCentre(0.5f*(bb.xmin + bb.xmax), 0.5f*(bb.ymin + bb.ymax), 0.5f*(bb.zmin + bb.zmax));
+	glm::vec3 localExtent(0.5f*(bb.xmax - bb.xmin), 0.5f*(bb.ymax - bb.ymin), 0.5f*(bb.zmax - bb.zmin));
+	glm::vec4 c = M * glm::vec4(localCentre, 1);
+	centre = glm::vec3(c.x, c.y, c.z);
+	//Arvo's method: each world axis gets the contribution of the three (rotated and scaled) local axes
+	for (int row = 0; row < 3; row++)
+		extent[row] = std::fabs(M[0][row]) * localExtent.x + std::fabs(M[1][row]) * localExtent.y + std::fabs(M[2][row]) * localExtent.z;
+}
+
+size_t FrustumCuller::addBox(const glm::vec3& centre, const glm::vec3& extent) {
+	if (numBoxes + 1 > cx.size()) {
+		size_t newSize = cx.size() < BATCH_SIZE ? BATCH_SIZE : 2 * cx.size();
+		cx.resize(newSize); cy.resize(newSize); cz.resize(newSize);
+		ex.resize(newSize); ey.resize(newSize); ez.resize(newSize);
+	}
+	cx[numBoxes] = centre.x; cy[numBoxes] = centre.y; cz[numBoxes] = centre.z;
+	ex[numBoxes] = extent.x; ey[numBoxes] = extent.y; ez[numBoxes] = extent.z;
+	return numBoxes++;
+}
+
+size_t FrustumCuller::cull(std::vector<unsigned char>& visible) {
+	visible.resize(numBoxes);
+	size_t numVisible = 0;
+	//A box is outside if it is completely behind any plane: dot(n, centre) + d < -dot(|n|, extent)
+#if defined(FRUSTUM_CULLER_AVX)
+	for (size_t i = 0; i < numBoxes; i += 8) {
+		__m256 centreX = _mm256_loadu_ps(&cx[i]), centreY = _mm256_loadu_ps(&cy[i]), centreZ = _mm256_loadu_ps(&cz[i]);
+		__m256 extentX = _mm256_loadu_ps(&ex[i]), extentY = _mm256_loadu_ps(&ey[i]), extentZ = _mm256_loadu_ps(&ez[i]);
+		__m256 outside = _mm256_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(centreX, _mm256_set1_ps(planes[p][0])), _mm256_mul_ps(centreY, _mm256_set1_ps(planes[p][1])))
+				, _mm256_add_ps(_mm256_mul_ps(centreZ, _mm256_set1_ps(planes[p][2])), _mm256_set1_ps(planes[p][3])));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(extentX, _mm256_set1_ps(std::fabs(planes[p][0]))), _mm256_mul_ps(extentY, _mm256_set1_ps(std::fabs(planes[p][1]))))
+				, _mm256_mul_ps(extentZ, _mm256_set1_ps(std::fabs(planes[p][2]))));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+		int mask = _mm256_movemask_ps(outside);
+		for (size_t j = 0; j < 8 && i + j < numBoxes; j++) {
+			visible[i + j] = (mask >> j) & 1 ? 0 : 1;
+			numVisible += visible[i + j];
+		}
+	}
+#elif defined(FRUSTUM_CULLER_SSE)
+	for (size_t i = 0; i < numBoxes; i += 4) {
+		__m128 centreX = _mm_loadu_ps(&cx[i]), centreY = _mm_loadu_ps(&cy[i]), centreZ = _mm_loadu_ps(&cz[i]);
+		__m128 extentX = _mm_loadu_ps(&ex[i]), extentY = _mm_loadu_ps(&ey[i]), extentZ = _mm_loadu_ps(&ez[i]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centreX, _mm_set1_ps(planes[p][0])), _mm_mul_ps(centreY, _mm_set1_ps(planes[p][1])))
+				, _mm_add_ps(_mm_mul_ps(centreZ, _mm_set1_ps(planes[p][2])), _mm_set1_ps(planes[p][3])));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::fabs(planes[p][0]))), _mm_mul_ps(extentY, _mm_set1_ps(std::fabs(planes[p][1]))))
+				, _mm_mul_ps(extentZ, _mm_set1_ps(std::fabs(planes[p][2]))));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (size_t j = 0; j < 4 && i + j < numBoxes; j++) {
+			visible[i + j] = (mask >> j) & 1 ? 0 : 1;
+			numVisible += visible[i + j];
+		}
+	}
+#else
+	for (size_t i = 0; i < numBoxes; i++) {
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++) {
+			float distance = planes[p][0] * cx[i] + planes[p][1] * cy[i] + planes[p][2] * cz[i] + planes[p][3];
+			float radius = std::fabs(planes[p][0]) * ex[i] + std::fabs(planes[p][1]) * ey[i] + std::fabs(planes[p][2]) * ez[i];
+			outside = distance + radius < 0;
+		}
+		visible[i] = outside ? 0 : 1;
+		numVisible += visible[i];
+	}
+#endif
+	return numVisible;
+}
@@ -0,0 +1,47 @@
+/**
+NAME: FrustumCuller
+DESCRIPTION: Decides which objects are (at least partially) inside the viewing volume of the camera (the frustum), 
+	so that objects we cannot see are not rendered at all.
+	The six planes of the frustum are extracted once per frame from the P*V matrix. Objects are described by their
+	world space axis aligned bounding box (the local bounding box of the renderable, transformed by its model matrix).
+	Boxes are stored as separate arrays of centres and extents (structure of arrays) and tested in batches of 8 (AVX),
+	4 (SSE) or 1 (plain C++), depending on what the compiler targets.
+	The test is conservative: some boxes near the corners of the frustum are reported as visible when they are not,
+	but a visible box is never culled.
+*/
+
+#ifndef _OPENGLFRAMEWORK_FRUSTUMCULLER
+#define _OPENGLFRAMEWORK_FRUSTUMCULLER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	class FrustumCuller {
+		float planes[6][4];								//(a,b,c,d): a*x+b*y+c*z+d >= 0 for points inside
+		std::vector<float> cx, cy, cz, ex, ey, ez;		//Centres and extents (half sizes) of the boxes to test
+		size_t numBoxes;
+	public:
+		FrustumCuller();
+		/**
+			Extracts the frustum planes from the projection and view matrices (Gribb & Hartmann's method).
+		*/
+		void setFrustum(const glm::mat4& P, const glm::mat4& V);
+		/**
+			Converts a local bounding box into a world space box (centre and extent), using the model matrix M.
+			The result contains the rotated box (it is slightly bigger than the original, unless M has no rotation).
+		*/
+		static void transformBox(const BoundingBox& bb, const glm::mat4& M, glm::vec3& centre, glm::vec3& extent);
+		/**
+			Adds a (world space) box to the batch. Returns its index.
+		*/
+		size_t addBox(const glm::vec3& centre, const glm::vec3& extent);
+		inline void clear() { numBoxes = 0; }
+		inline size_t size() const { return numBoxes; }
+		/**
+			Tests all the boxes in the batch. visible[i] is set to 1 if box i intersects the frustum, 0 otherwise.
+			Returns the number of visible boxes.
+		*/
+		size_t cull(std::vector<unsigned char>& visible);
+	};
+};
+#endif
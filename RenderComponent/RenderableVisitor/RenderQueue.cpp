@@ -0,0 +1,122 @@
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\RenderQueue.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+namespace {
+	//Positive floats keep their order when we look at their bits as integers. We keep the top 'bits' bits.
+	inline unsigned long long quantiseDepth(float depth, int bits) {
+		if (!(depth > 0)) depth = 0;		//Objects behind the camera (or NaN) go first
+		unsigned int asInt;
+		memcpy(&asInt, &depth, sizeof(asInt));
+		return asInt >> (32 - bits);		//The sign bit is always 0, so we get bits-1 significant bits
+	}
+	inline unsigned long long field(unsigned long long value, int bits) {
+		return value & ((1ULL << bits) - 1);
+	}
+};
+
+RenderQueue::RenderQueue() {
+	memset(&stats, 0, sizeof(stats));
+}
+
+unsigned long long RenderQueue::buildKey(OpenGL_Renderable* r, unsigned int batch, float viewDepth) {
+	if (!r->isTransparent()) {
+		if (batch)	// [0:1 | 1:1 | batch:24 | unused:19 | depth:19]
+			return (1ULL << 62) | (field(batch, 24) << 38) | quantiseDepth(viewDepth, 19);
+		// [0:1 | 0:1 | program:11 | texture:16 | mesh:16 | depth:19]
+		return (field(r->getShaderProgram(), 11) << 51) | (field(r->getTexture(), 16) << 35) | (field(r->getMesh(), 16) << 19)
+			| quantiseDepth(viewDepth, 19);
+	}
+	// [1:1 | inverted depth:24 | program:12 | texture:16 | mesh:11]
+	unsigned long long backToFront = field(~quantiseDepth(viewDepth, 24), 24);
+	return (1ULL << 63) | (backToFront << 39) | (field(r->getShaderProgram(), 12) << 27) | (field(r->getTexture(), 16) << 11)
+		| field(r->getMesh(), 11);
+}
+
+void RenderQueue::add(OpenGL_Renderable* renderable, float viewDepth, const glm::mat4& M) {
+	//Transparent renderables must be drawn in order (back to front), so they are never batched
+	unsigned int batch = renderable->isTransparent() ? 0 : renderable->getInstancingBatch();
+	DrawPacket p = { buildKey(renderable, batch, viewDepth), renderable, batch, (unsigned int)modelMatrices.size() };
+	packets.push_back(p);
+	modelMatrices.push_back(M);
+}
+
+void RenderQueue::sort() {
+	size_t n = packets.size();
+	if (n < 2) return;
+	scratch.resize(n);
+	DrawPacket* src = &packets[0], *dst = &scratch[0];
+	for (int shift = 0; shift < 64; shift += 8) {
+		//1. Histogram of this byte
+		size_t count[256];
+		memset(count, 0, sizeof(count));
+		for (size_t i = 0; i < n; i++)
+			count[(src[i].key >> shift) & 0xFF]++;
+		if (count[(src[0].key >> shift) & 0xFF] == n)
+			continue;		//All keys have the same byte here: this pass would not change anything
+		//2. Starting position of each bucket
+		size_t offset = 0;
+		for (int b = 0; b < 256; b++) {
+			size_t c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+		//3. Scatter (stable)
+		for (size_t i = 0; i < n; i++)
+			dst[count[(src[i].key >> shift) & 0xFF]++] = src[i];
+		DrawPacket* tmp = src; src = dst; dst = tmp;
+	}
+	if (src != &packets[0])
+		packets.swap(scratch);
+}
+
+void RenderQueue::submit(glm::mat4 P, glm::mat4 V) {
+	memset(&stats, 0, sizeof(stats));
+	size_t i = 0;
+	while (i < packets.size()) {
+		//0. One scope for each run of renderables of the same type (the keys sort them together), not for each draw:
+		//a scope costs about as much as a cheap draw (see the ProfilerOverhead benchmark)
+		const char* type = packets[i].renderable->getRenderableTypeName();
+		size_t typeEnd = i + 1;
+		while (typeEnd < packets.size() && packets[typeEnd].renderable->getRenderableTypeName() == type)
+			typeEnd++;
+		OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("render", type);
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+		RecordingGL::instance().setCurrentRenderableType(type);
+#endif
+		while (i < typeEnd) {
+			//1. Find the packets of the same batch (the keys put them next to each other)
+			size_t end = i + 1;
+			if (packets[i].batch)
+				while (end < typeEnd && packets[end].batch == packets[i].batch)
+					end++;
+			//2. Draw them all at once, using the first renderable (they all show the same asset)...
+			if (end - i > 1) {
+				instanceMatrices.clear();
+				for (size_t j = i; j < end; j++)
+					instanceMatrices.push_back(modelMatrices[packets[j].modelMatrix]);
+				if (packets[i].renderable->renderInstanced(P, V, &instanceMatrices[0], (unsigned int)instanceMatrices.size())) {
+					stats.drawCalls++;
+					stats.instancedDrawCalls++;
+					stats.instances += (unsigned int)(end - i);
+					i = end;
+					continue;
+				}
+			}
+			//3. ... or one by one
+			for (; i < end; i++) {
+				packets[i].renderable->setModelMatrix(&modelMatrices[packets[i].modelMatrix]);	//Saves render() asking its owner again
+				packets[i].renderable->render(P, V);
+				packets[i].renderable->setModelMatrix(NULL);
+				stats.drawCalls++;
+			}
+		}
+	}
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+	RecordingGL::instance().setCurrentRenderableType(NULL);
+#endif
+	clear();
+}
@@ -0,0 +1,67 @@
+/**
+NAME: RenderQueue
+DESCRIPTION: List of the draws (renderables) of one frame, sorted to minimise OpenGL state changes.
+	The RenderableVisitor adds a lightweight draw packet for each renderable it finds while traversing the scene,
+	and submits all of them at the end of the traversal. Each packet has a 64 bit sort key:
+		- Opaque renderables:		[pass=0 | instanced=0 | shader program | texture | mesh | depth (front to back)]
+		- Opaque instanceable:		[pass=0 | instanced=1 | batch | depth (front to back)]
+		- Transparent renderables:	[pass=1 | depth (back to front) | shader program | texture | mesh]
+	Sorting by this key (radix sort) draws opaque objects grouped by shader, then texture, then mesh, so that
+	RenderState can skip most glUseProgram/glBindTexture/glBindVertexArray calls. Within the same state, closer 
+	objects go first (helps early-Z). Transparent objects are drawn last, from back to front, so they blend correctly.
+	Opaque renderables showing the same asset (same instancing batch, see InstanceBatches) end up next to each other, 
+	and are drawn with a single instanced draw call, using the model matrices stored with the packets.
+	Object names (shaders, textures...) are truncated to the bits available in the key. That only makes the sorting
+	less effective in huge scenes, it never renders anything incorrectly.
+*/
+
+#ifndef _OPENGLFRAMEWORK_RENDERQUEUE
+#define _OPENGLFRAMEWORK_RENDERQUEUE
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+
+namespace OpenGLFramework {
+	class OpenGL_Renderable;		//Forward declaration
+
+	class RenderQueue {
+	public:
+		struct DrawPacket {
+			unsigned long long key;
+			OpenGL_Renderable* renderable;
+			unsigned int batch;				//Instancing batch (0 = not instanced)
+			unsigned int modelMatrix;		//Index in modelMatrices
+		};
+		struct Statistics {
+			unsigned int drawCalls;			//Calls to render() or renderInstanced() in the last submit
+			unsigned int instancedDrawCalls;//Calls to renderInstanced()
+			unsigned int instances;			//Renderables drawn by those calls
+		};
+	private:
+		std::vector<DrawPacket> packets, scratch;		//scratch is used by the radix sort (kept to avoid allocating every frame)
+		std::vector<glm::mat4> modelMatrices;			//Model matrix of each packet
+		std::vector<glm::mat4> instanceMatrices;		//Matrices of the batch being drawn (kept to avoid allocating every frame)
+		Statistics stats;
+		static unsigned long long buildKey(OpenGL_Renderable* renderable, unsigned int batch, float viewDepth);
+	public:
+		RenderQueue();
+		/**
+			Adds a renderable to the queue. viewDepth is the distance from the camera to the object (along the viewing direction).
+			M is the model matrix of its owner (only used if it gets drawn as part of an instanced batch).
+		*/
+		void add(OpenGL_Renderable* renderable, float viewDepth, const glm::mat4& M);
+		/**
+			Sorts the packets by their key (stable LSD radix sort, 8 bits per pass; passes where all keys have the same byte are skipped).
+		*/
+		void sort();
+		/**
+			Renders all the packets, in their current order, and empties the queue.
+			Consecutive packets of the same instancing batch are drawn together.
+		*/
+		void submit(glm::mat4 P, glm::mat4 V);
+		inline void clear() { packets.clear(); modelMatrices.clear(); }
+		inline const Statistics& getStatistics() const { return stats; }
+		inline size_t size() const { return packets.size(); }
+		inline const std::vector<DrawPacket>& getPackets() const { return packets; }
+	};
+};
+#endif
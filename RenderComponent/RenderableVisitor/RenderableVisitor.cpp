@@ -2,6 +2,11 @@
 #include <OpenGLFramework\SceneNodes\IVirtualObject.h>
 #include <OpenGLFramework\SceneNodes\IScenenode.h>
 #include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <OpenGLFramework\Components\RenderComponent\LODSelector.h>
+#include <OpenGLFramework\Components\RenderComponent\ClusteredLighting.h>
+#include <OpenGLFramework\Components\RenderComponent\UniformBlocks.h>
+#include <cstring>
 
 using namespace OpenGLFramework;
 //It is OK to use namespaces in the context of a .cpp file, but do not do it in a .h
@@ -9,27 +14,162 @@ using namespace OpenGLFramework;
 // When a piece of software uses many libraries, with many namesapces, this can lead to collisions in class names, methods, etc...
 //BONUS: Not using namespaces, you will know which library is giving you the functionality (i.e. I am using glm, stl, CImg, etc...)
 //CONS: You will be writing lot's of <namespace>::<method> (e.g. glm::normalise(...), std::vector<int>, etc.)
-OpenGLFramework::RenderableVisitor::RenderableVisitor(glm::mat4 P, glm::mat4 V) : P(P), V(V) { ; }
+OpenGLFramework::RenderableVisitor::RenderableVisitor(glm::mat4 P, glm::mat4 V) : P(P), V(V), frustumCulling(true), lodTolerance(1.0f / 1080), worldTransforms(NULL), renderableRegistry(NULL), visitDepth(0) { 
+	memset(&frameStats, 0, sizeof(frameStats));
+	culler.setFrustum(P, V);	//Camera does not change during the frame: we extract the frustum planes only once
+}
+
+void OpenGLFramework::RenderableVisitor::beginFrame() {
+	memset(&frameStats, 0, sizeof(frameStats));	//Each outermost visit (or renderRenderables) is one frame
+	frameStart = std::chrono::high_resolution_clock::now();
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+	RecordingGL::instance().beginFrame();
+#endif
+	if (worldTransforms)
+		worldTransforms->update();	//Only the nodes that moved (and their subtrees)
+}
 
 bool OpenGLFramework::RenderableVisitor::visitVirtualObject(OpenGLFramework::IVirtualObject* vo) {
-	//1. We get all renderable components
-	std::list<IComponent*> l=vo->getAllComponentsOfType("Renderable");
-	//2. Traverse them and ask them to render
-	std::list<IComponent*>::iterator it = l.begin();
-	for (; it != l.end(); it++) {
-		OpenGL_Renderable* renderable = dynamic_cast<OpenGL_Renderable*>(*it);
-		if (renderable && renderable->isEnabled())//dynamic_cast succeeded --> it is the right type of component
-			renderable->render(P, V);
+	if (visitDepth == 0)
+		beginFrame();
+	//1. We get all renderable components: from the registry, if the scene keeps one (a plain array: nothing to allocate, 
+	//   compare or cast), or else from the object itself
+	//2. Traverse them and add them to our queue (sorted by the distance of the centre of their bounding box to the camera)
+	//   Renderables that can be culled wait until the end of the traversal: we test all of them together (see FrustumCuller).
+	glm::mat4 M;
+	bool haveM = false;
+	size_t count = 0;
+	OpenGL_Renderable* const* registered = renderableRegistry ? renderableRegistry->getRenderables(vo, count) : NULL;
+	if (registered) {
+		for (size_t i = 0; i < count; i++)
+			visitRenderable(vo, registered[i], M, haveM);
 	}
+	else {
+		std::list<IComponent*> l=vo->getAllComponentsOfType("Renderable");
+		std::list<IComponent*>::iterator it = l.begin();
+		for (; it != l.end(); it++) {
+			OpenGL_Renderable* renderable = dynamic_cast<OpenGL_Renderable*>(*it);
+			if (renderable)//dynamic_cast succeeded --> it is the right type of component
+				visitRenderable(vo, renderable, M, haveM);
+		}
+	}
+	//3. If we were not visited as part of a scene node, render straight away
+	if (visitDepth == 0)
+		submitQueue();
 	return true;
 }
+
+void OpenGLFramework::RenderableVisitor::visitRenderable(IVirtualObject* vo, OpenGL_Renderable* renderable, glm::mat4& M, bool& haveM) {
+	if (!renderable->isEnabled() || !renderable->isReadyToRender())
+		return;
+	if (!haveM) {	//All renderables in the object share the same model matrix
+		unsigned int node = worldTransforms ? worldTransforms->findNode(vo) : WorldTransformCache::INVALID_NODE;
+		M = (node != WorldTransformCache::INVALID_NODE) ? worldTransforms->getWorldTransform(node) : vo->getFromObjectToWorldCoordinates();
+		haveM = true;
+	}
+	addRenderable(renderable, M);
+}
+
+void OpenGLFramework::RenderableVisitor::addRenderable(OpenGL_Renderable* renderable, const glm::mat4& M) {
+	glm::vec3 centre, extent;
+	FrustumCuller::transformBox(renderable->getLocalBoundingBox(), M, centre, extent);
+	float viewDepth = -(V * glm::vec4(centre, 1)).z;		//The camera looks down the -Z axis
+	float radius = glm::length(extent);
+	if (frustumCulling && renderable->isCullable()) {
+		culler.addBox(centre, extent);
+		CullingCandidate c = { renderable, viewDepth, radius, M };
+		candidates.push_back(c);
+	}
+	else {
+		queueRenderable(renderable, viewDepth, radius, M);
+		frameStats.renderablesVisible++;
+	}
+}
+
 bool OpenGLFramework::RenderableVisitor::visitSceneNode(OpenGLFramework::ISceneNode* vo) {
+	if (visitDepth == 0)
+		beginFrame();
+	visitDepth++;
 	//1. Get all the children of the node
 	std::map<unsigned int, IVirtualObject*>& children = vo->getAllChildren();
 	//2. ... and visit them
-	std::map<unsigned int, IVirtualObject*>::iterator it = children.begin();
-	for (; it != children.end(); it++)
-		it->second->visit(*((ISceneVisitor*)this));
-
+	{
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Traversal");
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::map<unsigned int, IVirtualObject*>::iterator it = children.begin();
+		for (; it != children.end(); it++)
+			it->second->visit(*((ISceneVisitor*)this));
+		if (visitDepth == 1)	//The outermost node (inner ones are part of its traversal)
+			frameStats.traversalSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	visitDepth--;
+	//3. The whole tree has been visited: sort and render everything we found
+	if (visitDepth == 0)
+		submitQueue();
 	return true;
 }
+
+void OpenGLFramework::RenderableVisitor::renderRenderables(OpenGL_Renderable* const* renderables, const glm::mat4* modelMatrices, size_t count) {
+	if (visitDepth == 0)
+		beginFrame();
+	visitDepth++;
+	{
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Traversal");
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < count; i++)
+			if (renderables[i]->isEnabled() && renderables[i]->isReadyToRender())
+				addRenderable(renderables[i], modelMatrices[i]);
+		if (visitDepth == 1)
+			frameStats.traversalSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	visitDepth--;
+	if (visitDepth == 0)
+		submitQueue();
+}
+
+void OpenGLFramework::RenderableVisitor::queueRenderable(OpenGL_Renderable* renderable, float viewDepth, float radius, const glm::mat4& M) {
+	//The level of detail decides which instancing batch the renderable is in, so it must be chosen before queueing it
+	if (renderable->selectLevelOfDetail(LODSelector::computeScreenSize(radius, viewDepth, P), lodTolerance) > 0)
+		frameStats.renderablesSimplified++;
+	queue.add(renderable, viewDepth, M);
+}
+
+void OpenGLFramework::RenderableVisitor::submitQueue() {
+	//Test all the candidates against the frustum and queue the visible ones
+	if (!candidates.empty()) {
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Frustum culling");
+		size_t numVisible = culler.cull(visibility);
+		for (size_t i = 0; i < candidates.size(); i++)
+			if (visibility[i])
+				queueRenderable(candidates[i].renderable, candidates[i].viewDepth, candidates[i].radius, candidates[i].M);
+		frameStats.renderablesVisible += (unsigned int)numVisible;
+		frameStats.renderablesCulled += (unsigned int)(candidates.size() - numVisible);
+		candidates.clear();
+		culler.clear();
+	}
+	//Other code might have changed the OpenGL state since the last frame (e.g. allocating resources)
+	RenderState::instance().invalidate();
+	RenderState::instance().resetStatistics();
+	//Lights of each cluster of this camera, for the renderables lit by all the lights of the scene
+	if (ClusteredLighting::instance().isInUse())
+		ClusteredLighting::instance().update(P, V);
+	//The camera (and those lights), in the uniform block shared by all the programs
+	if (UniformBlocks::instance().isInUse())
+		UniformBlocks::instance().beginFrame(P, V);
+	{
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Sort");
+		queue.sort();
+	}
+	{
+		OPENGLFRAMEWORK_PROFILE_SCOPE("Submit");
+		queue.submit(P, V);
+	}
+	frameStats.drawsSubmitted += queue.getStatistics().drawCalls;
+	frameStats.renderablesInstanced += queue.getStatistics().instances;
+	frameStats.stateChanges = RenderState::instance().getStatistics();
+	frameStats.submitSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - frameStart).count();
+#ifdef OPENGLFRAMEWORK_RECORDING_GL
+	RecordingGL::instance().endFrame();
+#endif
+	OPENGLFRAMEWORK_PROFILE_END_FRAME();
+}
@@ -3,10 +3,28 @@ NAME: RenderableVisitor
 DESCRIPTION: This is a Visitor subclass used to render the content of our scene.
 This kind of Visitors are connected to the components of type OpenGL_Renderable
 This vistor implements two different behaviours:
-	- For simple objects: simiply calls render, passing them with the camera details
+	- For simple objects: collects their renderables in a RenderQueue (they will be rendered with the camera details)
 	- For SceneNodes, it will not render anything. However, it will visit all its
 	children nodes, causing them to render.
 This behaviour ensures all the objects in the tree are visited and all single VirtualObjects rendered.
+Renderables whose bounding box falls outside the camera's frustum are discarded (see FrustumCuller); the test is
+done for all renderables at once, once the whole tree has been visited.
+Model matrices come from a WorldTransformCache, if the scene keeps one (see setWorldTransforms): it is updated at the
+start of the frame, and objects it knows about do not walk up the tree to compute their matrix. Renderables get the
+matrix from the queue when they are rendered, rather than asking their owner again (see OpenGL_Renderable::getModelMatrix).
+Renderables are read from a RenderableRegistry, if the scene keeps one (see setRenderableRegistry), rather than asking
+each object for its components (which builds a list and casts each component, for every object in every frame).
+Renderables with levels of detail choose the one they draw from their size on screen (see LODSelector).
+If any renderable is lit by all the lights of the scene, the lights are assigned to the clusters of the camera
+before rendering (see ClusteredLighting). The camera is written once per frame, in a uniform block shared by all the
+programs (see UniformBlocks).
+Renderables are not rendered as soon as we find them. Once the whole tree has been visited, the queue is sorted 
+(by shader, texture, mesh and depth) and rendered in one go. This groups objects that use the same OpenGL state,
+which saves most state changes (see RenderQueue and RenderState). Renderables showing the same asset are drawn 
+together, with a single instanced draw call. The counters of the last frame are available
+through getFrameStatistics(). If OPENGLFRAMEWORK_RECORDING_GL is defined, each visit is also recorded as a frame by 
+RecordingGL (draw calls, state changes and uploads of each type of renderable). Renderables that are not in a scene
+can be rendered the same way with renderRenderables (e.g. by the benchmarks, see Benchmarks/RenderBenchmark).
 
 NEXT OBJECT TO CHECK: Another part of the framework down... I am running out of ideas. 
 	Well... the real meat (related to 3D rendering) is mostly in the RenderComponents
@@ -17,15 +35,72 @@ NEXT OBJECT TO CHECK: Another part of the framework down... I am running out of
 #define _OPENGLFRAMEWORK_RENDERABLEVISITOR
 #include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
 #include <OpenGLFramework\Components\ISceneVisitor.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\RenderQueue.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\FrustumCuller.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderState.h>
+#include <OpenGLFramework\Components\RenderComponent\WorldTransformCache.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableRegistry.h>
+#include <chrono>
 
 namespace OpenGLFramework {
 	class IVirtualObject;			//Forward declaration
+	class OpenGL_Renderable;		//Forward declaration
 	class ISceneNode;				//Forward declaration
 
 	class RenderableVisitor : public ISceneVisitor{
+	public:
+		struct FrameStatistics {
+			unsigned int renderablesVisible;		//Renderables inside the camera's frustum (or not cullable)
+			unsigned int renderablesCulled;			//Renderables skipped, as they were outside the frustum
+			unsigned int drawsSubmitted;			//Draw calls issued (renderables drawn together by instancing count once)
+			unsigned int renderablesInstanced;		//Renderables drawn as part of an instanced draw call
+			unsigned int renderablesSimplified;		//Renderables drawing one of their simplified levels of detail
+			RenderState::Statistics stateChanges;	//State changes issued/saved while rendering them
+			double traversalSeconds;				//Part of submitSeconds spent visiting the tree (finding and queueing the renderables)
+			double submitSeconds;					//CPU time spent visiting the scene, culling, sorting and rendering it
+		};
+	private:
 		glm::mat4 P,  V;			//camera parameters used to render objects
+		RenderQueue queue;			//Renderables found during the traversal, waiting to be sorted and rendered
+		//Frustum culling: renderables that still need to be tested (their world space boxes are stored in the culler)
+		struct CullingCandidate {
+			OpenGL_Renderable* renderable;
+			float viewDepth;
+			float radius;			//Of the sphere around its world space box
+			glm::mat4 M;
+		};
+		bool frustumCulling;
+		float lodTolerance;
+		WorldTransformCache* worldTransforms;
+		RenderableRegistry* renderableRegistry;
+		FrustumCuller culler;
+		std::vector<CullingCandidate> candidates;
+		std::vector<unsigned char> visibility;
+		int visitDepth;				//How many visits are in progress (we submit the queue when the outermost one finishes)
+		FrameStatistics frameStats;
+		std::chrono::high_resolution_clock::time_point frameStart;
+		void beginFrame();
+		void submitQueue();
+		void visitRenderable(IVirtualObject* vo, OpenGL_Renderable* renderable, glm::mat4& M, bool& haveM);
+		void addRenderable(OpenGL_Renderable* renderable, const glm::mat4& M);
+		void queueRenderable(OpenGL_Renderable* renderable, float viewDepth, float radius, const glm::mat4& M);
 	public:
 		RenderableVisitor(glm::mat4 P, glm::mat4 V);
+		inline const FrameStatistics& getFrameStatistics() const { return frameStats; }
+		//Frustum culling is enabled by default.
+		inline void setFrustumCulling(bool enabled) { frustumCulling = enabled; }
+		//Error allowed on screen when choosing levels of detail, as a fraction of the screen's height (see LODSelector).
+		//By default, about a pixel on a 1080 pixel tall screen. 0 draws everything in full detail.
+		inline void setLevelOfDetailTolerance(float tolerance) { lodTolerance = tolerance; }
+		//World matrices of the objects of the scene (nodes created with the object as their owner). NULL by default: 
+		//objects compute their own. The visitor updates the cache before visiting the tree.
+		inline void setWorldTransforms(WorldTransformCache* cache) { worldTransforms = cache; }
+		//Renderables of the objects of the scene. NULL by default: objects are asked for their components. Objects
+		//missing from the registry are asked too.
+		inline void setRenderableRegistry(RenderableRegistry* registry) { renderableRegistry = registry; }
+		//Renders renderables that are not part of a scene (e.g. built by a tool or a benchmark), each with its model
+		//matrix, as one frame: they are culled, sorted and instanced like the renderables found in a scene.
+		void renderRenderables(OpenGL_Renderable* const* renderables, const glm::mat4* modelMatrices, size_t count);
 	protected://We extend here the behaviour of the base class
 		virtual bool visitVirtualObject(IVirtualObject* vo);
 		virtual bool visitSceneNode(ISceneNode* vo);
@@ -1,5 +1,8 @@
 #include <OpenGLFramework/Components/RenderComponent/SingleColourMesh_Renderable.h>
-#include <OpenGLFramework\3DUI_Utils\3DUI_Utils.h>
+#include <OpenGLFramework/Components/RenderComponent/ProgramCache.h>
+#include <OpenGLFramework/Components/RenderComponent/Profiler.h>
+#include <OpenGLFramework/Components/RenderComponent/MeshProcessing/IncrementalBounds.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
 
 using namespace OpenGLFramework;
 
@@ -7,7 +10,7 @@ using namespace OpenGLFramework;
 	//0. Copy data to our local buffer (in main memory~CPU)
 	g_vertex_buffer_data=new GLfloat[3*numVertex];
 	memcpy(g_vertex_buffer_data,vertex_buffer_data,3*numVertex*sizeof(GLfloat));
-	this->bb = ThreeDUI_Utils::createAABoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
+	this->bb = MeshStatistics::computeBoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
 }
 
 bool  SingleColourMesh_Renderable::loadResourcesToMainMemory(){
@@ -16,14 +19,19 @@ bool  SingleColourMesh_Renderable::loadResourcesToMainMemory(){
 }
 
 bool  SingleColourMesh_Renderable::allocateOpenGLResources(){
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("allocateOpenGLResources", getRenderableTypeName());
 	//0. Create and compile our GLSL program from the shaders
-	programID = ShaderManager::instance().LoadShaders("OpenGLFramework/shaders/ClipSpaceVertexShader.vertexshader", "OpenGLFramework/shaders/SingleColourFragmentShader.fragmentshader");
+	programID = ProgramCache::instance().acquireProgram("OpenGLFramework/shaders/ClipSpaceVertexShader.vertexshader", "OpenGLFramework/shaders/SingleColourFragmentShader.fragmentshader");
 	//1. Get a handle for the input attribute in our shader
-	vertexPosition_clipspaceID = glGetAttribLocation(programID, "vertexPosition_modelspace");
+	vertexPosition_clipspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexPosition_modelspace");
 	//2. Create a buffer in the GPU and load it with our data (it is still in main memory)
 	glGenBuffers(1, &vertexbuffer);
 	this->setVertices(numVertex, g_vertex_buffer_data);
-	//3. All ready to go in the GPU :)
+	//3. Create a VAO, which remembers how our buffer is fed to the shader's input attribute (see VertexFormat)
+	glGenVertexArrays(1, &vertexArrayID);
+	glBindVertexArray(vertexArrayID);
+	VertexFormat().add(vertexPosition_clipspaceID, 3).setupAttributes(vertexbuffer);
+	//4. All ready to go in the GPU :)
 	return true;
 
 }
@@ -32,36 +40,29 @@ bool  SingleColourMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 	if(!OpenGL_Renderable::render(P, V))return false;
 	
 	//1. Tell OpenGL to use our shader
-	glUseProgram(programID);
+	RenderState::instance().useProgram(programID);
 	
 	//2. We do not use MVP, this object works in clipspace coords...
-	// 2.1. Enable our 1st attribute: 
-	glEnableVertexAttribArray(vertexPosition_clipspaceID);
-	//2.2. Connect our attribute to the buffer of vertices (this will feed the data in the buffer to the shader's input attribute vertexPosition_clipspaceID)
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glVertexAttribPointer(
-		vertexPosition_clipspaceID,  // The attribute we want to configure
-		3,                            // size
-		GL_FLOAT,                     // type
-		GL_FALSE,                     // normalized?
-		0,                            // stride
-		(void*)0                      // array buffer offset
-	);
+	// 2.1. Bind our VAO. It connects our buffer of vertices to the shader's input attribute vertexPosition_clipspaceID
+	RenderState::instance().bindVertexArray(vertexArrayID);
+	// 2.2. Send the vertices changed since the last frame (only those, see updateVertices)
+	if (!dirtyVertices.empty()) {
+		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+		dirtyVertices.upload(GL_ARRAY_BUFFER, g_vertex_buffer_data, 3 * sizeof(GLfloat));
+	}
 	//3. Draw the mesh !
 	glDisable(GL_CULL_FACE);							//Play with this. It enables/disables back-face culling
 	glPointSize(5);										//If you are rendering points, this sets its size (in pixels)
 	glDrawArrays(getRenderPrimitive(), 0, numVertex);	//Actually render the stuff
 	glEnable(GL_CULL_FACE);								//Let's leave this on, it is generally a good idea
-	
-	//4. Let's disable our attribute now, we would not want someone to use it by accident.
-	glDisableVertexAttribArray(vertexPosition_clipspaceID);
 	return true;
 }
 
 bool  SingleColourMesh_Renderable::unallocateAllResources(){
 	// Cleanup what we allocated in the GPU: VBO and shader (the attribute handler vertexPosition_clipspaceID is part of the shader, will be deleted with it)
+	glDeleteVertexArrays(1, &vertexArrayID);
 	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteProgram(programID);
+	ProgramCache::instance().releaseProgram(programID);
 	return true;
 
 
@@ -72,5 +73,20 @@ void  SingleColourMesh_Renderable::setVertices(const int numVertex, const GLfloa
 	memcpy(g_vertex_buffer_data,vertex_buffer_data,3*numVertex*sizeof(GLfloat));
 	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
 	glBufferData(GL_ARRAY_BUFFER, 3*numVertex*sizeof(GLfloat), g_vertex_buffer_data, GL_DYNAMIC_DRAW);	
+	dirtyVertices.clear();	//Everything was uploaded
+	//Our geometry changed, so does our bounding box
+	this->bb = MeshStatistics::computeBoundingBox(numVertex, g_vertex_buffer_data);
+}
 
+bool SingleColourMesh_Renderable::updateVertices(int offset, int count, const GLfloat vertex_buffer_data[]) {
+	if (offset < 0 || count <= 0 || offset + count > numVertex)
+		return false;
+	GLfloat* changed = g_vertex_buffer_data + 3 * offset;
+	//The bounding box needs the old positions, so we update it before copying the new ones
+	bool boundsUpdated = IncrementalBounds::update(bb, changed, vertex_buffer_data, count);
+	memmove(changed, vertex_buffer_data, 3 * count*sizeof(GLfloat));
+	if (!boundsUpdated)		//A vertex on the surface of the box moved inwards: the box might need to shrink
+		this->bb = MeshStatistics::computeBoundingBox(numVertex, g_vertex_buffer_data);
+	dirtyVertices.add(offset, count);
+	return true;
 }
\ No newline at end of file
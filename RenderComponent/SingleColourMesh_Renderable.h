@@ -15,6 +15,8 @@ NEXT OBJECT TO CHECK: UnitPolygonTextured_Renderable
 #ifndef _OPENGL_MANUAL_SINGLECOLOUR
 #define _OPENGL_MANUAL_SINGLECOLOUR
 #include <OpenGLFramework/Components/RenderComponent/OpenGL_Renderable.h>
+#include <OpenGLFramework/Components/RenderComponent/VertexFormat.h>
+#include <OpenGLFramework/Components/RenderComponent/MeshProcessing/DirtyRanges.h>
 
 
 
@@ -30,17 +32,30 @@ namespace OpenGLFramework {
 		GLuint vertexPosition_clipspaceID;		//ID of the input attribute of the shader. This will allow us to tell OpenGL to feed our vertices into this shader's input attribute
 		//Data handlers
 		GLuint vertexbuffer;					//Identifies our buffer of vertices in the GPU. This will allow us to copy vertices from CPU to GPU and to feed them to the shader's attribute (vertexPosition_clipspaceID)
+		GLuint vertexArrayID;					//VAO: remembers how vertexbuffer is fed to vertexPosition_clipspaceID, so we do not need to configure it every frame
+		DirtyRanges dirtyVertices;				//Vertices changed by updateVertices, waiting to be uploaded to vertexbuffer
 
 
 	public:
 		//Own methods
 		SingleColourMesh_Renderable(const int numVertex, const GLfloat vertex_buffer_data[]);
 		void setVertices(const int numVertex, const GLfloat vertex_buffer_data[]);
+		/**
+			Changes count vertices, starting at vertex offset (the rest stay as they are). Only the vertices changed are sent 
+			to the GPU (in the next render), and the bounding box is updated incrementally (see IncrementalBounds).
+			Use it to edit parts of big meshes. Returns false if the range is outside the mesh.
+		*/
+		bool updateVertices(int offset, int count, const GLfloat vertex_buffer_data[]);
+		inline const DirtyRanges::Statistics& getUploadStatistics() const { return dirtyVertices.getStatistics(); }
 		//Methods inherited from base class OpenGL_Renderable
 		virtual bool loadResourcesToMainMemory();
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "SingleColourMesh_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getMesh() { return vertexArrayID; }
+		virtual bool isCullable() { return false; }	//We render in clip space coordinates (no MVP), so the camera's frustum does not apply
 	};
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\DynamicAABBTree.h>
+#include <algorithm>
+
+using namespace OpenGLFramework;
+
+DynamicAABBTree::DynamicAABBTree(float margin)
+	: root(NULL_NODE), freeList(NULL_NODE), proxyCount(0), margin(margin) {
+	;
+}
+
+void DynamicAABBTree::clear() {
+	nodes.clear();
+	root = freeList = NULL_NODE;
+	proxyCount = 0;
+}
+
+int DynamicAABBTree::allocateNode() {
+	if (freeList == NULL_NODE) {
+		//Grow the pool, chaining all the new nodes into the free list
+		int oldSize = (int)nodes.size(), newSize = std::max(16, oldSize * 2);
+		nodes.resize(newSize);
+		for (int i = oldSize; i < newSize; i++) {
+			nodes[i].parent = (i + 1 < newSize) ? i + 1 : NULL_NODE;
+			nodes[i].height = -1;
+		}
+		freeList = oldSize;
+	}
+	int id = freeList;
+	Node& n = nodes[id];
+	freeList = n.parent;
+	n.parent = n.child1 = n.child2 = NULL_NODE;
+	n.height = 0;
+	n.userData = NULL;
+	return id;
+}
+
+void DynamicAABBTree::freeNode(int node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+int DynamicAABBTree::createProxy(const AABB& box, void* userData) {
+	int id = allocateNode();
+	glm::vec3 m(margin);
+	nodes[id].box = AABB(box.min - m, box.max + m);
+	nodes[id].userData = userData;
+	insertLeaf(id);
+	proxyCount++;
+	return id;
+}
+
+void DynamicAABBTree::destroyProxy(int proxyId) {
+	removeLeaf(proxyId);
+	freeNode(proxyId);
+	proxyCount--;
+}
+
+bool DynamicAABBTree::moveProxy(int proxyId, const AABB& box) {
+	if (nodes[proxyId].box.contains(box))
+		return false;	//Still inside its fat box: nothing to do
+	removeLeaf(proxyId);
+	glm::vec3 m(margin);
+	nodes[proxyId].box = AABB(box.min - m, box.max + m);
+	insertLeaf(proxyId);
+	return true;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf) {
+	if (root == NULL_NODE) {
+		root = leaf;
+		nodes[root].parent = NULL_NODE;
+		return;
+	}
+	//1. Find the best sibling, descending towards the child where the leaf increases the surface area the least.
+	AABB leafBox = nodes[leaf].box;
+	int index = root;
+	while (!nodes[index].isLeaf()) {
+		int child1 = nodes[index].child1, child2 = nodes[index].child2;
+		float area = nodes[index].box.surfaceArea();
+		float combinedArea = AABB::merge(nodes[index].box, leafBox).surfaceArea();
+		//Cost of creating a new parent for this node and the new leaf
+		float cost = 2 * combinedArea;
+		//Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2 * (combinedArea - area);
+		float cost1 = AABB::merge(leafBox, nodes[child1].box).surfaceArea() + inheritanceCost;
+		if (!nodes[child1].isLeaf()) cost1 -= nodes[child1].box.surfaceArea();
+		float cost2 = AABB::merge(leafBox, nodes[child2].box).surfaceArea() + inheritanceCost;
+		if (!nodes[child2].isLeaf()) cost2 -= nodes[child2].box.surfaceArea();
+		if (cost < cost1 && cost < cost2) break;
+		index = (cost1 < cost2) ? child1 : child2;
+	}
+	int sibling = index;
+
+	//2. Create a new parent for the sibling and the leaf
+	int oldParent = nodes[sibling].parent;
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = AABB::merge(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+	if (oldParent != NULL_NODE) {
+		if (nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+		else nodes[oldParent].child2 = newParent;
+	}
+	else root = newParent;
+
+	//3. Walk back up, fixing heights and boxes (and rebalancing)
+	refitAncestors(nodes[leaf].parent);
+}
+
+void DynamicAABBTree::refitAncestors(int index) {
+	while (index != NULL_NODE) {
+		index = balance(index);
+		int child1 = nodes[index].child1, child2 = nodes[index].child2;
+		nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+		nodes[index].box = AABB::merge(nodes[child1].box, nodes[child2].box);
+		index = nodes[index].parent;
+	}
+}
+
+void DynamicAABBTree::removeLeaf(int leaf) {
+	if (leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+	//The parent of the leaf disappears, and the sibling takes its place
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+	if (grandParent != NULL_NODE) {
+		if (nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+		else nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refitAncestors(grandParent);
+	}
+	else {
+		root = sibling;
+		nodes[sibling].parent = NULL_NODE;
+		freeNode(parent);
+	}
+}
+
+/**
+	If the subtrees of node A differ in height by more than one, the tallest child (C) is rotated up, taking A's place:
+	      A              C
+	    /   \          /   \
+	   B     C   =>   A    F/G
+	        / \      / \
+	       F   G    B  G/F
+	Returns the index of the node now at the top of this subtree.
+*/
+int DynamicAABBTree::balance(int iA) {
+	Node& A = nodes[iA];
+	if (A.isLeaf() || A.height < 2) return iA;
+	int iB = A.child1, iC = A.child2;
+	int heightDifference = nodes[iC].height - nodes[iB].height;
+	if (heightDifference > 1) return rotate(iA, iC, iB);
+	if (heightDifference < -1) return rotate(iA, iB, iC);
+	return iA;
+}
+
+/**
+	Moves "up" (a child of A) in place of A. A keeps its other child (other) and the smallest child of up.
+*/
+int DynamicAABBTree::rotate(int iA, int iUp, int iOther) {
+	Node& A = nodes[iA];
+	Node& U = nodes[iUp];
+	int iF = U.child1, iG = U.child2;
+	//U takes A's place
+	U.child1 = iA;
+	U.parent = A.parent;
+	A.parent = iUp;
+	if (U.parent != NULL_NODE) {
+		if (nodes[U.parent].child1 == iA) nodes[U.parent].child1 = iUp;
+		else nodes[U.parent].child2 = iUp;
+	}
+	else root = iUp;
+	//The tallest child of U stays with U; the other one goes to A, replacing U
+	int keep = iF, give = iG;
+	if (nodes[iF].height < nodes[iG].height) { keep = iG; give = iF; }
+	U.child2 = keep;
+	if (A.child1 == iUp) A.child1 = give;
+	else A.child2 = give;
+	nodes[give].parent = iA;
+	A.box = AABB::merge(nodes[iOther].box, nodes[give].box);
+	A.height = 1 + std::max(nodes[iOther].height, nodes[give].height);
+	U.box = AABB::merge(A.box, nodes[keep].box);
+	U.height = 1 + std::max(A.height, nodes[keep].height);
+	return iUp;
+}
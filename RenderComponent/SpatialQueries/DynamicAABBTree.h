@@ -0,0 +1,195 @@
+/**********************************************************************
+NAME: DynamicAABBTree
+DESCRIPTION: Bounding volume hierarchy (BVH) of axis aligned boxes that can change over time. Each box (a "proxy")
+	is a leaf of a binary tree; every internal node stores the box containing its two children. Queries (boxes, rays,
+	nearest object) only descend into the nodes whose box can contain an answer, so they take logarithmic time
+	instead of testing every object.
+	Leaves store a slightly enlarged ("fat") box. Objects that move a little stay inside their fat box and the tree 
+	does not need to change at all; when they leave it, the leaf is removed and reinserted. Insertions pick the 
+	sibling that increases the total surface area the least, and rotations keep the tree balanced.
+	This is the same structure used by most physics engines for their broad phase (e.g. Box2D's dynamic tree).
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_DYNAMICAABBTREE
+#define _OPENGLFRAMEWORK_DYNAMICAABBTREE
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <cfloat>
+
+namespace OpenGLFramework {
+	struct AABB {
+		glm::vec3 min, max;
+		AABB() { ; }
+		AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) { ; }
+		inline bool contains(const AABB& other) const {
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+		}
+		inline bool overlaps(const AABB& other) const {
+			return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y
+				&& min.z <= other.max.z && other.min.z <= max.z;
+		}
+		inline float surfaceArea() const {
+			glm::vec3 d = max - min;
+			return 2 * (d.x*d.y + d.y*d.z + d.z*d.x);
+		}
+		inline static AABB merge(const AABB& a, const AABB& b) { return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max)); }
+		/**
+			Slab test. Returns the distance (along dir) where the ray enters the box, or -1 if it misses it (or the hit is beyond maxT).
+			invDir must be 1/dir (computed once per ray).
+		*/
+		inline float intersectRay(const glm::vec3& origin, const glm::vec3& invDir, float maxT) const {
+			float tmin = 0, tmax = maxT;
+			for (int i = 0; i < 3; i++) {
+				float t1 = (min[i] - origin[i]) * invDir[i];
+				float t2 = (max[i] - origin[i]) * invDir[i];
+				if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
+				if (t1 > tmin) tmin = t1;
+				if (t2 < tmax) tmax = t2;
+				if (tmin > tmax) return -1;
+			}
+			return tmin;
+		}
+		//Squared distance from a point to the box (0 if inside)
+		inline float distanceSquared(const glm::vec3& p) const {
+			glm::vec3 d = glm::max(glm::max(min - p, p - max), glm::vec3(0.0f));
+			return glm::dot(d, d);
+		}
+	};
+
+	class DynamicAABBTree {
+		static const int NULL_NODE = -1;
+		struct Node {
+			AABB box;
+			void* userData;
+			int parent;			//Also used as "next" in the list of free nodes
+			int child1, child2;
+			int height;			//Leaves have height 0, free nodes -1
+			inline bool isLeaf() const { return child1 == NULL_NODE; }
+		};
+		std::vector<Node> nodes;
+		int root, freeList;
+		int proxyCount;
+		float margin;			//How much we enlarge the boxes of the leaves
+
+		int allocateNode();
+		void freeNode(int node);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		void refitAncestors(int node);
+		int balance(int node);
+		int rotate(int node, int up, int other);
+	public:
+		DynamicAABBTree(float margin = 0.1f);
+		/**
+			Creates a proxy for an object with the given box. Returns its id (used to move or destroy it).
+		*/
+		int createProxy(const AABB& box, void* userData);
+		void destroyProxy(int proxyId);
+		/**
+			Updates the box of a proxy. The tree only changes if the new box is not inside the fat box of the proxy.
+			Returns true if the proxy was reinserted.
+		*/
+		bool moveProxy(int proxyId, const AABB& box);
+		inline void* getUserData(int proxyId) const { return nodes[proxyId].userData; }
+		inline const AABB& getFatBox(int proxyId) const { return nodes[proxyId].box; }
+		inline int getProxyCount() const { return proxyCount; }
+		inline int getHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+		void clear();
+
+		/**
+			Calls callback(proxyId) for each proxy whose fat box overlaps box. The callback returns false to stop the query.
+		*/
+		template <class Callback> void queryBox(const AABB& box, Callback callback) const {
+			if (root == NULL_NODE) return;
+			int stackBuffer[128];
+			std::vector<int> bigStack;
+			int* stack = stackBuffer; int top = 0, capacity = 128;
+			stack[top++] = root;
+			while (top > 0) {
+				const Node& n = nodes[stack[--top]];
+				if (!n.box.overlaps(box)) continue;
+				if (n.isLeaf()) {
+					if (!callback((int)(&n - &nodes[0]))) return;
+				}
+				else {
+					if (top + 2 > capacity) {	//Very unbalanced trees: move the stack to the heap
+						std::vector<int> grown(stack, stack + top); grown.resize(2 * capacity);
+						bigStack.swap(grown);
+						stack = &bigStack[0]; capacity *= 2;
+					}
+					stack[top++] = n.child1;
+					stack[top++] = n.child2;
+				}
+			}
+		}
+
+		/**
+			Casts a ray (origin + t*dir, 0<=t<=maxT) through the tree. For each proxy whose fat box the ray crosses, 
+			callback(proxyId, maxT) is called; it returns the new maxT: the distance to the closest hit found so far
+			(which prunes the rest of the search), maxT to keep going unchanged, or 0 to stop.
+			Closer nodes are visited first.
+		*/
+		template <class Callback> void rayCast(const glm::vec3& origin, const glm::vec3& dir, float maxT, Callback callback) const {
+			if (root == NULL_NODE) return;
+			glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+			int stackBuffer[128];			//Rays are cast in large numbers (e.g. by the RayTracer): avoid allocating memory for each
+			std::vector<int> bigStack;
+			int* stack = stackBuffer; int top = 0, capacity = 128;
+			stack[top++] = root;
+			while (top > 0 && maxT > 0) {
+				int id = stack[--top];
+				const Node& n = nodes[id];
+				if (n.box.intersectRay(origin, invDir, maxT) < 0) continue;
+				if (n.isLeaf()) {
+					maxT = callback(id, maxT);
+					continue;
+				}
+				//Push the farthest child first, so that the closest one is processed first
+				float t1 = nodes[n.child1].box.intersectRay(origin, invDir, maxT);
+				float t2 = nodes[n.child2].box.intersectRay(origin, invDir, maxT);
+				if (top + 2 > capacity) {
+					std::vector<int> grown(stack, stack + top); grown.resize(2 * capacity);
+					bigStack.swap(grown);
+					stack = &bigStack[0]; capacity *= 2;
+				}
+				if (t1 >= 0 && t2 >= 0) {
+					if (t1 < t2) { stack[top++] = n.child2; stack[top++] = n.child1; }
+					else { stack[top++] = n.child1; stack[top++] = n.child2; }
+				}
+				else if (t1 >= 0) stack[top++] = n.child1;
+				else if (t2 >= 0) stack[top++] = n.child2;
+			}
+		}
+
+		/**
+			Finds the closest proxy to point p. distanceSquared(proxyId) must return the squared distance from p
+			to the actual object (it can be larger than the distance to its fat box). Returns -1 if the tree is empty.
+		*/
+		template <class Distance> int nearest(const glm::vec3& p, Distance distanceSquared, float* outDistanceSquared = NULL) const {
+			if (root == NULL_NODE) return -1;
+			typedef std::pair<float, int> Entry;	//(lower bound of the distance, node)
+			std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+			open.push(Entry(nodes[root].box.distanceSquared(p), root));
+			int best = -1;
+			float bestDistance = FLT_MAX;
+			while (!open.empty() && open.top().first < bestDistance) {
+				int id = open.top().second; open.pop();
+				const Node& n = nodes[id];
+				if (n.isLeaf()) {
+					float d = distanceSquared(id);
+					if (d < bestDistance) { bestDistance = d; best = id; }
+				}
+				else {
+					open.push(Entry(nodes[n.child1].box.distanceSquared(p), n.child1));
+					open.push(Entry(nodes[n.child2].box.distanceSquared(p), n.child2));
+				}
+			}
+			if (outDistanceSquared) *outDistanceSquared = bestDistance;
+			return best;
+		}
+	};
+};
+#endif
@@ -0,0 +1,138 @@
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\MeshPicker.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\SceneNodes\IVirtualObject.h>
+#include <chrono>
+
+using namespace OpenGLFramework;
+
+namespace {
+	double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+};
+
+MeshPicker::MeshPicker() {
+	resetStatistics();
+}
+
+MeshPicker& MeshPicker::instance() {
+	static MeshPicker picker;
+	return picker;
+}
+
+std::shared_ptr<const TriangleBVH> MeshPicker::getBVH(const std::shared_ptr<const MeshData>& mesh) {
+	if (!mesh)
+		return std::shared_ptr<const TriangleBVH>();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<const MeshData*, Entry>::iterator it = bvhs.find(mesh.get());
+		if (it != bvhs.end() && it->second.mesh.lock() == mesh)
+			return it->second.bvh;
+	}
+	//Build it without holding the lock (big meshes take a while, and other meshes can still be picked meanwhile)
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	std::shared_ptr<TriangleBVH> bvh(new TriangleBVH());
+	bvh->build(*mesh);
+	double seconds = secondsSince(start);
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::map<const MeshData*, Entry>::iterator it = bvhs.begin(); it != bvhs.end();) {	//BVHs of meshes nobody uses any more
+		if (it->second.mesh.expired() && it->first != mesh.get())
+			bvhs.erase(it++);
+		else it++;
+	}
+	Entry& e = bvhs[mesh.get()];
+	if (e.mesh.lock() == mesh)		//Another thread built it at the same time. Use theirs.
+		return e.bvh;
+	e.mesh = mesh;
+	e.bvh = bvh;
+	stats.builds++;
+	stats.buildSeconds += seconds;
+	return e.bvh;
+}
+
+bool MeshPicker::prepare(OpenGL_Renderable* renderable) {
+	return getBVH(renderable->getMeshData()) != NULL;
+}
+
+void MeshPicker::fillHit(const MeshData& mesh, const TriangleBVH::Hit& bvhHit, Hit& hit) {
+	unsigned int i0 = mesh.indices[3 * bvhHit.triangle], i1 = mesh.indices[3 * bvhHit.triangle + 1], i2 = mesh.indices[3 * bvhHit.triangle + 2];
+	hit.triangle = bvhHit.triangle;
+	hit.barycentric = glm::vec3(1 - bvhHit.u - bvhHit.v, bvhHit.u, bvhHit.v);
+	hit.localPosition = hit.barycentric.x * mesh.vertices[i0] + hit.barycentric.y * mesh.vertices[i1] + hit.barycentric.z * mesh.vertices[i2];
+	hit.uv = glm::vec2(0, 0);
+	if (mesh.uvs.size() == mesh.vertices.size())
+		hit.uv = hit.barycentric.x * mesh.uvs[i0] + hit.barycentric.y * mesh.uvs[i1] + hit.barycentric.z * mesh.uvs[i2];
+}
+
+bool MeshPicker::pickLocal(const std::shared_ptr<const MeshData>& mesh, glm::vec3 origin, glm::vec3 dir, Hit& hit, float maxDistance) {
+	std::shared_ptr<const TriangleBVH> bvh = getBVH(mesh);
+	if (!bvh)
+		return false;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	TriangleBVH::Hit bvhHit;
+	bool found = bvh->intersect(origin, dir, maxDistance, bvhHit);
+	if (found) {
+		fillHit(*mesh, bvhHit, hit);
+		hit.distance = bvhHit.t;
+		hit.position = hit.localPosition;
+	}
+	double seconds = secondsSince(start);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.picks++;
+	stats.pickSeconds += seconds;
+	return found;
+}
+
+bool MeshPicker::pick(OpenGL_Renderable* renderable, glm::vec3 origin, glm::vec3 dir, Hit& hit, float maxDistance) {
+	if (!renderable->getOwner())
+		return false;
+	std::shared_ptr<const MeshData> mesh = renderable->getMeshData();
+	//The ray in the coordinates of the mesh. The direction is not normalized, so distances along it mean the same in both spaces
+	glm::mat4 M = renderable->getOwner()->getFromObjectToWorldCoordinates();
+	glm::mat4 invM = glm::inverse(M);
+	glm::vec3 localOrigin(invM * glm::vec4(origin, 1)), localDir(invM * glm::vec4(dir, 0));
+	if (!pickLocal(mesh, localOrigin, localDir, hit, maxDistance))
+		return false;
+	hit.position = glm::vec3(M * glm::vec4(hit.localPosition, 1));
+	return true;
+}
+
+void MeshPicker::removeUnusedMeshes() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<const MeshData*, Entry>::iterator it = bvhs.begin();
+	while (it != bvhs.end()) {
+		if (it->second.mesh.expired())
+			bvhs.erase(it++);
+		else it++;
+	}
+}
+
+void MeshPicker::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	bvhs.clear();
+}
+
+MeshPicker::Statistics MeshPicker::getStatistics() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	Statistics s = stats;
+	s.meshes = 0; s.triangles = 0; s.bytes = 0;
+	for (std::map<const MeshData*, Entry>::const_iterator it = bvhs.begin(); it != bvhs.end(); it++) {
+		if (it->second.mesh.expired())
+			continue;
+		s.meshes++;
+		s.triangles += it->second.bvh->getTriangleCount();
+		s.bytes += it->second.bvh->getSizeInBytes();
+	}
+	return s;
+}
+
+void MeshPicker::resetStatistics() {
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.meshes = 0;
+	stats.triangles = 0;
+	stats.bytes = 0;
+	stats.builds = 0;
+	stats.buildSeconds = 0;
+	stats.picks = 0;
+	stats.pickSeconds = 0;
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+NAME: MeshPicker
+DESCRIPTION: Picks the exact triangle of a mesh hit by a ray (e.g. the ray under the mouse cursor). 
+	rayCastingCollision/isInsideBB (3DUI_Utils) and SceneBVH only test bounding boxes, which is not enough for concave 
+	or sparse meshes (a click between the legs of a chair hits its box, but not the chair). 
+	The MeshPicker tests the triangles of the renderable (see OpenGL_Renderable::getMeshData), using a TriangleBVH, 
+	so even meshes with millions of triangles are picked in microseconds. The BVH of a mesh is built the first time 
+	it is picked (or when prepare() is called) and shared by all the renderables using that mesh.
+	It returns the triangle hit, its barycentric coordinates, the interpolated UV (e.g. to paint on the texture) and 
+	the distance along the ray. SceneBVH::pickTriangle uses it to pick among all the objects of a scene.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_MESHPICKER
+#define _OPENGLFRAMEWORK_MESHPICKER
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\RenderComponent\RayTracing\TriangleBVH.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cfloat>
+
+namespace OpenGLFramework {
+	class OpenGL_Renderable;		//Forward declaration
+
+	class MeshPicker {
+	public:
+		struct Hit {
+			float distance;				//Along the ray: hit point = origin + distance*dir (world units, if dir is normalized)
+			unsigned int triangle;		//Index of the triangle (mesh indices[3*triangle ... 3*triangle+2])
+			glm::vec3 barycentric;		//Weights of the three vertices of the triangle at the hit point
+			glm::vec2 uv;				//Texture coordinates at the hit point ((0,0) if the mesh has no UVs)
+			glm::vec3 localPosition;	//Hit point, in the coordinates of the mesh
+			glm::vec3 position;			//Hit point, in world coordinates
+		};
+		struct Statistics {
+			unsigned int meshes;		//Meshes with a BVH built
+			size_t triangles;			//Triangles in those meshes
+			size_t bytes;				//Memory used by their BVHs
+			unsigned int builds;		//BVHs built (since the last resetStatistics)
+			double buildSeconds;
+			unsigned int picks;
+			double pickSeconds;			//Time spent picking (without building BVHs)
+		};
+	private:
+		struct Entry {
+			std::weak_ptr<const MeshData> mesh;		//To know if the mesh is gone (and its address reused by another one)
+			std::shared_ptr<const TriangleBVH> bvh;
+		};
+		std::map<const MeshData*, Entry> bvhs;
+		mutable std::mutex mutex;
+		Statistics stats;
+		MeshPicker();
+		MeshPicker(const MeshPicker&);
+		MeshPicker& operator=(const MeshPicker&);
+		//Fills in everything but distance and position
+		static void fillHit(const MeshData& mesh, const TriangleBVH::Hit& bvhHit, Hit& hit);
+	public:
+		static MeshPicker& instance();
+		/**
+			BVH of a mesh, built now if it was not built yet. It is kept while the mesh exists.
+		*/
+		std::shared_ptr<const TriangleBVH> getBVH(const std::shared_ptr<const MeshData>& mesh);
+		/**
+			Builds the BVH of the renderable's mesh in advance, so the first pick is not slower (e.g. when the model is loaded).
+			Returns false if the renderable cannot describe its geometry (see OpenGL_Renderable::getMeshData).
+		*/
+		bool prepare(OpenGL_Renderable* renderable);
+		/**
+			Closest triangle of the mesh hit by the ray origin + t*dir, with t in (0, maxDistance). The ray is in the 
+			coordinates of the mesh. Returns false if no triangle is hit.
+		*/
+		bool pickLocal(const std::shared_ptr<const MeshData>& mesh, glm::vec3 origin, glm::vec3 dir, Hit& hit, float maxDistance = FLT_MAX);
+		/**
+			Same, for a renderable attached to an object, with the ray in world coordinates.
+		*/
+		bool pick(OpenGL_Renderable* renderable, glm::vec3 origin, glm::vec3 dir, Hit& hit, float maxDistance = FLT_MAX);
+		/**
+			Forgets the BVHs of the meshes no longer used by anyone (or all of them).
+		*/
+		void removeUnusedMeshes();
+		void clear();
+		Statistics getStatistics() const;
+		void resetStatistics();
+	};
+};
+#endif
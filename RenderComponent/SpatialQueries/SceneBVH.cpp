@@ -0,0 +1,208 @@
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\SceneBVH.h>
+#include <OpenGLFramework\Components\RenderComponent\RenderableVisitor\FrustumCuller.h>
+#include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\SceneNodes\IVirtualObject.h>
+#include <OpenGLFramework\SceneNodes\IScenenode.h>
+#include <cmath>
+
+using namespace OpenGLFramework;
+
+SceneBVH::SceneBVH(float margin) : tree(margin), currentVisit(0), visitDepth(0) {
+	resetStatistics();
+}
+
+bool SceneBVH::computeWorldBox(IVirtualObject* vo, AABB& box) {
+	std::list<IComponent*> l = vo->getAllComponentsOfType("Renderable");
+	bool found = false;
+	glm::mat4 M;
+	for (std::list<IComponent*>::iterator it = l.begin(); it != l.end(); it++) {
+		OpenGL_Renderable* renderable = dynamic_cast<OpenGL_Renderable*>(*it);
+		if (!renderable || !renderable->isEnabled())
+			continue;
+		if (!found) M = vo->getFromObjectToWorldCoordinates();
+		glm::vec3 centre, extent;
+		FrustumCuller::transformBox(renderable->getLocalBoundingBox(), M, centre, extent);
+		AABB b(centre - extent, centre + extent);
+		box = found ? AABB::merge(box, b) : b;
+		found = true;
+	}
+	return found;
+}
+
+bool SceneBVH::addObject(IVirtualObject* vo) {
+	if (objects.find(vo) != objects.end())
+		return updateObject(vo);
+	AABB box;
+	if (!computeWorldBox(vo, box))
+		return false;
+	Entry& e = objects[vo];
+	e.object = vo;
+	e.box = box;
+	e.proxyId = tree.createProxy(box, &e);
+	e.lastSeen = currentVisit;
+	return true;
+}
+
+bool SceneBVH::removeObject(IVirtualObject* vo) {
+	std::map<IVirtualObject*, Entry>::iterator it = objects.find(vo);
+	if (it == objects.end())
+		return false;
+	tree.destroyProxy(it->second.proxyId);
+	objects.erase(it);
+	return true;
+}
+
+bool SceneBVH::updateObject(IVirtualObject* vo) {
+	std::map<IVirtualObject*, Entry>::iterator it = objects.find(vo);
+	if (it == objects.end())
+		return addObject(vo);
+	Entry& e = it->second;
+	e.lastSeen = currentVisit;
+	if (!computeWorldBox(vo, e.box)) {	//Its renderables were removed (or disabled)
+		removeObject(vo);
+		return false;
+	}
+	stats.updates++;
+	if (tree.moveProxy(e.proxyId, e.box))
+		stats.reinsertions++;
+	return true;
+}
+
+void SceneBVH::refit() {
+	std::vector<IVirtualObject*> all;
+	all.reserve(objects.size());
+	for (std::map<IVirtualObject*, Entry>::iterator it = objects.begin(); it != objects.end(); it++)
+		all.push_back(it->first);
+	for (size_t i = 0; i < all.size(); i++)
+		updateObject(all[i]);
+}
+
+unsigned int SceneBVH::removeStaleObjects() {
+	unsigned int removed = 0;
+	std::map<IVirtualObject*, Entry>::iterator it = objects.begin();
+	while (it != objects.end()) {
+		if (it->second.lastSeen != currentVisit) {
+			tree.destroyProxy(it->second.proxyId);
+			objects.erase(it++);
+			removed++;
+		}
+		else it++;
+	}
+	return removed;
+}
+
+void SceneBVH::clear() {
+	tree.clear();
+	objects.clear();
+}
+
+bool SceneBVH::visitVirtualObject(IVirtualObject* vo) {
+	if (visitDepth == 0) currentVisit++;	//Visiting a single object
+	updateObject(vo);
+	return true;
+}
+
+bool SceneBVH::visitSceneNode(ISceneNode* node) {
+	if (visitDepth == 0) currentVisit++;	//A new visit to the scene starts
+	visitDepth++;
+	std::map<unsigned int, IVirtualObject*>& children = node->getAllChildren();
+	std::map<unsigned int, IVirtualObject*>::iterator it = children.begin();
+	for (; it != children.end(); it++)
+		it->second->visit(*((ISceneVisitor*)this));
+	visitDepth--;
+	return true;
+}
+
+IVirtualObject* SceneBVH::rayCast(glm::vec3 origin, glm::vec3 dir, float& distance, float maxDistance) const {
+	const Entry* closest = NULL;
+	float closestT = maxDistance;
+	const DynamicAABBTree& tree = this->tree;
+	glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	//The tree only knows about the fat boxes. We test the exact box of the objects it finds.
+	tree.rayCast(origin, dir, maxDistance, [&](int proxyId, float maxT) -> float {
+		const Entry* e = (const Entry*)tree.getUserData(proxyId);
+		float t = e->box.intersectRay(origin, invDir, maxT);
+		if (t < 0) return maxT;
+		closest = e;
+		closestT = t;
+		return t;	//Only objects closer than this one matter from now on
+	});
+	if (!closest) return NULL;
+	distance = closestT;
+	return closest->object;
+}
+
+IVirtualObject* SceneBVH::pickTriangle(glm::vec3 origin, glm::vec3 dir, MeshPicker::Hit& hit, OpenGL_Renderable** renderable, float maxDistance) const {
+	const Entry* closest = NULL;
+	OpenGL_Renderable* closestRenderable = NULL;
+	const DynamicAABBTree& tree = this->tree;
+	glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	//Objects are visited closest (box) first. Each triangle hit shortens the ray, so objects behind it are skipped
+	tree.rayCast(origin, dir, maxDistance, [&](int proxyId, float maxT) -> float {
+		const Entry* e = (const Entry*)tree.getUserData(proxyId);
+		float boxT = e->box.intersectRay(origin, invDir, maxT);
+		if (boxT < 0) return maxT;
+		std::list<IComponent*> l = e->object->getAllComponentsOfType("Renderable");
+		for (std::list<IComponent*>::iterator it = l.begin(); it != l.end(); it++) {
+			OpenGL_Renderable* r = dynamic_cast<OpenGL_Renderable*>(*it);
+			if (!r || !r->isEnabled())
+				continue;
+			MeshPicker::Hit candidate;
+			if (r->getMeshData()) {
+				if (!MeshPicker::instance().pick(r, origin, dir, candidate, maxT))
+					continue;
+			}
+			else {	//No geometry to test: its box will have to do
+				candidate.distance = boxT;
+				candidate.triangle = (unsigned int)-1;
+				candidate.barycentric = glm::vec3(0);
+				candidate.uv = glm::vec2(0);
+				candidate.position = candidate.localPosition = origin + boxT * dir;
+			}
+			closest = e;
+			closestRenderable = r;
+			hit = candidate;
+			maxT = candidate.distance;
+		}
+		return maxT;
+	});
+	if (!closest) return NULL;
+	if (renderable) *renderable = closestRenderable;
+	return closest->object;
+}
+
+void SceneBVH::queryBox(const BoundingBox& bb, std::vector<IVirtualObject*>& result) const {
+	AABB box(glm::vec3(bb.xmin, bb.ymin, bb.zmin), glm::vec3(bb.xmax, bb.ymax, bb.zmax));
+	const DynamicAABBTree& tree = this->tree;
+	tree.queryBox(box, [&](int proxyId) -> bool {
+		const Entry* e = (const Entry*)tree.getUserData(proxyId);
+		if (e->box.overlaps(box))
+			result.push_back(e->object);
+		return true;
+	});
+}
+
+IVirtualObject* SceneBVH::nearestObject(glm::vec3 p, float& distance) const {
+	const DynamicAABBTree& tree = this->tree;
+	float distanceSquared;
+	int proxyId = tree.nearest(p, [&](int proxyId) -> float {
+		return ((const Entry*)tree.getUserData(proxyId))->box.distanceSquared(p);
+	}, &distanceSquared);
+	if (proxyId < 0) return NULL;
+	distance = sqrtf(distanceSquared);
+	return ((const Entry*)tree.getUserData(proxyId))->object;
+}
+
+SceneBVH::Statistics SceneBVH::getStatistics() const {
+	Statistics s = stats;
+	s.objects = (unsigned int)objects.size();
+	s.treeHeight = tree.getHeight();
+	return s;
+}
+
+void SceneBVH::resetStatistics() {
+	stats.objects = 0;
+	stats.reinsertions = 0;
+	stats.updates = 0;
+	stats.treeHeight = 0;
+}
@@ -0,0 +1,99 @@
+/**********************************************************************
+NAME: SceneBVH
+DESCRIPTION: Keeps the world space bounding boxes of the objects in our scene in a DynamicAABBTree, so that we can
+	pick objects with a ray, or find the objects in a region (or closest to a point) without testing them one by one.
+	The box of an object is the union of the local bounding boxes of its Renderables, transformed to world coordinates.
+	SceneBVH is a visitor: visiting a scene with it (scene->visit(bvh)) adds the objects it did not know about and 
+	updates the boxes of the ones that moved. Call removeStaleObjects() after that visit to forget objects no longer in the
+	scene. Alternatively, objects can be managed one by one (addObject, removeObject, updateObject).
+	Objects that only move a bit stay inside the (slightly larger) box stored in the tree, so updating them is very cheap.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_SCENEBVH
+#define _OPENGLFRAMEWORK_SCENEBVH
+#include <OpenGLFramework\OpenGLFRameworkPrerequisites.h>
+#include <OpenGLFramework\Components\ISceneVisitor.h>
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\DynamicAABBTree.h>
+#include <OpenGLFramework\Components\RenderComponent\SpatialQueries\MeshPicker.h>
+#include <map>
+
+namespace OpenGLFramework {
+	class IVirtualObject;			//Forward declaration
+	class ISceneNode;				//Forward declaration
+	class OpenGL_Renderable;		//Forward declaration
+
+	class SceneBVH : public ISceneVisitor {
+		struct Entry {
+			IVirtualObject* object;
+			int proxyId;
+			AABB box;				//Exact world box (the tree stores a fattened one)
+			unsigned int lastSeen;	//Visit in which we last found the object in the scene
+		};
+		DynamicAABBTree tree;	//The user data of each proxy points to its Entry (std::map does not move its elements)
+		std::map<IVirtualObject*, Entry> objects;
+		unsigned int currentVisit;
+		int visitDepth;
+	public:
+		struct Statistics {
+			unsigned int objects;		//Objects in the tree
+			unsigned int reinsertions;	//Updates that had to modify the tree (since the last resetStatistics)
+			unsigned int updates;		//Updates (of any kind)
+			int treeHeight;
+		};
+	private:
+		Statistics stats;
+	public:
+		/**
+			margin: distance (in world units) we enlarge the boxes by. Objects can move this far without modifying the tree.
+		*/
+		SceneBVH(float margin = 0.1f);
+		/**
+			Computes the world space box of an object (the union of its enabled Renderables' boxes). 
+			Returns false if the object has no Renderables.
+		*/
+		static bool computeWorldBox(IVirtualObject* vo, AABB& box);
+		bool addObject(IVirtualObject* vo);
+		bool removeObject(IVirtualObject* vo);
+		/**
+			Recomputes the box of an object (call it when the object moves). Adds it if we did not know about it.
+		*/
+		bool updateObject(IVirtualObject* vo);
+		/**
+			Updates the boxes of all the objects in the tree.
+		*/
+		void refit();
+		/**
+			Removes the objects that were not found during the last visit to the scene. Returns how many objects were removed.
+		*/
+		unsigned int removeStaleObjects();
+		void clear();
+
+		/**
+			Returns the first object hit by the ray origin + t*dir (or NULL), and the distance (t) to its box.
+		*/
+		IVirtualObject* rayCast(glm::vec3 origin, glm::vec3 dir, float& distance, float maxDistance = FLT_MAX) const;
+		/**
+			Returns the first object whose triangles are hit by the ray (or NULL), with the renderable and triangle hit (see MeshPicker).
+			Boxes only tell which objects to test: rays through the holes of an object reach the objects behind it. 
+			Renderables that cannot describe their geometry (see OpenGL_Renderable::getMeshData) are picked by their box 
+			(hit.triangle is then -1).
+		*/
+		IVirtualObject* pickTriangle(glm::vec3 origin, glm::vec3 dir, MeshPicker::Hit& hit, OpenGL_Renderable** renderable = NULL, float maxDistance = FLT_MAX) const;
+		/**
+			Adds to result all the objects whose box overlaps the (world space) box.
+		*/
+		void queryBox(const BoundingBox& box, std::vector<IVirtualObject*>& result) const;
+		/**
+			Returns the object whose box is closest to point p (or NULL if the tree is empty), and the distance to it.
+		*/
+		IVirtualObject* nearestObject(glm::vec3 p, float& distance) const;
+		inline const DynamicAABBTree& getTree() const { return tree; }
+		Statistics getStatistics() const;
+		void resetStatistics();
+
+		//ISceneVisitor interface
+		virtual bool visitVirtualObject(IVirtualObject* vo);
+		virtual bool visitSceneNode(ISceneNode* vo);
+	};
+};
+#endif
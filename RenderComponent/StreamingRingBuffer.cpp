@@ -0,0 +1,137 @@
+#include <OpenGLFramework\Components\RenderComponent\StreamingRingBuffer.h>
+#include <chrono>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+StreamingRingBuffer::StreamingRingBuffer() : buffer(0), segmentSize(0), numSegments(0), currentSegment(0), writeSegment(0)
+	, writing(false), persistent(false), persistentMemory(NULL) {
+	resetStatistics();
+}
+
+void StreamingRingBuffer::resetStatistics() {
+	memset(&stats, 0, sizeof(stats));
+}
+
+bool StreamingRingBuffer::supportsPersistentMapping() {
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 4))
+		return true;
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint i = 0; i < numExtensions; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+			return true;
+	}
+	return false;
+}
+
+bool StreamingRingBuffer::allocate(GLsizeiptr segmentBytes, unsigned int segments) {
+	release();
+	if (segmentBytes <= 0 || segments == 0)
+		return false;
+	segmentSize = segmentBytes;
+	numSegments = segments;
+	fences.assign(segments, (GLsync)0);
+	currentSegment = 0;
+	writeSegment = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	persistent = supportsPersistentMapping();
+	if (persistent) {
+		//Immutable storage, mapped for good. Coherent: what we write is seen by the GPU without flushing it explicitly.
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, segmentSize * numSegments, NULL, flags);
+		persistentMemory = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, segmentSize * numSegments, flags);
+		if (!persistentMemory) {	//Should not happen... but we can still use the buffer the old way
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			persistent = false;
+		}
+	}
+	if (!persistent)
+		glBufferData(GL_ARRAY_BUFFER, segmentSize * numSegments, NULL, GL_STREAM_DRAW);
+	return true;
+}
+
+void StreamingRingBuffer::waitForSegment(unsigned int segment) {
+	GLsync fence = fences[segment];
+	if (!fence)
+		return;
+	//Is the GPU done with it already? (most of the time it is)
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		stats.stalls++;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);	//1 ms
+		} while (result == GL_TIMEOUT_EXPIRED);
+		stats.stallSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	glDeleteSync(fence);
+	fences[segment] = 0;
+}
+
+void* StreamingRingBuffer::beginWrite() {
+	if (!buffer)
+		return NULL;
+	writeSegment = (currentSegment + 1) % numSegments;
+	waitForSegment(writeSegment);
+	writing = true;
+	if (persistent)
+		return persistentMemory + writeSegment * segmentSize;
+	//Without persistent mapping, we map just this segment. The fence tells us the GPU is not using it, so there is 
+	//no need for OpenGL to synchronize (UNSYNCHRONIZED), nor to keep its old contents (INVALIDATE_RANGE).
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	void* memory = glMapBufferRange(GL_ARRAY_BUFFER, writeSegment * segmentSize, segmentSize
+		, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!memory)
+		writing = false;
+	return memory;
+}
+
+unsigned int StreamingRingBuffer::endWrite() {
+	if (!writing)
+		return currentSegment;
+	if (!persistent) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	writing = false;
+	currentSegment = writeSegment;
+	stats.segmentsWritten++;
+	stats.bytesWritten += (double)segmentSize;
+	return currentSegment;
+}
+
+void StreamingRingBuffer::fenceCurrent() {
+	if (!buffer)
+		return;
+	//The segment might be drawn several times before we write into it again: we only need to wait for the last draw
+	if (fences[currentSegment])
+		glDeleteSync(fences[currentSegment]);
+	fences[currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingRingBuffer::release() {
+	for (size_t i = 0; i < fences.size(); i++)
+		if (fences[i])
+			glDeleteSync(fences[i]);
+	fences.clear();
+	if (buffer) {
+		if (persistent || writing) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	persistentMemory = NULL;
+	persistent = writing = false;
+	segmentSize = 0;
+	numSegments = 0;
+}
@@ -0,0 +1,81 @@
+/**********************************************************************
+NAME: StreamingRingBuffer
+DESCRIPTION: Vertex buffer for data that is completely rewritten every frame (e.g. the point cloud of a depth camera).
+	Calling glBufferData every frame makes the driver allocate new storage (or wait until the GPU stops using the old one).
+	Instead, we allocate once a buffer split in several segments (3 by default) and use them in turns, as a ring: 
+	while the GPU draws from one segment, we write the next frame into another one.
+	Each segment is protected by a fence (glFenceSync), inserted after the draws reading from it. Before writing into a 
+	segment again, we wait for its fence. With 3 segments, the GPU is usually two frames ahead, so we rarely wait.
+	Writes go straight into memory mapped from the buffer (no copies in between):
+		- If OpenGL 4.4 (or ARB_buffer_storage) is available, the buffer is mapped once, persistently.
+		- Otherwise, each segment is mapped while it is written (glMapBufferRange, unsynchronized: the fences already 
+		tell us it is safe), and unmapped in endWrite().
+	The pointer returned by beginWrite() can be filled from any thread (e.g. the thread reading the camera), as long as 
+	beginWrite/endWrite/fenceCurrent are called from the OpenGL thread, and the writing finishes before endWrite.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_STREAMINGRINGBUFFER
+#define _OPENGLFRAMEWORK_STREAMINGRINGBUFFER
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>	//Replaces the OpenGL calls, if OPENGLFRAMEWORK_RECORDING_GL is defined
+#include <vector>
+
+namespace OpenGLFramework {
+	class StreamingRingBuffer {
+	public:
+		struct Statistics {
+			unsigned int segmentsWritten;
+			double bytesWritten;
+			unsigned int stalls;			//Times we had to wait for the GPU to finish with a segment
+			double stallSeconds;			//Time spent waiting
+		};
+	private:
+		GLuint buffer;
+		GLsizeiptr segmentSize;
+		unsigned int numSegments;
+		std::vector<GLsync> fences;		//One per segment (0: nobody is reading from it)
+		unsigned int currentSegment;	//Last segment written (the one draws should read from)
+		unsigned int writeSegment;		//Segment being written (between beginWrite and endWrite)
+		bool writing;
+		bool persistent;
+		unsigned char* persistentMemory;	//Whole buffer, if persistently mapped
+		Statistics stats;
+		void waitForSegment(unsigned int segment);
+	public:
+		StreamingRingBuffer();
+		~StreamingRingBuffer() { ; }		//OpenGL resources must be released explicitly (release()), from the OpenGL thread.
+		/**
+			True if this context supports persistent mapping (OpenGL 4.4 or ARB_buffer_storage).
+		*/
+		static bool supportsPersistentMapping();
+		/**
+			Creates the buffer: numSegments segments of segmentBytes each.
+		*/
+		bool allocate(GLsizeiptr segmentBytes, unsigned int numSegments = 3);
+		/**
+			Returns the memory of the next segment, to be filled with new data (waits if the GPU is still reading from it).
+			Returns NULL if the buffer is not allocated (or could not be mapped).
+		*/
+		void* beginWrite();
+		/**
+			The data of the segment returned by beginWrite is complete: from now on, draws should read from it.
+			Returns its index.
+		*/
+		unsigned int endWrite();
+		/**
+			Call it after issuing the draws that read from the current segment.
+		*/
+		void fenceCurrent();
+		void release();
+		inline GLuint getBuffer() const { return buffer; }
+		inline GLsizeiptr getSegmentSize() const { return segmentSize; }
+		inline unsigned int getNumSegments() const { return numSegments; }
+		inline unsigned int getCurrentSegment() const { return currentSegment; }
+		inline unsigned int getWriteSegment() const { return writeSegment; }
+		inline bool isWriting() const { return writing; }
+		inline bool isPersistent() const { return persistent; }
+		inline const Statistics& getStatistics() const { return stats; }
+		void resetStatistics();
+	};
+};
+#endif
@@ -1,5 +1,8 @@
 #include <OpenGLFramework\Components\RenderComponent\TexturedManualMesh_Renderable.h>
-#include <OpenGLFramework\3DUI_Utils\3DUI_Utils.h>
+#include <OpenGLFramework\Components\RenderComponent\ProgramCache.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshStatistics.h>
 
 using namespace OpenGLFramework;
 
@@ -12,7 +15,7 @@ TexturedManualMesh_Renderable::TexturedManualMesh_Renderable( const int numVerte
 
 	this->textureName=textureName;
 
-	this->bb = ThreeDUI_Utils::createAABoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
+	this->bb = MeshStatistics::computeBoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
 }
 
 TexturedManualMesh_Renderable::TexturedManualMesh_Renderable(const int numVertex, const GLfloat vertex_buffer_data[], const GLfloat uv_buffer_data[], GLuint Texture) :numVertex(numVertex){
@@ -25,6 +28,8 @@ TexturedManualMesh_Renderable::TexturedManualMesh_Renderable(const int numVertex
 	
 	this->textureName="";//The user provided a handler to the texture strainghtahead. Maybe it is a RTT or maybe the user has some external way of loading/creating the textures...
 	this->Texture=Texture;
+
+	this->bb = MeshStatistics::computeBoundingBox(numVertex, (GLfloat*)&(vertex_buffer_data[0]));
 }
 	
 
@@ -33,37 +38,34 @@ bool TexturedManualMesh_Renderable::loadResourcesToMainMemory(){
 }
 
 bool TexturedManualMesh_Renderable::allocateOpenGLResources(){
-	/* Load the texture. These methods actually load into main memory, but they also allocate
-	   the texture in the graphics card already, returning a handler for the texture.
-	   We support two formats, one for BMP and ne for DDS.	*/
-	if(		textureName.substr(textureName.find_last_of(".") + 1) == "bmp" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "BMP")
-				Texture = loadBMP_custom(textureName.c_str());  
-	else if(textureName.substr(textureName.find_last_of(".") + 1) == "dds" 
-		  ||textureName.substr(textureName.find_last_of(".") + 1) == "DDS")
-				Texture = loadDDS(textureName.c_str());
-	else if(textureName=="")
-		;//The user provided the texture himself/herself. No need to do anything more
-	else //The user did give a name, but it does not have the correct extension...
-		return false;
-
-	// Create and compile our GLSL program from the shaders
-	programID = ShaderManager::instance().LoadShaders("OpenGLFramework/shaders/MVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader");
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("allocateOpenGLResources", getRenderableTypeName());
+	/* Load the texture (BMP, DDS or JPEG). If other renderables already loaded the same file, we share theirs (see GPUAssetCache).
+	   These methods actually load into main memory, but they also allocate the texture in the graphics card already, returning a handler for the texture. */
+	if (textureName != "") {
+		Texture = GPUAssetCache::instance().acquireTexture(textureName);
+		if (!Texture)	//The file could not be read, or it does not have a supported extension...
+			return false;//... we indicate we failed misserably
+	}
+	//else: the user provided the texture himself/herself. No need to do anything more
+
+	// Create and compile our GLSL program from the shaders (shared with other renderables using the same shaders; see ProgramCache)
+	programID = ProgramCache::instance().acquireProgram("OpenGLFramework/shaders/MVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader");
 	// Get a handle for our "MVP" uniform
-	MatrixID = glGetUniformLocation(programID, "MVP");
+	MatrixID = ProgramCache::instance().getUniformLocation(programID, "MVP");
 	// Get a handle for our buffers
-	vertexPosition_modelspaceID = glGetAttribLocation(programID, "vertexPosition_modelspace");
-	vertexUVID = glGetAttribLocation(programID, "vertexUV");
+	vertexPosition_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexPosition_modelspace");
+	vertexUVID = ProgramCache::instance().getAttribLocation(programID, "vertexUV");
 	// Get a handle for our "myTextureSampler" uniform
-	TextureID  = glGetUniformLocation(programID, "myTextureSampler");
-	//Load raw data in OpenGL buffers...
+	TextureID  = ProgramCache::instance().getUniformLocation(programID, "myTextureSampler");
+	//Load raw data in OpenGL buffers: positions and UVs of each vertex next to each other (interleaved)...
+	std::vector<GLfloat> interleavedData = VertexFormat::interleave(numVertex, g_vertex_buffer_data, g_uv_buffer_data, NULL);
 	glGenBuffers(1, &vertexbuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, 3*numVertex*sizeof(GLfloat), g_vertex_buffer_data, GL_STATIC_DRAW);
-		
-	glGenBuffers(1, &uvbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, 2*numVertex*sizeof(GLfloat), g_uv_buffer_data, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, interleavedData.size()*sizeof(GLfloat), &interleavedData[0], GL_STATIC_DRAW);
+	// ... and a VAO that remembers how our shader attributes read from it.
+	VertexFormat format;
+	format.add(vertexPosition_modelspaceID, 3).add(vertexUVID, 2);
+	vertexArrayID = format.createVertexArray(vertexbuffer);
 	
 	return true;
 
@@ -71,45 +73,20 @@ bool TexturedManualMesh_Renderable::allocateOpenGLResources(){
 bool TexturedManualMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 	if(!OpenGL_Renderable::render(P, V))return false;
 	// Use our shader
-		glUseProgram(programID);
+		RenderState::instance().useProgram(programID);
 		// Send our transformation to the currently bound shader, 
 		// in the "MVP" uniform
-		glm::mat4 MVP        = P * V  * getOwner()->getFromObjectToWorldCoordinates();;
+		glm::mat4 MVP        = P * V  * getModelMatrix();;
 		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-		// Bind our texture in Texture Unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Texture);
+		// Bind our texture in Texture Unit 0 (RenderState skips it if it is already bound)
+		RenderState::instance().bindTexture2D(0, Texture);
 		// Set our "myTextureSampler" sampler to user Texture Unit 0
 		glUniform1i(TextureID, 0);
 
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(vertexPosition_modelspaceID);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glVertexAttribPointer(
-			vertexPosition_modelspaceID,  // The attribute we want to configure
-			3,                            // size
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(vertexUVID);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glVertexAttribPointer(
-			vertexUVID,                   // The attribute we want to configure
-			2,                            // size : U+V => 2
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
+		// Bind our vertices (the VAO has all our attributes configured already)
+		RenderState::instance().bindVertexArray(vertexArrayID);
 		// Draw the triangles !
 		glDrawArrays(getRenderPrimitive(), 0, numVertex);
-		glDisableVertexAttribArray(vertexPosition_modelspaceID);
-		glDisableVertexAttribArray(vertexUVID);
 
 		
 	return true;
@@ -117,11 +94,14 @@ bool TexturedManualMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 }
 
 bool TexturedManualMesh_Renderable::unallocateAllResources(){
-	// Cleanup VBO and shader
+	// Cleanup VAO, VBO and shader
+	glDeleteVertexArrays(1, &vertexArrayID);
 	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &uvbuffer);
-	glDeleteProgram(programID);
-	glDeleteTextures(1, &TextureID);
+	ProgramCache::instance().releaseProgram(programID);
+	// Textures loaded from a file are shared with other renderables: the cache deletes them when nobody uses them.
+	// Textures provided by the user are not ours to delete.
+	if (textureName != "")
+		GPUAssetCache::instance().releaseTexture(Texture);
 	return true;
 
 
@@ -27,6 +27,7 @@ NEXT OBJECT TO CHECK: DirectionalLightOBJMesh_Renderable
 #ifndef _TEXTURED_MANUAL_MESH_RENDERABLE
 #define _TEXTURED_MANUAL_MESH_RENDERABLE
 #include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\VertexFormat.h>
 
 namespace OpenGLFramework {
 	class TexturedManualMesh_Renderable : public OpenGL_Renderable {
@@ -42,8 +43,8 @@ namespace OpenGLFramework {
 		GLuint vertexUVID;
 		GLuint Texture;
 		GLuint TextureID;
-		GLuint vertexbuffer;
-		GLuint uvbuffer;
+		GLuint vertexbuffer;		//Interleaved positions and UVs (see VertexFormat)
+		GLuint vertexArrayID;		//VAO: how our shader attributes read from vertexbuffer
 	public:
 		//Own methods
 		TexturedManualMesh_Renderable(const int numVertex, const GLfloat vertex_buffer_data[], const GLfloat uv_buffer_data[], std::string textureName);
@@ -53,6 +54,10 @@ namespace OpenGLFramework {
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "TexturedManualMesh_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getTexture() { return Texture; }
+		virtual GLuint getMesh() { return vertexArrayID; }
 	};
 };
 #endif
\ No newline at end of file
@@ -1,106 +1,170 @@
 #include <OpenGLFramework\Components\RenderComponent\TexturedOBJMesh_Renderable.h>
-#include <OpenGLFramework/common/objloader.hpp>
+#include <OpenGLFramework\Components\RenderComponent\ProgramCache.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <OpenGLFramework\Components\RenderComponent\InstanceBatches.h>
 #include <OpenGLFramework\3DUI_Utils\3DUI_Utils.h>
+#include <cstdio>
 
 using namespace OpenGLFramework;
 
 bool TexturedOBJMesh_Renderable::loadResourcesToMainMemory(){
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("loadResourcesToMainMemory", getRenderableTypeName());
 
-	// Read our .obj file into our raw data buffers
-	bool res = loadOBJ(modelFileName.c_str(), vertices, uvs, normals);
-	this->bb = ThreeDUI_Utils::createAABoundingBox(vertices);
+	// Read our .obj file into our raw data buffers (from its binary cache, if it is up to date. See OBJMeshCache)
+	// If other renderables already loaded this model, we just share their copy (see GPUAssetCache)
+	mesh = GPUAssetCache::instance().acquireMeshData(modelFileName);
+	if (!mesh)
+		return false;
+	this->bb = mesh->bb;
 	//The method we use to load textures from a file, already allocates it into the GPU, so we will do that in allocateOpenGLResources
 	return true;
 }
 
 bool TexturedOBJMesh_Renderable::allocateOpenGLResources(){
-	/* Load the texture. These methods actually load into main memory, but they also allocate
-	the texture in the graphics card already, returning a handler for the texture.
-	We support two formats, one for BMP and ne for DDS.	*/
-	if (textureFileName.substr(textureFileName.find_last_of(".") + 1) == "bmp"
-		|| textureFileName.substr(textureFileName.find_last_of(".") + 1) == "BMP")
-		Texture = loadBMP_custom(textureFileName.c_str());
-	else if (textureFileName.substr(textureFileName.find_last_of(".") + 1) == "dds"
-		|| textureFileName.substr(textureFileName.find_last_of(".") + 1) == "DDS")
-		Texture = loadDDS(textureFileName.c_str());
-	else if (textureFileName == "")
-		;//The user provided the texture himself/herself. No need to do anything more
-	else //The user did give a name, but it does not have the correct extension...
+	OPENGLFRAMEWORK_PROFILE_SCOPE_CATEGORY("allocateOpenGLResources", getRenderableTypeName());
+	if (!mesh)	//loadResourcesToMainMemory failed (or was not called)
 		return false;
+	/* Load the texture (BMP, DDS or JPEG). If other renderables already loaded the same file, we share theirs (see GPUAssetCache).
+	   These methods actually load into main memory, but they also allocate the texture in the graphics card already, returning a handler for the texture. */
+	if (textureFileName != "") {
+		Texture = GPUAssetCache::instance().acquireTexture(textureFileName);
+		if (!Texture)	//The file could not be read, or it does not have a supported extension...
+			return false;
+	}
+	//else: the user provided the texture himself/herself. No need to do anything more
 
-	// Create and compile our GLSL program from the shaders
-	programID = ShaderManager::instance().LoadShaders("OpenGLFramework/shaders/MVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader");
+	// Create and compile our GLSL program from the shaders (shared with other renderables using the same shaders; see ProgramCache)
+	// Quantised vertices need a vertex shader that decodes them (see VertexQuantiser)
+	if (quantised)
+		programID = ProgramCache::instance().acquireProgram("OpenGLFramework/Components/RenderComponent/shaders/QuantisedMVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader");
+	else
+		programID = ProgramCache::instance().acquireProgram("OpenGLFramework/shaders/MVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader");
 	// Get a handle for our "MVP" uniform
-	MatrixID = glGetUniformLocation(programID, "MVP");
+	MatrixID = ProgramCache::instance().getUniformLocation(programID, "MVP");
 	// Get a handler for our buffers
-	vertexPosition_modelspaceID = glGetAttribLocation(programID, "vertexPosition_modelspace");
-	vertexUVID = glGetAttribLocation(programID, "vertexUV");
+	vertexPosition_modelspaceID = ProgramCache::instance().getAttribLocation(programID, "vertexPosition_modelspace");
+	vertexUVID = ProgramCache::instance().getAttribLocation(programID, "vertexUV");
 	// Get a handler for our "myTextureSampler" uniform
-	TextureID  = glGetUniformLocation(programID, "myTextureSampler");
-	// Load object data into OpenGL buffers (VBO for vertices and UVs)
-	glGenBuffers(1, &vertexbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-	glGenBuffers(1, &uvbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
+	TextureID  = ProgramCache::instance().getUniformLocation(programID, "myTextureSampler");
+	positionOffsetID = ProgramCache::instance().getUniformLocation(programID, "PositionOffset");
+	positionScaleID = ProgramCache::instance().getUniformLocation(programID, "PositionScale");
+	VertexQuantiser::getPositionDecode(mesh->bb, positionOffset, positionScale);
+	// Load object data into OpenGL buffers: a single VBO with the position and UV of each vertex next to each other (interleaved), and the indices.
+	// Renderables using the same model share them (see GPUAssetCache)...
+	meshBuffers = GPUAssetCache::instance().acquireMeshBuffers(modelFileName, *mesh, false, quantised);
+	if (!meshBuffers.vertexBuffer)	//Empty mesh, or its attribute arrays do not match
+		return false;
+	// ... and a VAO that remembers how our shader attributes read from it. render() only needs to bind it.
+	VertexFormat format;
+	if (quantised)	//16 bit positions (normalised to [0,1] inside the bounding box) and half float UVs
+		format.add(vertexPosition_modelspaceID, 3, GL_UNSIGNED_SHORT, GL_TRUE).add(vertexUVID, 2, GL_HALF_FLOAT);
+	else
+		format.add(vertexPosition_modelspaceID, 3).add(vertexUVID, 2);
+	vertexArrayID = format.createVertexArray(meshBuffers.vertexBuffer, meshBuffers.elementBuffer);
+	// Renderables loading the same files (and drawing the same level of detail) look exactly the same: they can be drawn together 
+	// (textures provided by the user could be anything)
+	instancingBatches.clear();
+	if (textureFileName != "") {
+		std::string asset = "TexturedOBJ|" + GPUAssetCache::canonicalPath(modelFileName) + "|" + GPUAssetCache::canonicalPath(textureFileName) + (quantised ? "|quantised" : "");
+		for (unsigned int level = 0; level < mesh->getNumLevelsOfDetail(); level++) {
+			char suffix[16];
+			sprintf(suffix, "|LOD%u", level);
+			instancingBatches.push_back(InstanceBatches::instance().getBatchID(level == 0 ? asset : asset + suffix));
+		}
+	}
+
+	return true;
+}
 
+bool TexturedOBJMesh_Renderable::allocateInstancedResources() {
+	if (quantised)
+		instancedProgramID = ProgramCache::instance().acquireProgram("OpenGLFramework/Components/RenderComponent/shaders/QuantisedMVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader", "INSTANCED");
+	else
+		instancedProgramID = ProgramCache::instance().acquireProgram("OpenGLFramework/Components/RenderComponent/shaders/InstancedMVPVertexShader.vertexshader", "OpenGLFramework/shaders/TextureFragmentShader.fragmentshader");
+	if (!instancedProgramID)
+		return false;
+	instancedVP_ID = ProgramCache::instance().getUniformLocation(instancedProgramID, "VP");
+	instancedTextureID = ProgramCache::instance().getUniformLocation(instancedProgramID, "myTextureSampler");
+	instancedPositionOffsetID = ProgramCache::instance().getUniformLocation(instancedProgramID, "PositionOffset");
+	instancedPositionScaleID = ProgramCache::instance().getUniformLocation(instancedProgramID, "PositionScale");
+	// Same vertices and indices as usual (the attribute locations can differ in this shader), plus one model matrix per instance
+	GLuint positionID = ProgramCache::instance().getAttribLocation(instancedProgramID, "vertexPosition_modelspace");
+	GLuint uvID = ProgramCache::instance().getAttribLocation(instancedProgramID, "vertexUV");
+	VertexFormat format;
+	if (quantised)
+		format.add(positionID, 3, GL_UNSIGNED_SHORT, GL_TRUE).add(uvID, 2, GL_HALF_FLOAT);
+	else
+		format.add(positionID, 3).add(uvID, 2);
+	instancedVertexArrayID = format.createVertexArray(meshBuffers.vertexBuffer, meshBuffers.elementBuffer);
+	instanceBuffer.setupAttributes(ProgramCache::instance().getAttribLocation(instancedProgramID, "instanceModelMatrix"));
+	RenderState::instance().invalidate();	//We bound a VAO and a buffer behind RenderState's back
 	return true;
 }
 
 bool TexturedOBJMesh_Renderable::render(glm::mat4 P, glm::mat4 V){
 	if(!OpenGL_Renderable::render(P, V))return false;
 	// Use our shader
-		glUseProgram(programID);
+		RenderState::instance().useProgram(programID);
 
 		// Send our transformation to the currently bound shader, 
 		// in the "MVP" uniform
-		glm::mat4 MVP        = P * V * getOwner()->getFromObjectToWorldCoordinates();
+		glm::mat4 MVP        = P * V * getModelMatrix();
 		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
+		if (quantised) {	//Where the quantised positions are (our bounding box)
+			glUniform3f(positionOffsetID, positionOffset.x, positionOffset.y, positionOffset.z);
+			glUniform3f(positionScaleID, positionScale.x, positionScale.y, positionScale.z);
+		}
 
-		// Bind our texture in Texture Unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Texture);
+		// Bind our texture in Texture Unit 0 (RenderState skips it if it is already bound)
+		RenderState::instance().bindTexture2D(0, Texture);
 		// Set our "myTextureSampler" sampler to user Texture Unit 0
 		glUniform1i(TextureID, 0);
 
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(vertexPosition_modelspaceID);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glVertexAttribPointer(
-			vertexPosition_modelspaceID,  // The attribute we want to configure
-			3,                            // size
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(vertexUVID);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glVertexAttribPointer(
-			vertexUVID,                   // The attribute we want to configure
-			2,                            // size : U+V => 2
-			GL_FLOAT,                     // type
-			GL_FALSE,                     // normalized?
-			0,                            // stride
-			(void*)0                      // array buffer offset
-		);
-
-		// Draw the triangles !
-		glDrawArrays(getRenderPrimitive(), 0, vertices.size()); 
+		// Bind our vertices and indices (the VAO has all our attributes configured already)
+		RenderState::instance().bindVertexArray(vertexArrayID);
+		// Draw the triangles (indexed: each vertex is shared by several triangles) of our level of detail (a range of the element buffer, see MeshData)!
+		unsigned int level = lod.getLevel(*mesh);
+		glDrawElements(getRenderPrimitive(), (GLsizei)mesh->getLevelNumIndices(level), GL_UNSIGNED_INT, (void*)(mesh->getLevelFirstIndex(level) * sizeof(unsigned int)));
+	return true;
+}
 
-		glDisableVertexAttribArray(vertexPosition_modelspaceID);
-		glDisableVertexAttribArray(vertexUVID);		
+bool TexturedOBJMesh_Renderable::renderInstanced(glm::mat4 P, glm::mat4 V, const glm::mat4* modelMatrices, unsigned int count) {
+	if (!instancedProgramID && !allocateInstancedResources())
+		return false;
+	RenderState::instance().useProgram(instancedProgramID);
+	// The view and projection are the same for all instances. Their model matrices go into a buffer
+	glm::mat4 VP = P * V;
+	glUniformMatrix4fv(instancedVP_ID, 1, GL_FALSE, &VP[0][0]);
+	if (quantised) {
+		glUniform3f(instancedPositionOffsetID, positionOffset.x, positionOffset.y, positionOffset.z);
+		glUniform3f(instancedPositionScaleID, positionScale.x, positionScale.y, positionScale.z);
+	}
+	instanceBuffer.upload(modelMatrices, count);
+	RenderState::instance().bindTexture2D(0, Texture);
+	glUniform1i(instancedTextureID, 0);
+	RenderState::instance().bindVertexArray(instancedVertexArrayID);
+	// Draw the mesh 'count' times, in one call (all the renderables in our batch use our level of detail)
+	unsigned int level = lod.getLevel(*mesh);
+	glDrawElementsInstanced(getRenderPrimitive(), (GLsizei)mesh->getLevelNumIndices(level), GL_UNSIGNED_INT, (void*)(mesh->getLevelFirstIndex(level) * sizeof(unsigned int)), count);
 	return true;
 }
 
 bool TexturedOBJMesh_Renderable::unallocateAllResources(){
-	// Cleanup VBO and shader
-	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &uvbuffer);
-	glDeleteProgram(programID);
-	glDeleteTextures(1, &TextureID);
+	// Cleanup VAO, buffers and shader
+	glDeleteVertexArrays(1, &vertexArrayID);
+	GPUAssetCache::instance().releaseMeshBuffers(meshBuffers);
+	ProgramCache::instance().releaseProgram(programID);
+	if (instancedProgramID) {
+		glDeleteVertexArrays(1, &instancedVertexArrayID);
+		ProgramCache::instance().releaseProgram(instancedProgramID);
+		instanceBuffer.release();
+		instancedProgramID = instancedVertexArrayID = 0;
+	}
+	// Textures loaded from a file are shared with other renderables: the cache deletes them when nobody uses them.
+	// Textures provided by the user are not ours to delete.
+	if (textureFileName != "")
+		GPUAssetCache::instance().releaseTexture(Texture);
+	instancingBatches.clear();
+	mesh.reset();
 	return true;
 }
@@ -21,6 +21,12 @@ SHADERS (Same than UnitPolygonTexturedh_Renderable):
 		a) UV: This is the interpolated UV coordinates of this fragment. That is, the point inside the texture we will get the fragment colour from
 		b) myTextureSample: This is the texture we read colours from. It is a uniform, as all fragments get their colour from the same
 		texture file. 
+	- InstancedMVPVertexShader.vertexshader (in RenderComponent/shaders): same as MVPVertexShader, but the model matrix is 
+		a per instance attribute (instanceModelMatrix), so one draw call renders all the objects showing the same model
+		and texture (see renderInstanced). It only needs VP (view-projection) as a uniform.
+	- QuantisedMVPVertexShader.vertexshader (in RenderComponent/shaders): same as MVPVertexShader (or InstancedMVPVertexShader),
+		for quantised vertices (see setQuantisedVertices and VertexQuantiser). It decodes the positions with the uniforms
+		PositionOffset and PositionScale (the bounding box of the mesh).
 NEXT OBJECT TO CHECK: DirectionalLightOBJMesh_Renderable 
 
 **************************************************************************************************************/
@@ -28,6 +34,12 @@ NEXT OBJECT TO CHECK: DirectionalLightOBJMesh_Renderable
 #ifndef _TEXTURED_OBJ_MESH_RENDERABLE
 #define _TEXTURED_OBJ_MESH_RENDERABLE
 #include <OpenGLFramework\Components\RenderComponent\OpenGL_Renderable.h>
+#include <OpenGLFramework\Components\RenderComponent\VertexFormat.h>
+#include <OpenGLFramework\Components\RenderComponent\GPUAssetCache.h>
+#include <OpenGLFramework\Components\RenderComponent\InstanceBuffer.h>
+#include <OpenGLFramework\Components\RenderComponent\LODSelector.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\MeshWelder.h>
+#include <OpenGLFramework\Components\RenderComponent\MeshProcessing\VertexQuantiser.h>
 #include <vector>
 
 namespace OpenGLFramework {
@@ -35,10 +47,8 @@ namespace OpenGLFramework {
 		//Config parameters
 		std::string textureFileName, modelFileName;
 		//std::string vertexShader, fragmentShader; //This is fixed, as the arguments (see "vertexPosition_modelspace" "myTextureSampler" init) are specific for the shaders, changing programs makes no sense...
-		//Raw data (as read from a file, etc...)
-		std::vector<glm::vec3> vertices;
-		std::vector<glm::vec2> uvs;
-		std::vector<glm::vec3> normals; // Won't be used at the moment.
+		//Raw data (as read from a file, etc...). Renderables loading the same model share it (see GPUAssetCache)
+		std::shared_ptr<const MeshData> mesh;
 		//OpenGL handlers
 		GLuint programID;
 		GLuint MatrixID;
@@ -46,23 +56,59 @@ namespace OpenGLFramework {
 		GLuint vertexUVID;
 		GLuint Texture;
 		GLuint TextureID;
-		GLuint vertexbuffer;
-		GLuint uvbuffer;
-
-
+		GLuint positionOffsetID, positionScaleID;	//Decoding of quantised positions (see VertexQuantiser)
+		bool quantised;						//16 bit positions and half float UVs, instead of floats
+		glm::vec3 positionOffset, positionScale;
+		GPUAssetCache::MeshBuffers meshBuffers;	//Interleaved positions, UVs and indices (shared, see GPUAssetCache)
+		GLuint vertexArrayID;				//VAO: how our shader attributes read from meshBuffers
+		LODSelector lod;					//Level of detail drawn this frame (see MeshSimplifier)
+		//Instanced rendering (see renderInstanced). The shader and VAO are only created if we ever draw several instances.
+		std::vector<unsigned int> instancingBatches;	//One per level of detail: renderables with the same model, texture and level share it
+		GLuint instancedProgramID;
+		GLuint instancedVP_ID, instancedTextureID, instancedPositionOffsetID, instancedPositionScaleID;
+		GLuint instancedVertexArrayID;		//VAO reading our meshBuffers and the model matrices in instanceBuffer
+		InstanceBuffer instanceBuffer;
+		bool allocateInstancedResources();
 
 	public:
 		//Own methods:
 		TexturedOBJMesh_Renderable(std::string model, std::string texture)
-			: TextureID(-1), textureFileName(texture), modelFileName(model)
+			: TextureID(-1), textureFileName(texture), modelFileName(model), quantised(false)
+			, instancedProgramID(0), instancedVertexArrayID(0)
 		{
 			;
 		}
+		/**
+			Uploads our vertices quantised (see VertexQuantiser): 12 bytes per vertex instead of 20. Call it before allocateOpenGLResources.
+		*/
+		inline void setQuantisedVertices(bool enabled) { quantised = enabled; }
+		inline bool hasQuantisedVertices() const { return quantised; }
+		/**
+			Memory used by our buffers, before (one vertex per triangle corner, as read from the file) and after welding the mesh.
+		*/
+		inline MeshWelder::Report getMeshMemoryReport() { return (mesh ? MeshWelder::computeReport(mesh->vertices.size(), mesh->indices.size()) : MeshWelder::computeReport(0, 0)); }
+		/**
+			Memory saved, and errors introduced, by quantising our vertices (whether we use them quantised or not).
+		*/
+		inline VertexQuantiser::Report getQuantisationReport() { return (mesh ? VertexQuantiser::computeReport(*mesh, false) : VertexQuantiser::computeReport(MeshData(), false)); }
 		//Methods inherited from base class OpenGL_Renderable
 		virtual bool loadResourcesToMainMemory();
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "TexturedOBJMesh_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getTexture() { return Texture; }
+		virtual GLuint getMesh() { return vertexArrayID; }
+		virtual std::shared_ptr<const MeshData> getMeshData() { return mesh; }
+		virtual bool getSurfaceDescription(SurfaceDescription& surface) {
+			surface.lighting = SurfaceDescription::UNLIT;	//Our shader just shows the texture
+			surface.textureFile = textureFileName;
+			return true;
+		}
+		virtual unsigned int getInstancingBatch() { return instancingBatches.empty() ? 0 : instancingBatches[lod.getLevel(*mesh)]; }
+		virtual unsigned int selectLevelOfDetail(float screenSize, float tolerance) { return mesh ? lod.select(*mesh, screenSize, tolerance) : 0; }
+		virtual bool renderInstanced(glm::mat4 P, glm::mat4 V, const glm::mat4* modelMatrices, unsigned int count);
 	};
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include <OpenGLFramework\Components\RenderComponent\UniformBlocks.h>
+#include <OpenGLFramework\Components\RenderComponent\ClusteredLighting.h>
+#include <cstring>
+
+using namespace OpenGLFramework;
+
+UniformBlocks::UniformBlocks()
+	: frameBuffer(0), objectBuffer(0), objectCapacity(INITIAL_OBJECT_BUFFER_SIZE), objectOffset(0), objectBytesThisFrame(0)
+	, alignment(256), users(0)
+{
+	memset(&frame, 0, sizeof(frame));
+	memset(&stats, 0, sizeof(stats));
+}
+
+UniformBlocks& UniformBlocks::instance() {
+	static UniformBlocks _instance;
+	return _instance;
+}
+
+void UniformBlocks::setupProgram(GLuint program) {
+	GLuint frameBlock = glGetUniformBlockIndex(program, "FrameConstants");
+	if (frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, frameBlock, FRAME_BINDING);
+	GLuint objectBlock = glGetUniformBlockIndex(program, "ObjectConstants");
+	if (objectBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, objectBlock, OBJECT_BINDING);
+}
+
+void UniformBlocks::acquire() {
+	users++;
+}
+
+void UniformBlocks::release() {
+	if (users == 0 || --users > 0)
+		return;
+	if (frameBuffer) {
+		glDeleteBuffers(1, &frameBuffer);
+		glDeleteBuffers(1, &objectBuffer);
+	}
+	frameBuffer = objectBuffer = 0;
+	objectCapacity = INITIAL_OBJECT_BUFFER_SIZE;
+	objectOffset = objectBytesThisFrame = 0;
+}
+
+void UniformBlocks::allocateOpenGLResources() {
+	glGenBuffers(1, &frameBuffer);
+	glGenBuffers(1, &objectBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, objectCapacity, NULL, GL_STREAM_DRAW);
+	GLint required = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &required);
+	alignment = (required > 0 ? required : 256);	//256 is the largest alignment drivers ask for
+}
+
+void UniformBlocks::beginFrame(const glm::mat4& P, const glm::mat4& V) {
+	if (!frameBuffer)
+		allocateOpenGLResources();
+	//1. The camera: its position is the translation of V, undone (V is a rotation and a translation)
+	frame.P = P;
+	frame.V = V;
+	frame.PV = P * V;
+	for (int i = 0; i < 3; i++)
+		frame.cameraPosition[i] = -(V[i][0] * V[3][0] + V[i][1] * V[3][1] + V[i][2] * V[3][2]);
+	frame.cameraPosition[3] = 1;
+	//2. The lights (see ClusteredLighting: it must have been updated for this frame already)
+	if (ClusteredLighting::instance().isInUse()) {
+		frame.clusterDepth = ClusteredLighting::instance().getDepthParameters();
+		frame.clusterGrid[0] = ClusteredLighting::CLUSTERS_X;
+		frame.clusterGrid[1] = ClusteredLighting::CLUSTERS_Y;
+		frame.clusterGrid[2] = ClusteredLighting::CLUSTERS_Z;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(frame), &frame, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameBuffer);
+	//3. New storage for the object blocks, big enough for what the last frame needed
+	if (objectBytesThisFrame > objectCapacity)
+		objectCapacity = objectBytesThisFrame + objectBytesThisFrame / 2;
+	glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, objectCapacity, NULL, GL_STREAM_DRAW);	//Orphan the old storage
+	objectOffset = objectBytesThisFrame = 0;
+	memset(&stats, 0, sizeof(stats));
+	stats.bytesUploaded = sizeof(frame);
+}
+
+void UniformBlocks::bindObject(const void* data, GLsizeiptr bytes) {
+	if (!frameBuffer)
+		allocateOpenGLResources();
+	GLsizeiptr offset = (objectOffset + alignment - 1) / alignment * alignment;
+	glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+	if (offset + bytes > objectCapacity) {	//Full: carry on in new storage (the GPU keeps the old one until it is done with it)
+		if (bytes > objectCapacity)
+			objectCapacity = 2 * bytes;
+		glBufferData(GL_UNIFORM_BUFFER, objectCapacity, NULL, GL_STREAM_DRAW);
+		offset = 0;
+		stats.overflows++;
+	}
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, bytes, data);
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, objectBuffer, offset, bytes);
+	objectOffset = offset + bytes;
+	objectBytesThisFrame += (bytes + alignment - 1) / alignment * alignment;
+	stats.objectBlocks++;
+	stats.bytesUploaded += bytes;
+}
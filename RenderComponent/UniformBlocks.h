@@ -0,0 +1,71 @@
+/**********************************************************************
+NAME: UniformBlocks
+DESCRIPTION: Uniform buffers shared by the shaders, so that renderables do not set the same uniforms one by one again
+	and again (each glUniform call costs CPU time in the driver, and most of them were sending the same values):
+		- FrameConstants (binding point FRAME_BINDING): the camera (P, V, PV and its position) and the clustered lights
+		(see ClusteredLighting). Written once per frame by the RenderableVisitor (beginFrame), and read by every program.
+		- ObjectConstants (binding point OBJECT_BINDING): whatever a renderable needs for one draw (e.g. M, MVP, material
+		and light). Each draw copies its block into the next free part of one big buffer, and binds that range
+		(bindObject). The buffer is used as a ring: it gets new storage (orphaning, as InstanceBuffer does) at the start
+		of each frame, or when it fills up, so we never overwrite blocks the GPU has not read yet.
+	Shaders declare the blocks with layout(std140), with the same members as the structs their renderables fill (see
+	shaders/PointLightShading.vertexshader). ProgramCache calls setupProgram for each program it creates, to connect
+	the blocks it declares to their binding points (GLSL 3.30 cannot do it with layout(binding)).
+	Renderables using the blocks acquire them in allocateOpenGLResources and release them in unallocateAllResources.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_UNIFORMBLOCKS
+#define _OPENGLFRAMEWORK_UNIFORMBLOCKS
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>	//Replaces the OpenGL calls, if OPENGLFRAMEWORK_RECORDING_GL is defined
+
+namespace OpenGLFramework {
+	class UniformBlocks {
+	public:
+		static const GLuint FRAME_BINDING = 0, OBJECT_BINDING = 1;
+		static const GLsizeiptr INITIAL_OBJECT_BUFFER_SIZE = 64 * 1024;
+		/**
+			Layout of the FrameConstants block (std140: mat4 and vec4 members need no padding).
+		*/
+		struct FrameConstants {
+			glm::mat4 P, V, PV;
+			glm::vec4 cameraPosition;		//World space (w = 1)
+			glm::vec4 clusterDepth;			//See ClusteredLighting::getDepthParameters
+			GLint clusterGrid[4];			//Clusters in x, y and z (and 0)
+		};
+		struct Statistics {
+			unsigned int objectBlocks;		//Blocks written by bindObject in the last frame
+			unsigned int overflows;			//Times the object buffer filled up during the frame (and got new storage)
+			size_t bytesUploaded;			//Frame and object blocks
+		};
+	private:
+		GLuint frameBuffer, objectBuffer;
+		GLsizeiptr objectCapacity, objectOffset, objectBytesThisFrame;
+		GLint alignment;					//Of the offsets of the ranges bound (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+		unsigned int users;
+		FrameConstants frame;
+		Statistics stats;
+		UniformBlocks();
+		void allocateOpenGLResources();
+	public:
+		static UniformBlocks& instance();
+		/**
+			Connects the blocks named FrameConstants and ObjectConstants in the program (if it declares them) to their binding points.
+		*/
+		static void setupProgram(GLuint program);
+		void acquire();
+		void release();
+		inline bool isInUse() const { return users > 0; }
+		/**
+			Writes the FrameConstants of this camera. Called by the RenderableVisitor, before rendering.
+		*/
+		void beginFrame(const glm::mat4& P, const glm::mat4& V);
+		inline const FrameConstants& getFrameConstants() const { return frame; }
+		/**
+			Copies a block (e.g. the ObjectConstants of a renderable) to the buffer, and binds it to OBJECT_BINDING for the next draw.
+		*/
+		void bindObject(const void* data, GLsizeiptr bytes);
+		inline const Statistics& getStatistics() const { return stats; }
+	};
+};
+#endif
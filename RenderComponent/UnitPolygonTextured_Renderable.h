@@ -30,6 +30,7 @@ NEXT OBJECT TO CHECK: TexturedOBJMesh_Renderable & TexturedManualMesh_Renderable
 #ifndef _OPENGL_UNIT_POLYGON_TEXTURED
 #define _OPENGL_UNIT_POLYGON_TEXTURED
 #include <OpenGLFramework/Components/RenderComponent/OpenGL_Renderable.h>
+#include <OpenGLFramework/Components/RenderComponent/VertexFormat.h>
 
 namespace OpenGLFramework {
 	class UnitPolygonTextured_Renderable : public OpenGL_Renderable {
@@ -44,23 +45,30 @@ namespace OpenGLFramework {
 		GLuint vertexUVID;					//handler for the UV coordinates of each vertex (for our fragment shader).
 		GLuint TextureID;					//handler for the texture to use (for the fragment shader)
 		//Actual OpenGL data structures (data allocated in the graphics card memory which we can access for main memory)
-		GLuint vertexbuffer;
-		GLuint uvbuffer;
+		GLuint vertexbuffer;				//Positions and UVs, interleaved (see VertexFormat)
+		GLuint vertexArrayID;				//VAO: remembers how our shader attributes read from vertexbuffer
 		GLuint Texture;
 	public:
 		//Own Methods
 		UnitPolygonTextured_Renderable(std::string textureFileName = "uvtemplate.bmp") :textureFileName(textureFileName) { 
+			setUnitBoundingBox();
+		}
+		UnitPolygonTextured_Renderable(GLuint Texture) :textureFileName(""), Texture(Texture) { setUnitBoundingBox(); }
+		inline void setUnitBoundingBox() {
 			//Set the sixe of the bounding box of our unit polygon
 			bb.xmin=bb.ymin=-0.5f; 
 			bb.xmax = bb.ymax = 0.5;
 			bb.zmin = -0.01f; bb.zmax = 0.01f;	//It still needs a thickness 
 		}
-		UnitPolygonTextured_Renderable(GLuint Texture) :textureFileName(""), Texture(Texture) { ; }
 		//Methods inherited from base class OpenGL_Renderable
 		virtual bool loadResourcesToMainMemory();
 		virtual bool allocateOpenGLResources();
 		virtual bool render(glm::mat4 P, glm::mat4 V);
 		virtual bool unallocateAllResources();
+		virtual const char* getRenderableTypeName() const { return "UnitPolygonTextured_Renderable"; }
+		virtual GLuint getShaderProgram() { return programID; }
+		virtual GLuint getTexture() { return Texture; }
+		virtual GLuint getMesh() { return vertexArrayID; }
 	};
 };
 #endif
\ No newline at end of file
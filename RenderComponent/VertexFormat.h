@@ -0,0 +1,124 @@
+/**********************************************************************
+NAME: VertexFormat
+DESCRIPTION: Describes how the vertices of a renderable are laid out in a vertex buffer (VBO): which shader attributes
+	they feed, how many components each one has, their type and where they are inside each vertex.
+	Renderables use it in allocateOpenGLResources() to capture that layout once, in a Vertex Array Object (VAO).
+	From then on, render() only needs to bind the VAO (glBindVertexArray), instead of enabling and configuring 
+	each attribute (glBindBuffer + glVertexAttribPointer) on every frame.
+	Attributes added to the same format are interleaved (position, uv, normal, position, uv, normal...), so all the 
+	data a vertex needs is read from one place in memory. Renderables that update some of their data often (e.g. 
+	PerVertexColourMesh_Renderable) can still use one format per buffer, all captured in the same VAO.
+	NOTE: While a VAO is bound, any glVertexAttribPointer call modifies it. Code that configures attributes by hand 
+	must bind its own VAO first.
+	Formats can also describe per-instance data (e.g. a model matrix per object, see InstanceBuffer): after setDivisor(1), 
+	their attributes advance once per instance drawn, instead of once per vertex.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_VERTEXFORMAT
+#define _OPENGLFRAMEWORK_VERTEXFORMAT
+#include "OpenGLFRameworkPrerequisites.h"
+#include <OpenGLFramework\Components\RenderComponent\RecordingGL.h>	//Replaces the OpenGL calls, if OPENGLFRAMEWORK_RECORDING_GL is defined
+#include <vector>
+
+namespace OpenGLFramework {
+	class VertexFormat {
+		struct Attribute {
+			GLuint location;			//Shader attribute (as returned by glGetAttribLocation)
+			GLint size;					//Number of components (e.g. 3 for a position, 2 for UVs)
+			GLenum type;				//GL_FLOAT, GL_HALF_FLOAT, GL_SHORT...
+			GLboolean normalized;		//Integer types: map their range to [0,1] ([-1,1] if signed)?
+			size_t offset;				//Bytes from the start of the vertex
+		};
+		std::vector<Attribute> attributes;
+		GLsizei stride;					//Size of a vertex, in bytes
+		GLuint divisor;					//0: attributes advance per vertex. N: they advance every N instances
+
+	public:
+		VertexFormat() :stride(0), divisor(0) { ; }
+
+		static inline GLsizei sizeOfType(GLenum type) {
+			switch (type) {
+			case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+			case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+			default: return 4;			//GL_FLOAT, GL_INT, GL_UNSIGNED_INT, GL_INT_2_10_10_10_REV...
+			}
+		}
+
+		/**
+			Adds an attribute to the format, right after the previous one. 
+			Shaders might not use all the attributes we have (the compiler removes them, and glGetAttribLocation returns -1).
+			Those attributes still take space in the vertex, but are not fed to the shader.
+		*/
+		inline VertexFormat& add(GLuint location, GLint size, GLenum type = GL_FLOAT, GLboolean normalized = GL_FALSE) {
+			Attribute a = { location, size, type, normalized, (size_t)stride };
+			attributes.push_back(a);
+			GLsizei bytes = (type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV) ? 4 : size * sizeOfType(type);
+			stride += (bytes + 3) & ~3;	//Keep attributes 4 byte aligned
+			return *this;
+		}
+
+		/**
+			Adds a 4x4 float matrix. Shaders see it as a single mat4 attribute, but it takes 4 locations (one per column).
+		*/
+		inline VertexFormat& addMatrix4(GLuint location) {
+			for (GLuint column = 0; column < 4; column++)
+				add(location == (GLuint)-1 ? location : location + column, 4);
+			return *this;
+		}
+
+		inline VertexFormat& setDivisor(GLuint attributeDivisor) { divisor = attributeDivisor; return *this; }
+
+		inline GLsizei getStride() const { return stride; }
+
+		/**
+			Configures our attributes to read from the buffer provided, in the VAO currently bound.
+		*/
+		inline void setupAttributes(GLuint buffer, size_t bufferOffset = 0) const {
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			for (size_t i = 0; i < attributes.size(); i++) {
+				const Attribute& a = attributes[i];
+				if (a.location == (GLuint)-1) continue;	//Not used by the shader
+				glEnableVertexAttribArray(a.location);
+				glVertexAttribPointer(a.location, a.size, a.type, a.normalized, stride, (void*)(bufferOffset + a.offset));
+				glVertexAttribDivisor(a.location, divisor);
+			}
+		}
+
+		/**
+			Creates a VAO that feeds our attributes from buffer (and takes the indices from elementBuffer, if not 0).
+			The VAO is left bound.
+		*/
+		inline GLuint createVertexArray(GLuint buffer, GLuint elementBuffer = 0) const {
+			GLuint vao;
+			glGenVertexArrays(1, &vao);
+			glBindVertexArray(vao);
+			setupAttributes(buffer);
+			if (elementBuffer)
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);	//The element buffer binding is part of the VAO state
+			return vao;
+		}
+
+		/**
+			Builds an interleaved array of vertices (position, uv, normal) from separate arrays.
+			uvs and normals are optional (NULL). The result can be uploaded to a VBO straight away.
+		*/
+		static inline std::vector<GLfloat> interleave(size_t numVertex, const GLfloat* vertices, const GLfloat* uvs, const GLfloat* normals) {
+			size_t floatsPerVertex = 3 + (uvs ? 2 : 0) + (normals ? 3 : 0);
+			std::vector<GLfloat> result(numVertex * floatsPerVertex);
+			GLfloat* out = result.empty() ? NULL : &result[0];
+			for (size_t i = 0; i < numVertex; i++) {
+				*(out++) = vertices[3 * i]; *(out++) = vertices[3 * i + 1]; *(out++) = vertices[3 * i + 2];
+				if (uvs) { *(out++) = uvs[2 * i]; *(out++) = uvs[2 * i + 1]; }
+				if (normals) { *(out++) = normals[3 * i]; *(out++) = normals[3 * i + 1]; *(out++) = normals[3 * i + 2]; }
+			}
+			return result;
+		}
+		static inline std::vector<GLfloat> interleave(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>* uvs, const std::vector<glm::vec3>* normals) {
+			if (vertices.empty()) return std::vector<GLfloat>();
+			return interleave(vertices.size(), &vertices[0].x
+				, (uvs && uvs->size() == vertices.size()) ? &(*uvs)[0].x : NULL
+				, (normals && normals->size() == vertices.size()) ? &(*normals)[0].x : NULL);
+		}
+	};
+};
+#endif
@@ -0,0 +1,166 @@
+#include <OpenGLFramework\Components\RenderComponent\WorldTransformCache.h>
+#include <OpenGLFramework\Components\RenderComponent\Profiler.h>
+#include <thread>
+#include <functional>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define WORLDTRANSFORMCACHE_SSE
+#endif
+
+using namespace OpenGLFramework;
+
+WorldTransformCache::WorldTransformCache() : numDirty(0), maxThreads(0) {
+	memset(&stats, 0, sizeof(stats));
+}
+
+unsigned int WorldTransformCache::createNode(unsigned int parentNode, const glm::mat4& localTransform, const void* nodeOwner) {
+	unsigned int node;
+	if (!freeNodes.empty()) {
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else {
+		node = (unsigned int)local.size();
+		local.push_back(glm::mat4(1.0f)); world.push_back(glm::mat4(1.0f));
+		parent.push_back(0); level.push_back(0); children.push_back(0); slot.push_back(0);
+		dirty.push_back(0); changed.push_back(0); alive.push_back(0);
+		owner.push_back(NULL);
+	}
+	local[node] = localTransform;
+	parent[node] = parentNode;
+	level[node] = (parentNode == INVALID_NODE ? 0 : level[parentNode] + 1);
+	children[node] = 0;
+	if (parentNode != INVALID_NODE)
+		children[parentNode]++;
+	if (levels.size() <= level[node])
+		levels.resize(level[node] + 1);
+	slot[node] = (unsigned int)levels[level[node]].size();
+	levels[level[node]].push_back(node);
+	dirty[node] = 1;
+	numDirty++;
+	changed[node] = 0;
+	alive[node] = 1;
+	owner[node] = nodeOwner;
+	if (nodeOwner)
+		nodesByOwner[nodeOwner] = node;
+	stats.nodes++;
+	return node;
+}
+
+bool WorldTransformCache::removeNode(unsigned int node) {
+	if (node >= alive.size() || !alive[node] || children[node] > 0)
+		return false;
+	//Take it out of its level: the last node of the level takes its place
+	std::vector<unsigned int>& nodes = levels[level[node]];
+	unsigned int moved = nodes.back();
+	nodes[slot[node]] = moved;
+	slot[moved] = slot[node];
+	nodes.pop_back();
+	while (!levels.empty() && levels.back().empty())
+		levels.pop_back();
+	if (parent[node] != INVALID_NODE)
+		children[parent[node]]--;
+	if (owner[node]) {
+		nodesByOwner.erase(owner[node]);
+		owner[node] = NULL;
+	}
+	if (dirty[node])
+		numDirty--;
+	dirty[node] = changed[node] = alive[node] = 0;
+	freeNodes.push_back(node);
+	stats.nodes--;
+	return true;
+}
+
+void WorldTransformCache::setLocalTransform(unsigned int node, const glm::mat4& localTransform) {
+	local[node] = localTransform;
+	if (!dirty[node]) {
+		dirty[node] = 1;
+		numDirty++;
+	}
+}
+
+unsigned int WorldTransformCache::findNode(const void* nodeOwner) const {
+	std::unordered_map<const void*, unsigned int>::const_iterator it = nodesByOwner.find(nodeOwner);
+	return (it == nodesByOwner.end() ? INVALID_NODE : it->second);
+}
+
+void WorldTransformCache::multiply(const glm::mat4& parentMatrix, const glm::mat4& localMatrix, glm::mat4& result) {
+	const float* p = &parentMatrix[0][0];
+	const float* l = &localMatrix[0][0];
+	float* r = &result[0][0];
+#ifdef WORLDTRANSFORMCACHE_SSE
+	__m128 p0 = _mm_loadu_ps(p), p1 = _mm_loadu_ps(p + 4), p2 = _mm_loadu_ps(p + 8), p3 = _mm_loadu_ps(p + 12);
+	for (int c = 0; c < 4; c++) {
+		__m128 column = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(l[4 * c])), _mm_mul_ps(p1, _mm_set1_ps(l[4 * c + 1]))),
+			_mm_add_ps(_mm_mul_ps(p2, _mm_set1_ps(l[4 * c + 2])), _mm_mul_ps(p3, _mm_set1_ps(l[4 * c + 3]))));
+		_mm_storeu_ps(r + 4 * c, column);
+	}
+#else
+	float column[4];
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++)
+			column[row] = p[row] * l[4 * c] + p[4 + row] * l[4 * c + 1] + p[8 + row] * l[4 * c + 2] + p[12 + row] * l[4 * c + 3];
+		memcpy(r + 4 * c, column, sizeof(column));
+	}
+#endif
+}
+
+void WorldTransformCache::updateNodes(const std::vector<unsigned int>& nodes, size_t begin, size_t end, unsigned int* updated) {
+	unsigned int count = 0;
+	for (size_t i = begin; i < end; i++) {
+		unsigned int node = nodes[i];
+		unsigned int p = parent[node];
+		//The dirty flags propagate down: a node is recomputed if it changed, or if its parent (a level up, already done) did
+		changed[node] = (dirty[node] || (p != INVALID_NODE && changed[p])) ? 1 : 0;
+		if (!changed[node])
+			continue;
+		if (p == INVALID_NODE)
+			world[node] = local[node];
+		else
+			multiply(world[p], local[node], world[node]);
+		dirty[node] = 0;
+		count++;
+	}
+	*updated = count;
+}
+
+void WorldTransformCache::update() {
+	OPENGLFRAMEWORK_PROFILE_SCOPE("World transforms");
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	stats.levels = (unsigned int)levels.size();
+	stats.nodesUpdated = 0;
+	stats.threads = 1;
+	if (numDirty == 0) {	//Nothing moved: only clear what changed last time
+		if (stats.nodes > 0)
+			memset(&changed[0], 0, changed.size());
+		stats.updateSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		return;
+	}
+	unsigned int threads = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	std::vector<unsigned int> updated(threads);
+	for (size_t l = 0; l < levels.size(); l++) {
+		//Levels one after the other (a level needs the one above), the nodes of a big level split between threads
+		const std::vector<unsigned int>& nodes = levels[l];
+		size_t count = nodes.size();
+		unsigned int levelThreads = (unsigned int)std::min<size_t>(threads, std::max<size_t>(count / MIN_NODES_PER_THREAD, 1));
+		size_t chunk = (count + levelThreads - 1) / levelThreads;
+		stats.threads = std::max(stats.threads, levelThreads);
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < levelThreads; t++)
+			workers.push_back(std::thread(&WorldTransformCache::updateNodes, this, std::cref(nodes), std::min(count, t * chunk), std::min(count, (t + 1) * chunk), &updated[t]));
+		updateNodes(nodes, 0, std::min(count, chunk), &updated[0]);	//This thread does its share too
+		for (size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+		for (unsigned int t = 0; t < levelThreads; t++)
+			stats.nodesUpdated += updated[t];
+	}
+	numDirty = 0;
+	stats.updateSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
@@ -0,0 +1,92 @@
+/**********************************************************************
+NAME: WorldTransformCache
+DESCRIPTION: World matrices of a hierarchy of nodes (e.g. the scene nodes and virtual objects of a scene), computed once
+	per frame instead of every time someone asks for them. Asking a node for its world matrix usually multiplies all the
+	local matrices from the root down to it: in a deep hierarchy, the same parent chains are multiplied over and over
+	(by the RenderableVisitor, each renderable, the picking...).
+	Here, each node stores its local matrix and its world matrix (world = world of its parent * local), in arrays with
+	one entry per node (structure of arrays: the matrices of all the nodes next to each other, and their parents, levels
+	and flags in other arrays). Changing a local matrix only marks the node as dirty. update() then goes through the
+	hierarchy one level at a time (roots first), and recomputes the nodes that are dirty or whose parent changed: the
+	dirty flags propagate down the subtrees, and nodes that did not move cost nothing but a check.
+		- Nodes of the same level do not depend on each other, so big levels are split between several threads.
+		- The 4x4 multiplies use SSE (a column of the result is the parent's 4 columns, weighted by a column of the local matrix).
+	Nodes can be given an owner (e.g. their IVirtualObject), so the RenderableVisitor finds the matrix of each object it
+	visits (see RenderableVisitor::setWorldTransforms). It calls update() at the start of each frame.
+***********************************************************************/
+
+#ifndef _OPENGLFRAMEWORK_WORLDTRANSFORMCACHE
+#define _OPENGLFRAMEWORK_WORLDTRANSFORMCACHE
+#include "OpenGLFRameworkPrerequisites.h"
+#include <vector>
+#include <unordered_map>
+
+namespace OpenGLFramework {
+	class WorldTransformCache {
+	public:
+		static const unsigned int INVALID_NODE = 0xFFFFFFFF;		//Also "no parent"
+		//Starting a thread costs tens of microseconds, about as much as updating a couple of thousand nodes
+		static const size_t MIN_NODES_PER_THREAD = 2 * 1024;
+		struct Statistics {
+			unsigned int nodes;
+			unsigned int levels;				//Depth of the hierarchy
+			unsigned int nodesUpdated;			//World matrices recomputed by the last update
+			unsigned int threads;				//Most threads a level was split between, in the last update
+			double updateSeconds;
+		};
+	private:
+		//One entry per node (node handles are indices into these arrays; removed nodes are reused)
+		std::vector<glm::mat4> local, world;
+		std::vector<unsigned int> parent, level, children;
+		std::vector<unsigned int> slot;					//Position of the node in levels[level]
+		std::vector<unsigned char> dirty, changed, alive;
+		std::vector<const void*> owner;
+		//Nodes of each level of the hierarchy (level 0: roots)
+		std::vector<std::vector<unsigned int> > levels;
+		std::vector<unsigned int> freeNodes;
+		std::unordered_map<const void*, unsigned int> nodesByOwner;
+		size_t numDirty;
+		unsigned int maxThreads;
+		Statistics stats;
+		void updateNodes(const std::vector<unsigned int>& nodes, size_t begin, size_t end, unsigned int* updated);
+	public:
+		WorldTransformCache();
+		/**
+			Adds a node under parent (INVALID_NODE: a root), and returns its handle. owner (optional) lets findNode find it.
+		*/
+		unsigned int createNode(unsigned int parent = INVALID_NODE, const glm::mat4& localTransform = glm::mat4(1.0f), const void* owner = NULL);
+		/**
+			Removes a node without children (remove the children first). Returns false if it has children.
+		*/
+		bool removeNode(unsigned int node);
+		void setLocalTransform(unsigned int node, const glm::mat4& localTransform);
+		inline const glm::mat4& getLocalTransform(unsigned int node) const { return local[node]; }
+		/**
+			World matrix of the node, as computed by the last update().
+		*/
+		inline const glm::mat4& getWorldTransform(unsigned int node) const { return world[node]; }
+		/**
+			True if the world matrix of the node changed in the last update().
+		*/
+		inline bool wasUpdated(unsigned int node) const { return changed[node] != 0; }
+		inline unsigned int getParent(unsigned int node) const { return parent[node]; }
+		/**
+			Node created for this owner (INVALID_NODE if there is none).
+		*/
+		unsigned int findNode(const void* owner) const;
+		/**
+			Recomputes the world matrices of the dirty nodes and their subtrees.
+		*/
+		void update();
+		/**
+			Limits the threads used by update (0, the default: one per core).
+		*/
+		inline void setMaxThreads(unsigned int threads) { maxThreads = threads; }
+		inline const Statistics& getStatistics() const { return stats; }
+		/**
+			world = parent * local (both column major, as glm stores them), 4 floats at a time if SSE is available.
+		*/
+		static void multiply(const glm::mat4& parent, const glm::mat4& local, glm::mat4& world);
+	};
+};
+#endif